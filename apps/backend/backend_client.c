@@ -1360,7 +1360,10 @@ from_client_msg(clicon_handle        h,
 	clicon_err(OE_XML, errno, "cbuf_new");
 	goto done;
     }
-    /* Decode msg from client -> xml top (ct) and session id */
+    /* Decode msg from client -> xml top (ct) and session id 
+     * The request is short-lived: allocate it from an arena */
+    if ((xt = xml_new_arena("top", NULL)) == NULL)
+	goto done;
     if (clicon_msg_decode(msg, yspec, &id, &xt) < 0){
 	if (netconf_malformed_message(cbret, "XML parse error")< 0)
 	    goto done;
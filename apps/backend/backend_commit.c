@@ -81,6 +81,7 @@
  * are if code comes via XML/NETCONF.
  * @param[in]   yspec   Yang spec
  * @param[in]   td      Transaction data
+ * @param[in]   all     Validate all entries, not only new or changed
  * @param[out]  xret    Error XML tree. Free with xml_free after use
  * @retval     -1       Error
  * @retval      0       Validation failed (with cbret set)
@@ -90,6 +91,7 @@ static int
 generic_validate(clicon_handle       h,
 		 yang_stmt          *yspec,
 		 transaction_data_t *td,
+		 int                 all,
 		 cxobj             **xret)
 {
     int             retval = -1;
@@ -100,10 +102,12 @@ generic_validate(clicon_handle       h,
     int             ret;
 
     /* All entries */
-    if ((ret = xml_yang_validate_all_top(h, td->td_target, xret)) < 0) 
-	goto done;
-    if (ret == 0)
-	goto fail;
+    if (all){
+	if ((ret = xml_yang_validate_all_top(h, td->td_target, xret)) < 0) 
+	    goto done;
+	if (ret == 0)
+	    goto fail;
+    }
     /* changed entries */
     for (i=0; i<td->td_clen; i++){
 	x1 = td->td_scvec[i]; /* source changed */
@@ -233,7 +237,7 @@ startup_common(clicon_handle       h,
     /* 5. Make generic validation on all new or changed data.
        Note this is only call that uses 3-values */
     clicon_debug(1, "Validating startup %s", db);
-    if ((ret = generic_validate(h, yspec, td, &xret)) < 0)
+    if ((ret = generic_validate(h, yspec, td, 1, &xret)) < 0)
 	goto done;
     if (ret == 0){
 	if (clicon_xml2cbuf(cbret, xret, 0, 0, -1) < 0)
@@ -365,6 +369,9 @@ startup_commit(clicon_handle  h,
 	 goto done;
      if (ret == 0)
 	 goto fail;
+     /* Running is valid, a base for incremental validation, see xmldb_edit_base */
+     if (xmldb_validated(h, "running") < 0)
+	 goto done;
     /* 10. Call plugin transaction end callbacks */
     plugin_transaction_end(h, td);
     retval = 1;
@@ -405,11 +412,17 @@ from_validate_common(clicon_handle       h,
     int         i;
     cxobj      *xn;
     int         ret;
+    int         incr;
     
     if ((yspec = clicon_dbspec_yang(h)) == NULL){
 	clicon_err(OE_FATAL, 0, "No DB_SPEC");
 	goto done;
     }	
+    /* If candidate and running are edited from a common copy, only edited
+     * subtrees need to be compared, and only changes need to be validated
+     * since running is valid. Running is only known to be valid if it has
+     * been validated, not eg if it is read from file with -s none */
+    incr = xmldb_edit_base(h, "running", candidate);
     /* This is the state we are going to */
     if (xmldb_get0(h, candidate, NULL, "/", 0, &td->td_target, NULL) < 0)
 	goto done;
@@ -421,11 +434,14 @@ from_validate_common(clicon_handle       h,
      * here. It is being made in generic_validate below. 
      * But xml_diff requires some basic validation, at least check that yang-specs
      * have been assigned
+     * (Cached trees have yang-specs assigned)
      */
-    if ((ret = xml_yang_validate_all_top(h, td->td_target, xret)) < 0)
-	goto done;
-    if (ret == 0)
-	goto fail;
+    if (!incr){
+	if ((ret = xml_yang_validate_all_top(h, td->td_target, xret)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
+    }
 
     /* 2. Parse xml trees 
      * This is the state we are going from */
@@ -435,16 +451,29 @@ from_validate_common(clicon_handle       h,
     xml_apply0(td->td_src, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset,
 	       (void*)(XML_FLAG_MARK|XML_FLAG_CHANGE));
     /* 3. Compute differences */
-    if (xml_diff(yspec, 
-		 td->td_src,
-		 td->td_target,
-		 &td->td_dvec,      /* removed: only in running */
-		 &td->td_dlen,
-		 &td->td_avec,      /* added: only in candidate */
-		 &td->td_alen,
-		 &td->td_scvec,     /* changed: original values */
-		 &td->td_tcvec,     /* changed: wanted values */
-		 &td->td_clen) < 0)
+    if (incr){
+	if (xml_diff_edit(yspec, 
+			  td->td_src,
+			  td->td_target,
+			  &td->td_dvec,      /* removed: only in running */
+			  &td->td_dlen,
+			  &td->td_avec,      /* added: only in candidate */
+			  &td->td_alen,
+			  &td->td_scvec,     /* changed: original values */
+			  &td->td_tcvec,     /* changed: wanted values */
+			  &td->td_clen) < 0)
+	    goto done;
+    }
+    else if (xml_diff(yspec, 
+		      td->td_src,
+		      td->td_target,
+		      &td->td_dvec,      /* removed: only in running */
+		      &td->td_dlen,
+		      &td->td_avec,      /* added: only in candidate */
+		      &td->td_alen,
+		      &td->td_scvec,     /* changed: original values */
+		      &td->td_tcvec,     /* changed: wanted values */
+		      &td->td_clen) < 0)
 	goto done;
     if (debug>1)
 	transaction_print(stderr, td);
@@ -469,13 +498,24 @@ from_validate_common(clicon_handle       h,
 	xml_flag_set(xn, XML_FLAG_CHANGE);
 	xml_apply_ancestor(xn, (xml_applyfn_t*)xml_flag_set, (void*)XML_FLAG_CHANGE);
     }
+    /* Validate the target state affected by the changes */
+    if (incr){
+	if ((ret = xml_yang_validate_changed(h, yspec, td->td_target,
+					     td->td_avec, td->td_alen,
+					     td->td_dvec, td->td_dlen,
+					     td->td_tcvec, td->td_clen,
+					     xret)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
+    }
     /* 4. Call plugin transaction start callbacks */
     if (plugin_transaction_begin(h, td) < 0)
 	goto done;
 
     /* 5. Make generic validation on all new or changed data.
        Note this is only call that uses 3-values */
-    if ((ret = generic_validate(h, yspec, td, xret)) < 0)
+    if ((ret = generic_validate(h, yspec, td, !incr, xret)) < 0)
 	goto done;
     if (ret == 0)
 	goto fail;
@@ -553,7 +593,10 @@ candidate_commit(clicon_handle h,
 	     goto fail;
      }
      /* 8. Success: Copy candidate to running 
+      * Candidate is valid, so running and candidate get a common edit base
       */
+     if (xmldb_validated(h, candidate) < 0)
+	 goto done;
      if (xmldb_copy(h, candidate, "running") < 0)
 	 goto done;
      /* Here pointers to old (source) tree are obsolete */
@@ -229,6 +229,8 @@ xmldb_drop_priv(clicon_handle h,
 {
     int         retval = -1;
     char       *filename = NULL;
+    cbuf       *cb = NULL;
+    struct stat st;
 
     if (xmldb_db2file(h, db, &filename) < 0)
 	goto done;
@@ -236,8 +238,21 @@ xmldb_drop_priv(clicon_handle h,
 	clicon_err(OE_UNIX, errno, "chown");
 	goto done;
     }
+    /* Journal file of CLICON_XMLDB_FORMAT=journal, if any */
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    cprintf(cb, "%s.journal", filename);
+    if (lstat(cbuf_get(cb), &st) == 0 &&
+	chown(cbuf_get(cb), uid, gid) < 0){
+	clicon_err(OE_UNIX, errno, "chown");
+	goto done;
+    }
     retval = 0;
  done:
+    if (cb)
+	cbuf_free(cb);
     if (filename)
 	free(filename);
     return retval;
@@ -138,7 +138,11 @@ netconf_input_packet(clicon_handle h,
 	return -1;
     }
     str = str0;
-    /* Parse incoming XML message */
+    /* Parse incoming XML message. The request is short-lived: use an arena */
+    if ((xreq = xml_new_arena("top", NULL)) == NULL){
+	free(str0);
+	goto done;
+    }
     if (xml_parse_string(str, yspec, &xreq) < 0){ 
 	free(str0);
 	if (netconf_operation_failed(cbret, "rpc", clicon_err_reason)< 0)
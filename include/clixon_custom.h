@@ -58,3 +58,39 @@
  * on the top-level for the modules involved in the netconf operation.
  */
 #define IDENTITYREF_KLUDGE
+
+/*! Build a hash index of keyed list entries when a parent has at least this 
+ * many children.
+ * The index is used by xml_search (eg edit-config and xml_binsearch) for 
+ * constant-time lookup of list entries, instead of binary or linear search.
+ * Undefine to disable list key indexes.
+ */
+#define XML_LIST_INDEX_MIN 64
+
+/*! Number of parsed xpath expressions kept in the compiled xpath cache.
+ * Evaluated xpath strings are parsed once and then looked up by string, see
+ * xpath_compile.
+ * Undefine to disable the xpath cache.
+ */
+#define XPATH_CACHE_SIZE 1024
+
+/*! Resolve xpath steps selecting a config list entry by all its keys, such as 
+ * /x/y[a='42'], or a leaf-list entry by value, using binary search instead of
+ * evaluating predicates for every child, see xpath_list_optimize.
+ * Undefine to disable.
+ */
+#define XPATH_LIST_OPTIMIZE
+
+/*! Use the yang spec to prune descendant xpath searches, such as //name.
+ * Subtrees of containers and lists whose schema has no descendant called name
+ * are not searched, see yang_descendant_name.
+ * Undefine to disable.
+ */
+#define XPATH_DESCENDANT_SCHEMA
+
+/*! Minimum size in bytes of a datastore journal before it is compacted.
+ * With CLICON_XMLDB_FORMAT=journal, edits are appended to a journal file
+ * which is compacted into a new snapshot of the datastore when it grows 
+ * larger than both the snapshot and this size, see xmldb_journal_write.
+ */
+#define XMLDB_JOURNAL_MIN 65536
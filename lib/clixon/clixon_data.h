@@ -53,6 +53,9 @@
 typedef struct {
     uint32_t  de_id;  /* session id */
     cxobj    *de_xml; /* cache */
+    uint32_t  de_base;/* Edit base of cache, 0 if none, see xmldb_edit_base */
+    int       de_valid;/* Cache has been validated since last edit, see 
+                          xmldb_validated */
 } db_elmnt;
 
 /*
@@ -64,6 +64,9 @@ uint32_t xmldb_islocked(clicon_handle h, const char *db);
 int xmldb_exists(clicon_handle h, const char *db);
 int xmldb_delete(clicon_handle h, const char *db);
 int xmldb_create(clicon_handle h, const char *db);
+int xmldb_resident(clicon_handle h, const char *db, uint32_t *resident, uint32_t *total);
+int xmldb_edit_base(clicon_handle h, const char *db1, const char *db2);
+int xmldb_validated(clicon_handle h, const char *db);
 /* utility functions */
 int xmldb_db_reset(clicon_handle h, char *db);
 
@@ -31,16 +31,21 @@
 
   ***** END LICENSE BLOCK *****
 
-  * This file requires dirent.h
+  * This file requires sys/types.h, and dirent.h to use clicon_file_dirent
  */
 
 #ifndef _CLIXON_FILE_H_
 #define _CLIXON_FILE_H_
 
+struct dirent;
 
 int clicon_file_dirent(const char *dir, struct dirent **ent, 
 		       const char *regexp, mode_t type);
 
 int clicon_file_copy(char *src, char *target);
 
+int clicon_fsync_dir(const char *path);
+
+int clicon_file_read(int fd, char *endtag, char **bufp, size_t *lenp);
+
 #endif /* _CLIXON_FILE_H_ */
@@ -53,6 +53,12 @@ int clicon_hash_del (clicon_hash_t *head, const char *key);
 int clicon_hash_dump(clicon_hash_t *head, FILE *f);
 int clicon_hash_keys(clicon_hash_t *hash, char ***vector, size_t *nkeys);
 
+/* Initial value of FNV-1a hash, see clicon_hash_fnv1a */
+#define CLICON_HASH_FNV1A_INIT 2166136261U
+
+uint32_t clicon_hash_fnv1a(uint32_t h, const void *buf, size_t len);
+uint32_t clicon_hash_fnv1a_str(uint32_t h, const char *str);
+
 /*
  *   Macros to iterate over hash contents.
  *   XXX A bit crude. Just as easy for app to loop through the keys itself.
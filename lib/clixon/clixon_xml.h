@@ -82,6 +82,29 @@ enum cxobj_type {CX_ERROR=-1,
 
 typedef struct xml cxobj; /* struct defined in clicon_xml.c */
 
+/* Type of a cached list key value */
+enum xml_key_type {XK_NONE, /* Key leaf or its body missing */
+		   XK_INT,  /* Signed integer */
+		   XK_UINT, /* Unsigned integer */
+		   XK_STR,  /* String, compared bytewise */
+		   XK_CV};  /* Other types, compared with cv_cmp() */
+
+/*! Typed value of one key of a list entry, cached in the entry for xml_cmp
+ * @see xml_keys_set
+ */
+struct xml_key{
+    enum xml_key_type xk_type;
+    union {
+	int64_t       xk_int;
+	uint64_t      xk_uint;
+	struct {
+	    char     *xk_str;   /* Body of key leaf, not copied */
+	    size_t    xk_len;   /* Length of string */
+	}             xk_s;
+	cg_var       *xk_cv;    /* Cached cv of key leaf, see xml_cv() */
+    } xk_u;
+};
+
 /*! Callback function type for xml_apply 
  * @retval    -1    Error, aborted at first error encounter
  * @retval     0    OK, continue
@@ -99,6 +122,21 @@ typedef int (xml_applyfn_t)(cxobj *x, void *arg);
 #define XML_FLAG_CHANGE 0x08  /* Node is changed (commits) or child changed rec */
 #define XML_FLAG_NONE   0x10  /* Node is added as NONE */
 #define XML_FLAG_DEFAULT 0x20 /* Added as default value @see xml_default*/
+#define XML_FLAG_SORTED 0x40  /* Children verified sorted, reset when children
+                                change @see xml_sort_sorted */
+#define XML_FLAG_EDIT   0x100 /* Node or descendant edited since datastore base
+                                set with xml_edit_mark @see xml_diff_edit */
+
+/*
+ * xml_dsindex() and xml_dsdirty(): block index of the node record in a tree 
+ * datastore file, and whether the record needs to be written
+ * Dirty bits are only set on nodes with a record, ie of trees read from or 
+ * written to a tree datastore file.
+ */
+#define XML_DSINDEX_MASK   0x1fffffff /* Block index */
+#define XML_DSDIRTY_SELF   0x80000000 /* Record of node is changed */
+#define XML_DSDIRTY_DESC   0x40000000 /* Record of a descendant is changed */
+#define XML_DSDIRTY_RM     0x20000000 /* Children have been removed */
 
 /*
  * Prototypes
@@ -108,6 +146,7 @@ char     *xml_name(cxobj *xn);
 int       xml_name_set(cxobj *xn, char *name);
 char     *xml_prefix(cxobj *xn);
 int       xml_prefix_set(cxobj *xn, char *name);
+char     *xml_symbol_find(char *str);
 char     *nscache_get(cxobj *x, char *prefix);
 int       nscache_get_prefix(cxobj *x, char *namespace, char **prefix);
 cvec     *nscache_get_all(cxobj *x);
@@ -126,6 +165,17 @@ int       xml_parent_set(cxobj *xn, cxobj *parent);
 uint16_t  xml_flag(cxobj *xn, uint16_t flag);
 int       xml_flag_set(cxobj *xn, uint16_t flag);
 int       xml_flag_reset(cxobj *xn, uint16_t flag);
+int       xml_edit_mark(cxobj *x);
+int       xml_edit_removed(cxobj *x, cxobj *xc);
+int       xml_edit_reset(cxobj *x);
+int       xml_edit_nr(cxobj *x);
+cxobj    *xml_edit_i(cxobj *x, int i);
+int       xml_edit_removed_nr(cxobj *x);
+cxobj    *xml_edit_removed_i(cxobj *x, int i);
+uint32_t  xml_dsindex(cxobj *xn);
+int       xml_dsindex_set(cxobj *xn, uint32_t index);
+uint32_t  xml_dsdirty(cxobj *xn);
+int       xml_dsdirty_set(cxobj *xn);
 
 char     *xml_value(cxobj *xn);
 int       xml_value_set(cxobj *xn, char *val);
@@ -145,11 +195,18 @@ cxobj    *xml_child_each(cxobj *xparent, cxobj *xprev,  enum cxobj_type type);
 int       xml_child_insert_pos(cxobj *x, cxobj *xc, int i);
 int       xml_childvec_set(cxobj *x, int len);
 cxobj   **xml_childvec_get(cxobj *x);
+int       xml_child_sort(cxobj *x, int (*compar)(const void *, const void *));
 cxobj    *xml_new(char *name, cxobj *xn_parent, yang_stmt *spec);
+cxobj    *xml_new_arena(char *name, yang_stmt *spec);
 yang_stmt *xml_spec(cxobj *x);
 int       xml_spec_set(cxobj *x, yang_stmt *spec);
 cg_var   *xml_cv(cxobj *x);
 int       xml_cv_set(cxobj *x, cg_var *cv);
+struct xml_key *xml_keys(cxobj *x, int *len);
+int       xml_keys_set(cxobj *x, struct xml_key *keys, int len);
+int       xml_index_add(cxobj *xp, cxobj *x);
+cxobj    *xml_index_find(cxobj *xp, yang_stmt *y, struct xml_key *keys, int len);
+int       xml_index_nr(cxobj *xp);
 cxobj    *xml_find(cxobj *xn_parent, char *name);
 
 int       xml_addsub(cxobj *xp, cxobj *xc);
@@ -193,6 +250,7 @@ cxobj    *xml_dup(cxobj *x0);
 
 int       cxvec_dup(cxobj **vec0, size_t len0, cxobj ***vec1, size_t *len1);
 int       cxvec_append(cxobj *x, cxobj ***vec, size_t  *len);
+int       cxvec_append_max(cxobj *x, cxobj ***vec, size_t *len, size_t *max);
 int       xml_apply(cxobj *xn, enum cxobj_type type, xml_applyfn_t fn, void *arg);
 int       xml_apply0(cxobj *xn, enum cxobj_type type, xml_applyfn_t fn, void *arg);
 int       xml_apply_ancestor(cxobj *xn, xml_applyfn_t fn, void *arg);
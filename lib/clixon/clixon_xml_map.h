@@ -54,12 +54,19 @@ int xml_yang_validate_list_key_only(clicon_handle h, cxobj *xt, cxobj **xret);
 int xml_yang_validate_add(clicon_handle h, cxobj *xt, cxobj **xret);
 int xml_yang_validate_all(clicon_handle h, cxobj *xt, cxobj **xret);
 int xml_yang_validate_all_top(clicon_handle h, cxobj *xt, cxobj **xret);
+int xml_yang_validate_changed(clicon_handle h, yang_stmt *yspec, cxobj *xt,
+			      cxobj **avec, size_t alen, cxobj **dvec, size_t dlen,
+			      cxobj **cvec, size_t clen, cxobj **xret);
 int xml2cvec(cxobj *xt, yang_stmt *ys, cvec **cvv0);
 int cvec2xml_1(cvec *cvv, char *toptag, cxobj *xp, cxobj **xt0);
 int xml_diff(yang_stmt *yspec, cxobj *x0, cxobj *x1, 	 
 	     cxobj ***first, size_t *firstlen, 
 	     cxobj ***second, size_t *secondlen, 
 	     cxobj ***changed_x0, cxobj ***changed_x1, size_t *changedlen);
+int xml_diff_edit(yang_stmt *yspec, cxobj *x0, cxobj *x1, 	 
+		  cxobj ***first, size_t *firstlen, 
+		  cxobj ***second, size_t *secondlen, 
+		  cxobj ***changed_x0, cxobj ***changed_x1, size_t *changedlen);
 int yang2api_path_fmt(yang_stmt *ys, int inclkey, char **api_path_fmt);
 int api_path_fmt2api_path(char *api_path_fmt, cvec *cvv, char **api_path);
 int api_path_fmt2xpath(char *api_path_fmt, cvec *cvv, char **xpath);
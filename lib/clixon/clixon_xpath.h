@@ -123,7 +123,13 @@ int   xpath_tree_print(FILE *f, xpath_tree *xs);
 int   xpath_tree2cbuf(xpath_tree *xs, cbuf *xpathcb);
 int   xpath_tree_free(xpath_tree *xs);
 int   xpath_parse(char *xpath, xpath_tree **xptree);
+int   xpath_compile(char *xpath, xpath_tree **xptree);
+int   xpath_compile_free(xpath_tree *xptree);
+int   xpath_cache_flush(void);
+int   xpath_vec_compiled(cxobj *xcur, cvec *nsc, xpath_tree *xptree, xp_ctx **xrp);
 int   xpath_vec_ctx(cxobj *xcur, cvec *nsc, char *xpath, xp_ctx  **xrp);
+int   xpath_descendant_schema_set(int enable);
+int   xpath_descendant_stats(uint64_t *nvisit);
 
 #if defined(__GNUC__) && __GNUC__ >= 3
 int    xpath_vec_bool(cxobj *xcur, cvec *nsc, char *xpformat, ...) __attribute__ ((format (printf, 3, 4)));
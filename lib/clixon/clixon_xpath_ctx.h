@@ -74,6 +74,7 @@ struct xp_ctx{
     enum xp_objtype xc_type;
     cxobj         **xc_nodeset; /* if type XT_NODESET */
     size_t          xc_size;    /* Length of nodeset */
+    size_t          xc_max;     /* Allocated length of nodeset */
     int             xc_bool;    /* if xc_type XT_BOOL */
     double          xc_number;  /* if xc_type XT_NUMBER */
     char           *xc_string;  /* if xc_type XT_STRING */
@@ -81,9 +82,24 @@ struct xp_ctx{
     cxobj          *xc_initial; /* RFC 7960 10.1.1 extension: for current() */
     int             xc_descendant;  /* // */
     /* NYI: a set of variable bindings, set of namespace declarations */
+    struct xp_arena *xc_arena;  /* Arena if allocated by ctx_new in arena */
+    struct xp_ctx  *xc_next;    /* Arena free list */
 };
 typedef struct xp_ctx xp_ctx;
 
+/*! Per-evaluation arena of xpath contexts
+ * Contexts are allocated in blocks and freed contexts are reused, keeping
+ * their nodeset vectors. Everything is freed at once by ctx_arena_pop.
+ * @see ctx_arena_push
+ */
+struct xp_arena{
+    struct xp_arena       *xa_prev;   /* Enclosing arena */
+    struct xp_arena_block *xa_blocks; /* Context blocks, first is partially used */
+    int                    xa_used;   /* Used contexts in first block */
+    xp_ctx                *xa_free;   /* Free list of contexts */
+};
+typedef struct xp_arena xp_arena;
+
 /*
  * Variables
  */
@@ -92,6 +108,12 @@ extern const map_str2int ctxmap[];
 /*
  * Prototypes
  */
+int ctx_arena_set(int enable);
+int ctx_arena_push(xp_arena *xa);
+int ctx_arena_pop(xp_arena *xa);
+int ctx_stats(uint64_t *nalloc);
+xp_ctx *ctx_new(void);
+xp_ctx *ctx_detach(xp_ctx *xc);
 int ctx_free(xp_ctx *xc);
 xp_ctx *ctx_dup(xp_ctx *xc);
 int ctx_nodeset_replace(xp_ctx *xc, cxobj **vec, size_t veclen);
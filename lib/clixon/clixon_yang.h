@@ -182,6 +182,7 @@ char      *yang_find_mynamespace(yang_stmt *ys);
 int        yang_find_prefix_by_namespace(yang_stmt *ys, char *namespace, char **prefix);
 yang_stmt *yang_choice(yang_stmt *y);
 int        yang_order(yang_stmt *y);
+int        yang_descendant_name(yang_stmt *ys, char *name);
 int        yang_print(FILE *f, yang_stmt *yn);
 int        yang_print_cbuf(cbuf *cb, yang_stmt *yn, int marginal);
 int        if_feature(yang_stmt *yspec, char *module, char *feature);
@@ -77,6 +77,11 @@
 
 #include "clixon_datastore_write.h"
 #include "clixon_datastore_read.h"
+#include "clixon_datastore_journal.h"
+#include "clixon_datastore_tree.h"
+
+/* Last edit base given to a datastore cache, see xmldb_edit_base */
+static uint32_t _xmldb_base = 0;
 
 
 /*! Translate from symbolic database name to actual filename in file-system
@@ -160,13 +165,18 @@ xmldb_disconnect(clicon_handle h)
     size_t    klen;
     int       i;
     db_elmnt *de;
+    int       ret;
     
     if (clicon_hash_keys(clicon_db_elmnt(h), &keys, &klen) < 0)
 	goto done;
     for(i = 0; i < klen; i++) 
 	if ((de = clicon_hash_value(clicon_db_elmnt(h), keys[i], NULL)) != NULL){
 	    if (de->de_xml){
-		xml_free(de->de_xml);
+		/* A shared tree is freed with the last database using it */
+		if ((ret = xmldb_cache_shared(h, keys[i], de->de_xml)) < 0)
+		    goto done;
+		if (ret == 0)
+		    xml_free(de->de_xml);
 		de->de_xml = NULL;
 	    }
 	}
@@ -177,7 +187,98 @@ xmldb_disconnect(clicon_handle h)
     return retval;
 }
 
+/*! Set a new edit base of all databases whose cache is xt
+ * After this, edits to the cache of each database are marked relative to
+ * the common tree xt.
+ * @param[in]  h     Clicon handle
+ * @param[in]  xt    Cache XML tree
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+xmldb_edit_base_set(clicon_handle h,
+		    cxobj        *xt)
+{
+    int       retval = -1;
+    char    **keys = NULL;
+    size_t    klen;
+    int       i;
+    db_elmnt *de;
+
+    if (xml_edit_reset(xt) < 0)
+	goto done;
+    if (++_xmldb_base == 0) /* 0 is no base */
+	_xmldb_base++;
+    if (clicon_hash_keys(clicon_db_elmnt(h), &keys, &klen) < 0)
+	goto done;
+    for (i = 0; i < klen; i++)
+	if ((de = clicon_hash_value(clicon_db_elmnt(h), keys[i], NULL)) != NULL &&
+	    de->de_xml == xt)
+	    de->de_base = _xmldb_base;
+    retval = 0;
+ done:
+    if (keys)
+	free(keys);
+    return retval;
+}
+
+/*! Check if the differences of two databases are marked as edits
+ * Two databases copied from each other have a common edit base, and their
+ * caches are only different in subtrees marked with XML_FLAG_EDIT.
+ * A common edit base is only given by xmldb_copy of a validated database, and
+ * db1 must not have been edited since. Then db1 is valid and only the edits
+ * of db2 need to be validated.
+ * @param[in]  h     Clicon handle
+ * @param[in]  db1   First database, eg running
+ * @param[in]  db2   Second database, eg candidate
+ * @retval     1     Yes, trees of db1 and db2 can be diffed with xml_diff_edit
+ * @retval     0     No, xml_diff and full validation are needed
+ * @see xmldb_validated
+ */
+int
+xmldb_edit_base(clicon_handle h,
+		const char   *db1,
+		const char   *db2)
+{
+    db_elmnt *de1;
+    db_elmnt *de2;
+
+    if (clicon_datastore_cache(h) == DATASTORE_NOCACHE)
+	return 0;
+    if ((de1 = clicon_db_elmnt_get(h, db1)) == NULL || de1->de_xml == NULL ||
+	(de2 = clicon_db_elmnt_get(h, db2)) == NULL || de2->de_xml == NULL)
+	return 0;
+    return de1->de_valid && de1->de_base != 0 && de1->de_base == de2->de_base;
+}
+
+/*! Mark the cache of a database as validated
+ * Call this after a successful validation of the whole database, eg when it
+ * is committed. An edit of the database clears the mark.
+ * @param[in]  h     Clicon handle
+ * @param[in]  db    Database
+ * @retval     0     OK
+ * @retval    -1     Error
+ * @see xmldb_edit_base
+ */
+int
+xmldb_validated(clicon_handle h,
+		const char   *db)
+{
+    db_elmnt *de;
+
+    if ((de = clicon_db_elmnt_get(h, db)) != NULL && de->de_xml != NULL){
+	de->de_valid = 1;
+	if (clicon_db_elmnt_set(h, db, de) < 0)
+	    return -1;
+    }
+    return 0;
+}
+
 /*! Copy database from db1 to db2
+ * The cache of db2 shares the cache tree of db1, which is copied by 
+ * xmldb_cache_unshare when one of them is modified.
+ * If db1 is validated, so is db2, and both databases get a new edit base, 
+ * see xmldb_edit_base. Otherwise db2 gets no edit base.
  * @param[in]  h     Clicon handle
  * @param[in]  from  Source database
  * @param[in]  to    Destination database
@@ -197,6 +298,7 @@ xmldb_copy(clicon_handle h,
     db_elmnt            de0 = {0,};
     cxobj              *x1 = NULL;  /* from */
     cxobj              *x2 = NULL;  /* to */
+    int                 ret;
 
     /* XXX lock */
     if (clicon_datastore_cache(h) != DATASTORE_NOCACHE){
@@ -204,35 +306,31 @@ xmldb_copy(clicon_handle h,
 	/* 1. "to" xml tree in x1 */
 	if ((de1 = clicon_db_elmnt_get(h, from)) != NULL)
 	    x1 = de1->de_xml;
+	/* Subtrees of a lazily read datastore are copied too */
+	if (x1 && xmldb_load(h, from, x1, NULL) < 0)
+	    goto done;
 	if ((de2 = clicon_db_elmnt_get(h, to)) != NULL)
 	    x2 = de2->de_xml;
-	if (x1 == NULL && x2 == NULL){
-	    /* do nothing */
-	}
-	else if (x1 == NULL){  /* free x2 and set to NULL */
-	    xml_free(x2);
-	    x2 = NULL;
-	}
-	else  if (x2 == NULL){ /* create x2 and copy from x1 */
-	    if ((x2 = xml_new(xml_name(x1), NULL, xml_spec(x1))) == NULL)
-		goto done;
-	    if (xml_copy(x1, x2) < 0) 
-		goto done;
-	}
-	else{ /* copy x1 to x2 */
-	    xml_free(x2);
-	    if ((x2 = xml_new(xml_name(x1), NULL, xml_spec(x1))) == NULL)
-		goto done;
-	    if (xml_copy(x1, x2) < 0) 
+	/* free x2 unless shared, and share x1 */
+	if (x2 && x2 != x1){
+	    if ((ret = xmldb_cache_shared(h, to, x2)) < 0)
 		goto done;
+	    if (ret == 0)
+		xml_free(x2);
 	}
+	x2 = x1;
 	/* always set cache although not strictly necessary in case 1
 	 * above, but logic gets complicated due to differences with
 	 * de and de->de_xml */
 	if (de2)
 	    de0 = *de2;
 	de0.de_xml = x2; /* The new tree */
+	de0.de_valid = (de1 = clicon_db_elmnt_get(h, from)) != NULL && de1->de_valid;
+	de0.de_base = 0;
 	clicon_db_elmnt_set(h, to, &de0);
+	/* Only a valid tree is a base for incremental validation */
+	if (x2 && de0.de_valid && xmldb_edit_base_set(h, x2) < 0)
+	    goto done;
     }
     /* Copy the files themselves (above only in-memory cache) */
     if (xmldb_db2file(h, from, &fromfile) < 0)
@@ -241,6 +339,12 @@ xmldb_copy(clicon_handle h,
 	goto done;
     if (clicon_file_copy(fromfile, tofile) < 0)
 	goto done;
+    if (datastore_tree_forget(tofile) < 0)
+	goto done;
+    /* Journal format: edits since the snapshot are in a separate file */
+    if (xmldb_journal_format(h) &&
+	xmldb_journal_copy(fromfile, tofile) < 0)
+	goto done;
     retval = 0;
  done:
     if (fromfile)
@@ -385,13 +489,19 @@ xmldb_delete(clicon_handle h,
     db_elmnt           *de = NULL;
     cxobj              *xt = NULL;
     struct stat         sb;
+    int                 ret;
     
     if (clicon_datastore_cache(h) != DATASTORE_NOCACHE){
 	if ((de = clicon_db_elmnt_get(h, db)) != NULL){
 	    if ((xt = de->de_xml) != NULL){
-		xml_free(xt);
+		if ((ret = xmldb_cache_shared(h, db, xt)) < 0)
+		    goto done;
+		if (ret == 0)
+		    xml_free(xt);
 		de->de_xml = NULL;
 	    }
+	    de->de_base = 0;
+	    de->de_valid = 0;
 	}
     }
     if (xmldb_db2file(h, db, &filename) < 0)
@@ -401,6 +511,11 @@ xmldb_delete(clicon_handle h,
 	    clicon_err(OE_DB, errno, "truncate %s", filename);
 	    goto done;
 	}
+    if (datastore_tree_forget(filename) < 0)
+	goto done;
+    if (xmldb_journal_format(h) &&
+	xmldb_journal_remove(filename) < 0)
+	goto done;
     retval = 0;
  done:
     if (filename)
@@ -408,6 +523,38 @@ xmldb_delete(clicon_handle h,
     return retval;
 }
 
+/*! Get nr of blocks of a tree datastore file that are read into memory
+ * With CLICON_XMLDB_LAZY, top-level subtrees are only read when accessed.
+ * @param[in]  h         Clicon handle
+ * @param[in]  db        Database
+ * @param[out] resident  Nr of blocks of file read into XML
+ * @param[out] total     Nr of blocks in file not known to be free
+ * @retval     1         OK
+ * @retval     0         Not a tree datastore, or not read
+ * @retval    -1         Error
+ */
+int
+xmldb_resident(clicon_handle h,
+	       const char   *db,
+	       uint32_t     *resident,
+	       uint32_t     *total)
+{
+    int   retval = -1;
+    char *filename = NULL;
+    char *format;
+
+    if ((format = clicon_option_str(h, "CLICON_XMLDB_FORMAT")) == NULL ||
+	strcmp(format, "tree") != 0)
+	return 0;
+    if (xmldb_db2file(h, db, &filename) < 0)
+	goto done;
+    retval = datastore_tree_stats(filename, resident, total);
+ done:
+    if (filename)
+	free(filename);
+    return retval;
+}
+
 /*! Create a database. Open database for writing.
  * @param[in]  h   Clicon handle
  * @param[in]  db  Database
@@ -423,13 +570,19 @@ xmldb_create(clicon_handle h,
     int                 fd = -1;
     db_elmnt           *de = NULL;
     cxobj              *xt = NULL;
+    int                 ret;
 
     if (clicon_datastore_cache(h) != DATASTORE_NOCACHE){ 
 	if ((de = clicon_db_elmnt_get(h, db)) != NULL){
 	    if ((xt = de->de_xml) != NULL){
-		xml_free(xt);
+		if ((ret = xmldb_cache_shared(h, db, xt)) < 0)
+		    goto done;
+		if (ret == 0)
+		    xml_free(xt);
 		de->de_xml = NULL;
 	    }
+	    de->de_base = 0;
+	    de->de_valid = 0;
 	}
     }
     if (xmldb_db2file(h, db, &filename) < 0)
@@ -438,6 +591,8 @@ xmldb_create(clicon_handle h,
 	clicon_err(OE_UNIX, errno, "open(%s)", filename);
 	goto done;
     }
+    if (datastore_tree_forget(filename) < 0)
+	goto done;
    retval = 0;
  done:
     if (filename)
@@ -0,0 +1,662 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2009-2019 Olof Hagsand and Benny Holmgren
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2,
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ *
+ * Datastore write-ahead journal
+ * With CLICON_XMLDB_FORMAT=journal, the datastore file <db> is an XML snapshot
+ * and every xmldb_put appends the edit to <db>.journal instead of rewriting
+ * the snapshot. When the journal grows larger than the snapshot (and at least
+ * XMLDB_JOURNAL_MIN) a new snapshot is written and the journal is removed.
+ * The journal is replayed on top of the snapshot when the datastore is read.
+ *
+ * Crash safety:
+ * - A new snapshot is written to <db>.tmp and renamed to <db>. The journal
+ *   header binds it to the inode, size and mtime of the snapshot, so that a
+ *   journal left from before the rename is ignored.
+ * - Each record has a length and checksum. A truncated or corrupt tail (eg an
+ *   append interrupted by a crash) is cut off the journal when it is replayed,
+ *   so that later records are appended after the last valid record.
+ * - Journal appends are synced with fsync, and the directory is synced after
+ *   a journal is created or a snapshot is renamed.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <syslog.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clicon */
+#include "clixon_err.h"
+#include "clixon_string.h"
+#include "clixon_queue.h"
+#include "clixon_hash.h"
+#include "clixon_handle.h"
+#include "clixon_log.h"
+#include "clixon_file.h"
+#include "clixon_yang.h"
+#include "clixon_xml.h"
+#include "clixon_xml_sort.h"
+#include "clixon_options.h"
+#include "clixon_xml_nsctx.h"
+#include "clixon_xml_map.h"
+
+#include "clixon_datastore_write.h"
+#include "clixon_datastore_journal.h"
+
+/*! FNV-1a 32-bit checksum of a journal record
+ */
+static uint32_t
+journal_checksum(char  *buf,
+		 size_t len)
+{
+    return clicon_hash_fnv1a(CLICON_HASH_FNV1A_INIT, buf, len);
+}
+
+/*! Get journal filename of a datastore file
+ * @param[in]  dbfile   Datastore filename
+ * @param[out] journal  Journal filename. Free after use
+ */
+static int
+journal_file(char  *dbfile,
+	     char **journal)
+{
+    int    retval = -1;
+    size_t len;
+
+    len = strlen(dbfile) + strlen(XMLDB_JOURNAL_SUFFIX) + 1;
+    if ((*journal = malloc(len)) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    snprintf(*journal, len, "%s%s", dbfile, XMLDB_JOURNAL_SUFFIX);
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Cut off a truncated or corrupt tail of a journal
+ * @param[in]  journal  Journal filename
+ * @param[in]  off      Offset of first invalid record
+ * @retval     0        OK
+ * @retval    -1        Error
+ */
+static int
+journal_truncate(char  *journal,
+		 size_t off)
+{
+    int retval = -1;
+    int fd = -1;
+
+    if ((fd = open(journal, O_WRONLY)) < 0){
+	clicon_err(OE_UNIX, errno, "open(%s)", journal);
+	goto done;
+    }
+    if (ftruncate(fd, off) < 0 || fsync(fd) < 0){
+	clicon_err(OE_UNIX, errno, "ftruncate(%s)", journal);
+	goto done;
+    }
+    retval = 0;
+ done:
+    if (fd != -1)
+	close(fd);
+    return retval;
+}
+
+/*! Print journal header binding the journal to a snapshot file
+ * @param[in]  cb   Buffer to print header to
+ * @param[in]  st   Status of snapshot file
+ */
+static int
+journal_header(cbuf        *cb,
+	       struct stat *st)
+{
+    cprintf(cb, "%s %llu %lld %lld\n", XMLDB_JOURNAL_MAGIC,
+	    (unsigned long long)st->st_ino,
+	    (long long)st->st_size,
+	    (long long)st->st_mtime);
+    return 0;
+}
+
+/*! Read a journal and check that its header matches the snapshot file
+ * @param[in]  dbfile   Datastore (snapshot) filename
+ * @param[in]  journal  Journal filename
+ * @param[out] bufp     Malloced journal contents if valid. Free after use
+ * @param[out] lenp     Length of journal
+ * @param[out] offp     Offset of first record after header
+ * @retval     1        Journal exists and is valid for snapshot
+ * @retval     0        No journal, or journal is stale
+ * @retval    -1        Error
+ */
+static int
+journal_read(char   *dbfile,
+	     char   *journal,
+	     char  **bufp,
+	     size_t *lenp,
+	     size_t *offp)
+{
+    int         retval = -1;
+    int         fd = -1;
+    struct stat st;
+    cbuf       *cb = NULL;
+    char       *buf = NULL;
+    size_t      len = 0;
+
+    if ((fd = open(journal, O_RDONLY)) < 0){
+	if (errno == ENOENT)
+	    goto stale;
+	clicon_err(OE_UNIX, errno, "open(%s)", journal);
+	goto done;
+    }
+    if (stat(dbfile, &st) < 0)
+	goto stale;
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_XML, errno, "cbuf_new");
+	goto done;
+    }
+    journal_header(cb, &st);
+    if (clicon_file_read(fd, NULL, &buf, &len) < 0)
+	goto done;
+    if (len < cbuf_len(cb) ||
+	strncmp(buf, cbuf_get(cb), cbuf_len(cb)) != 0){
+	clicon_debug(1, "%s: %s stale, ignored", __FUNCTION__, journal);
+	goto stale;
+    }
+    *offp = cbuf_len(cb);
+    *lenp = len;
+    *bufp = buf;
+    buf = NULL;
+    retval = 1;
+ done:
+    if (buf)
+	free(buf);
+    if (cb)
+	cbuf_free(cb);
+    if (fd != -1)
+	close(fd);
+    return retval;
+ stale:
+    retval = 0;
+    goto done;
+}
+
+/*! Check if datastores use the journal format
+ * @param[in]  h   Clicon handle
+ * @retval     1   CLICON_XMLDB_FORMAT is journal
+ * @retval     0   Other format
+ */
+int
+xmldb_journal_format(clicon_handle h)
+{
+    char *format;
+
+    if ((format = clicon_option_str(h, "CLICON_XMLDB_FORMAT")) == NULL)
+	return 0;
+    return strcmp(format, "journal") == 0;
+}
+
+/*! Make a journal record of an edit as given to xmldb_put
+ * Namespace declarations in scope of x1 (eg on an enclosing rpc) are added to
+ * the top-level element of the record, so that it can be parsed on its own.
+ * @param[in]  x1    Modification xml tree, top-level is "config"
+ * @param[in]  op    Top-level operation
+ * @param[out] cbp   Journal record. Free with cbuf_free
+ * @retval     0     OK
+ * @retval    -1     Error
+ * @note Must be made before text_modify, which may modify x1
+ */
+int
+xmldb_journal_record(cxobj             *x1,
+		     enum operation_type op,
+		     cbuf             **cbp)
+{
+    int    retval = -1;
+    cbuf  *cb = NULL;
+    cbuf  *cbx = NULL;
+    cvec  *nsc = NULL;
+    cg_var *cv = NULL;
+    cxobj *xc;
+    char  *prefix;
+
+    if ((cbx = cbuf_new()) == NULL){
+	clicon_err(OE_XML, errno, "cbuf_new");
+	goto done;
+    }
+    if (xml_nsctx_node(x1, &nsc) < 0)
+	goto done;
+    if (xml_prefix(x1))
+	cprintf(cbx, "<%s:%s", xml_prefix(x1), xml_name(x1));
+    else
+	cprintf(cbx, "<%s", xml_name(x1));
+    /* Inherited namespace declarations not declared on x1 itself */
+    while ((cv = cvec_each(nsc, cv)) != NULL){
+	if ((prefix = cv_name_get(cv)) == NULL){
+	    if (xml_find_type(x1, NULL, "xmlns", CX_ATTR) == NULL)
+		cprintf(cbx, " xmlns=\"%s\"", cv_string_get(cv));
+	}
+	else if (xml_find_type(x1, "xmlns", prefix, CX_ATTR) == NULL)
+	    cprintf(cbx, " xmlns:%s=\"%s\"", prefix, cv_string_get(cv));
+    }
+    xc = NULL;
+    while ((xc = xml_child_each(x1, xc, CX_ATTR)) != NULL)
+	if (clicon_xml2cbuf(cbx, xc, 0, 0, -1) < 0)
+	    goto done;
+    cprintf(cbx, ">");
+    xc = NULL;
+    while ((xc = xml_child_each(x1, xc, -1)) != NULL)
+	if (xml_type(xc) != CX_ATTR &&
+	    clicon_xml2cbuf(cbx, xc, 0, 0, -1) < 0)
+	    goto done;
+    if (xml_prefix(x1))
+	cprintf(cbx, "</%s:%s>", xml_prefix(x1), xml_name(x1));
+    else
+	cprintf(cbx, "</%s>", xml_name(x1));
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_XML, errno, "cbuf_new");
+	goto done;
+    }
+    cprintf(cb, "%d %s %08x\n%s\n", cbuf_len(cbx), xml_operation2str(op),
+	    journal_checksum(cbuf_get(cbx), cbuf_len(cbx)),
+	    cbuf_get(cbx));
+    *cbp = cb;
+    cb = NULL;
+    retval = 0;
+ done:
+    if (nsc)
+	xml_nsctx_free(nsc);
+    if (cbx)
+	cbuf_free(cbx);
+    if (cb)
+	cbuf_free(cb);
+    return retval;
+}
+
+/*! Write a new snapshot of the datastore and remove its journal
+ * The snapshot is written to a temporary file which is renamed to dbfile.
+ * @param[in]  h       Clicon handle
+ * @param[in]  dbfile  Datastore filename
+ * @param[in]  journal Journal filename
+ * @param[in]  x0      Datastore xml tree
+ */
+static int
+journal_snapshot(clicon_handle h,
+		 char         *dbfile,
+		 char         *journal,
+		 cxobj        *x0)
+{
+    int    retval = -1;
+    cbuf  *cb = NULL;
+    FILE  *f = NULL;
+
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_XML, errno, "cbuf_new");
+	goto done;
+    }
+    cprintf(cb, "%s.tmp", dbfile);
+    if ((f = fopen(cbuf_get(cb), "w")) == NULL){
+	clicon_err(OE_CFG, errno, "Creating file %s", cbuf_get(cb));
+	goto done;
+    }
+    if (clicon_xml2file(f, x0, 0, clicon_option_bool(h, "CLICON_XMLDB_PRETTY")) < 0)
+	goto done;
+    if (fflush(f) != 0 || fsync(fileno(f)) < 0){
+	clicon_err(OE_UNIX, errno, "fsync(%s)", cbuf_get(cb));
+	goto done;
+    }
+    fclose(f);
+    f = NULL;
+    /* After rename the journal is stale, since the header does not match */
+    if (rename(cbuf_get(cb), dbfile) < 0){
+	clicon_err(OE_UNIX, errno, "rename(%s)", dbfile);
+	goto done;
+    }
+    if (unlink(journal) < 0 && errno != ENOENT){
+	clicon_err(OE_UNIX, errno, "unlink(%s)", journal);
+	goto done;
+    }
+    if (clicon_fsync_dir(dbfile) < 0)
+	goto done;
+    retval = 0;
+ done:
+    if (f)
+	fclose(f);
+    if (cb)
+	cbuf_free(cb);
+    return retval;
+}
+
+/*! Write an edit of a datastore to its journal, or write a new snapshot
+ * The record is appended to the journal if it is valid for the snapshot.
+ * If there is no valid journal, a new journal is started.
+ * A new snapshot is written instead if there is no record or no snapshot, or
+ * if the journal would grow larger than the snapshot and XMLDB_JOURNAL_MIN.
+ * @param[in]  h       Clicon handle
+ * @param[in]  dbfile  Datastore filename
+ * @param[in]  cbj     Journal record made by xmldb_journal_record, or NULL
+ * @param[in]  x0      Datastore xml tree after the edit
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+int
+xmldb_journal_write(clicon_handle h,
+		    char         *dbfile,
+		    cbuf         *cbj,
+		    cxobj        *x0)
+{
+    int         retval = -1;
+    char       *journal = NULL;
+    struct stat st;
+    struct stat stj;
+    cbuf       *cb = NULL;
+    int         fd = -1;
+    size_t      jlen;
+    size_t      max;
+    int         valid = 0;
+    char        buf[128];
+    ssize_t     n;
+
+    if (journal_file(dbfile, &journal) < 0)
+	goto done;
+    if (cbj == NULL || stat(dbfile, &st) < 0)
+	goto snapshot;
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_XML, errno, "cbuf_new");
+	goto done;
+    }
+    journal_header(cb, &st);
+    /* Check the journal header only, the records are not read */
+    jlen = cbuf_len(cb);
+    if ((fd = open(journal, O_RDONLY)) >= 0){
+	if (fstat(fd, &stj) == 0 &&
+	    (n = read(fd, buf, sizeof(buf))) >= (ssize_t)cbuf_len(cb) &&
+	    strncmp(buf, cbuf_get(cb), cbuf_len(cb)) == 0){
+	    valid = 1;
+	    jlen = stj.st_size;
+	}
+	close(fd);
+	fd = -1;
+    }
+    max = st.st_size > XMLDB_JOURNAL_MIN ? st.st_size : XMLDB_JOURNAL_MIN;
+    if (jlen + cbuf_len(cbj) > max)
+	goto snapshot;
+    if (valid){
+	if ((fd = open(journal, O_WRONLY|O_APPEND)) < 0){
+	    clicon_err(OE_UNIX, errno, "open(%s)", journal);
+	    goto done;
+	}
+	cbuf_reset(cb);
+    }
+    else if ((fd = open(journal, O_WRONLY|O_CREAT|O_TRUNC, st.st_mode & 0777)) < 0){
+	clicon_err(OE_UNIX, errno, "open(%s)", journal);
+	goto done;
+    }
+    /* Header (if new) and record are written in one write(2) */
+    cprintf(cb, "%s", cbuf_get(cbj));
+    if (write(fd, cbuf_get(cb), cbuf_len(cb)) != cbuf_len(cb)){
+	clicon_err(OE_UNIX, errno, "write(%s)", journal);
+	goto done;
+    }
+    if (fsync(fd) < 0){
+	clicon_err(OE_UNIX, errno, "fsync(%s)", journal);
+	goto done;
+    }
+    if (!valid && clicon_fsync_dir(journal) < 0)
+	goto done;
+ ok:
+    retval = 0;
+ done:
+    if (fd != -1)
+	close(fd);
+    if (cb)
+	cbuf_free(cb);
+    if (journal)
+	free(journal);
+    return retval;
+ snapshot:
+    if (journal_snapshot(h, dbfile, journal, x0) < 0)
+	goto done;
+    goto ok;
+}
+
+/*! Replay the journal of a datastore file on its snapshot tree
+ * Records are applied in order with the operation they were written with.
+ * A stale journal is ignored. A truncated or corrupt record ends the replay,
+ * and it and any records after it are cut off the journal.
+ * @param[in]  h       Clicon handle
+ * @param[in]  dbfile  Datastore filename
+ * @param[in]  yspec   Top-level yang spec
+ * @param[in]  x0      Datastore xml tree read from snapshot, top is "config"
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+int
+xmldb_journal_replay(clicon_handle h,
+		     char         *dbfile,
+		     yang_stmt    *yspec,
+		     cxobj        *x0)
+{
+    int                 retval = -1;
+    char               *journal = NULL;
+    char               *buf = NULL;
+    size_t              len = 0;
+    size_t              i = 0;
+    unsigned long       rlen;
+    char                opstr[16];
+    unsigned int        sum;
+    int                 n;
+    char               *rec;
+    enum operation_type op;
+    cxobj              *xt = NULL;
+    cbuf               *cbret = NULL;
+    int                 ret;
+    int                 nr = 0;
+
+    if (journal_file(dbfile, &journal) < 0)
+	goto done;
+    if ((ret = journal_read(dbfile, journal, &buf, &len, &i)) < 0)
+	goto done;
+    if (ret == 0)
+	goto ok;
+    if ((cbret = cbuf_new()) == NULL){
+	clicon_err(OE_XML, errno, "cbuf_new");
+	goto done;
+    }
+    while (i < len){
+	/* Record header: <len> <operation> <checksum>\n */
+	n = 0;
+	if (sscanf(buf+i, "%lu %15s %x\n%n", &rlen, opstr, &sum, &n) != 3 ||
+	    n == 0 ||
+	    rlen + 1 > len - i - n ||
+	    buf[i+n+rlen] != '\n'){
+	    clicon_log(LOG_WARNING, "%s: %s: truncated record at offset %zu, removed",
+		       __FUNCTION__, journal, i);
+	    if (journal_truncate(journal, i) < 0)
+		goto done;
+	    break;
+	}
+	rec = buf+i+n;
+	if (journal_checksum(rec, rlen) != sum){
+	    clicon_log(LOG_WARNING, "%s: %s: checksum mismatch at offset %zu, removed",
+		       __FUNCTION__, journal, i);
+	    if (journal_truncate(journal, i) < 0)
+		goto done;
+	    break;
+	}
+	rec[rlen] = '\0';
+	i += n + rlen + 1;
+	if (xml_operation(opstr, &op) < 0)
+	    goto done;
+	if (xml_parse_string(rec, yspec, &xt) < 0)
+	    goto done;
+	if (xml_rootchild(xt, 0, &xt) < 0)
+	    goto done;
+	/* Same as for an edit-config, see from_client_edit_config */
+	xml_spec_set(xt, NULL);
+	if (xml_apply(xt, CX_ELMNT, xml_spec_populate, yspec) < 0)
+	    goto done;
+	if (xml_apply0(xt, CX_ELMNT, xml_sort, h) < 0)
+	    goto done;
+	cbuf_reset(cbret);
+	if ((ret = xmldb_put_tree(h, x0, xt, yspec, op, cbret)) < 0)
+	    goto done;
+	if (ret == 0)
+	    clicon_log(LOG_WARNING, "%s: %s: record at offset %zu failed: %s",
+		       __FUNCTION__, journal, i, cbuf_get(cbret));
+	xml_free(xt);
+	xt = NULL;
+	nr++;
+    }
+    clicon_debug(1, "%s: %s: %d records", __FUNCTION__, journal, nr);
+ ok:
+    retval = 0;
+ done:
+    if (xt)
+	xml_free(xt);
+    if (cbret)
+	cbuf_free(cbret);
+    if (buf)
+	free(buf);
+    if (journal)
+	free(journal);
+    return retval;
+}
+
+/*! Copy the journal of a datastore file to another datastore file
+ * Call after the snapshot has been copied. Any journal of tofile is removed
+ * and a valid journal of fromfile is copied, bound to the new snapshot.
+ * @param[in]  fromfile  Source datastore filename
+ * @param[in]  tofile    Destination datastore filename
+ * @retval     0         OK
+ * @retval    -1         Error
+ */
+int
+xmldb_journal_copy(char *fromfile,
+		   char *tofile)
+{
+    int         retval = -1;
+    char       *fromj = NULL;
+    char       *toj = NULL;
+    char       *buf = NULL;
+    size_t      len = 0;
+    size_t      off = 0;
+    struct stat st;
+    cbuf       *cb = NULL;
+    int         fd = -1;
+    int         ret;
+
+    if (xmldb_journal_remove(tofile) < 0)
+	goto done;
+    if (journal_file(fromfile, &fromj) < 0)
+	goto done;
+    if ((ret = journal_read(fromfile, fromj, &buf, &len, &off)) < 0)
+	goto done;
+    if (ret == 0)
+	goto ok;
+    if (stat(tofile, &st) < 0){
+	clicon_err(OE_UNIX, errno, "stat(%s)", tofile);
+	goto done;
+    }
+    if (journal_file(tofile, &toj) < 0)
+	goto done;
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_XML, errno, "cbuf_new");
+	goto done;
+    }
+    journal_header(cb, &st);
+    if ((fd = open(toj, O_WRONLY|O_CREAT|O_TRUNC, st.st_mode & 0777)) < 0){
+	clicon_err(OE_UNIX, errno, "open(%s)", toj);
+	goto done;
+    }
+    if (write(fd, cbuf_get(cb), cbuf_len(cb)) != cbuf_len(cb) ||
+	write(fd, buf+off, len-off) != len-off){
+	clicon_err(OE_UNIX, errno, "write(%s)", toj);
+	goto done;
+    }
+    if (fsync(fd) < 0){
+	clicon_err(OE_UNIX, errno, "fsync(%s)", toj);
+	goto done;
+    }
+    if (clicon_fsync_dir(toj) < 0)
+	goto done;
+ ok:
+    retval = 0;
+ done:
+    if (fd != -1)
+	close(fd);
+    if (cb)
+	cbuf_free(cb);
+    if (buf)
+	free(buf);
+    if (fromj)
+	free(fromj);
+    if (toj)
+	free(toj);
+    return retval;
+}
+
+/*! Remove the journal of a datastore file, if any
+ * @param[in]  dbfile  Datastore filename
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+int
+xmldb_journal_remove(char *dbfile)
+{
+    int   retval = -1;
+    char *journal = NULL;
+
+    if (journal_file(dbfile, &journal) < 0)
+	goto done;
+    if (unlink(journal) < 0 && errno != ENOENT){
+	clicon_err(OE_UNIX, errno, "unlink(%s)", journal);
+	goto done;
+    }
+    retval = 0;
+ done:
+    if (journal)
+	free(journal);
+    return retval;
+}
@@ -0,0 +1,64 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+ 
+  Copyright (C) 2009-2019 Olof Hagsand and Benny Holmgren
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, 
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ *
+ * Datastore write-ahead journal
+ */
+
+#ifndef _CLIXON_DATASTORE_JOURNAL_H_
+#define _CLIXON_DATASTORE_JOURNAL_H_
+
+/*
+ * Constants and macros
+ */
+/* The journal of a datastore file <db> is named <db>.journal
+ * It starts with a header line binding it to one version of the snapshot:
+ *   clixon-journal <inode> <size> <mtime>\n
+ * followed by records, each an edit as given to xmldb_put:
+ *   <len> <operation> <checksum>\n<xml of len bytes>\n
+ * where checksum is fnv-1a 32-bit of the xml in hex.
+ */
+#define XMLDB_JOURNAL_SUFFIX ".journal"
+#define XMLDB_JOURNAL_MAGIC  "clixon-journal"
+
+/*
+ * Prototypes
+ */
+int xmldb_journal_format(clicon_handle h);
+int xmldb_journal_record(cxobj *x1, enum operation_type op, cbuf **cbp);
+int xmldb_journal_write(clicon_handle h, char *dbfile, cbuf *cbj, cxobj *x0);
+int xmldb_journal_replay(clicon_handle h, char *dbfile, yang_stmt *yspec, cxobj *x0);
+int xmldb_journal_copy(char *fromfile, char *tofile);
+int xmldb_journal_remove(char *dbfile);
+
+#endif  /* _CLIXON_DATASTORE_JOURNAL_H_ */
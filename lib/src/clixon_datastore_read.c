@@ -69,6 +69,7 @@
 #include "clixon_data.h"
 #include "clixon_xpath_ctx.h"
 #include "clixon_xpath.h"
+#include "clixon_xpath_optimize.h"
 #include "clixon_json.h"
 #include "clixon_nacm.h"
 #include "clixon_netconf_lib.h"
@@ -79,6 +80,7 @@
 #include "clixon_datastore.h"
 #include "clixon_datastore_read.h"
 #include "clixon_datastore_tree.h"
+#include "clixon_datastore_journal.h"
 
 #define handle(xh) (assert(text_handle_check(xh)==0),(struct text_handle *)(xh))
 
@@ -208,6 +210,43 @@ xml_copy_marked(cxobj *x0,
     return retval;
 }
 
+/*! Copy edit marks of a cache tree to a copy of it
+ * Edit marks are not copied by xml_copy, they are only kept in copies of
+ * the cache made here, which the backend diffs with xml_diff_edit.
+ * Only edited nodes are visited, nodes not in the copy are skipped.
+ * @param[in]  x0  Cache XML tree node
+ * @param[in]  x1  Copy of x0
+ * @retval     0   OK
+ * @retval    -1   Error
+ */
+static int
+xml_copy_edits(cxobj *x0, 
+	       cxobj *x1)
+{
+    int    retval = -1;
+    cxobj *x0c;
+    cxobj *x1c;
+    int    i;
+
+    if (!xml_flag(x0, XML_FLAG_EDIT))
+	goto ok;
+    if (xml_edit_mark(x1) < 0)
+	goto done;
+    for (i=0; i<xml_edit_nr(x0); i++){
+	x0c = xml_edit_i(x0, i);
+	if ((x1c = xml_find_equal(x1, x0c)) != NULL &&
+	    xml_copy_edits(x0c, x1c) < 0)
+	    goto done;
+    }
+    for (i=0; i<xml_edit_removed_nr(x0); i++)
+	if (xml_edit_removed(x1, xml_edit_removed_i(x0, i)) < 0)
+	    goto done;
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
 /*! Read module-state in an XML tree
  *
  * @param[in]  th    Datastore text handle
@@ -303,19 +342,59 @@ text_read_modstate(clicon_handle       h,
     return retval;
 }
 
-/*! Common read function that reads an XML tree from file
- * @param[in]  th    Datastore text handle
+/*! Get name of the top-level node an xpath is restricted to
+ * Only simple absolute paths are recognized, eg /a:b/c[d='e'].
+ * @param[in]  xpath  XPATH, or NULL
+ * @param[out] top    Local name of top-level node, or NULL. Free after use
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+xpath_top(char  *xpath,
+	  char **top)
+{
+    char  *p;
+    size_t len;
+
+    *top = NULL;
+    if (xpath == NULL || xpath[0] != '/' || xpath[1] == '/' ||
+	strchr(xpath, '|') || strstr(xpath, "..") || strstr(xpath, "::"))
+	return 0;
+    xpath++;
+    len = strcspn(xpath, "/[");
+    if ((p = memchr(xpath, ':', len)) != NULL){
+	len -= p + 1 - xpath;
+	xpath = p + 1;
+    }
+    if (len == 0 || strspn(xpath, "abcdefghijklmnopqrstuvwxyz"
+			   "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-.") < len)
+	return 0;
+    if ((*top = strndup(xpath, len)) == NULL){
+	clicon_err(OE_UNIX, errno, "strndup");
+	return -1;
+    }
+    return 0;
+}
+
+/*! Read an XML tree from file, possibly only one top-level subtree
+ * @param[in]  h     Clicon handle
  * @param[in]  db    Symbolic database name, eg "candidate", "running"
  * @param[in]  yspec Top-level yang spec
+ * @param[in]  top   If set, only read top-level nodes with this name (and 
+ *                   modules-state) if the format supports it, otherwise NULL
+ * @param[in]  lazy  If set and top is NULL, leave top-level subtrees of a tree
+ *                   datastore in file until loaded by xmldb_load
  * @param[out] xp    XML tree read from file
  * @param[out] msd    If set, return modules-state differences
  */
-int
-xmldb_readfile(clicon_handle      h,
-	       const char         *db,
-	       yang_stmt          *yspec,
-	       cxobj             **xp,
-	       modstate_diff_t    *msd)
+static int
+xmldb_readfile_top(clicon_handle      h,
+		   const char         *db,
+		   yang_stmt          *yspec,
+		   char               *top,
+		   int                 lazy,
+		   cxobj             **xp,
+		   modstate_diff_t    *msd)
 {
     int    retval = -1;
     cxobj *x0 = NULL;
@@ -336,7 +415,16 @@ xmldb_readfile(clicon_handle      h,
     }
     /* Parse file into internal XML tree from different formats */
     if (strcmp(format, "tree")==0){
-	if (datastore_tree_read(h, dbfile, &x0) < 0)
+	if (top == NULL && lazy){
+	    if (datastore_tree_read_lazy(h, dbfile, &x0) < 0)
+		goto done;
+	}
+	else if (datastore_tree_read(h, dbfile, top, &x0) < 0)
+	    goto done;
+	if (xml_apply(x0, CX_ELMNT, xml_spec_populate, yspec) < 0)
+	    goto done;
+	/* Top-level subtrees not loaded are last in the root record */
+	if (xml_sort(x0, NULL) < 0)
 	    goto done;
     }
     else{
@@ -370,6 +458,11 @@ xmldb_readfile(clicon_handle      h,
      */
     if (text_read_modstate(h, yspec, x0, msd) < 0)
 	goto done;
+    /* Journal format: apply edits made since the snapshot was written */
+    if (strcmp(format, "journal")==0){
+	if (xmldb_journal_replay(h, dbfile, yspec, x0) < 0)
+	    goto done;
+    }
     if (xp){
 	*xp = x0;
 	x0 = NULL;
@@ -385,6 +478,187 @@ xmldb_readfile(clicon_handle      h,
     return retval;
 }
 
+/*! Common read function that reads an XML tree from file
+ * @param[in]  th    Datastore text handle
+ * @param[in]  db    Symbolic database name, eg "candidate", "running"
+ * @param[in]  yspec Top-level yang spec
+ * @param[out] xp    XML tree read from file
+ * @param[out] msd    If set, return modules-state differences
+ * @note With CLICON_XMLDB_LAZY, subtrees must be loaded with xmldb_load
+ */
+int
+xmldb_readfile(clicon_handle      h,
+	       const char         *db,
+	       yang_stmt          *yspec,
+	       cxobj             **xp,
+	       modstate_diff_t    *msd)
+{
+    return xmldb_readfile_top(h, db, yspec, NULL,
+			      clicon_option_bool(h, "CLICON_XMLDB_LAZY"), xp, msd);
+}
+
+/*! Load top-level subtrees of a datastore tree that were left in the file
+ * With CLICON_XMLDB_LAZY, xmldb_readfile only reads the root of a tree 
+ * datastore. Subtrees must be loaded before they are accessed.
+ * @param[in]  h     Clicon handle
+ * @param[in]  db    Symbolic database name, eg "candidate", "running"
+ * @param[in]  xt    XML tree read with xmldb_readfile
+ * @param[in]  top   Local name of top-level subtrees to load, or NULL for all
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+int
+xmldb_load(clicon_handle h,
+	   const char   *db,
+	   cxobj        *xt,
+	   char         *top)
+{
+    int        retval = -1;
+    char      *format;
+    char      *dbfile = NULL;
+    yang_stmt *yspec;
+
+    if ((format = clicon_option_str(h, "CLICON_XMLDB_FORMAT")) == NULL ||
+	strcmp(format, "tree") != 0 ||
+	!clicon_option_bool(h, "CLICON_XMLDB_LAZY"))
+	return 0;
+    if ((yspec = clicon_dbspec_yang(h)) == NULL){
+	clicon_err(OE_YANG, ENOENT, "No yang spec");
+	goto done;
+    }
+    if (xmldb_db2file(h, db, &dbfile) < 0)
+	goto done;
+    if (datastore_tree_load(h, dbfile, yspec, xt, top) < 0)
+	goto done;
+    retval = 0;
+ done:
+    if (dbfile)
+	free(dbfile);
+    return retval;
+}
+
+/*! Load top-level subtrees of a datastore tree that an xpath refers to
+ * @see xmldb_load
+ */
+static int
+xmldb_load_xpath(clicon_handle h,
+		 const char   *db,
+		 cxobj        *xt,
+		 char         *xpath)
+{
+    int   retval = -1;
+    char *top = NULL;
+
+    if (xpath_top(xpath, &top) < 0)
+	goto done;
+    if (xmldb_load(h, db, xt, top) < 0)
+	goto done;
+    retval = 0;
+ done:
+    if (top)
+	free(top);
+    return retval;
+}
+
+/*! Check if the cache tree of a database is shared with another database
+ * xmldb_copy makes the cache of the destination share the tree of the source.
+ * A shared tree must not be modified or freed, see xmldb_cache_unshare.
+ * @param[in]  h     Clicon handle
+ * @param[in]  db    Symbolic database name, eg "candidate", "running"
+ * @param[in]  xt    Cache tree of db
+ * @retval     1     Shared, xt is also the cache of another database
+ * @retval     0     Not shared
+ * @retval    -1     Error
+ */
+int
+xmldb_cache_shared(clicon_handle h,
+		   const char   *db,
+		   cxobj        *xt)
+{
+    int       retval = -1;
+    char    **keys = NULL;
+    size_t    klen;
+    int       i;
+    db_elmnt *de;
+
+    if (clicon_hash_keys(clicon_db_elmnt(h), &keys, &klen) < 0)
+	goto done;
+    retval = 0;
+    for (i = 0; i < klen; i++)
+	if (strcmp(keys[i], db) != 0 &&
+	    (de = clicon_hash_value(clicon_db_elmnt(h), keys[i], NULL)) != NULL &&
+	    de->de_xml == xt){
+	    retval = 1;
+	    break;
+	}
+ done:
+    if (keys)
+	free(keys);
+    return retval;
+}
+
+/*! Make a private copy of the cache tree of a database before modifying it
+ * The copy of xmldb_copy is deferred to here, made by xmldb_put only.
+ * Reads, including xmldb_get0, use the shared tree as is.
+ * This is not path copying: subtrees cannot be shared between trees since
+ * every node has a single parent, so the whole tree is copied, unless the
+ * edit replaces all of it. An edit after a commit still costs one copy of
+ * the tree, only copies that are never followed by an edit are saved.
+ * @param[in]  h     Clicon handle
+ * @param[in]  db    Symbolic database name, eg "candidate", "running"
+ * @param[in]  root  If set, copy the root only, all children are replaced
+ * @retval     0     OK, cache of db is not shared (or empty)
+ * @retval    -1     Error
+ */
+int
+xmldb_cache_unshare(clicon_handle h,
+		    const char   *db,
+		    int           root)
+{
+    int       retval = -1;
+    db_elmnt *de;
+    db_elmnt  de0;
+    cxobj    *x = NULL;
+    cxobj    *xa;
+    cxobj    *xc;
+    int       ret;
+
+    if ((de = clicon_db_elmnt_get(h, db)) == NULL || de->de_xml == NULL)
+	goto ok;
+    if ((ret = xmldb_cache_shared(h, db, de->de_xml)) < 0)
+	goto done;
+    if (ret == 0)
+	goto ok;
+    clicon_debug(1, "%s %s: copy shared cache%s", __FUNCTION__, db,
+		 root?" root":"");
+    if (root){
+	if ((x = xml_new(xml_name(de->de_xml), NULL, xml_spec(de->de_xml))) == NULL)
+	    goto done;
+	if (xml_copy_one(de->de_xml, x) < 0)
+	    goto done;
+	xa = NULL;
+	while ((xa = xml_child_each(de->de_xml, xa, CX_ATTR)) != NULL) {
+	    if ((xc = xml_new(xml_name(xa), x, NULL)) == NULL)
+		goto done;
+	    if (xml_copy(xa, xc) < 0)
+		goto done;
+	}
+    }
+    else if ((x = xml_dup(de->de_xml)) == NULL)
+	goto done;
+    de0 = *de;
+    de0.de_xml = x;
+    if (clicon_db_elmnt_set(h, db, &de0) < 0)
+	goto done;
+    x = NULL;
+ ok:
+    retval = 0;
+ done:
+    if (x)
+	xml_free(x);
+    return retval;
+}
+
 /*! Get content of database using xpath. return a set of matching sub-trees
  * The function returns a minimal tree that includes all sub-trees that match
  * xpath.
@@ -416,12 +690,16 @@ xmldb_get_nocache(clicon_handle       h,
     cxobj         **xvec = NULL;
     size_t          xlen;
     int             i;
+    char           *top = NULL;
 
     if ((yspec = clicon_dbspec_yang(h)) == NULL){
 	clicon_err(OE_YANG, ENOENT, "No yang spec");
 	goto done;
     }
-    if (xmldb_readfile(h, db, yspec, &xt, msd) < 0)
+    /* Only the top-level subtree of the xpath is needed */
+    if (xpath_top(xpath, &top) < 0)
+	goto done;
+    if (xmldb_readfile_top(h, db, yspec, top, 0, &xt, msd) < 0)
 	goto done;
     /* Here xt looks like: <config>...</config> */
     /* Given the xpath, return a vector of matches in xvec */
@@ -460,6 +738,8 @@ xmldb_get_nocache(clicon_handle       h,
  done:
     if (xt)
 	xml_free(xt);
+    if (top)
+	free(top);
     if (dbfile)
 	free(dbfile);
     if (xvec)
@@ -520,6 +800,8 @@ xmldb_get_cache(clicon_handle    h,
     } /* x0t == NULL */
     else
 	x0t = de->de_xml;
+    if (xmldb_load_xpath(h, db, x0t, xpath) < 0)
+	goto done;
     /* Here x0t looks like: <config>...</config> */
     /* Given the xpath, return a vector of matches in xvec 
      * Can we do everything in one go?
@@ -530,12 +812,16 @@ xmldb_get_cache(clicon_handle    h,
      *   b) if config dont dont state data
      */
 
-    /* Here xt looks like: <config>...</config> */
-    if (xpath_vec_nsc(x0t, nsc, "%s", &xvec, &xlen, xpath?xpath:"/") < 0)
+    /* Here xt looks like: <config>...</config> 
+     * Absolute paths are resolved by lookups in the sorted cache tree */
+    if (xpath_vec_plan(x0t, nsc, xpath?xpath:"/", &xvec, &xlen, NULL) < 0)
 	goto done;
 
-    /* Make new tree by copying top-of-tree from x0t to x1t */
-    if ((x1t = xml_new(xml_name(x0t), NULL, xml_spec(x0t))) == NULL)
+    /* Make new tree by copying top-of-tree from x0t to x1t 
+     * The copy is allocated from an arena since it is typically only used
+     * for a single request.
+     */
+    if ((x1t = xml_new_arena(xml_name(x0t), xml_spec(x0t))) == NULL)
 	goto done;
     /* Iterate through the match vector
      * For every node found in x0, mark the tree up to t1
@@ -547,6 +833,8 @@ xmldb_get_cache(clicon_handle    h,
     }
     if (xml_copy_marked(x0t, x1t) < 0) /* config */
 	goto done;
+    if (xml_copy_edits(x0t, x1t) < 0)
+	goto done;
     if (xml_apply(x0t, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, (void*)(XML_FLAG_MARK|XML_FLAG_CHANGE)) < 0)
 	goto done;
     if (xml_apply(x1t, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, (void*)(XML_FLAG_MARK|XML_FLAG_CHANGE)) < 0)
@@ -605,6 +893,9 @@ xmldb_get_zerocopy(clicon_handle    h,
 	clicon_err(OE_YANG, ENOENT, "No yang spec");
 	goto done;
     }
+    /* The raw cache may be shared with another database. It is marked and
+     * given default values, which are removed by xmldb_get0_clear, but it
+     * is not otherwise modified, see xmldb_cache_unshare */
     de = clicon_db_elmnt_get(h, db);
     if (de == NULL || de->de_xml == NULL){ /* Cache miss, read XML from file */
 	/* If there is no xml x0 tree (in cache), then read it from file */
@@ -619,8 +910,11 @@ xmldb_get_zerocopy(clicon_handle    h,
     } /* x0t == NULL */
     else
 	x0t = de->de_xml;
-    /* Here xt looks like: <config>...</config> */
-    if (xpath_vec_nsc(x0t, nsc, "%s", &xvec, &xlen, xpath?xpath:"/") < 0)
+    if (xmldb_load_xpath(h, db, x0t, xpath) < 0)
+	goto done;
+    /* Here xt looks like: <config>...</config> 
+     * Absolute paths are resolved by lookups in the sorted cache tree */
+    if (xpath_vec_plan(x0t, nsc, xpath?xpath:"/", &xvec, &xlen, NULL) < 0)
 	goto done;
     /* Iterate through the match vector
      * For every node found in x0, mark the tree up to t1
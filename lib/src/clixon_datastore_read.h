@@ -40,5 +40,8 @@
  * Prototypes
  */
 int xmldb_readfile(clicon_handle h, const char *db, yang_stmt *yspec, cxobj **xp, modstate_diff_t *msd);
+int xmldb_load(clicon_handle h, const char *db, cxobj *xt, char *top);
+int xmldb_cache_shared(clicon_handle h, const char *db, cxobj *xt);
+int xmldb_cache_unshare(clicon_handle h, const char *db, int root);
 
 #endif /* _CLIXON_DATASTORE_READ_H */
@@ -32,9 +32,27 @@
   ***** END LICENSE BLOCK *****
 
  *
- * XML file save
+ * Block tree datastore file, see clixon_datastore_tree.h for the format.
+ * Block allocation state of a file is kept between writes, so that only the
+ * records of changed XML nodes are written, and blocks of removed and moved
+ * records are reused. Changed nodes are found with the dirty bits of 
+ * xml_dsindex, set by the XML API when a node is modified.
+ * Files are read with mmap. A lazy read only makes XML of the root and leaves
+ * top-level subtrees in the mapped file until they are loaded.
+ *
+ * Crash safety (shadow paging):
+ * - A changed record is written to free blocks, never over a record of the
+ *   tree of the current superblock. Its old blocks are free after the write.
+ * - The records are synced before a new superblock is written, alternating
+ *   between two superblock slots. A reader uses the valid superblock with the
+ *   highest generation, so a crash before or during the superblock write
+ *   leaves the previous tree.
+ * - A full write is made to a temporary file which is renamed to the file.
+ * - The generation and file id of the superblock tell if the file was written
+ *   by others since it was last read or written.
  */
 
+
 #ifdef HAVE_CONFIG_H
 #include "clixon_config.h" /* generated by config & autoconf */
 #endif
@@ -43,13 +61,17 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
-#include <ctype.h>
 #include <string.h>
+#include <stdint.h>
 #include <syslog.h>
 #include <fcntl.h>
-#include <assert.h>
+#include <dirent.h>
+#include <time.h>
 #include <arpa/inet.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <sys/param.h>
+#include <sys/mman.h>
 #include <netinet/in.h>
 
 /* cligen */
@@ -63,396 +85,1324 @@
 #include "clixon_err.h"
 #include "clixon_log.h"
 #include "clixon_handle.h"
+#include "clixon_file.h"
 #include "clixon_yang.h"
 #include "clixon_xml.h"
+#include "clixon_xml_sort.h"
+#include "clixon_options.h"
+#include "clixon_xml_map.h"
 
 #include "clixon_datastore_tree.h"
 
-#define align4(s) (((s)/4)*4 + 4)
+/* Number of blocks of a record with payload length len */
+#define df_blocks(len) (((len) + DF_HDRLEN + DF_BLOCK - 1)/DF_BLOCK)
+
+/* Length of superblock: magic, version, root, nr of blocks, generation,
+ * file id and checksum */
+#define DF_SUPERLEN 28
+
+/* Nr of superblock slots, blocks 0 and 1 */
+#define DF_SUPERNR 2
+
+/* Block map value of the blocks of a record except the first */
+#define DF_MAP_USED 0xffffffff
+
+/*! Superblock contents */
+struct tree_super{
+    uint32_t ts_root; /* Block index of root record */
+    uint32_t ts_len;  /* Nr of blocks in file */
+    uint32_t ts_gen;  /* Generation, incremented by every write */
+    uint32_t ts_id;   /* File id, new for every full write */
+};
+
+/*! Block allocation state of a tree datastore file
+ * Valid as long as the file is not changed by others (checked with the
+ * generation and file id of the superblock) and the block indexes of tf_root
+ * refer to the file.
+ */
+struct tree_file{
+    struct tree_file *tf_next;
+    char             *tf_name;    /* Filename */
+    cxobj            *tf_root;    /* Tree whose block indexes refer to file */
+    uint32_t          tf_gen;     /* Superblock after last read or write */
+    uint32_t          tf_id;
+    uint32_t         *tf_map;     /* Per block: nr of blocks of the record 
+				     starting there, DF_MAP_USED if in a 
+				     record, 0 if free */
+    uint32_t          tf_len;     /* Nr of blocks in file */
+    uint32_t          tf_max;     /* Allocated length of tf_map */
+    uint32_t          tf_free;    /* No free block below this index */
+    uint32_t         *tf_pend;    /* Frees pending until end of write, 
+				     as (index, nr of blocks) pairs */
+    uint32_t          tf_pendlen; /* Nr of uint32 in tf_pend */
+    uint32_t          tf_pendmax; /* Allocated length of tf_pend */
+    int               tf_lazy;    /* Blocks not read are marked as used */
+    char             *tf_mem;     /* Mapped file while subtrees are not loaded */
+    size_t            tf_memlen;  /* Length of tf_mem */
+    uint32_t         *tf_skip;    /* Block indexes of top-level subtrees of 
+				     tf_root not loaded */
+    uint32_t          tf_skiplen; /* Nr of uint32 in tf_skip */
+    uint32_t          tf_skipmax; /* Allocated length of tf_skip */
+};
 
-struct indexlist{
-    qelem_t  il_q; /* this must be there */
-    uint32_t il_i;
-    int      il_len; /* How many */
+/*! Growable buffer used to build a record */
+struct tree_buf{
+    char   *tb_buf;
+    size_t  tb_len;
+    size_t  tb_max;
 };
-typedef struct indexlist indexlist;
 
-struct indexhead{
-    indexlist *ih_list;
+/*! Record reader, from the mapped file */
+struct tree_reader{
+    char   *tr_buf;  /* Mapped file */
+    size_t  tr_len;  /* Length of tr_buf */
 };
-typedef struct indexhead indexhead;
+
+/* Allocation state of tree datastore files */
+static struct tree_file *_tree_files = NULL;
+
+/*! FNV-1a 32-bit checksum of a superblock or record payload
+ */
+static uint32_t
+df_checksum(char  *buf,
+	    size_t len)
+{
+    return clicon_hash_fnv1a(CLICON_HASH_FNV1A_INIT, buf, len);
+}
 
 static int
-indexhead_free(indexhead *ih)
+tree_buf_append(struct tree_buf *tb,
+		void            *data,
+		size_t           len)
 {
-    indexlist *il;
+    size_t max;
+    char  *b;
 
-    while ((il = ih->ih_list) != NULL)
-	DELQ(il, ih->ih_list, indexlist*);
+    if (tb->tb_len + len > tb->tb_max){
+	max = tb->tb_max ? tb->tb_max : 256;
+	while (max < tb->tb_len + len)
+	    max *= 2;
+	if ((b = realloc(tb->tb_buf, max)) == NULL){
+	    clicon_err(OE_UNIX, errno, "realloc");
+	    return -1;
+	}
+	tb->tb_buf = b;
+	tb->tb_max = max;
+    }
+    memcpy(tb->tb_buf + tb->tb_len, data, len);
+    tb->tb_len += len;
     return 0;
 }
 
-int
-index_get(indexhead *ih,
-	  size_t     len, /* in bytes */
-	  uint32_t  *indexp)
-{
-    int               retval = -1;
-    int               nr;
-    uint32_t          index = 0;
-    struct indexlist *il;
-    indexlist        *new;
-
-    nr = len/DF_BLOCK + 1;
-    if ((new = malloc(sizeof(indexlist))) == NULL){
-	clicon_err(OE_XML, errno, "malloc");
-	goto done;
+/*! Append [prefix:]name of a node as null-terminated string
+ */
+static int
+tree_buf_name(struct tree_buf *tb,
+	      cxobj           *x)
+{
+    char *prefix;
+
+    if ((prefix = xml_prefix(x)) != NULL){
+	if (tree_buf_append(tb, prefix, strlen(prefix)) < 0 ||
+	    tree_buf_append(tb, ":", 1) < 0)
+	    return -1;
     }
-    memset(new, 0, sizeof(indexlist));
-    //    new->il_i = i; Dont know i yet
-    new->il_len = nr;
-    if ((il = ih->ih_list) != NULL) {
-	il = PREVQ(indexlist*, il);
-	index = il->il_i + il->il_len;
+    return tree_buf_append(tb, xml_name(x), strlen(xml_name(x))+1);
+}
+
+/*! Find allocation state of a file, or create it
+ */
+static struct tree_file *
+tree_file_get(char *filename)
+{
+    struct tree_file *tf;
+
+    for (tf = _tree_files; tf; tf = tf->tf_next)
+	if (strcmp(tf->tf_name, filename) == 0)
+	    return tf;
+    if ((tf = malloc(sizeof(*tf))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	return NULL;
     }
-    ADDQ(new, ih->ih_list);
-    new->il_i = index;
-    *indexp = index;
-    retval = 0;
- done:
-    return retval;
+    memset(tf, 0, sizeof(*tf));
+    if ((tf->tf_name = strdup(filename)) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	free(tf);
+	return NULL;
+    }
+    tf->tf_next = _tree_files;
+    _tree_files = tf;
+    return tf;
 }
-#ifdef NOTYET
-int
-index_get(indexhead *ih,
-	  size_t     len, /* in bytes */
-	  uint32_t  *indexp)
-{
-    int               retval = -1;
-    int               nr;
-    uint32_t          index = 0;
-    struct indexlist *il;
-    indexlist        *new;
-
-    nr = len/DF_BLOCK + 1;
-    if ((new = malloc(sizeof(indexlist))) == NULL){
-	clicon_err(OE_XML, errno, "malloc");
-	goto done;
+
+/*! Grow block map so that it covers len blocks, new blocks are free
+ */
+static int
+tree_file_grow(struct tree_file *tf,
+	       uint32_t          len)
+{
+    uint32_t  max;
+    uint32_t *map;
+
+    if (len <= tf->tf_max)
+	return 0;
+    max = tf->tf_max ? tf->tf_max : 1024;
+    while (max < len)
+	max *= 2;
+    if ((map = realloc(tf->tf_map, max*sizeof(uint32_t))) == NULL){
+	clicon_err(OE_UNIX, errno, "realloc");
+	return -1;
     }
-    memset(new, 0, sizeof(indexlist));
-    //    new->il_i = i; Dont know i yet
-    new->il_len = nr;
+    memset(&map[tf->tf_max], 0, (max - tf->tf_max)*sizeof(uint32_t));
+    tf->tf_map = map;
+    tf->tf_max = max;
+    return 0;
+}
 
-    /* Find nr conseq blocks */
-    if ((il = ih->ih_list) != NULL) {
-	do {
-	    if (il->il_i - index >= nr){ /* Found */
-		INSQ(new, il);
-		break;
-	    }
-	    index = il->il_i + il->il_len;
-	    il = NEXTQ(indexlist*, il);
-	} while (il != ih->ih_list);
-	ADDQ(new, il); /* after? */
-    }
-    else
-	INSQ(new, ih->ih_list);
-    new->il_i = index;
-    *indexp = index;
-    retval = 0;
- done:
-    return retval;
+/*! Reset allocation state to an empty file with only superblocks
+ */
+static int
+tree_file_reset(struct tree_file *tf)
+{
+    uint32_t i;
+
+    if (tree_file_grow(tf, DF_SUPERNR) < 0)
+	return -1;
+    memset(tf->tf_map, 0, tf->tf_max*sizeof(uint32_t));
+    for (i=0; i<DF_SUPERNR; i++)
+	tf->tf_map[i] = 1;
+    tf->tf_len = DF_SUPERNR;
+    tf->tf_free = DF_SUPERNR;
+    tf->tf_pendlen = 0;
+    tf->tf_root = NULL;
+    tf->tf_lazy = 0;
+    tf->tf_skiplen = 0;
+    if (tf->tf_mem){
+	munmap(tf->tf_mem, tf->tf_memlen);
+	tf->tf_mem = NULL;
+    }
+    return 0;
 }
-#endif
 
-int
-index_dump(FILE      *f,
-	   indexhead *ih)
+/*! Map a file for reading records
+ * @param[in]  fd    File descriptor
+ * @param[in]  len   Length of file, not 0
+ * @param[out] tr    Record reader, unmap tr_buf after use
+ */
+static int
+tree_mmap(int                 fd,
+	  size_t              len,
+	  struct tree_reader *tr)
 {
-    indexlist *il;
+    char *mem;
 
-    if ((il = ih->ih_list) != NULL) {
-	do {
-	    fprintf(f, "%u %d\n", il->il_i, il->il_len);
-	    il = NEXTQ(indexlist*, il);
-	}  while (il != ih->ih_list);
+    if ((mem = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED){
+	clicon_err(OE_UNIX, errno, "mmap");
+	return -1;
     }
+    tr->tr_buf = mem;
+    tr->tr_len = len;
     return 0;
 }
 
-/*
- * @param[out] xp
- * @param[out] vec If type is CX_ELMNT, points to vector of indexes,...
- * @retval    -1   Error
- * @retval     0   Sanity check failed
- * @retval     1   OK  xp set (or NULL if empty)
+/*! Check that a block index is the start of a record in the block map
  */
 static int
-buf2xml(FILE      *f,
-	uint32_t   index,
-	cxobj    **xp)
+tree_file_record(struct tree_file *tf,
+		 uint32_t          index)
 {
-    int      retval = -1;
-    uint8_t  ver;
-    uint8_t  type;
-    int      ptr;
-    uint32_t len;
-    cxobj   *x = NULL;
-    char    *name;
-    char    *prefix = NULL;
-    char     hdr[8] = {0, };
-    char    *buf = NULL;
-    int       vlen;
-    int       i;
-    uint32_t  ind;
-    cxobj    *xc;
-    size_t    ret;
-
-    /* Read hdr
-     * +-----+-----+-----+-----+-----+-----+-----+-----+
-     * | ver | type| de  | ad  | len                   |
-     * +-----+-----+-----+-----+-----+-----+-----+-----+
-     */
-    if (fseek(f, index*DF_BLOCK, SEEK_SET) < 0){
-	clicon_err(OE_UNIX, errno, "fseek");
-	goto done;
+    if (index < DF_SUPERNR || index >= tf->tf_len ||
+	tf->tf_map[index] == 0 || tf->tf_map[index] == DF_MAP_USED){
+	clicon_err(OE_XML, 0, "%s: block %u is not a record", tf->tf_name, index);
+	return -1;
     }
-    if ((ret = fread(hdr, sizeof(char), sizeof(hdr), f)) != sizeof(hdr)){
-	clicon_err(OE_XML, errno, "fread");
-	goto done;
+    return 0;
+}
+
+/*! Mark nr blocks from index as a record in the block map
+ */
+static int
+tree_file_mark(struct tree_file *tf,
+	       uint32_t          index,
+	       uint32_t          nr)
+{
+    uint32_t i;
+
+    if (tree_file_grow(tf, index + nr) < 0)
+	return -1;
+    tf->tf_map[index] = nr;
+    for (i=index+1; i<index+nr; i++)
+	tf->tf_map[i] = DF_MAP_USED;
+    if (index + nr > tf->tf_len)
+	tf->tf_len = index + nr;
+    return 0;
+}
+
+/*! Allocate nr consecutive free blocks, first fit
+ * Blocks at the end of the file are used if no free range is large enough.
+ * @param[in]  tf      File allocation state
+ * @param[in]  nr      Nr of blocks
+ * @param[out] indexp  Index of first block
+ */
+static int
+tree_alloc(struct tree_file *tf,
+	   uint32_t          nr,
+	   uint32_t         *indexp)
+{
+    uint32_t i;
+    uint32_t j;
+
+    i = tf->tf_free;
+    while (i < tf->tf_len){
+	if (tf->tf_map[i] == 0){
+	    for (j=i; j<tf->tf_len && j-i<nr && tf->tf_map[j]==0; j++);
+	    if (j-i == nr || j == tf->tf_len) /* Fits, possibly extending file */
+		break;
+	    i = j;
+	}
+	else if (tf->tf_map[i] == DF_MAP_USED)
+	    i++;
+	else
+	    i += tf->tf_map[i];
     }
-    if ((ver = hdr[0]&0xff) == 0) /* Means empty */
-	goto ok;
-    if (ver != 1){
-	clicon_debug(1, "%s Wrong version: %d", __FUNCTION__, ver);
-	goto fail;
+    if (i > XML_DSINDEX_MASK - nr){
+	clicon_err(OE_XML, EFBIG, "%s: too many blocks", tf->tf_name);
+	return -1;
+    }
+    if (tree_file_mark(tf, i, nr) < 0)
+	return -1;
+    if (i == tf->tf_free)
+	tf->tf_free = i + nr;
+    *indexp = i;
+    return 0;
+}
+
+/*! Free nr blocks from index when the write is done
+ * Blocks are not reused in the same write, since old records are read to
+ * find removed subtrees.
+ */
+static int
+tree_free(struct tree_file *tf,
+	  uint32_t          index,
+	  uint32_t          nr)
+{
+    uint32_t  max;
+    uint32_t *p;
+
+    if (tf->tf_pendlen + 2 > tf->tf_pendmax){
+	max = tf->tf_pendmax ? 2*tf->tf_pendmax : 64;
+	if ((p = realloc(tf->tf_pend, max*sizeof(uint32_t))) == NULL){
+	    clicon_err(OE_UNIX, errno, "realloc");
+	    return -1;
+	}
+	tf->tf_pend = p;
+	tf->tf_pendmax = max;
     }
-    type =  hdr[1]&0x0f;
-    if (type != CX_BODY && type != CX_ELMNT && type != CX_ATTR){
-	clicon_debug(1, "%s Wrong type: %d", __FUNCTION__, type);
-	goto fail;
+    tf->tf_pend[tf->tf_pendlen++] = index;
+    tf->tf_pend[tf->tf_pendlen++] = nr;
+    return 0;
+}
+
+/*! Free blocks of pending frees, and shrink file if last blocks are free
+ */
+static void
+tree_free_apply(struct tree_file *tf)
+{
+    uint32_t k;
+    uint32_t i;
+
+    for (k=0; k<tf->tf_pendlen; k+=2){
+	for (i=tf->tf_pend[k]; i<tf->tf_pend[k]+tf->tf_pend[k+1]; i++)
+	    tf->tf_map[i] = 0;
+	if (tf->tf_pend[k] < tf->tf_free)
+	    tf->tf_free = tf->tf_pend[k];
     }
-    if ((hdr[2]&0xff) != 0xde){
-	clicon_debug(1, "%s Expected 0xde: %x", __FUNCTION__, hdr[2]&0xff);
-	goto fail;
+    tf->tf_pendlen = 0;
+    while (tf->tf_len > DF_SUPERNR && tf->tf_map[tf->tf_len-1] == 0)
+	tf->tf_len--;
+}
+
+/*! Get a superblock slot if it is valid
+ * @param[in]  p      Superblock slot
+ * @param[out] ts     Superblock contents
+ * @retval     1      Valid
+ * @retval     0      Not valid
+ */
+static int
+tree_super_slot(char              *p,
+		struct tree_super *ts)
+{
+    uint32_t u;
+
+    if (memcmp(p, DF_MAGIC, 4) != 0 || p[4] != DF_VERSION)
+	return 0;
+    memcpy(&u, p+24, 4);
+    if (ntohl(u) != df_checksum(p, 24))
+	return 0;
+    memcpy(&u, p+8, 4);
+    ts->ts_root = ntohl(u);
+    memcpy(&u, p+12, 4);
+    ts->ts_len = ntohl(u);
+    memcpy(&u, p+16, 4);
+    ts->ts_gen = ntohl(u);
+    memcpy(&u, p+20, 4);
+    ts->ts_id = ntohl(u);
+    return 1;
+}
+
+/*! Find the valid superblock with the highest generation
+ * @param[in]  tr     Record reader
+ * @param[out] ts     Superblock contents
+ * @retval     1      Found
+ * @retval     0      No valid superblock
+ */
+static int
+tree_super_find(struct tree_reader *tr,
+		struct tree_super  *ts)
+{
+    struct tree_super ts1;
+    int               found = 0;
+    int               i;
+
+    for (i=0; i<DF_SUPERNR; i++){
+	if (tr->tr_len < (size_t)i*DF_BLOCK + DF_SUPERLEN)
+	    break;
+	if (!tree_super_slot(tr->tr_buf + i*DF_BLOCK, &ts1))
+	    continue;
+	if (!found || (int32_t)(ts1.ts_gen - ts->ts_gen) > 0)
+	    *ts = ts1;
+	found = 1;
     }
-    if ((hdr[3]&0xff) != 0xad){
-	clicon_debug(1, "%s Expected 0xad: %x", __FUNCTION__, hdr[3]&0xff);
-	goto fail;
+    return found;
+}
+
+/*! Read superblock
+ * @param[in]  tr     Record reader
+ * @param[out] ts     Superblock contents
+ */
+static int
+tree_super_read(struct tree_reader *tr,
+		struct tree_super  *ts)
+{
+    if (tree_super_find(tr, ts) == 0){
+	clicon_err(OE_XML, 0, "Not a tree datastore file or corrupt superblock");
+	return -1;
     }
-    /* Copy and byte-swap length field */
-    memcpy(&len, &hdr[4], 4);
+    return 0;
+}
+
+/*! Write superblock, in the slot of its generation
+ * The other slot is left with the superblock of the previous generation.
+ */
+static int
+tree_super_write(int                fd,
+		 struct tree_super *ts)
+{
+    char     super[DF_SUPERLEN] = {0,};
+    uint32_t u;
+
+    memcpy(super, DF_MAGIC, 4);
+    super[4] = DF_VERSION;
+    u = htonl(ts->ts_root);
+    memcpy(super+8, &u, 4);
+    u = htonl(ts->ts_len);
+    memcpy(super+12, &u, 4);
+    u = htonl(ts->ts_gen);
+    memcpy(super+16, &u, 4);
+    u = htonl(ts->ts_id);
+    memcpy(super+20, &u, 4);
+    u = htonl(df_checksum(super, 24));
+    memcpy(super+24, &u, 4);
+    if (pwrite(fd, super, DF_SUPERLEN,
+	       (off_t)(ts->ts_gen % DF_SUPERNR)*DF_BLOCK) != DF_SUPERLEN){
+	clicon_err(OE_UNIX, errno, "pwrite");
+	return -1;
+    }
+    return 0;
+}
+
+/*! Make a new file id for a full write
+ */
+static uint32_t
+tree_file_id(void)
+{
+    static uint32_t n = 0;
+    uint32_t        id;
+
+    id = (uint32_t)time(NULL) ^ ((uint32_t)getpid() << 16) ^ ++n;
+    return id ? id : 1;
+}
+
+/*! Read a record and verify header and checksum
+ * @param[in]  tr      Record reader
+ * @param[in]  index   Block index of record
+ * @param[out] payload Payload of record in mapped file, null-terminated
+ * @param[out] lenp    Length of payload
+ */
+static int
+tree_record_read(struct tree_reader *tr,
+		 uint32_t            index,
+		 char              **payload,
+		 uint32_t           *lenp)
+{
+    char    *hdr;
+    char    *p;
+    size_t   off;
+    uint32_t len;
+    uint32_t sum;
+
+    off = (size_t)index*DF_BLOCK;
+    if (off + DF_HDRLEN > tr->tr_len)
+	goto corrupt;
+    hdr = tr->tr_buf + off;
+    if (hdr[0] != DF_VERSION || (hdr[1]&0xff) != (0x80|CX_ELMNT))
+	goto corrupt;
+    memcpy(&len, hdr+4, 4);
     len = ntohl(len);
+    memcpy(&sum, hdr+8, 4);
+    sum = ntohl(sum);
+    if (len == 0 || off + DF_HDRLEN + len > tr->tr_len)
+	goto corrupt;
+    p = tr->tr_buf + off + DF_HDRLEN;
+    if (df_checksum(p, len) != sum || p[len-1] != '\0')
+	goto corrupt;
+    *payload = p;
+    *lenp = len;
+    return 0;
+ corrupt:
+    clicon_err(OE_XML, 0, "Corrupt tree datastore record at block %u", index);
+    return -1;
+}
 
-    /* Read rest
-     */
-    ptr = 0;
-    if ((buf = malloc(len - sizeof(hdr))) == NULL){
-	clicon_err(OE_UNIX, errno, "malloc");
-	goto done;
+/*! Get next child entry of a record payload
+ * @param[in]     p      Payload
+ * @param[in]     len    Length of payload
+ * @param[in,out] pos    Position of entry, updated to next entry
+ * @param[out]    type   Type of child
+ * @param[out]    name   Name of attribute
+ * @param[out]    value  Value of attribute or body
+ * @param[out]    index  Block index of element
+ * @retval        1      Entry returned
+ * @retval        0      No more entries
+ * @retval       -1      Error, corrupt payload
+ */
+static int
+tree_record_next(char     *p,
+		 uint32_t  len,
+		 uint32_t *pos,
+		 int      *type,
+		 char    **name,
+		 char    **value,
+		 uint32_t *index)
+{
+    uint32_t i = *pos;
+    uint32_t u;
+
+    if (i >= len)
+	return 0;
+    *type = p[i++];
+    switch (*type){
+    case CX_ELMNT:
+	if (i + 4 > len)
+	    goto corrupt;
+	memcpy(&u, p+i, 4);
+	*index = ntohl(u);
+	i += 4;
+	break;
+    case CX_ATTR:
+	*name = p+i;
+	i += strlen(p+i) + 1;
+	if (i >= len)
+	    goto corrupt;
+	/* fall through */
+    case CX_BODY:
+	*value = p+i;
+	i += strlen(p+i) + 1;
+	break;
+    default:
+	goto corrupt;
     }
-    if ((ret = fread(buf, sizeof(char), len-sizeof(hdr), f)) != len-sizeof(hdr)){
-	clicon_err(OE_XML, errno, "fread");
-	goto done;
+    if (i > len)
+	goto corrupt;
+    *pos = i;
+    return 1;
+ corrupt:
+    clicon_err(OE_XML, 0, "Corrupt tree datastore record");
+    return -1;
+}
+
+/*! Set [prefix:]name of a node from a record string
+ */
+static int
+tree_name_set(cxobj *x,
+	      char  *str)
+{
+    char *name;
+    char *prefix;
+    int   retval;
+
+    if ((name = strchr(str, ':')) == NULL)
+	return xml_name_set(x, str);
+    if ((prefix = strndup(str, name-str)) == NULL){
+	clicon_err(OE_UNIX, errno, "strndup");
+	return -1;
     }
-    if ((name = strchr(buf, ':')) != NULL){
-	*name = '\0';
-	name++;
-	prefix = buf;
-	ptr += strlen(prefix)+1;
-    }
-    else
-	name = buf;
-    ptr += strlen(name) + 1;
-    ptr = align4(ptr);
-    if ((x = xml_new(name, NULL, NULL)) == NULL)
-	goto done;
-    if (prefix)
-	if (xml_prefix_set(x, prefix) < 0)
-	    goto done;
-    xml_type_set(x, type);
-    if (xml_type(x) != CX_ELMNT){
-	if (xml_value_set(x, &buf[ptr]) < 0)
-	    goto done;
-	ptr += strlen(xml_value(x)) +1;
+    retval = xml_prefix_set(x, prefix) < 0 || xml_name_set(x, name+1) < 0 ? -1 : 0;
+    free(prefix);
+    return retval;
+}
+
+/*! Local name in a [prefix:]name record string
+ */
+static char *
+tree_name_local(char *str)
+{
+    char *name;
+
+    return (name = strchr(str, ':')) != NULL ? name+1 : str;
+}
+
+/*! Add a top-level subtree to the subtrees not loaded
+ */
+static int
+tree_skip_add(struct tree_file *tf,
+	      uint32_t          index)
+{
+    uint32_t  max;
+    uint32_t *p;
+
+    if (tf->tf_skiplen + 1 > tf->tf_skipmax){
+	max = tf->tf_skipmax ? 2*tf->tf_skipmax : 16;
+	if ((p = realloc(tf->tf_skip, max*sizeof(uint32_t))) == NULL){
+	    clicon_err(OE_UNIX, errno, "realloc");
+	    return -1;
+	}
+	tf->tf_skip = p;
+	tf->tf_skipmax = max;
     }
-    else{
-	vlen = (len - sizeof(hdr) - ptr)/ sizeof(uint32_t);
-	if (vlen < 0){
-	    clicon_debug(1, "%s Nr of elements should not be negative: %d", __FUNCTION__, vlen);
-	    goto fail;
+    tf->tf_skip[tf->tf_skiplen++] = index;
+    return 0;
+}
+
+/*! Read the record of an element and its subtree from file
+ * @param[in]  tr     Record reader
+ * @param[in]  tf     If set, record blocks in block map and set block indexes,
+ *                    and add skipped top-level subtrees to tf_skip
+ * @param[in]  index  Block index of record
+ * @param[in]  xp     Parent, or NULL for root
+ * @param[in]  top    If set, only read children of root with this name
+ * @param[out] xp     New element, or NULL if skipped
+ */
+static int
+tree_read_node(struct tree_reader *tr,
+	       struct tree_file   *tf,
+	       uint32_t            index,
+	       cxobj              *xp,
+	       char               *top,
+	       cxobj             **xret)
+{
+    int      retval = -1;
+    char    *p = NULL;
+    uint32_t len;
+    uint32_t pos;
+    int      type;
+    char    *name = NULL;
+    char    *value = NULL;
+    uint32_t ci = 0;
+    cxobj   *x = NULL;
+    cxobj   *xc;
+    char    *str;
+    int      ret;
+
+    if (tree_record_read(tr, index, &p, &len) < 0)
+	goto done;
+    /* Partial read: skip other top-level subtrees, but always read 
+     * module-state */
+    if (top && xp && xml_parent(xp) == NULL){
+	str = tree_name_local(p);
+	if (strcmp(str, top) != 0 && strcmp(str, "modules-state") != 0){
+	    if (tf && tree_skip_add(tf, index) < 0)
+		goto done;
+	    goto ok;
 	}
-	for (i=0; i<vlen; i++){
-	    memcpy(&ind, &buf[ptr], sizeof(uint32_t));
-	    ptr += sizeof(uint32_t);
-	    if (buf2xml(f, ntohl(ind), &xc) < 0)
+    }
+    if ((x = xml_new("", xp, NULL)) == NULL)
+	goto done;
+    if (tree_name_set(x, p) < 0)
+	goto done;
+    pos = strlen(p) + 1;
+    while ((ret = tree_record_next(p, len, &pos, &type, &name, &value, &ci)) == 1){
+	switch (type){
+	case CX_ELMNT:
+	    if (tree_read_node(tr, tf, ci, x, top, NULL) < 0)
 		goto done;
-	    if (xml_addsub(x, xc) < 0)
+	    break;
+	case CX_ATTR:
+	    if ((xc = xml_new("", x, NULL)) == NULL)
 		goto done;
+	    if (tree_name_set(xc, name) < 0)
+		goto done;
+	    xml_type_set(xc, CX_ATTR);
+	    if (xml_value_set(xc, value) < 0)
+		goto done;
+	    break;
+	case CX_BODY:
+	    if ((xc = xml_new("body", x, NULL)) == NULL)
+		goto done;
+	    xml_type_set(xc, CX_BODY);
+	    if (xml_value_set(xc, value) < 0)
+		goto done;
+	    break;
 	}
     }
-    assert(len == sizeof(hdr)+ptr);
+    if (ret < 0)
+	goto done;
+    if (tf){
+	if (index < tf->tf_max &&
+	    tf->tf_map[index] != (tf->tf_lazy ? DF_MAP_USED : 0)){
+	    clicon_err(OE_XML, 0, "%s: block %u used twice", tf->tf_name, index);
+	    goto done;
+	}
+	if (tree_file_mark(tf, index, df_blocks(len)) < 0)
+	    goto done;
+	/* After children are added, which mark x as changed */
+	xml_dsindex_set(x, index);
+    }
  ok:
-    if (xp)
-	*xp = x;
-    retval = 1;
+    if (xret)
+	*xret = x;
+    x = NULL;
+    retval = 0;
  done:
-    if (buf)
-	free(buf);
+    if (x && xp == NULL)
+	xml_free(x);
     return retval;
- fail:
+}
+
+/*! Free the blocks of a removed subtree, read from file
+ */
+static int
+tree_free_subtree(struct tree_file   *tf,
+		  struct tree_reader *tr,
+		  uint32_t            index)
+{
+    int      retval = -1;
+    char    *p = NULL;
+    uint32_t len;
+    uint32_t pos;
+    int      type;
+    char    *name;
+    char    *value;
+    uint32_t ci = 0;
+    int      ret;
+
+    if (tree_file_record(tf, index) < 0)
+	goto done;
+    if (tree_record_read(tr, index, &p, &len) < 0)
+	goto done;
+    pos = strlen(p) + 1;
+    while ((ret = tree_record_next(p, len, &pos, &type, &name, &value, &ci)) == 1)
+	if (type == CX_ELMNT && tree_free_subtree(tf, tr, ci) < 0)
+	    goto done;
+    if (ret < 0)
+	goto done;
+    if (tree_free(tf, index, tf->tf_map[index]) < 0)
+	goto done;
     retval = 0;
-    goto done;
+ done:
+    return retval;
+}
+
+static int
+uint32_cmp(const void *a,
+	   const void *b)
+{
+    uint32_t ua = *(uint32_t*)a;
+    uint32_t ub = *(uint32_t*)b;
+
+    return ua < ub ? -1 : ua > ub;
 }
 
-/*! Dump xml object to a datastore block 
+/*! Free subtrees of children removed since the record of x was written
+ * Compare element children in the old record with the old block indexes of
+ * the current children.
+ * @param[in]  tf     File allocation state
+ * @param[in]  tr     Record reader of file before write
+ * @param[in]  index  Block index of old record
+ * @param[in]  oldv   Sorted old block indexes of current children
+ * @param[in]  oldlen Length of oldv
  */
 static int
-xml2buf(FILE      *f,
-	cxobj     *x,
-	indexhead *ih,
-	uint32_t  *indexp)
-{
-    int   retval = -1;
-    char  hdr[8] = {0,};
-    int   len; 
-    int   len1;
-    int   ptr;
-    int   i;
-    char *buf0 = NULL;
-    char *buf;
-    uint32_t  myindex;
-    
-    hdr[0] = 1;
-    hdr[1] = 0x80 | xml_type(x);
-    hdr[2] = 0xde;
-    hdr[3] = 0xad;
-    len = sizeof(hdr);
-    if (xml_prefix(x))
-	len += strlen(xml_prefix(x)) + 1; /* colon */
-    len += strlen(xml_name(x)) + 1; /* end-of-string */
-    len = align4(len);
-    switch(xml_type(x)){
-    case CX_ELMNT:
-	len += xml_child_nr(x)*sizeof(uint32_t);
-	break;
-    case CX_BODY:
-    case CX_ATTR:
-	len += strlen(xml_value(x))+1;
-	break;
-    default:
-	break;
+tree_free_removed(struct tree_file   *tf,
+		  struct tree_reader *tr,
+		  uint32_t            index,
+		  uint32_t           *oldv,
+		  size_t              oldlen)
+{
+    int      retval = -1;
+    char    *p = NULL;
+    uint32_t len;
+    uint32_t pos;
+    int      type;
+    char    *name;
+    char    *value;
+    uint32_t ci = 0;
+    int      ret;
+
+    if (tree_record_read(tr, index, &p, &len) < 0)
+	goto done;
+    pos = strlen(p) + 1;
+    while ((ret = tree_record_next(p, len, &pos, &type, &name, &value, &ci)) == 1)
+	if (type == CX_ELMNT &&
+	    bsearch(&ci, oldv, oldlen, sizeof(uint32_t), uint32_cmp) == NULL &&
+	    tree_free_subtree(tf, tr, ci) < 0)
+	    goto done;
+    if (ret < 0)
+	goto done;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Write records of changed nodes of an XML subtree
+ * A clean subtree is not visited. The record of a node is written if the node
+ * is new or changed, or if the block index of an element child changed.
+ * It is written in new blocks, the old blocks are freed when the write is done.
+ * Top-level subtrees not loaded are kept in the record of the root.
+ * @param[in]  tf      File allocation state
+ * @param[in]  fd      File descriptor
+ * @param[in]  tr      Record reader of file before write, for old records
+ * @param[in]  x       XML element
+ * @param[in]  full    Write all records, ignore old block indexes
+ * @param[out] indexp  Block index of record of x
+ */
+static int
+tree_write_node(struct tree_file   *tf,
+		int                 fd,
+		struct tree_reader *tr,
+		cxobj              *x,
+		int                 full,
+		uint32_t           *indexp)
+{
+    int             retval = -1;
+    uint32_t        idx;
+    uint32_t        dirty;
+    int             self;
+    cxobj          *xc;
+    uint32_t        oi;
+    uint32_t        ci;
+    uint32_t       *oldv = NULL;
+    size_t          oldlen = 0;
+    int             rm;
+    struct tree_buf tb = {NULL, 0, 0};
+    char            hdr[DF_HDRLEN] = {DF_VERSION, 0x80|CX_ELMNT, 0, 0};
+    char            type;
+    uint32_t        u;
+    uint32_t        len;
+    uint32_t        nr;
+    uint32_t        newidx;
+    uint32_t        skiplen;
+    uint32_t        i;
+
+    idx = full ? 0 : xml_dsindex(x);
+    dirty = xml_dsdirty(x);
+    if (idx && !dirty){
+	*indexp = idx;
+	return 0;
     }
-    if (index_get(ih, len, &myindex) < 0)
+    if (idx && tree_file_record(tf, idx) < 0)
 	goto done;
-    
-    len1 = htonl(len); /* swap */
-    memcpy(&hdr[4], &len1, 4);
-    /* Write rest
-     */
-    if ((buf0 = malloc(len)) == NULL){
+    self = idx == 0 || (dirty & XML_DSDIRTY_SELF);
+    rm = idx && (dirty & XML_DSDIRTY_RM);
+    skiplen = xml_parent(x) == NULL ? tf->tf_skiplen : 0;
+    if (rm &&
+	(oldv = malloc((xml_child_nr(x)+skiplen)*sizeof(uint32_t)+1)) == NULL){
 	clicon_err(OE_UNIX, errno, "malloc");
 	goto done;
     }
-    buf = buf0+sizeof(hdr);
-    ptr = 0;
-    if (xml_prefix(x)){
-	strcpy(buf, xml_prefix(x));
-	ptr += strlen(xml_prefix(x));
-	buf[ptr++] = ':';
-    }
-    strcpy(&buf[ptr], xml_name(x));
-    ptr += strlen(xml_name(x)) + 1;
-    for (i=ptr; i< align4(ptr); i++)
-	buf[i] = 0;
-    ptr = align4(ptr);
-    if (xml_type(x) != CX_ELMNT){
-	strcpy(&buf[ptr], xml_value(x));
-	ptr += strlen(xml_value(x)) +1;
-    }
-    else{
-	uint32_t index;
-	for (i=0; i< xml_child_nr(x); i++){
-	    if (xml2buf(f, xml_child_i(x, i), ih,
-			&index) < 0)
+    for (i=0; rm && i<skiplen; i++)
+	oldv[oldlen++] = tf->tf_skip[i];
+    /* Write changed children first, they may get new block indexes */
+    xc = NULL;
+    while ((xc = xml_child_each(x, xc, CX_ELMNT)) != NULL){
+	oi = full ? 0 : xml_dsindex(xc);
+	if (rm && oi)
+	    oldv[oldlen++] = oi;
+	if (tree_write_node(tf, fd, tr, xc, full, &ci) < 0)
+	    goto done;
+	if (ci != oi)
+	    self = 1;
+    }
+    if (!self){
+	xml_dsindex_set(x, idx);
+	*indexp = idx;
+	goto ok;
+    }
+    if (rm){
+	qsort(oldv, oldlen, sizeof(uint32_t), uint32_cmp);
+	if (tree_free_removed(tf, tr, idx, oldv, oldlen) < 0)
+	    goto done;
+    }
+    /* Build record */
+    if (tree_buf_append(&tb, hdr, DF_HDRLEN) < 0)
+	goto done;
+    if (tree_buf_name(&tb, x) < 0)
+	goto done;
+    xc = NULL;
+    while ((xc = xml_child_each(x, xc, -1)) != NULL){
+	type = xml_type(xc);
+	if (tree_buf_append(&tb, &type, 1) < 0)
+	    goto done;
+	switch (xml_type(xc)){
+	case CX_ELMNT:
+	    u = htonl(xml_dsindex(xc));
+	    if (tree_buf_append(&tb, &u, 4) < 0)
 		goto done;
-	    index = htonl(index);
-	    memcpy(&buf[ptr], &index, sizeof(uint32_t));
-	    ptr += sizeof(uint32_t);
+	    break;
+	case CX_ATTR:
+	    if (tree_buf_name(&tb, xc) < 0)
+		goto done;
+	    /* fall through */
+	case CX_BODY:
+	    if (tree_buf_append(&tb, xml_value(xc)?xml_value(xc):"",
+				xml_value(xc)?strlen(xml_value(xc))+1:1) < 0)
+		goto done;
+	    break;
+	default:
+	    break;
 	}
     }
-    assert(len == sizeof(hdr)+ptr);
-    /* Note write both here so we dont get an intermediate seek,... */
-    if (fseek(f, myindex*DF_BLOCK, SEEK_SET) < 0){
-	clicon_err(OE_UNIX, errno, "fseek");
-	goto done;
+    for (i=0; i<skiplen; i++){
+	type = CX_ELMNT;
+	u = htonl(tf->tf_skip[i]);
+	if (tree_buf_append(&tb, &type, 1) < 0 ||
+	    tree_buf_append(&tb, &u, 4) < 0)
+	    goto done;
     }
-    memcpy(buf0, hdr, sizeof(hdr));
-    if (fwrite(buf0, sizeof(char), len, f) < 0){
-	clicon_err(OE_XML, errno, "fwrite");
+    len = tb.tb_len - DF_HDRLEN;
+    u = htonl(len);
+    memcpy(tb.tb_buf+4, &u, 4);
+    u = htonl(df_checksum(tb.tb_buf+DF_HDRLEN, len));
+    memcpy(tb.tb_buf+8, &u, 4);
+    /* Place record in free blocks, the old record is in the current tree */
+    nr = df_blocks(len);
+    if (tree_alloc(tf, nr, &newidx) < 0)
+	goto done;
+    if (idx && tree_free(tf, idx, tf->tf_map[idx]) < 0)
+	goto done;
+    if (pwrite(fd, tb.tb_buf, tb.tb_len, (off_t)newidx*DF_BLOCK) != tb.tb_len){
+	clicon_err(OE_UNIX, errno, "pwrite");
 	goto done;
-    }	
-    if (indexp)
-	*indexp = myindex;
+    }
+    xml_dsindex_set(x, newidx);
+    *indexp = newidx;
+ ok:
     retval = 0;
  done:
-    if (buf0)
-	free(buf0);
+    if (tb.tb_buf)
+	free(tb.tb_buf);
+    if (oldv)
+	free(oldv);
     return retval;
 }
 
+/*! Write XML tree to a tree datastore file
+ * If the tree was read from or last written to the file, only changed records
+ * are written, followed by a new superblock. Otherwise the whole tree is 
+ * written to a temporary file which is renamed to filename.
+ * @param[in]  h         Clicon handle
+ * @param[in]  filename  Datastore file
+ * @param[in]  xt        XML tree, top-level is "config"
+ * @retval     0         OK
+ * @retval    -1         Error
+ */
 int
 datastore_tree_write(clicon_handle h,
 		     char         *filename,
 		     cxobj        *xt)
 {
-    int              retval = -1;
-    FILE            *f = NULL;
-    indexhead       ih = {0,};
-    
-    if ((f = fopen(filename, "w+b")) == NULL){
-	clicon_err(OE_XML, errno, "Opening file %s", filename);
+    int                retval = -1;
+    struct tree_file  *tf;
+    struct tree_file  *tf1;
+    int                fd = -1;
+    struct stat        st;
+    int                full;
+    struct tree_super  ts = {0,};
+    struct tree_reader tr = {NULL, 0};
+    cbuf              *cb = NULL;
+    mode_t             mode = S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH|S_IWOTH;
+
+    if ((tf = tree_file_get(filename)) == NULL)
+	goto done;
+    full = tf->tf_root != xt || xml_dsindex(xt) == 0;
+    if (!full){
+	if ((fd = open(filename, O_RDWR)) < 0){
+	    if (errno != ENOENT){
+		clicon_err(OE_XML, errno, "Opening file %s", filename);
+		goto done;
+	    }
+	    full = 1;
+	}
+	else if (fstat(fd, &st) < 0){
+	    clicon_err(OE_UNIX, errno, "fstat(%s)", filename);
+	    goto done;
+	}
+	else if (st.st_size < DF_SUPERNR*DF_BLOCK)
+	    full = 1;
+	else{
+	    if (tree_mmap(fd, st.st_size, &tr) < 0)
+		goto done;
+	    /* Written by others since last read or write */
+	    if (tree_super_find(&tr, &ts) == 0 ||
+		ts.ts_gen != tf->tf_gen || ts.ts_id != tf->tf_id)
+		full = 1;
+	}
+    }
+    /* A full write would lose subtrees not loaded */
+    for (tf1 = _tree_files; full && tf1; tf1 = tf1->tf_next)
+	if (tf1->tf_root == xt && tf1->tf_skiplen){
+	    clicon_err(OE_XML, 0, "%s: tree is not loaded from %s, or file changed",
+		       filename, tf1->tf_name);
+	    goto done;
+	}
+    /* State is invalid until written */
+    tf->tf_root = NULL;
+    if (full){
+	if (tr.tr_buf){
+	    munmap(tr.tr_buf, tr.tr_len);
+	    tr.tr_buf = NULL;
+	}
+	if (fd != -1){
+	    close(fd);
+	    fd = -1;
+	}
+	if (tree_file_reset(tf) < 0)
+	    goto done;
+	ts.ts_gen = 0;
+	ts.ts_id = tree_file_id();
+	if (stat(filename, &st) == 0)
+	    mode = st.st_mode & 0777;
+	if ((cb = cbuf_new()) == NULL){
+	    clicon_err(OE_XML, errno, "cbuf_new");
+	    goto done;
+	}
+	cprintf(cb, "%s.tmp", filename);
+	if ((fd = open(cbuf_get(cb), O_RDWR|O_CREAT|O_TRUNC, mode)) < 0){
+	    clicon_err(OE_XML, errno, "Opening file %s", cbuf_get(cb));
+	    goto done;
+	}
+	/* Block indexes of xt will refer to this file only */
+	for (tf1 = _tree_files; tf1; tf1 = tf1->tf_next)
+	    if (tf1->tf_root == xt)
+		tf1->tf_root = NULL;
+    }
+    if (tree_write_node(tf, fd, &tr, xt, full, &ts.ts_root) < 0)
+	goto done;
+    tree_free_apply(tf);
+    ts.ts_len = tf->tf_len;
+    ts.ts_gen++;
+    /* Records are on disk before the superblock refers to them */
+    if (fsync(fd) < 0){
+	clicon_err(OE_UNIX, errno, "fsync(%s)", filename);
 	goto done;
     }
-    if (xml2buf(f, xt, &ih, NULL) < 0)
+    if (tree_super_write(fd, &ts) < 0)
 	goto done;
-    if (debug)
-	index_dump(stderr, &ih);
+    if (fsync(fd) < 0){
+	clicon_err(OE_UNIX, errno, "fsync(%s)", filename);
+	goto done;
+    }
+    /* Free blocks at the end are only used by the previous superblock */
+    if (ftruncate(fd, (off_t)tf->tf_len*DF_BLOCK) < 0){
+	clicon_err(OE_UNIX, errno, "ftruncate(%s)", filename);
+	goto done;
+    }
+    if (full){
+	if (rename(cbuf_get(cb), filename) < 0){
+	    clicon_err(OE_UNIX, errno, "rename(%s)", filename);
+	    goto done;
+	}
+	cbuf_free(cb);
+	cb = NULL;
+	if (clicon_fsync_dir(filename) < 0)
+	    goto done;
+    }
+    clicon_debug(2, "%s: %s %s write, generation %u, %u blocks", __FUNCTION__,
+		 filename, full?"full":"incremental", ts.ts_gen, tf->tf_len);
+    tf->tf_gen = ts.ts_gen;
+    tf->tf_id = ts.ts_id;
+    tf->tf_root = xt;
     retval = 0;
  done:
-    indexhead_free(&ih);
-    if (f != NULL)
-	fclose(f);
+    if (cb){ /* Temporary file not renamed */
+	unlink(cbuf_get(cb));
+	cbuf_free(cb);
+    }
+    if (tr.tr_buf)
+	munmap(tr.tr_buf, tr.tr_len);
+    if (fd != -1)
+	close(fd);
     return retval;
 }
 
-/*
- * @retval    -1   Error
- * @retval     0   Sanity check failed
- * @retval     1   OK  xp set (or NULL if empty)
+/*! Read XML tree from a tree datastore file
+ * @param[in]  h         Clicon handle
+ * @param[in]  filename  Datastore file
+ * @param[in]  top       Name of top-level subtree to read, or NULL for all
+ * @param[in]  lazy      Bind partial tree to file and keep file mapped
+ * @param[out] xt        XML tree, top-level is "config". Free with xml_free
+ * @retval     1         OK
+ * @retval    -1         Error
+ */
+static int
+tree_read(clicon_handle h,
+	  char         *filename,
+	  char         *top,
+	  int           lazy,
+	  cxobj       **xt)
+{
+    int                retval = -1;
+    int                fd = -1;
+    struct stat        st;
+    struct tree_reader tr = {NULL, 0};
+    struct tree_file  *tf = NULL;
+    struct tree_super  ts;
+    uint32_t           i;
+    cxobj             *x0 = NULL;
+
+    if ((fd = open(filename, O_RDONLY)) < 0){
+	clicon_err(OE_XML, errno, "Opening file %s", filename);
+	goto done;
+    }
+    if (fstat(fd, &st) < 0){
+	clicon_err(OE_UNIX, errno, "fstat(%s)", filename);
+	goto done;
+    }
+    if (st.st_size == 0){ /* empty */
+	if ((x0 = xml_new("config", NULL, NULL)) == NULL)
+	    goto done;
+	xml_type_set(x0, CX_ELMNT);
+	goto ok;
+    }
+    if (tree_mmap(fd, st.st_size, &tr) < 0)
+	goto done;
+    if (tree_super_read(&tr, &ts) < 0)
+	goto done;
+    if (top == NULL || lazy){
+	if ((tf = tree_file_get(filename)) == NULL)
+	    goto done;
+	if (tree_file_reset(tf) < 0)
+	    goto done;
+    }
+    if (lazy){ /* Blocks of subtrees not read are used */
+	if (tree_file_grow(tf, ts.ts_len) < 0)
+	    goto done;
+	for (i=DF_SUPERNR; i<ts.ts_len; i++)
+	    tf->tf_map[i] = DF_MAP_USED;
+	tf->tf_len = ts.ts_len;
+	tf->tf_free = ts.ts_len;
+	tf->tf_lazy = 1;
+    }
+    if (tree_read_node(&tr, tf, ts.ts_root, NULL, top, &x0) < 0)
+	goto done;
+    if (tf){
+	if (ts.ts_len < tf->tf_len){
+	    clicon_err(OE_XML, 0, "%s: records beyond %u blocks", filename, ts.ts_len);
+	    goto done;
+	}
+	tf->tf_len = ts.ts_len;
+	tf->tf_gen = ts.ts_gen;
+	tf->tf_id = ts.ts_id;
+	tf->tf_root = x0;
+	if (tf->tf_skiplen){ /* Keep file mapped until subtrees are loaded */
+	    tf->tf_mem = tr.tr_buf;
+	    tf->tf_memlen = tr.tr_len;
+	    tr.tr_buf = NULL;
+	}
+    }
+ ok:
+    *xt = x0;
+    x0 = NULL;
+    retval = 1;
+ done:
+    if (x0)
+	xml_free(x0);
+    if (tr.tr_buf)
+	munmap(tr.tr_buf, tr.tr_len);
+    if (fd != -1)
+	close(fd);
+    return retval;
+}
+
+/*! Read XML tree from a tree datastore file
+ * If top is NULL the whole file is read and the tree is bound to the file, so
+ * that a following datastore_tree_write only writes changes.
+ * If top is set, only the top-level subtrees with that name (and module-state)
+ * are read, and the tree is not bound to the file.
+ * @param[in]  h         Clicon handle
+ * @param[in]  filename  Datastore file
+ * @param[in]  top       Name of top-level subtree to read, or NULL for all
+ * @param[out] xt        XML tree, top-level is "config". Free with xml_free
+ * @retval     1         OK
+ * @retval    -1         Error
+ * @see datastore_tree_read_lazy  Read subtrees when needed
  */
 int
 datastore_tree_read(clicon_handle h,
 		    char         *filename,
+		    char         *top,
 		    cxobj       **xt)
 {
-    int              retval = -1;
-    FILE            *f = NULL;
-    
-    if ((f = fopen(filename, "r")) == NULL){
-	clicon_err(OE_XML, errno, "Opening file %s", filename);
-	goto done;
+    return tree_read(h, filename, top, 0, xt);
+}
+
+/*! Read XML tree from a tree datastore file, leaving subtrees in the file
+ * Only the root and module-state are read. The file is kept mapped and the 
+ * other top-level subtrees are read into the tree by datastore_tree_load. 
+ * The tree is bound to the file as by datastore_tree_read and can be written
+ * with datastore_tree_write before all subtrees are loaded.
+ * @param[in]  h         Clicon handle
+ * @param[in]  filename  Datastore file
+ * @param[out] xt        XML tree, top-level is "config". Free with xml_free
+ * @retval     1         OK
+ * @retval    -1         Error
+ */
+int
+datastore_tree_read_lazy(clicon_handle h,
+			 char         *filename,
+			 cxobj       **xt)
+{
+    return tree_read(h, filename, "modules-state", 1, xt);
+}
+
+/*! Load top-level subtrees of a lazily read tree from file
+ * Loaded subtrees are bound to yang and the top-level is sorted.
+ * Nothing is done unless xt is the tree last read or written lazily to file.
+ * @param[in]  h         Clicon handle
+ * @param[in]  filename  Datastore file
+ * @param[in]  yspec     Yang spec
+ * @param[in]  xt        XML tree, top-level is "config"
+ * @param[in]  top       Local name of top-level subtrees to load, or NULL for all
+ * @retval     0         OK
+ * @retval    -1         Error
+ */
+int
+datastore_tree_load(clicon_handle h,
+		    char         *filename,
+		    yang_stmt    *yspec,
+		    cxobj        *xt,
+		    char         *top)
+{
+    int                retval = -1;
+    struct tree_file  *tf;
+    struct tree_reader tr;
+    uint32_t           i;
+    uint32_t           j;
+    char              *p;
+    uint32_t           len;
+    cxobj             *xc;
+    int                loaded = 0;
+
+    for (tf = _tree_files; tf; tf = tf->tf_next)
+	if (tf->tf_root == xt && tf->tf_skiplen && strcmp(tf->tf_name, filename) == 0)
+	    break;
+    if (tf == NULL)
+	return 0;
+    tr.tr_buf = tf->tf_mem;
+    tr.tr_len = tf->tf_memlen;
+    for (i=0, j=0; i<tf->tf_skiplen; i++){
+	if (top){
+	    if (tree_record_read(&tr, tf->tf_skip[i], &p, &len) < 0)
+		goto done;
+	    if (strcmp(tree_name_local(p), top) != 0){
+		tf->tf_skip[j++] = tf->tf_skip[i];
+		continue;
+	    }
+	}
+	if (tree_read_node(&tr, tf, tf->tf_skip[i], xt, NULL, &xc) < 0)
+	    goto done;
+	if (xml_apply0(xc, CX_ELMNT, xml_spec_populate, yspec) < 0)
+	    goto done;
+	loaded++;
     }
-    if ((retval = buf2xml(f, 0, xt)) < 0)
+    tf->tf_skiplen = j;
+    if (loaded && xml_sort(xt, NULL) < 0)
 	goto done;
-    if (retval == 0 || /* fail */
-	*xt == NULL){  /* empty */
-	if ((*xt = xml_new("config", NULL, NULL)) == NULL)
-	    goto done;
-	xml_type_set(*xt, CX_ELMNT);
+    if (tf->tf_skiplen == 0){
+	munmap(tf->tf_mem, tf->tf_memlen);
+	tf->tf_mem = NULL;
     }
+    retval = 0;
  done:
-    if (f != NULL)
-	fclose(f);
+    if (retval < 0) /* Subtrees are partly loaded, tree cannot be written */
+	tf->tf_root = NULL;
     return retval;
 }
+
+/*! Get nr of blocks of a tree datastore file read into an XML tree
+ * Blocks of subtrees not loaded by datastore_tree_load are not resident.
+ * @param[in]  filename  Datastore file
+ * @param[out] resident  Nr of blocks of records read into XML
+ * @param[out] total     Nr of blocks in file not known to be free
+ * @retval     1         OK
+ * @retval     0         File is not read or written by this process
+ */
+int
+datastore_tree_stats(char     *filename,
+		     uint32_t *resident,
+		     uint32_t *total)
+{
+    struct tree_file *tf;
+    uint32_t          i;
+
+    for (tf = _tree_files; tf; tf = tf->tf_next)
+	if (strcmp(tf->tf_name, filename) == 0)
+	    break;
+    if (tf == NULL || tf->tf_root == NULL)
+	return 0;
+    *resident = *total = 0;
+    for (i=1; i<tf->tf_len; ){
+	if (tf->tf_map[i] == 0)
+	    i++;
+	else if (tf->tf_map[i] == DF_MAP_USED){ /* Not read */
+	    (*total)++;
+	    i++;
+	}
+	else{
+	    *resident += tf->tf_map[i];
+	    *total += tf->tf_map[i];
+	    i += tf->tf_map[i];
+	}
+    }
+    return 1;
+}
+
+/*! Forget allocation state of a tree datastore file
+ * Call when the file is replaced or removed by other means than
+ * datastore_tree_write, eg copied.
+ * @param[in]  filename  Datastore file
+ * @retval     0         OK
+ */
+int
+datastore_tree_forget(char *filename)
+{
+    struct tree_file **tfp;
+    struct tree_file  *tf;
+
+    for (tfp = &_tree_files; (tf = *tfp) != NULL; tfp = &tf->tf_next)
+	if (strcmp(tf->tf_name, filename) == 0){
+	    *tfp = tf->tf_next;
+	    if (tf->tf_map)
+		free(tf->tf_map);
+	    if (tf->tf_pend)
+		free(tf->tf_pend);
+	    if (tf->tf_skip)
+		free(tf->tf_skip);
+	    if (tf->tf_mem)
+		munmap(tf->tf_mem, tf->tf_memlen);
+	    free(tf->tf_name);
+	    free(tf);
+	    break;
+	}
+    return 0;
+}
@@ -47,44 +47,60 @@
  */
 #define DF_BLOCK 32
 
+#define DF_MAGIC   "CXTR"   /* Superblock magic */
+#define DF_VERSION 3        /* File format version */
+#define DF_HDRLEN  12       /* Record header length */
+
 /*
  * Types
  */
-/* On file                      value (dep of type)
- * off: Offset in bytes to where value starts (name ends +1)
- * len: Total length in bytes (network byte order)
- * childi: Block index to child (network byte order)
- * ELMNT:                       
- * +-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+
- * | 1   | 128 | de  | ad  | len                   | name ...  |  0  |
- * +-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+
- * +-----+-----+-----+-----+-----+-----+-----+------+--
- * | child0 (index in file)|  child1 (index in file)|
- * +-----+-----+-----+-----+-----+-----+-----+-----+--
- * ATTR:
- * +-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+
- * | 1   | 129 | de  | ad  | len                   | name  ... |  0  |
- * +-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+
- * +-----+-----+-----+
- * | value ... | 0   |
- * +-----+-----+-----+
- * BODY: (off = 8)
- * +-----+-----+-----+-----+-----+-----+-----+-----+-----+
- * | 1   | 130 | de  | ad  |   len                 | 0   |
- * +-----+-----+-----+-----+-----+-----+-----+-----+-----+
- * +-----+-----+-----+
- * | value ... | 0   |
- * +-----+-----+-----+
- * FREE
- * +------+
- * | 0    |
- * +------+
-*/
+/* The file is a sequence of DF_BLOCK byte blocks. Blocks 0 and 1 are 
+ * superblock slots, every other block is free or belongs to the record of one
+ * XML element. The valid superblock with the highest generation is used, a
+ * write of generation n writes slot n%2.
+ * All integers are in network byte order.
+ * checksum: FNV-1a 32-bit, of bytes 0-23 (super) or of the payload (record)
+ * SUPER:
+ * +-----+-----+-----+-----+-----+-----+-----+-----+
+ * | C   | X   | T   | R   | 3   | 0   | 0   | 0   |
+ * +-----+-----+-----+-----+-----+-----+-----+-----+
+ * | root (block index)    | nr of blocks in file  |
+ * +-----+-----+-----+-----+-----+-----+-----+-----+
+ * | generation            | file id               |
+ * +-----+-----+-----+-----+-----+-----+-----+-----+
+ * | checksum              |
+ * +-----+-----+-----+-----+
+ * RECORD: header followed by len bytes of payload, allocated in
+ * (DF_HDRLEN+len)/DF_BLOCK rounded up consecutive blocks
+ * +-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+
+ * | 3   | 128 | 0   | 0   | len                   | checksum              |
+ * +-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+
+ * Payload: element name, then one entry per child in child order
+ * +-----+-----+-----+-----+
+ * | [prefix:]name ... | 0 |
+ * +-----+-----+-----+-----+
+ * ELMNT child: block index of child record
+ * +-----+-----+-----+-----+-----+
+ * | 0   | index                 |
+ * +-----+-----+-----+-----+-----+
+ * ATTR child:
+ * +-----+-----+-----+-----+-----+-----+-----+-----+
+ * | 1   | [prefix:]name ... | 0 | value ... | 0   |
+ * +-----+-----+-----+-----+-----+-----+-----+-----+
+ * BODY child:
+ * +-----+-----+-----+-----+
+ * | 2   | value ... | 0   |
+ * +-----+-----+-----+-----+
+ */
 
 /*
  * Prototypes
  */
 int datastore_tree_write(clicon_handle h, char *filename, cxobj *xt);
-int datastore_tree_read(clicon_handle h, char *filename, cxobj **xt);
+int datastore_tree_read(clicon_handle h, char *filename, char *top, cxobj **xt);
+int datastore_tree_read_lazy(clicon_handle h, char *filename, cxobj **xt);
+int datastore_tree_load(clicon_handle h, char *filename, yang_stmt *yspec, cxobj *xt, char *top);
+int datastore_tree_stats(char *filename, uint32_t *resident, uint32_t *total);
+int datastore_tree_forget(char *filename);
 
 #endif  /* _CLIXON_DATASTORE_TREE_H_ */
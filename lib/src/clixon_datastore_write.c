@@ -82,6 +82,7 @@
 #include "clixon_datastore_write.h"
 #include "clixon_datastore_read.h"
 #include "clixon_datastore_tree.h"
+#include "clixon_datastore_journal.h"
 
 /*! Given an attribute name and its expected namespace, find its value
  * 
@@ -204,6 +205,22 @@ check_identityref(cxobj     *x0,
     return retval;
 }
 
+/*! Remove a base tree node and record it as removed from its parent
+ * The edit marks are used to diff datastores incrementally, only visiting
+ * edited and removed nodes.
+ * @param[in]  x    Base XML tree node
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @see xml_diff_edit
+ */
+static int
+text_purge(cxobj *x)
+{
+    if (xml_parent(x) && xml_edit_removed(xml_parent(x), x) < 0)
+	return -1;
+    return xml_purge(x);
+}
+
 /*! Modify a base tree x0 with x1 with yang spec y according to operation op
  * @param[in]  th       Datastore text handle
  * @param[in]  x0       Base xml tree (can be NULL in add scenarios)
@@ -329,7 +346,8 @@ text_modify(clicon_handle       h,
 		 * original object is not reverted.
 		 */
 		if (x0){
-		    xml_purge(x0);
+		    if (text_purge(x0) < 0)
+			goto done;
 		    x0 = NULL;
 		}
 	    } /* OP_MERGE & insert */
@@ -377,12 +395,16 @@ text_modify(clicon_handle       h,
 			}
 			if (xml_value_set(x0b, x1bstr) < 0)
 			    goto done;
+			if (xml_edit_mark(x0) < 0)
+			    goto done;
 		    }
 		}
 	    }
 	    if (changed){ 
 		if (xml_insert(x0p, x0, insert, valstr, NULL) < 0) 
 		    goto done;
+		if (xml_edit_mark(x0) < 0)
+		    goto done;
 	    }
 	    break;
 	case OP_DELETE:
@@ -399,7 +421,7 @@ text_modify(clicon_handle       h,
 		    if (ret == 0)
 			goto fail;
 		}
-		if (xml_purge(x0) < 0)
+		if (text_purge(x0) < 0)
 		    goto done;
 	    }
 	    break;
@@ -466,7 +488,8 @@ text_modify(clicon_handle       h,
 		 * original object is not reverted.
 		 */
 		if (x0){
-		    xml_purge(x0);
+		    if (text_purge(x0) < 0)
+			goto done;
 		    x0 = NULL;
 		}
 	    } /* OP_MERGE & insert */
@@ -495,6 +518,8 @@ text_modify(clicon_handle       h,
 		    goto done;
 		if (xml_copy(x1, x0) < 0)
 		    goto done;
+		if (xml_edit_mark(x0) < 0)
+		    goto done;
 		break;
 	    }
 	    if (x0==NULL){
@@ -552,7 +577,7 @@ text_modify(clicon_handle       h,
 		    goto done;
 		if (x0c && (yc != xml_spec(x0c))){
 		    /* There is a match but is should be replaced (choice)*/
-		    if (xml_purge(x0c) < 0)
+		    if (text_purge(x0c) < 0)
 			goto done;
 		    x0c = NULL;
 		}
@@ -578,6 +603,8 @@ text_modify(clicon_handle       h,
 	    if (changed){
 		if (xml_insert(x0p, x0, insert, keystr, nscx1) < 0)
 		    goto done;
+		if (xml_edit_mark(x0) < 0)
+		    goto done;
 	    }
 	    break;
 	case OP_DELETE:
@@ -594,7 +621,7 @@ text_modify(clicon_handle       h,
 		    if (ret == 0)
 			goto fail;
 		}
-		if (xml_purge(x0) < 0)
+		if (text_purge(x0) < 0)
 		    goto done;
 	    }
 	    break;
@@ -677,7 +704,7 @@ text_modify_top(clicon_handle       h,
 		    permit = 1;
 		}
 		while ((x0c = xml_child_i(x0, 0)) != 0)
-		    if (xml_purge(x0c) < 0)
+		    if (text_purge(x0c) < 0)
 			goto done;
 		break;
 	    default:
@@ -711,7 +738,7 @@ text_modify_top(clicon_handle       h,
 	    permit = 1;
 	}
 	while ((x0c = xml_child_i(x0, 0)) != 0)
-	    if (xml_purge(x0c) < 0)
+	    if (text_purge(x0c) < 0)
 		goto done;
     }
     /* Loop through children of the modification tree */
@@ -734,7 +761,7 @@ text_modify_top(clicon_handle       h,
 	    goto done;
 	if (x0c && (yc != xml_spec(x0c))){
 	    /* There is a match but is should be replaced (choice)*/
-	    if (xml_purge(x0c) < 0)
+	    if (text_purge(x0c) < 0)
 		goto done;
 	    x0c = NULL;
 	}
@@ -784,13 +811,83 @@ xml_container_presence(cxobj  *x,
     /* Mark node that is: container, have no children, dont have presence */
     if (yang_keyword_get(y) == Y_CONTAINER && 
 	xml_child_nr_notype(x, CX_ATTR)==0 &&
-	yang_find(y, Y_PRESENCE, NULL) == NULL)
+	yang_find(y, Y_PRESENCE, NULL) == NULL){
 	xml_flag_set(x, XML_FLAG_MARK); /* Mark, remove later */
+	if (xml_parent(x) && xml_edit_removed(xml_parent(x), x) < 0)
+	    goto done;
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Clean up base tree after modification
+ * Remove NONE nodes and non-presence containers without children
+ * @param[in]  x0   Base xml tree
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+text_modify_cleanup(cxobj *x0)
+{
+    int retval = -1;
+
+    /* Remove NONE nodes if all subs recursively are also NONE */
+    if (xml_tree_prune_flagged_sub(x0, XML_FLAG_NONE, 0, NULL) <0)
+	goto done;
+    if (xml_apply(x0, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, 
+		  (void*)(XML_FLAG_NONE|XML_FLAG_MARK)) < 0)
+	goto done;
+    /* Mark non-presence containers that do not have children */
+    if (xml_apply(x0, CX_ELMNT, (xml_applyfn_t*)xml_container_presence, NULL) < 0)
+	goto done;
+    /* Remove (prune) nodes that are marked (non-presence containers w/o children) */
+    if (xml_tree_prune_flagged(x0, XML_FLAG_MARK, 1) < 0)
+	goto done;
     retval = 0;
  done:
     return retval;
 }
 
+/*! Modify an xml tree with a modification tree, without access control
+ * Same modification as xmldb_put but on a given base tree and no file is
+ * written. Used when replaying a datastore journal.
+ * @param[in]  h      Clicon handle
+ * @param[in]  x0     Base xml tree, top-level is "config"
+ * @param[in]  x1     Modification xml tree, top-level is "config"
+ * @param[in]  yspec  Top-level yang spec
+ * @param[in]  op     Top-level operation, can be superceded by other op in tree
+ * @param[out] cbret  Initialized cligen buffer. Contains error XML if retval is 0
+ * @retval     1      OK
+ * @retval     0      Failed, cbret contains error xml message
+ * @retval    -1      Error
+ * @see xmldb_put
+ */
+int
+xmldb_put_tree(clicon_handle       h,
+	       cxobj              *x0,
+	       cxobj              *x1,
+	       yang_stmt          *yspec,
+	       enum operation_type op,
+	       cbuf               *cbret)
+{
+    int retval = -1;
+    int ret;
+
+    if ((ret = text_modify_top(h, x0, x1, yspec, op, NULL, NULL, 1, cbret)) < 0)
+	goto done;
+    if (ret == 0)
+	goto fail;
+    if (text_modify_cleanup(x0) < 0)
+	goto done;
+    retval = 1;
+ done:
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
 /*! Modify database given an xml tree and an operation
  *
  * @param[in]  h      CLICON handle
@@ -840,6 +937,7 @@ xmldb_put(clicon_handle       h,
     char               *format;
     cvec               *nsc = NULL; /* nacm namespace context */
     int                 firsttime = 0;
+    cbuf               *cbj = NULL; /* journal record */
 
     if (cbret == NULL){
 	clicon_err(OE_XML, EINVAL, "cbret is NULL");
@@ -877,6 +975,22 @@ xmldb_put(clicon_handle       h,
 	clicon_log(LOG_NOTICE, "%s: verify failed #1", __FUNCTION__);
 #endif
     mode = clicon_option_str(h, "CLICON_NACM_MODE");
+    /* Load top-level subtrees of a lazily read datastore that the edit refers
+     * to, or all if the top-level itself is edited */
+    if (x1 == NULL || (op != OP_MERGE && op != OP_NONE) || 
+	xml_child_nr_type(x1, CX_ATTR)){
+	if (xmldb_load(h, db, x0, NULL) < 0)
+	    goto done;
+    }
+    else{
+	x = NULL;
+	while ((x = xml_child_each(x1, x, CX_ELMNT)) != NULL)
+	    if (xmldb_load(h, db, x0, xml_name(x)) < 0)
+		goto done;
+    }
+    if (mode && strcmp(mode, "internal")==0 &&
+	xmldb_load(h, db, x0, "nacm") < 0)
+	goto done;
     if (mode){
 	if (strcmp(mode, "external")==0)
 	    xnacm0 = clicon_nacm_ext(h);
@@ -894,6 +1008,26 @@ xmldb_put(clicon_handle       h,
 	    goto done;
     }
     /* Here assume if xnacm is set and !permit do NACM */
+    if ((format = clicon_option_str(h, "CLICON_XMLDB_FORMAT")) == NULL){
+	clicon_err(OE_CFG, ENOENT, "No CLICON_XMLDB_FORMAT");
+	goto done;
+    }
+    /* Journal record is made before x1 is modified, see text_modify */
+    if (strcmp(format, "journal") == 0 && x1 &&
+	xmldb_journal_record(x1, op, &cbj) < 0)
+	goto done;
+    /* Deferred copy if the cache is shared with another database, made just
+     * before the edit. Only the root is copied if all of it is replaced and
+     * the edit cannot be denied by NACM */
+    if (!firsttime && clicon_datastore_cache(h) != DATASTORE_NOCACHE){
+	if (xmldb_cache_unshare(h, db,
+				x1 && (op == OP_REPLACE || op == OP_DELETE) &&
+				xml_child_nr_type(x1, CX_ATTR) == 0 &&
+				(permit || xnacm == NULL)) < 0)
+	    goto done;
+	if ((de = clicon_db_elmnt_get(h, db)) != NULL)
+	    x0 = de->de_xml;
+    }
     /* 
      * Modify base tree x with modification x1. This is where the
      * new tree is made.
@@ -910,17 +1044,8 @@ xmldb_put(clicon_handle       h,
 	goto fail;
     }
 
-    /* Remove NONE nodes if all subs recursively are also NONE */
-    if (xml_tree_prune_flagged_sub(x0, XML_FLAG_NONE, 0, NULL) <0)
-	goto done;
-    if (xml_apply(x0, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, 
-		  (void*)(XML_FLAG_NONE|XML_FLAG_MARK)) < 0)
-	goto done;
-    /* Mark non-presence containers that do not have children */
-    if (xml_apply(x0, CX_ELMNT, (xml_applyfn_t*)xml_container_presence, NULL) < 0)
-	goto done;
-    /* Remove (prune) nodes that are marked (non-presence containers w/o children) */
-    if (xml_tree_prune_flagged(x0, XML_FLAG_MARK, 1) < 0)
+    /* Remove NONE nodes and non-presence containers w/o children */
+    if (text_modify_cleanup(x0) < 0)
 	goto done;
 #if 0 /* debug */
     if (xml_apply0(x0, -1, xml_sort_verify, NULL) < 0)
@@ -934,8 +1059,10 @@ xmldb_put(clicon_handle       h,
 	    de0 = *de;
 	if (de0.de_xml == NULL){
 	    de0.de_xml = x0;
-	    clicon_db_elmnt_set(h, db, &de0);
+	    de0.de_base = 0; /* Read from file */
 	}
+	de0.de_valid = 0; /* Edited, see xmldb_validated */
+	clicon_db_elmnt_set(h, db, &de0);
     }
     if (xmldb_db2file(h, db, &dbfile) < 0)
 	goto done;
@@ -952,14 +1079,15 @@ xmldb_put(clicon_handle       h,
 	if (xml_addsub(x0, xmodst) < 0)
 	    goto done;
     }
-    if ((format = clicon_option_str(h, "CLICON_XMLDB_FORMAT")) == NULL){
-	clicon_err(OE_CFG, ENOENT, "No CLICON_XMLDB_FORMAT");
-	goto done;
-    }
    if (strcmp(format, "tree") == 0){
        	if (datastore_tree_write(h, dbfile, x0) < 0)
 	    goto done;
    }
+   else if (strcmp(format, "journal") == 0){
+       /* Append edit to journal, or write snapshot of x0 */
+       if (xmldb_journal_write(h, dbfile, cbj, x0) < 0)
+	   goto done;
+   }
    else{
        if ((f = fopen(dbfile, "w")) == NULL){
 	   clicon_err(OE_CFG, errno, "Creating file %s", dbfile);
@@ -980,6 +1108,8 @@ xmldb_put(clicon_handle       h,
  done:
     if (f != NULL)
 	fclose(f);
+    if (cbj)
+	cbuf_free(cbj);
     if (nsc)
 	xml_nsctx_free(nsc);
     if (dbfile)
@@ -44,5 +44,6 @@
  * Prototypes
  */
 int xmldb_put(clicon_handle h, const char *db, enum operation_type op, cxobj *xt, char *username, cbuf *cbret);
+int xmldb_put_tree(clicon_handle h, cxobj *x0, cxobj *x1, yang_stmt *yspec, enum operation_type op, cbuf *cbret);
 
 #endif /* _CLIXON_DATASTORE_WRITE_H */
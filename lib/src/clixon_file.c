@@ -44,6 +44,7 @@
 #include <dirent.h>
 #include <regex.h>
 #include <fcntl.h>
+#include <libgen.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/param.h>
@@ -208,3 +209,159 @@ clicon_file_copy(char *src,
 	errno = err;
     return retval;
 }
+
+/*! Sync the directory of a file, making a create, rename or unlink durable
+ * @param[in]  path   Filename
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+int
+clicon_fsync_dir(const char *path)
+{
+    int   retval = -1;
+    char *dir = NULL;
+    int   fd = -1;
+
+    if ((dir = strdup(path)) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	goto done;
+    }
+    if ((fd = open(dirname(dir), O_RDONLY)) < 0){
+	clicon_err(OE_UNIX, errno, "open(%s)", dir);
+	goto done;
+    }
+    if (fsync(fd) < 0){
+	clicon_err(OE_UNIX, errno, "fsync(%s)", dir);
+	goto done;
+    }
+    retval = 0;
+ done:
+    if (fd != -1)
+	close(fd);
+    if (dir)
+	free(dir);
+    return retval;
+}
+
+/*! Find first occurrence of tag in a buffer of given length (not null-terminated)
+ * @param[in]  buf    Buffer to search
+ * @param[in]  len    Length of buffer
+ * @param[in]  tag    Tag to search for
+ * @param[in]  taglen Length of tag
+ * @retval     p      Pointer to first occurrence of tag in buf
+ * @retval     NULL   Tag not found
+ */
+static char *
+clicon_file_memstr(char  *buf,
+		   size_t len,
+		   char  *tag,
+		   size_t taglen)
+{
+    char *p = buf;
+    char *end = buf + len;
+
+    while (end - p >= (ssize_t)taglen &&
+	   (p = memchr(p, tag[0], end - p - taglen + 1)) != NULL){
+	if (memcmp(p, tag, taglen) == 0)
+	    return p;
+	p++;
+    }
+    return NULL;
+}
+
+/*! Read from file descriptor until endtag or end-of-file into a malloced buffer
+ *
+ * Reads in large blocks. If the file is regular, the initial buffer is sized 
+ * after the remaining file size so that a whole file is typically read in
+ * one read(2). If endtag is found the file offset is positioned right after
+ * the endtag, as if reading one byte at a time.
+ * Non-seekable descriptors (pipes, sockets) with an endtag are read one byte
+ * at a time since data after the endtag cannot be pushed back.
+ * @param[in]  fd      File descriptor
+ * @param[in]  endtag  Read until encounter "endtag" in the stream, or NULL
+ * @param[out] bufp    Malloced null-terminated buffer. Free after use
+ * @param[out] lenp    Length of buffer (excluding null-character), or NULL
+ * @retval     0       OK
+ * @retval    -1       Error with clicon_err called
+ * @code
+ *   char  *buf = NULL;
+ *   size_t len;
+ *   if (clicon_file_read(fd, "</config>", &buf, &len) < 0)
+ *      err;
+ *   free(buf);
+ * @endcode
+ */
+int
+clicon_file_read(int     fd,
+		 char   *endtag,
+		 char  **bufp,
+		 size_t *lenp)
+{
+    int         retval = -1;
+    char       *buf = NULL;
+    size_t      buflen = BUFSIZ;
+    size_t      len = 0;
+    size_t      endtaglen = 0;
+    size_t      from;
+    ssize_t     ret;
+    int         seekable = 0;
+    struct stat st;
+    off_t       off;
+    char       *p;
+
+    if (endtag != NULL)
+	endtaglen = strlen(endtag);
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+	(off = lseek(fd, 0, SEEK_CUR)) >= 0){
+	seekable = 1;
+	if (st.st_size - off + 1 > (off_t)buflen)
+	    buflen = st.st_size - off + 1;
+    }
+    if ((buf = malloc(buflen)) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    while (1){
+	if (len >= buflen-1){ /* Space: one for the null character */
+	    if ((p = realloc(buf, buflen*2)) == NULL){
+		clicon_err(OE_UNIX, errno, "realloc");
+		goto done;
+	    }
+	    buf = p;
+	    buflen *= 2;
+	}
+	if ((ret = read(fd, buf+len, 
+			(endtag && !seekable)?1:buflen-len-1)) < 0){
+	    clicon_err(OE_UNIX, errno, "read");
+	    goto done;
+	}
+	if (ret == 0)
+	    break;
+	if (endtag){
+	    /* Only search new data and the part of the endtag possibly before */
+	    from = len > endtaglen ? len - endtaglen + 1 : 0;
+	    if ((p = clicon_file_memstr(buf+from, len+ret-from,
+					endtag, endtaglen)) != NULL){
+		/* Leave file offset after endtag */
+		if (seekable && p+endtaglen < buf+len+ret &&
+		    lseek(fd, (p+endtaglen)-(buf+len+ret), SEEK_CUR) < 0){
+		    clicon_err(OE_UNIX, errno, "lseek");
+		    goto done;
+		}
+		len = (p+endtaglen) - buf;
+		break;
+	    }
+	}
+	len += ret;
+    }
+    buf[len] = '\0';
+    *bufp = buf;
+    buf = NULL;
+    if (lenp)
+	*lenp = len;
+    retval = 0;
+ done:
+    if (buf)
+	free(buf);
+    return retval;
+}
@@ -48,6 +48,7 @@
 #include <cligen/cligen.h>
 
 /* clicon */
+#include "clixon_string.h"
 #include "clixon_queue.h"
 #include "clixon_hash.h"
 #include "clixon_handle.h"
@@ -55,6 +56,8 @@
 #include "clixon_err.h"
 #include "clixon_yang.h"
 #include "clixon_xml.h"
+#include "clixon_xpath_ctx.h"
+#include "clixon_xpath.h"
 #include "clixon_stream.h"
 #include "clixon_data.h"
 #include "clixon_options.h"
@@ -161,6 +164,7 @@ clicon_handle_exit(clicon_handle h)
     if ((ha = clicon_db_elmnt(h)) != NULL)
 	clicon_hash_free(ha);
     stream_delete_all(h, 1);
+    xpath_cache_flush();
     free(ch);
     retval = 0;
     return retval;
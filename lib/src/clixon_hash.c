@@ -383,3 +383,43 @@ clicon_hash_dump(clicon_hash_t *hash,
 	free(keys);
     return retval;
 }
+
+/*! Hash a buffer with 32-bit FNV-1a
+ * Hash values of several buffers may be chained by passing the hash of the
+ * preceding buffers as initial value.
+ * @param[in]  h     Initial value: CLICON_HASH_FNV1A_INIT, or preceding hash
+ * @param[in]  buf   Buffer
+ * @param[in]  len   Length of buf
+ * @retval     h     Hash value
+ * @see clicon_hash_fnv1a_str  For null-terminated strings
+ */
+uint32_t
+clicon_hash_fnv1a(uint32_t    h,
+		  const void *buf,
+		  size_t      len)
+{
+    const unsigned char *p = buf;
+
+    while (len--){
+	h ^= *p++;
+	h *= 16777619U;
+    }
+    return h;
+}
+
+/*! Hash a null-terminated string with 32-bit FNV-1a
+ * @param[in]  h     Initial value: CLICON_HASH_FNV1A_INIT, or preceding hash
+ * @param[in]  str   Null-terminated string
+ * @retval     h     Hash value
+ * @see clicon_hash_fnv1a
+ */
+uint32_t
+clicon_hash_fnv1a_str(uint32_t    h,
+		      const char *str)
+{
+    while (*str){
+	h ^= (unsigned char)*str++;
+	h *= 16777619U;
+    }
+    return h;
+}
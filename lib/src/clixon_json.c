@@ -50,6 +50,7 @@
 #include <stdint.h>
 #include <syslog.h>
 #include <assert.h>
+#include <sys/types.h>
 
 /* cligen */
 #include <cligen/cligen.h>
@@ -71,6 +72,7 @@
 #include "clixon_netconf_lib.h"
 #include "clixon_json.h"
 #include "clixon_json_parse.h"
+#include "clixon_file.h"
 
 #define JSON_INDENT 2 /* maybe we should set this programmatically? */
 
@@ -79,9 +81,6 @@
 */
 #define VEC_ARRAY 1
 
-/* Size of json read buffer when reading from file*/
-#define BUFLEN 1024
-
 /* Name of xml top object created by xml parse functions */
 #define JSON_TOP_SYMBOL "top"
 
@@ -1252,55 +1251,27 @@ json_parse_file(int        fd,
 		cxobj    **xt,
 		cxobj    **xerr)
 {
-    int   retval = -1;
-    int   ret;
-    char *jsonbuf = NULL;
-    int   jsonbuflen = BUFLEN; /* start size */
-    int   oldjsonbuflen;
-    char *ptr;
-    char  ch;
-    int   len = 0;
+    int    retval = -1;
+    int    ret;
+    char  *jsonbuf = NULL;
+    size_t len = 0;
     
-    if ((jsonbuf = malloc(jsonbuflen)) == NULL){
-	clicon_err(OE_XML, errno, "malloc");
+    /* Read whole file in blocks, not one byte at a time */
+    if (clicon_file_read(fd, NULL, &jsonbuf, &len) < 0)
 	goto done;
-    }
-    memset(jsonbuf, 0, jsonbuflen);
-    ptr = jsonbuf;
-    while (1){
-	if ((ret = read(fd, &ch, 1)) < 0){
-	    clicon_err(OE_XML, errno, "read");
-	    break;
-	}
-	if (ret != 0)
-	    jsonbuf[len++] = ch;
-	if (ret == 0){
-	    if (*xt == NULL)
-		if ((*xt = xml_new(JSON_TOP_SYMBOL, NULL, NULL)) == NULL)
-		    goto done;
-	    if (len){
-		if ((ret = json_parse(ptr, yspec, "", *xt, xerr)) < 0)
-		    goto done;
-		if (ret == 0)
-		    goto fail;
-	    }
-	    break;
-	}
-	if (len>=jsonbuflen-1){ /* Space: one for the null character */
-	    oldjsonbuflen = jsonbuflen;
-	    jsonbuflen *= 2;
-	    if ((jsonbuf = realloc(jsonbuf, jsonbuflen)) == NULL){
-		clicon_err(OE_XML, errno, "realloc");
-		goto done;
-	    }
-	    memset(jsonbuf+oldjsonbuflen, 0, jsonbuflen-oldjsonbuflen);
-	    ptr = jsonbuf;
-	}
+    if (*xt == NULL)
+	if ((*xt = xml_new(JSON_TOP_SYMBOL, NULL, NULL)) == NULL)
+	    goto done;
+    if (len){
+	if ((ret = json_parse(jsonbuf, yspec, "", *xt, xerr)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
     }
     retval = 1;
  done:
     if (retval < 0 && *xt){
-	free(*xt);
+	xml_free(*xt);
 	*xt = NULL;
     }
     if (jsonbuf)
@@ -47,7 +47,9 @@
 #include <string.h>
 #include <limits.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <assert.h>
+#include <sys/types.h>
 
 /* cligen */
 #include <cligen/cligen.h>
@@ -66,12 +68,11 @@
 #include "clixon_xml_sort.h"
 #include "clixon_xml_parse.h"
 #include "clixon_xml_nsctx.h"
+#include "clixon_file.h"
 
 /*
  * Constants
  */
-/* Size of xml read buffer */
-#define BUFLEN 1024  
 /* Indentation for xml pretty-print. Consider option? */
 #define XML_INDENT 3 
 /* Name of xml top object created by xml parse functions */
@@ -80,11 +81,149 @@
 #define XML_CHILDVEC_MAX_DEFAULT 4
 /* Initial length of x_value malloced string */
 #define XML_VALUE_MAX_DEFAULT 32
+/* Size of arena memory blocks, larger requests get a block of their own */
+#define XML_ARENA_BLOCK_SIZE 65536
+/* Arena allocation alignment */
+#define XML_ARENA_ALIGN(n) (((n)+sizeof(void*)-1) & ~(sizeof(void*)-1))
+/* Initial number of buckets in symbol table, power of 2 (and then doubled) */
+#define XML_SYMTAB_SIZE_DEFAULT 1024
+/* Initial number of buckets in a list key index */
+#define XML_INDEX_SIZE_DEFAULT 64
+/* Number of children from which the children of a (non-arena) node are stored 
+ * in chunks, so that insert and remove do not move the whole child vector */
+#define XML_CHILDVEC_CHUNKED_MIN 4096
+/* Max number of children in a chunk */
+#define XML_CHUNK_MAX 512
+/* Value of x_childvec_max if children are stored in chunks, see x_ext */
+#define XML_CHILDVEC_CHUNKED -1
 
 /*
  * Types
  */
 
+/*! Arena memory block, data follows directly after the header */
+struct xml_arena_block{
+    struct xml_arena_block *ab_next;  /* Next (older) block */
+    size_t                  ab_size;  /* Size of data */
+    size_t                  ab_used;  /* Bytes of data used */
+};
+
+/*! Reference held by an arena, released when the arena is released
+ * @see xml_arena_ref
+ */
+struct xml_arena_ref{
+    struct xml_arena_ref *ar_next;    /* Next reference */
+    void                 *ar_p;       /* Referenced node or symbol */
+};
+
+/*! Arena from which a whole xml tree is bump-allocated
+ * Nodes, values and child vectors of all nodes created under
+ * an arena top node are allocated from the arena and are never freed one by
+ * one. The arena is released when its last root is freed, where a root is a 
+ * node of the arena that is not a child of another node of the same arena.
+ * Releasing the arena does not visit its nodes, only the references it holds.
+ * @see xml_new_arena
+ * @see xml_arena_release
+ */
+struct xml_arena{
+    struct xml_arena_block *xa_block;   /* Current block, older blocks linked */
+    char                   *xa_last;    /* Last allocation, may be extended */
+    int                     xa_roots;   /* Number of live roots in arena */
+    struct xml_arena_ref   *xa_ext;     /* Nodes with side structure, whose
+					   contents are heap memory */
+    struct xml_arena_ref   *xa_foreign; /* Children of arena nodes that are
+					   not allocated from the arena */
+    struct xml_arena_ref   *xa_syms;    /* Symbols referenced by arena nodes */
+};
+
+/*! Rarely used xml node fields, allocated on demand
+ * Most nodes, in particular bodies, never set them.
+ * @see xml_ext_get
+ */
+struct xml_ext{
+    cg_var           *xe_cv;        /* Cached value as cligen variable 
+                                       (eg xml_cmp) */
+    cvec             *xe_ns_cache;  /* Cached vector of namespaces */
+    struct xml_key   *xe_keys;      /* Cached key tuple of list entry (malloced) */
+    int               xe_keys_len;  /* Number of keys in xe_keys */
+    struct xml_index *xe_index;     /* Hash index of keyed list children */
+    struct xml_chunks *xe_chunks;   /* Children if stored in chunks */
+    struct xml_edits *xe_edits;     /* Edited and removed children */
+};
+
+/*! Chunk of children of a node with many children
+ */
+struct xml_chunk{
+    int               xch_len;                /* Number of children in chunk */
+    struct xml       *xch_vec[XML_CHUNK_MAX]; /* Children */
+};
+
+/*! Children of a node stored as an ordered vector of chunks
+ * A child is found by binary search on the start index of the chunks. 
+ * Insert and remove only move children within a chunk and update start 
+ * indexes of the following chunks.
+ * Chunks are never empty, unless there is a single chunk.
+ * @see xml_chunks_split
+ */
+struct xml_chunks{
+    struct xml_chunk **xcs_vec;   /* Chunks in child order */
+    int               *xcs_start; /* Index of first child of each chunk */
+    int                xcs_len;   /* Number of chunks */
+    int                xcs_max;   /* Allocated length of xcs_vec and xcs_start */
+    int                xcs_last;  /* Last chunk accessed, eg when iterating */
+};
+
+/*! Entry in hash index of keyed list children
+ */
+struct xml_index_entry{
+    struct xml_index_entry *xie_next;  /* Next entry in hash bucket */
+    uint32_t                xie_hash;  /* Hash of spec and key tuple of xie_x */
+    cxobj                  *xie_x;     /* Indexed list entry */
+};
+
+/*! Hash index from key tuple to list entry, on a parent node
+ * Only list entries whose key tuple is cached are indexed, and an entry is
+ * removed from the index when its key tuple is cleared. The index is
+ * therefore never stale, but it may be incomplete, a miss must be verified
+ * by other means.
+ * @see xml_index_add
+ * @see xml_index_find
+ */
+struct xml_index{
+    struct xml_index_entry **xi_tab;   /* Hash buckets */
+    uint32_t                 xi_size;  /* Number of buckets, power of 2 */
+    uint32_t                 xi_nr;    /* Number of entries */
+};
+
+/*! Edited and removed children of a node marked with XML_FLAG_EDIT
+ * Lets an incremental diff visit only the edits of a node, not all children.
+ * A child is in xed_vec if and only if it is marked with XML_FLAG_EDIT.
+ * Removed children are kept as detached copies with only their keys (list) 
+ * or value (leaf-list), enough to find the same node in another tree.
+ * @see xml_edit_mark
+ * @see xml_edit_removed
+ */
+struct xml_edits{
+    struct xml **xed_vec;    /* Children marked with XML_FLAG_EDIT */
+    int          xed_len;    /* Length of xed_vec */
+    int          xed_max;    /* Allocated length of xed_vec */
+    struct xml **xed_rm;     /* Copies of removed children */
+    int          xed_rmlen;  /* Length of xed_rm */
+    int          xed_rmmax;  /* Allocated length of xed_rm */
+};
+
+/*! Interned string, shared by all xml nodes with same name or prefix
+ * @see xml_symbol_get
+ */
+struct xml_symbol{
+    struct xml_symbol *xs_next;  /* Next symbol in hash bucket */
+    uint32_t           xs_hash;  /* Hash value of xs_str */
+    uint32_t           xs_refs;  /* Number of references to symbol */
+    struct xml_arena  *xs_arena; /* Last arena that took a reference, 
+				    see xml_node_symbol_get */
+    char               xs_str[]; /* Null-terminated string */
+};
+
 /*! xml tree node, with name, type, parent, children, etc 
  * Note that this is a private type not visible from externally, use
  * access functions.
@@ -122,22 +261,43 @@ struct xml{
     char             *x_name;       /* name of node */
     char             *x_prefix;     /* namespace localname N, called prefix */
     struct xml       *x_up;         /* parent node in hierarchy if any */
-    struct xml      **x_childvec;   /* vector of children nodes */
-    int               x_childvec_len;/* Number of children */
-    int               x_childvec_max;/* Length of allocated vector */
-    enum cxobj_type   x_type;       /* type of node: element, attribute, body */
-    cbuf             *x_value_cb;   /* attribute and body nodes have values */
-    int               x_flags;      /* Flags according to XML_FLAG_* */
     yang_stmt        *x_spec;       /* Pointer to specification, eg yang, by 
 				       reference, dont free */
-    cg_var           *x_cv;         /* Cached value as cligen variable 
-                                       (eg xml_cmp) */
-    cvec             *x_ns_cache;   /* Cached vector of namespaces */
+    struct xml_ext   *x_ext;        /* Lazily allocated caches, or NULL */
+    struct xml_arena *x_arena;      /* Arena node is allocated from or NULL */
+    int8_t            x_type;       /* enum cxobj_type: element, attribute, body */
+    uint16_t          x_flags;      /* Flags according to XML_FLAG_* */
     int              _x_vector_i;   /* internal use: xml_child_each */
     int              _x_i;          /* internal use for sorting: 
 				       see xml_enumerate and xml_cmp */
+    uint32_t          x_dsindex;    /* Block index in tree datastore file and
+				       dirty bits, see xml_dsindex. Fits in 
+				       padding before x_u on LP64 */
+    union {
+	struct {                    /* CX_ELMNT */
+	    struct xml **xe_childvec;     /* vector of children nodes */
+	    int          xe_childvec_len; /* Number of children */
+	    int          xe_childvec_max; /* Length of allocated vector */
+	} xu_elmnt;
+	struct {                    /* CX_ATTR and CX_BODY */
+	    char        *xv_value;        /* value string */
+	    uint32_t     xv_value_len;    /* Length of value string */
+	    uint32_t     xv_value_max;    /* Allocated length of value string */
+	} xu_value;
+    } x_u;
 };
 
+/* Type-specific fields of struct xml, only valid for the given node type 
+ * If x_childvec_max is XML_CHILDVEC_CHUNKED, x_childvec is NULL and children 
+ * are in x_ext->xe_chunks, x_childvec_len is still the number of children */
+#define x_childvec     x_u.xu_elmnt.xe_childvec
+#define x_childvec_len x_u.xu_elmnt.xe_childvec_len
+#define x_childvec_max x_u.xu_elmnt.xe_childvec_max
+#define x_chunked(x)   ((x)->x_type == CX_ELMNT && (x)->x_childvec_max == XML_CHILDVEC_CHUNKED)
+#define x_value        x_u.xu_value.xv_value
+#define x_value_len    x_u.xu_value.xv_value_len
+#define x_value_max    x_u.xu_value.xv_value_max
+
 /*
  * Variables
  */
@@ -151,6 +311,11 @@ static const map_str2int xsmap[] = {
     {NULL,           -1}
 };
 
+/* Symbol table of interned names and prefixes, hashed with chained buckets */
+static struct xml_symbol **_xml_symtab = NULL;
+static size_t              _xml_symtab_size = 0; /* Number of buckets */
+static size_t              _xml_symtab_nr = 0;   /* Number of symbols */
+
 
 /*! Translate from xml type in enum form to string keyword
  * @param[in] type  Xml type
@@ -162,6 +327,921 @@ xml_type2str(enum cxobj_type type)
     return (char*)clicon_int2str(xsmap, type);
 }
 
+/*
+ * Arena allocator
+ */
+/*! Create a new arena
+ * @retval  xa    Arena. Freed when its last node is freed
+ * @retval  NULL  Error
+ */
+static struct xml_arena *
+xml_arena_new(void)
+{
+    struct xml_arena *xa;
+    
+    if ((xa = malloc(sizeof(*xa))) == NULL){
+	clicon_err(OE_XML, errno, "malloc");
+	return NULL;
+    }
+    memset(xa, 0, sizeof(*xa));
+    return xa;
+}
+
+/*! Free an arena and all its blocks, but not the references it holds
+ * @param[in]  xa  Arena
+ * @see xml_arena_release
+ */
+static void
+xml_arena_free(struct xml_arena *xa)
+{
+    struct xml_arena_block *ab;
+
+    while ((ab = xa->xa_block) != NULL){
+	xa->xa_block = ab->ab_next;
+	free(ab);
+    }
+    free(xa);
+}
+
+/*! Allocate memory from an arena, memory is not cleared
+ * @param[in]  xa    Arena
+ * @param[in]  size  Number of bytes
+ * @retval     p     Allocated memory, not to be freed individually
+ * @retval     NULL  Error, errno set
+ */
+static void *
+xml_arena_alloc(struct xml_arena *xa,
+		size_t            size)
+{
+    struct xml_arena_block *ab;
+    size_t                  bsize;
+    char                   *p;
+
+    size = XML_ARENA_ALIGN(size);
+    if ((ab = xa->xa_block) == NULL || ab->ab_used + size > ab->ab_size){
+	bsize = size > XML_ARENA_BLOCK_SIZE ? size : XML_ARENA_BLOCK_SIZE;
+	if ((ab = malloc(sizeof(*ab) + bsize)) == NULL)
+	    return NULL;
+	ab->ab_size = bsize;
+	ab->ab_used = 0;
+	ab->ab_next = xa->xa_block;
+	xa->xa_block = ab;
+    }
+    p = (char*)(ab+1) + ab->ab_used;
+    ab->ab_used += size;
+    xa->xa_last = p;
+    return p;
+}
+
+/*! Add a reference to a list of an arena, released with the arena
+ * @param[in]  xa    Arena
+ * @param[in]  list  List of arena, eg &xa->xa_ext
+ * @param[in]  p     Node or symbol
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+xml_arena_ref(struct xml_arena      *xa,
+	      struct xml_arena_ref **list,
+	      void                  *p)
+{
+    struct xml_arena_ref *ar;
+
+    if ((ar = xml_arena_alloc(xa, sizeof(*ar))) == NULL){
+	clicon_err(OE_XML, errno, "malloc");
+	return -1;
+    }
+    ar->ar_p = p;
+    ar->ar_next = *list;
+    *list = ar;
+    return 0;
+}
+
+/*! Remove a reference from a list of an arena, if present
+ * The memory of the reference is released with the arena.
+ * @param[in]  list  List of arena, eg &xa->xa_foreign
+ * @param[in]  p     Node or symbol
+ */
+static void
+xml_arena_unref(struct xml_arena_ref **list,
+		void                  *p)
+{
+    struct xml_arena_ref **arp;
+
+    for (arp = list; *arp; arp = &(*arp)->ar_next)
+	if ((*arp)->ar_p == p){
+	    *arp = (*arp)->ar_next;
+	    break;
+	}
+}
+
+/*! Reallocate memory in arena, extend in place if it was the last allocation
+ * The old memory is not freed (it is released with the arena).
+ * @param[in]  xa      Arena
+ * @param[in]  p       Previous memory, or NULL
+ * @param[in]  oldsize Previous size
+ * @param[in]  size    New size (larger than oldsize)
+ * @retval     p       Allocated memory, with old content copied
+ * @retval     NULL    Error, errno set
+ */
+static void *
+xml_arena_realloc(struct xml_arena *xa,
+		  void             *p,
+		  size_t            oldsize,
+		  size_t            size)
+{
+    struct xml_arena_block *ab = xa->xa_block;
+    void                   *pnew;
+
+    if (p != NULL && p == xa->xa_last && ab != NULL &&
+	(char*)p + XML_ARENA_ALIGN(size) <= (char*)(ab+1) + ab->ab_size){
+	ab->ab_used = ((char*)p - (char*)(ab+1)) + XML_ARENA_ALIGN(size);
+	return p;
+    }
+    if ((pnew = xml_arena_alloc(xa, size)) == NULL)
+	return NULL;
+    if (p != NULL && oldsize)
+	memcpy(pnew, p, oldsize);
+    return pnew;
+}
+
+/*
+ * Symbol table
+ * Element names and prefixes are interned: all nodes with the same name share
+ * one reference-counted string. This saves memory in large trees with many
+ * equal names (eg list entries), and lets name lookups compare pointers
+ * instead of strings.
+ */
+/*! Get interned symbol header given its string
+ */
+#define XML_SYMBOL(str) ((struct xml_symbol*)((str) - offsetof(struct xml_symbol, xs_str)))
+
+/*! Hash a string, FNV-1a
+ * @param[in]  str  Null-terminated string
+ * @retval     h    Hash value
+ */
+static uint32_t
+xml_symbol_hash(char *str)
+{
+    return clicon_hash_fnv1a_str(CLICON_HASH_FNV1A_INIT, str);
+}
+
+/*! Double the number of buckets in the symbol table and rehash all symbols
+ * @retval  0   OK
+ * @retval -1   Error
+ */
+static int
+xml_symtab_grow(void)
+{
+    struct xml_symbol **tab;
+    struct xml_symbol  *xs;
+    size_t              size;
+    size_t              i;
+    size_t              j;
+
+    size = _xml_symtab_size ? 2*_xml_symtab_size : XML_SYMTAB_SIZE_DEFAULT;
+    if ((tab = calloc(size, sizeof(*tab))) == NULL){
+	clicon_err(OE_XML, errno, "calloc");
+	return -1;
+    }
+    for (i=0; i<_xml_symtab_size; i++)
+	while ((xs = _xml_symtab[i]) != NULL){
+	    _xml_symtab[i] = xs->xs_next;
+	    j = xs->xs_hash & (size-1);
+	    xs->xs_next = tab[j];
+	    tab[j] = xs;
+	}
+    if (_xml_symtab)
+	free(_xml_symtab);
+    _xml_symtab = tab;
+    _xml_symtab_size = size;
+    return 0;
+}
+
+/*! Look up a string in the symbol table
+ * @param[in]  str   Null-terminated string
+ * @param[in]  hash  Hash value of str
+ * @retval     xs    Symbol
+ * @retval     NULL  Not found
+ */
+static struct xml_symbol *
+xml_symbol_lookup(char    *str,
+		  uint32_t hash)
+{
+    struct xml_symbol *xs;
+
+    if (_xml_symtab_size == 0)
+	return NULL;
+    for (xs = _xml_symtab[hash & (_xml_symtab_size-1)]; xs; xs = xs->xs_next)
+	if (xs->xs_hash == hash && strcmp(xs->xs_str, str) == 0)
+	    return xs;
+    return NULL;
+}
+
+/*! Intern a string and increment its reference count
+ * @param[in]  str   Null-terminated string
+ * @retval     sym   Interned string, release with xml_symbol_put
+ * @retval     NULL  Error, clicon_err called
+ */
+static char *
+xml_symbol_get(char *str)
+{
+    struct xml_symbol *xs;
+    uint32_t           hash;
+    size_t             len;
+    size_t             i;
+
+    hash = xml_symbol_hash(str);
+    if ((xs = xml_symbol_lookup(str, hash)) == NULL){
+	if (_xml_symtab_nr >= _xml_symtab_size &&
+	    xml_symtab_grow() < 0)
+	    return NULL;
+	len = strlen(str) + 1;
+	if ((xs = malloc(sizeof(*xs) + len)) == NULL){
+	    clicon_err(OE_XML, errno, "malloc");
+	    return NULL;
+	}
+	memcpy(xs->xs_str, str, len);
+	xs->xs_hash = hash;
+	xs->xs_refs = 0;
+	xs->xs_arena = NULL;
+	i = hash & (_xml_symtab_size-1);
+	xs->xs_next = _xml_symtab[i];
+	_xml_symtab[i] = xs;
+	_xml_symtab_nr++;
+    }
+    xs->xs_refs++;
+    return xs->xs_str;
+}
+
+/*! Release an interned string, free it if it is not referenced anymore
+ * @param[in]  sym   Interned string as returned by xml_symbol_get
+ */
+static void
+xml_symbol_put(char *sym)
+{
+    struct xml_symbol  *xs = XML_SYMBOL(sym);
+    struct xml_symbol **xsp;
+
+    if (--xs->xs_refs > 0)
+	return;
+    xsp = &_xml_symtab[xs->xs_hash & (_xml_symtab_size-1)];
+    while (*xsp != xs)
+	xsp = &(*xsp)->xs_next;
+    *xsp = xs->xs_next;
+    free(xs);
+    if (--_xml_symtab_nr == 0){ /* Last symbol, free table */
+	free(_xml_symtab);
+	_xml_symtab = NULL;
+	_xml_symtab_size = 0;
+    }
+}
+
+/*! Find the interned version of a string if any
+ * Use this to look up a name once and then compare xml_name() by pointer.
+ * @param[in]  str   Null-terminated string
+ * @retval     sym   Interned string, equal to xml_name() of nodes named str
+ * @retval     NULL  No xml node has name or prefix str
+ * @code
+ *   if ((sym = xml_symbol_find("interface")) != NULL)
+ *      while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL)
+ *         if (xml_name(x) == sym)
+ *            ...
+ * @endcode
+ */
+char *
+xml_symbol_find(char *str)
+{
+    struct xml_symbol *xs;
+
+    if ((xs = xml_symbol_lookup(str, xml_symbol_hash(str))) == NULL)
+	return NULL;
+    return xs->xs_str;
+}
+
+/*! Intern the name or prefix of a node
+ * A node allocated from an arena does not hold a reference of its own, the
+ * arena holds one reference to each symbol used by its nodes instead. The
+ * symbol is therefore not released node by node, but with the arena.
+ * @param[in]  x     XML node
+ * @param[in]  str   Null-terminated string
+ * @retval     sym   Interned string, release with xml_node_symbol_put
+ * @retval     NULL  Error, clicon_err called
+ */
+static char *
+xml_node_symbol_get(cxobj *x,
+		    char  *str)
+{
+    struct xml_arena  *xa = x->x_arena;
+    struct xml_symbol *xs;
+    char              *sym;
+
+    if ((sym = xml_symbol_get(str)) == NULL)
+	return NULL;
+    if (xa == NULL)
+	return sym;
+    xs = XML_SYMBOL(sym);
+    if (xs->xs_arena == xa) /* Arena already holds a reference */
+	xml_symbol_put(sym);
+    else {
+	if (xml_arena_ref(xa, &xa->xa_syms, sym) < 0){
+	    xml_symbol_put(sym);
+	    return NULL;
+	}
+	xs->xs_arena = xa;
+    }
+    return sym;
+}
+
+/*! Release the name or prefix of a node
+ * @param[in]  x     XML node
+ * @param[in]  sym   Interned string as returned by xml_node_symbol_get
+ */
+static void
+xml_node_symbol_put(cxobj *x,
+		    char  *sym)
+{
+    if (x->x_arena == NULL)
+	xml_symbol_put(sym);
+}
+
+/*! Get the side structure of an xml node, allocate it if not present
+ * @param[in]  x    XML node
+ * @retval     xe   Side structure
+ * @retval     NULL Error, clicon_err called
+ */
+static struct xml_ext *
+xml_ext_get(cxobj *x)
+{
+    struct xml_ext *xe;
+
+    if ((xe = x->x_ext) != NULL)
+	return xe;
+    if (x->x_arena)
+	xe = xml_arena_alloc(x->x_arena, sizeof(*xe));
+    else
+	xe = malloc(sizeof(*xe));
+    if (xe == NULL){
+	clicon_err(OE_XML, errno, "malloc");
+	return NULL;
+    }
+    memset(xe, 0, sizeof(*xe));
+    /* Contents are heap memory, freed when the arena is released */
+    if (x->x_arena && xml_arena_ref(x->x_arena, &x->x_arena->xa_ext, x) < 0)
+	return NULL;
+    x->x_ext = xe;
+    return xe;
+}
+
+/*! Find chunk containing a child
+ * @param[in]  xcs   Chunked children
+ * @param[in]  i     Child index, or number of children (append position)
+ * @retval     j     Chunk index
+ */
+static int
+xml_chunks_find(struct xml_chunks *xcs,
+		int                i)
+{
+    int j;
+    int low;
+    int upper;
+
+    /* Try last accessed chunk, and the next one, before searching */
+    j = xcs->xcs_last;
+    if (i >= xcs->xcs_start[j]){
+	if (i < xcs->xcs_start[j] + xcs->xcs_vec[j]->xch_len || j == xcs->xcs_len-1)
+	    return j;
+	if (i < xcs->xcs_start[j+1] + xcs->xcs_vec[j+1]->xch_len || j+1 == xcs->xcs_len-1)
+	    return xcs->xcs_last = j+1;
+    }
+    /* Last chunk with start <= i */
+    low = 0;
+    upper = xcs->xcs_len-1;
+    while (low < upper){
+	j = (low + upper + 1) / 2;
+	if (xcs->xcs_start[j] <= i)
+	    low = j;
+	else
+	    upper = j-1;
+    }
+    return xcs->xcs_last = low;
+}
+
+/*! Get reference to the slot of a child of a node with chunked children
+ * @param[in]  x     XML node with chunked children
+ * @param[in]  i     Child index, less than number of children
+ * @retval     xp    Pointer to child slot
+ */
+static cxobj **
+xml_chunks_ref(cxobj *x,
+	       int    i)
+{
+    struct xml_chunks *xcs = x->x_ext->xe_chunks;
+    int                j;
+
+    j = xml_chunks_find(xcs, i);
+    return &xcs->xcs_vec[j]->xch_vec[i - xcs->xcs_start[j]];
+}
+
+/*! Insert an empty chunk in the chunk vector
+ * @param[in]  xcs   Chunked children
+ * @param[in]  j     Position of new chunk
+ * @param[in]  start Index of first child of new chunk
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+xml_chunks_add(struct xml_chunks *xcs,
+	       int                j,
+	       int                start)
+{
+    struct xml_chunk **vec;
+    int               *sv;
+    struct xml_chunk  *xch;
+    int                max;
+
+    if (xcs->xcs_len == xcs->xcs_max){
+	max = xcs->xcs_max?2*xcs->xcs_max:XML_CHILDVEC_MAX_DEFAULT;
+	if ((vec = realloc(xcs->xcs_vec, max*sizeof(*vec))) == NULL){
+	    clicon_err(OE_XML, errno, "realloc");
+	    return -1;
+	}
+	xcs->xcs_vec = vec;
+	if ((sv = realloc(xcs->xcs_start, max*sizeof(*sv))) == NULL){
+	    clicon_err(OE_XML, errno, "realloc");
+	    return -1;
+	}
+	xcs->xcs_start = sv;
+	xcs->xcs_max = max;
+    }
+    if ((xch = malloc(sizeof(*xch))) == NULL){
+	clicon_err(OE_XML, errno, "malloc");
+	return -1;
+    }
+    xch->xch_len = 0;
+    memmove(&xcs->xcs_vec[j+1], &xcs->xcs_vec[j], (xcs->xcs_len-j)*sizeof(*xcs->xcs_vec));
+    memmove(&xcs->xcs_start[j+1], &xcs->xcs_start[j], (xcs->xcs_len-j)*sizeof(*xcs->xcs_start));
+    xcs->xcs_vec[j] = xch;
+    xcs->xcs_start[j] = start;
+    xcs->xcs_len++;
+    return 0;
+}
+
+/*! Free chunk vector of a node, but not the children
+ * @param[in]  x     XML node
+ */
+static void
+xml_chunks_free(cxobj *x)
+{
+    struct xml_chunks *xcs;
+    int                j;
+
+    if (x->x_ext == NULL || (xcs = x->x_ext->xe_chunks) == NULL)
+	return;
+    for (j=0; j<xcs->xcs_len; j++)
+	free(xcs->xcs_vec[j]);
+    if (xcs->xcs_vec)
+	free(xcs->xcs_vec);
+    if (xcs->xcs_start)
+	free(xcs->xcs_start);
+    free(xcs);
+    x->x_ext->xe_chunks = NULL;
+}
+
+/*! Move children of a node from a child vector to chunks
+ * Chunks are half-filled to leave room for inserts.
+ * @param[in]  x     XML node (element, not allocated from arena)
+ * @retval     0     OK
+ * @retval    -1     Error
+ * @see xml_chunks_flatten
+ */
+static int
+xml_chunks_split(cxobj *x)
+{
+    struct xml_ext    *xe;
+    struct xml_chunks *xcs;
+    struct xml_chunk  *xch;
+    int                i;
+    int                n;
+
+    if ((xe = xml_ext_get(x)) == NULL)
+	return -1;
+    if ((xcs = calloc(1, sizeof(*xcs))) == NULL){
+	clicon_err(OE_XML, errno, "calloc");
+	return -1;
+    }
+    xe->xe_chunks = xcs;
+    i = 0;
+    do {
+	if (xml_chunks_add(xcs, xcs->xcs_len, i) < 0){
+	    xml_chunks_free(x);
+	    return -1;
+	}
+	xch = xcs->xcs_vec[xcs->xcs_len-1];
+	n = x->x_childvec_len - i;
+	if (n > XML_CHUNK_MAX/2)
+	    n = XML_CHUNK_MAX/2;
+	memcpy(xch->xch_vec, &x->x_childvec[i], n*sizeof(cxobj*));
+	xch->xch_len = n;
+	i += n;
+    } while (i < x->x_childvec_len);
+    if (x->x_childvec)
+	free(x->x_childvec);
+    x->x_childvec = NULL;
+    x->x_childvec_max = XML_CHILDVEC_CHUNKED;
+    return 0;
+}
+
+/*! Move chunked children of a node back to a child vector
+ * @param[in]  x     XML node with chunked children
+ * @retval     0     OK
+ * @retval    -1     Error
+ * @see xml_chunks_split
+ */
+static int
+xml_chunks_flatten(cxobj *x)
+{
+    struct xml_chunks *xcs = x->x_ext->xe_chunks;
+    cxobj            **vec;
+    int                max;
+    int                i;
+    int                j;
+
+    max = x->x_childvec_len?x->x_childvec_len:XML_CHILDVEC_MAX_DEFAULT;
+    if ((vec = malloc(max*sizeof(cxobj*))) == NULL){
+	clicon_err(OE_XML, errno, "malloc");
+	return -1;
+    }
+    i = 0;
+    for (j=0; j<xcs->xcs_len; j++){
+	memcpy(&vec[i], xcs->xcs_vec[j]->xch_vec, xcs->xcs_vec[j]->xch_len*sizeof(cxobj*));
+	i += xcs->xcs_vec[j]->xch_len;
+    }
+    xml_chunks_free(x);
+    x->x_childvec = vec;
+    x->x_childvec_max = max;
+    return 0;
+}
+
+/*! Insert child at position in chunked children
+ * @param[in]  x     XML node with chunked children
+ * @param[in]  xc    Child
+ * @param[in]  i     Position, 0..number of children
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+xml_chunks_insert(cxobj *x,
+		  cxobj *xc,
+		  int    i)
+{
+    struct xml_chunks *xcs = x->x_ext->xe_chunks;
+    struct xml_chunk  *xch;
+    struct xml_chunk  *xnew;
+    int                j;
+    int                k;
+    int                off;
+
+    j = xml_chunks_find(xcs, i);
+    xch = xcs->xcs_vec[j];
+    if (xch->xch_len == XML_CHUNK_MAX){ /* Split full chunk in two halves */
+	if (xml_chunks_add(xcs, j+1, xcs->xcs_start[j] + XML_CHUNK_MAX/2) < 0)
+	    return -1;
+	xnew = xcs->xcs_vec[j+1];
+	memcpy(xnew->xch_vec, &xch->xch_vec[XML_CHUNK_MAX/2], 
+	       (XML_CHUNK_MAX - XML_CHUNK_MAX/2)*sizeof(cxobj*));
+	xnew->xch_len = XML_CHUNK_MAX - XML_CHUNK_MAX/2;
+	xch->xch_len = XML_CHUNK_MAX/2;
+	if (i > xcs->xcs_start[j+1]){
+	    j++;
+	    xch = xnew;
+	}
+    }
+    off = i - xcs->xcs_start[j];
+    memmove(&xch->xch_vec[off+1], &xch->xch_vec[off], (xch->xch_len-off)*sizeof(cxobj*));
+    xch->xch_vec[off] = xc;
+    xch->xch_len++;
+    for (k=j+1; k<xcs->xcs_len; k++)
+	xcs->xcs_start[k]++;
+    xcs->xcs_last = j;
+    x->x_childvec_len++;
+    return 0;
+}
+
+/*! Remove child at position from chunked children
+ * @param[in]  x     XML node with chunked children
+ * @param[in]  i     Position of child
+ */
+static void
+xml_chunks_rm(cxobj *x,
+	      int    i)
+{
+    struct xml_chunks *xcs = x->x_ext->xe_chunks;
+    struct xml_chunk  *xch;
+    int                j;
+    int                k;
+    int                off;
+
+    j = xml_chunks_find(xcs, i);
+    xch = xcs->xcs_vec[j];
+    off = i - xcs->xcs_start[j];
+    memmove(&xch->xch_vec[off], &xch->xch_vec[off+1], (xch->xch_len-off-1)*sizeof(cxobj*));
+    xch->xch_len--;
+    for (k=j+1; k<xcs->xcs_len; k++)
+	xcs->xcs_start[k]--;
+    if (xch->xch_len == 0 && xcs->xcs_len > 1){ /* Remove empty chunk */
+	free(xch);
+	xcs->xcs_len--;
+	memmove(&xcs->xcs_vec[j], &xcs->xcs_vec[j+1], (xcs->xcs_len-j)*sizeof(*xcs->xcs_vec));
+	memmove(&xcs->xcs_start[j], &xcs->xcs_start[j+1], (xcs->xcs_len-j)*sizeof(*xcs->xcs_start));
+	j = 0;
+    }
+    xcs->xcs_last = j;
+    x->x_childvec_len--;
+}
+
+/*! Hash a list entry's spec and key tuple
+ * @param[in]  y     Yang spec of list entry
+ * @param[in]  keys  Key tuple
+ * @param[in]  len   Number of keys
+ * @param[out] hash  Hash value
+ * @retval     1     OK
+ * @retval     0     Not indexable, eg missing keys or keys compared as cv
+ */
+static int
+xml_keys_hash(yang_stmt      *y,
+	      struct xml_key *keys,
+	      int             len,
+	      uint32_t       *hash)
+{
+    uint32_t       h;
+    unsigned char *p;
+    size_t         n;
+    int            i;
+
+    h = clicon_hash_fnv1a(CLICON_HASH_FNV1A_INIT, &y, sizeof(y));
+    for (i=0; i<len; i++){
+	switch (keys[i].xk_type){
+	case XK_INT:
+	case XK_UINT: /* Same size in union */
+	    p = (unsigned char*)&keys[i].xk_u.xk_uint;
+	    n = sizeof(keys[i].xk_u.xk_uint);
+	    break;
+	case XK_STR:
+	    p = (unsigned char*)keys[i].xk_u.xk_s.xk_str;
+	    n = keys[i].xk_u.xk_s.xk_len;
+	    break;
+	default:
+	    return 0;
+	}
+	h = clicon_hash_fnv1a(h, p, n);
+	h = clicon_hash_fnv1a(h, "\xff", 1); /* Key separator */
+    }
+    *hash = h;
+    return 1;
+}
+
+/*! Check if two indexable key tuples are equal
+ * @param[in]  k1    Key tuple 1
+ * @param[in]  k2    Key tuple 2
+ * @param[in]  len   Number of keys in both tuples
+ * @retval     1     Equal
+ * @retval     0     Not equal
+ * @see xml_keys_hash  for which key types are indexable
+ */
+static int
+xml_keys_equal(struct xml_key *k1,
+	       struct xml_key *k2,
+	       int             len)
+{
+    int i;
+
+    for (i=0; i<len; i++){
+	if (k1[i].xk_type != k2[i].xk_type)
+	    return 0;
+	switch (k1[i].xk_type){
+	case XK_INT:
+	case XK_UINT:
+	    if (k1[i].xk_u.xk_uint != k2[i].xk_u.xk_uint)
+		return 0;
+	    break;
+	case XK_STR:
+	    if (k1[i].xk_u.xk_s.xk_len != k2[i].xk_u.xk_s.xk_len ||
+		memcmp(k1[i].xk_u.xk_s.xk_str, k2[i].xk_u.xk_s.xk_str,
+		       k1[i].xk_u.xk_s.xk_len) != 0)
+		return 0;
+	    break;
+	default:
+	    return 0;
+	}
+    }
+    return 1;
+}
+
+/*! Remove a list entry from the key index of its parent, if indexed
+ * @param[in]  xp   Parent XML node
+ * @param[in]  x    XML list entry with cached key tuple
+ */
+static void
+xml_index_rm(cxobj *xp,
+	     cxobj *x)
+{
+    struct xml_index        *xi;
+    struct xml_index_entry **xiep;
+    struct xml_index_entry  *xie;
+    uint32_t                 hash;
+
+    if (xp->x_ext == NULL || (xi = xp->x_ext->xe_index) == NULL)
+	return;
+    if (x->x_ext == NULL || x->x_ext->xe_keys == NULL)
+	return;
+    if (xml_keys_hash(x->x_spec, x->x_ext->xe_keys, x->x_ext->xe_keys_len, &hash) == 0)
+	return;
+    xiep = &xi->xi_tab[hash & (xi->xi_size-1)];
+    while ((xie = *xiep) != NULL){
+	if (xie->xie_x == x){
+	    *xiep = xie->xie_next;
+	    free(xie);
+	    xi->xi_nr--;
+	    break;
+	}
+	xiep = &xie->xie_next;
+    }
+}
+
+/*! Free the key index of a node, eg when its children are replaced
+ * @param[in]  x    XML node
+ */
+static void
+xml_index_free(cxobj *x)
+{
+    struct xml_index       *xi;
+    struct xml_index_entry *xie;
+    uint32_t                i;
+
+    if (x->x_ext == NULL || (xi = x->x_ext->xe_index) == NULL)
+	return;
+    for (i=0; i<xi->xi_size; i++)
+	while ((xie = xi->xi_tab[i]) != NULL){
+	    xi->xi_tab[i] = xie->xie_next;
+	    free(xie);
+	}
+    free(xi->xi_tab);
+    free(xi);
+    x->x_ext->xe_index = NULL;
+}
+
+/*! Check if a child of a list entry is one of its key leafs
+ * @param[in]  x    XML list entry
+ * @param[in]  xc   XML child of x
+ * @retval     1    xc is (or may be) a key leaf of x
+ * @retval     0    xc is not a key leaf of x
+ */
+static int
+xml_key_child(cxobj *x,
+	      cxobj *xc)
+{
+    cg_var *cvi = NULL;
+
+    if (x->x_spec == NULL || xc->x_name == NULL)
+	return 1;
+    while ((cvi = cvec_each(yang_cvec_get(x->x_spec), cvi)) != NULL)
+	if (strcmp(cv_string_get(cvi), xc->x_name) == 0)
+	    return 1;
+    return 0;
+}
+
+/*! Clear cached key tuple of a list entry, eg when its children change
+ * The entry is also removed from its parent's key index.
+ * @param[in]  x    XML node
+ */
+static void
+xml_keys_reset(cxobj *x)
+{
+    struct xml_ext *xe;
+
+    if ((xe = x->x_ext) != NULL && xe->xe_keys != NULL){
+	if (x->x_up)
+	    xml_index_rm(x->x_up, x);
+	free(xe->xe_keys);
+	xe->xe_keys = NULL;
+	xe->xe_keys_len = 0;
+    }
+}
+
+/*! Check if node has a cached key tuple
+ */
+#define xml_keys_cached(x) ((x)->x_ext != NULL && (x)->x_ext->xe_keys != NULL)
+
+/*! Mark the tree datastore record of a node as changed
+ * The record of an element contains its name, attributes, bodies and the
+ * block indexes of its element children. A change of a body or attribute
+ * therefore marks its parent element. Ancestors are marked as having a changed
+ * descendant, which stops at the first ancestor already marked.
+ * Only an element with a record is marked, other trees are not tracked. A new
+ * element has no record, it is written with its subtree and its parent was 
+ * marked when it was added.
+ * @param[in]  x     XML node
+ * @param[in]  bits  XML_DSDIRTY_SELF, optionally with XML_DSDIRTY_RM
+ * @see datastore_tree_write
+ */
+static void
+xml_dsdirty_mark(cxobj   *x,
+		 uint32_t bits)
+{
+    if (x->x_type != CX_ELMNT && (x = x->x_up) == NULL)
+	return;
+    if ((x->x_dsindex & XML_DSINDEX_MASK) == 0)
+	return;
+    x->x_dsindex |= bits;
+    for (x = x->x_up; x && (x->x_dsindex & XML_DSDIRTY_DESC) == 0; x = x->x_up)
+	x->x_dsindex |= XML_DSDIRTY_DESC;
+}
+
+/*! Clear tree datastore block indexes of a subtree removed from its parent
+ * The blocks of the subtree are freed when the parent is written, so the
+ * subtree must be written anew if it is added somewhere else.
+ * @param[in]  x     XML node
+ */
+static void
+xml_dsindex_clear(cxobj *x)
+{
+    int    i;
+    cxobj *xc;
+
+    if (x->x_type != CX_ELMNT || (x->x_dsindex & XML_DSINDEX_MASK) == 0)
+	return;
+    x->x_dsindex = 0;
+    for (i=0; i<x->x_childvec_len; i++)
+	if ((xc = xml_child_i(x, i)) != NULL)
+	    xml_dsindex_clear(xc);
+}
+
+/*! The order of a node among its siblings may have changed
+ * Clear the sorted mark of its parent, and of its grand-parent since the node
+ * may be a key leaf of a list entry.
+ * @param[in]  x    XML node
+ */
+static void
+xml_sorted_reset(cxobj *x)
+{
+    if ((x = x->x_up) == NULL)
+	return;
+    x->x_flags &= ~XML_FLAG_SORTED;
+    if ((x = x->x_up) != NULL)
+	x->x_flags &= ~XML_FLAG_SORTED;
+}
+
+/*! Children of a node have changed, clear caches that depend on them
+ * Clear cached key tuple of the node (if it is a list entry and a key leaf
+ * changed) and of its parent (if the node is a key leaf).
+ * The sorted mark of the node is only cleared on unknown changes, adding or
+ * removing a single child is handled by the caller, see xml_child_append.
+ * The sorted mark of the parent is cleared if the order of the node among
+ * its siblings may change, ie if a key leaf or a body changed.
+ * @param[in]  x    XML node
+ * @param[in]  xc   Child added or removed, or NULL if unknown/all
+ */
+static void
+xml_children_changed(cxobj *x,
+		     cxobj *xc)
+{
+    if (xc == NULL)
+	x->x_flags &= ~XML_FLAG_SORTED;
+    if (x->x_up &&
+	(xc == NULL || xc->x_type == CX_BODY || xml_key_child(x, xc)))
+	x->x_up->x_flags &= ~XML_FLAG_SORTED;
+    /* Unknown change may have removed children */
+    xml_dsdirty_mark(x, xc?XML_DSDIRTY_SELF:(XML_DSDIRTY_SELF|XML_DSDIRTY_RM));
+    if (xml_keys_cached(x) && (xc == NULL || xml_key_child(x, xc)))
+	xml_keys_reset(x);
+    if (x->x_up && xml_keys_cached(x->x_up) && xml_key_child(x->x_up, x))
+	xml_keys_reset(x->x_up);
+}
+
+/*! A body or attribute value has changed, clear caches that depend on it
+ * Clear cached cv of the parent leaf and cached key tuple of grand-parent 
+ * list entry. The order of a leaf-list entry or of a list entry (if a key
+ * changed) among its siblings may change, clear their sorted mark.
+ * @param[in]  x    XML body node
+ */
+static void
+xml_value_changed(cxobj *x)
+{
+    cxobj *xp;
+
+    if ((xp = x->x_up) == NULL)
+	return;
+    xml_sorted_reset(xp);
+    xml_dsdirty_mark(xp, XML_DSDIRTY_SELF);
+    if (xp->x_ext != NULL && xp->x_ext->xe_cv != NULL){
+	cv_free(xp->x_ext->xe_cv);
+	xp->x_ext->xe_cv = NULL;
+    }
+    if (xp->x_up && xml_keys_cached(xp->x_up) && xml_key_child(xp->x_up, xp))
+	xml_keys_reset(xp->x_up);
+}
+
 /*
  * Access functions
  */
@@ -175,7 +1255,7 @@ xml_name(cxobj *xn)
     return xn->x_name;
 }
 
-/*! Set name of xnode, name is copied
+/*! Set name of xnode, name is copied (interned)
  * @param[in]  xn    xml node
  * @param[in]  name  new name, null-terminated string, copied by function
  * @retval     -1    on error with clicon-err set
@@ -185,16 +1265,18 @@ int
 xml_name_set(cxobj *xn, 
 	     char  *name)
 {
-    if (xn->x_name){
-	free(xn->x_name);
-	xn->x_name = NULL;
-    }
-    if (name){
-	if ((xn->x_name = strdup(name)) == NULL){
-	    clicon_err(OE_XML, errno, "strdup");
-	    return -1;
-	}
-    }
+    char *sym = NULL;
+
+    /* Intern new name before releasing old, they may be the same symbol */
+    if (name && (sym = xml_node_symbol_get(xn, name)) == NULL)
+	return -1;
+    if (xn->x_up && xml_keys_cached(xn->x_up))
+	xml_keys_reset(xn->x_up); /* May be a key leaf */
+    xml_sorted_reset(xn);
+    xml_dsdirty_mark(xn, XML_DSDIRTY_SELF);
+    if (xn->x_name)
+	xml_node_symbol_put(xn, xn->x_name);
+    xn->x_name = sym;
     return 0;
 }
 
@@ -208,7 +1290,7 @@ xml_prefix(cxobj *xn)
     return xn->x_prefix;
 }
 
-/*! Set prefix of xnode, prefix is copied
+/*! Set prefix of xnode, prefix is copied (interned)
  * @param[in]  xn         xml node
  * @param[in]  localname  new prefix, null-terminated string, copied by function
  * @retval     -1         on error with clicon-err set
@@ -218,16 +1300,14 @@ int
 xml_prefix_set(cxobj *xn, 
 	       char  *localname)
 {
-    if (xn->x_prefix){
-	free(xn->x_prefix);
-	xn->x_prefix = NULL;
-    }
-    if (localname){
-	if ((xn->x_prefix = strdup(localname)) == NULL){
-	    clicon_err(OE_XML, errno, "strdup");
-	    return -1;
-	}
-    }
+    char *sym = NULL;
+
+    if (localname && (sym = xml_node_symbol_get(xn, localname)) == NULL)
+	return -1;
+    xml_dsdirty_mark(xn, XML_DSDIRTY_SELF);
+    if (xn->x_prefix)
+	xml_node_symbol_put(xn, xn->x_prefix);
+    xn->x_prefix = sym;
     return 0;
 }
 
@@ -242,8 +1322,8 @@ char*
 nscache_get(cxobj *x,
 	    char  *prefix)
 {
-    if (x->x_ns_cache != NULL)
-	return xml_nsctx_get(x->x_ns_cache, prefix);
+    if (x->x_ext && x->x_ext->xe_ns_cache != NULL)
+	return xml_nsctx_get(x->x_ext->xe_ns_cache, prefix);
     return NULL;
 }
 
@@ -259,8 +1339,8 @@ nscache_get_prefix(cxobj *x,
 		   char  *namespace,
 		   char **prefix)
 {
-    if (x->x_ns_cache != NULL)
-	return xml_nsctx_get_prefix(x->x_ns_cache, namespace, prefix);
+    if (x->x_ext && x->x_ext->xe_ns_cache != NULL)
+	return xml_nsctx_get_prefix(x->x_ext->xe_ns_cache, namespace, prefix);
     return 0;
 }
 
@@ -273,7 +1353,7 @@ nscache_get_prefix(cxobj *x,
 cvec *
 nscache_get_all(cxobj *x)
 {
-    return x->x_ns_cache;
+    return x->x_ext?x->x_ext->xe_ns_cache:NULL;
 }
 
 /*! Set cached namespace for specific namespace. Replace if necessary
@@ -289,14 +1369,17 @@ nscache_set(cxobj *x,
 	    char  *prefix,
 	    char  *namespace)
 {
-    int     retval = -1;
+    int             retval = -1;
+    struct xml_ext *xe;
 
-    if (x->x_ns_cache == NULL){
-	if ((x->x_ns_cache = xml_nsctx_init(prefix, namespace)) == NULL)
+    if ((xe = xml_ext_get(x)) == NULL)
+	goto done;
+    if (xe->xe_ns_cache == NULL){
+	if ((xe->xe_ns_cache = xml_nsctx_init(prefix, namespace)) == NULL)
 	    goto done;
     }
     else 
-	return xml_nsctx_add(x->x_ns_cache, prefix, namespace);
+	return xml_nsctx_add(xe->xe_ns_cache, prefix, namespace);
     retval = 0;
  done:
     return retval;
@@ -313,15 +1396,19 @@ int
 nscache_replace(cxobj *x,
 		cvec  *nsc)
 {
-    int     retval = -1;
+    int             retval = -1;
+    struct xml_ext *xe;
 
-    if (x->x_ns_cache != NULL){
-	xml_nsctx_free(x->x_ns_cache);
-	x->x_ns_cache = NULL;
+    nscache_clear(x);
+    if (nsc == NULL){
+	retval = 0;
+	goto done;
     }
-    x->x_ns_cache = nsc;
+    if ((xe = xml_ext_get(x)) == NULL)
+	goto done;
+    xe->xe_ns_cache = nsc;
     retval = 0;
-    // done:
+ done:
     return retval;
 }
 
@@ -335,9 +1422,9 @@ nscache_replace(cxobj *x,
 int
 nscache_clear(cxobj *x)
 {
-    if (x->x_ns_cache != NULL){
-	xml_nsctx_free(x->x_ns_cache);
-	x->x_ns_cache = NULL;
+    if (x->x_ext && x->x_ext->xe_ns_cache != NULL){
+	xml_nsctx_free(x->x_ext->xe_ns_cache);
+	x->x_ext->xe_ns_cache = NULL;
     }
     return 0;
 }
@@ -615,6 +1702,315 @@ xml_flag_reset(cxobj   *xn,
     return 0;
 }
 
+/*! Append a node to a vector of edited or removed children
+ * @param[in,out] vec  Vector
+ * @param[in,out] len  Length of vector
+ * @param[in,out] max  Allocated length of vector
+ * @param[in]     x    Node to append
+ * @retval        0    OK
+ * @retval       -1    Error
+ */
+static int
+xml_edits_append(cxobj ***vec,
+		 int      *len,
+		 int      *max,
+		 cxobj    *x)
+{
+    cxobj **v;
+    int     m;
+
+    if (*len == *max){
+	m = *max ? 2 * *max : 4;
+	if ((v = realloc(*vec, m*sizeof(cxobj *))) == NULL){
+	    clicon_err(OE_XML, errno, "realloc");
+	    return -1;
+	}
+	*vec = v;
+	*max = m;
+    }
+    (*vec)[(*len)++] = x;
+    return 0;
+}
+
+/*! Get edits of a node, allocate them if not present
+ * @param[in]  x    XML node
+ * @retval     xed  Edits of x
+ * @retval     NULL Error, clicon_err called
+ */
+static struct xml_edits *
+xml_edits_get(cxobj *x)
+{
+    struct xml_ext *xe;
+
+    if ((xe = xml_ext_get(x)) == NULL)
+	return NULL;
+    if (xe->xe_edits == NULL &&
+	(xe->xe_edits = calloc(1, sizeof(*xe->xe_edits))) == NULL){
+	clicon_err(OE_XML, errno, "calloc");
+	return NULL;
+    }
+    return xe->xe_edits;
+}
+
+/*! Free edits of a node, copies of removed children included
+ * @param[in]  x    XML node
+ */
+static void
+xml_edits_free(cxobj *x)
+{
+    struct xml_edits *xed;
+    int               i;
+
+    if (x->x_ext == NULL || (xed = x->x_ext->xe_edits) == NULL)
+	return;
+    for (i=0; i<xed->xed_rmlen; i++)
+	xml_free(xed->xed_rm[i]);
+    if (xed->xed_vec)
+	free(xed->xed_vec);
+    if (xed->xed_rm)
+	free(xed->xed_rm);
+    free(xed);
+    x->x_ext->xe_edits = NULL;
+}
+
+/*! Register an edited child xc of x, and mark x and its ancestors as edited
+ * @param[in]  x    XML node
+ * @param[in]  xc   Child of x marked with XML_FLAG_EDIT
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+xml_edits_add(cxobj *x,
+	      cxobj *xc)
+{
+    struct xml_edits *xed;
+
+    if ((xed = xml_edits_get(x)) == NULL)
+	return -1;
+    if (xml_edits_append(&xed->xed_vec, &xed->xed_len, &xed->xed_max, xc) < 0)
+	return -1;
+    return xml_edit_mark(x);
+}
+
+/*! Unregister an edited child xc of x, eg when it is removed from x
+ * @param[in]  x    XML node
+ * @param[in]  xc   Child of x marked with XML_FLAG_EDIT
+ */
+static void
+xml_edits_rm(cxobj *x,
+	     cxobj *xc)
+{
+    struct xml_edits *xed;
+    int               i;
+
+    if (x->x_ext == NULL || (xed = x->x_ext->xe_edits) == NULL)
+	return;
+    /* Search from the end, a child is often removed soon after it is edited */
+    for (i=xed->xed_len-1; i>=0; i--)
+	if (xed->xed_vec[i] == xc){
+	    xed->xed_vec[i] = xed->xed_vec[--xed->xed_len];
+	    break;
+	}
+}
+
+/*! Mark a node and its ancestors as edited with XML_FLAG_EDIT
+ * Each marked node is registered in its parent, so that the edits of a
+ * node can be visited without going through all its children.
+ * Ancestors of a marked node are always marked, so marking stops at the first
+ * marked node. A marked node added to a parent marks the parent.
+ * @param[in]  x    XML node, modified, added or parent of removed node
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @see xml_edit_reset
+ * @see xml_diff_edit
+ */
+int
+xml_edit_mark(cxobj *x)
+{
+    if (x->x_flags & XML_FLAG_EDIT)
+	return 0;
+    x->x_flags |= XML_FLAG_EDIT;
+    if (x->x_up == NULL)
+	return 0;
+    return xml_edits_add(x->x_up, x);
+}
+
+/*! Record that a child is removed from a node, and mark the node as edited
+ * A copy of xc with only its keys (list) or value (leaf-list) is kept, the
+ * child itself may be freed after this call.
+ * @param[in]  x    XML node
+ * @param[in]  xc   Child of x that is removed, or copy of removed child
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @see xml_edit_removed_i
+ */
+int
+xml_edit_removed(cxobj *x,
+		 cxobj *xc)
+{
+    int               retval = -1;
+    struct xml_edits *xed;
+    cxobj            *xr = NULL;
+    cxobj            *xcc;
+    cxobj            *xrc;
+
+    if ((xr = xml_new(xml_name(xc), NULL, xml_spec(xc))) == NULL)
+	goto done;
+    xcc = NULL;
+    while ((xcc = xml_child_each(xc, xcc, CX_ERROR)) != NULL){
+	if (xml_type(xcc) == CX_ATTR)
+	    continue;
+	if (xml_type(xcc) == CX_ELMNT &&
+	    (xml_spec(xc) == NULL ||
+	     yang_keyword_get(xml_spec(xc)) != Y_LIST ||
+	     !xml_key_child(xc, xcc)))
+	    continue;
+	if ((xrc = xml_new(xml_name(xcc), xr, xml_spec(xcc))) == NULL)
+	    goto done;
+	if (xml_copy(xcc, xrc) < 0)
+	    goto done;
+    }
+    if ((xed = xml_edits_get(x)) == NULL)
+	goto done;
+    if (xml_edits_append(&xed->xed_rm, &xed->xed_rmlen, &xed->xed_rmmax, xr) < 0)
+	goto done;
+    xr = NULL;
+    if (xml_edit_mark(x) < 0)
+	goto done;
+    retval = 0;
+ done:
+    if (xr)
+	xml_free(xr);
+    return retval;
+}
+
+/*! Reset edit marks of a node and its descendants, only visiting edits
+ * Copies of removed children are freed.
+ * @param[in]  x    XML node
+ */
+static void
+xml_edit_reset1(cxobj *x)
+{
+    struct xml_edits *xed;
+    int               i;
+
+    x->x_flags &= ~XML_FLAG_EDIT;
+    if (x->x_ext == NULL || (xed = x->x_ext->xe_edits) == NULL)
+	return;
+    for (i=0; i<xed->xed_len; i++)
+	xml_edit_reset1(xed->xed_vec[i]);
+    xml_edits_free(x);
+}
+
+/*! Reset edit marks of a node and its descendants
+ * @param[in]  x    XML node
+ * @retval     0    OK
+ * @see xml_edit_mark
+ */
+int
+xml_edit_reset(cxobj *x)
+{
+    if ((x->x_flags & XML_FLAG_EDIT) == 0)
+	return 0;
+    if (x->x_up)
+	xml_edits_rm(x->x_up, x);
+    xml_edit_reset1(x);
+    return 0;
+}
+
+/*! Get number of edited children of a node
+ * @param[in]  x    XML node
+ * @retval     nr   Number of children marked with XML_FLAG_EDIT
+ */
+int
+xml_edit_nr(cxobj *x)
+{
+    if (x->x_ext == NULL || x->x_ext->xe_edits == NULL)
+	return 0;
+    return x->x_ext->xe_edits->xed_len;
+}
+
+/*! Get edited child of a node, in no particular order
+ * @param[in]  x    XML node
+ * @param[in]  i    Number of edited child, less than xml_edit_nr(x)
+ * @retval     xc   Child of x marked with XML_FLAG_EDIT
+ */
+cxobj *
+xml_edit_i(cxobj *x,
+	   int    i)
+{
+    return x->x_ext->xe_edits->xed_vec[i];
+}
+
+/*! Get number of children removed from a node since its edit marks were reset
+ * @param[in]  x    XML node
+ * @retval     nr   Number of removed children
+ */
+int
+xml_edit_removed_nr(cxobj *x)
+{
+    if (x->x_ext == NULL || x->x_ext->xe_edits == NULL)
+	return 0;
+    return x->x_ext->xe_edits->xed_rmlen;
+}
+
+/*! Get copy of child removed from a node, in no particular order
+ * @param[in]  x    XML node
+ * @param[in]  i    Number of removed child, less than xml_edit_removed_nr(x)
+ * @retval     xr   Detached copy of removed child with keys or value only
+ */
+cxobj *
+xml_edit_removed_i(cxobj *x,
+		   int    i)
+{
+    return x->x_ext->xe_edits->xed_rm[i];
+}
+
+/*! Get block index of the record of a node in a tree datastore file
+ * @param[in]  xn     xml node
+ * @retval     index  Block index, or 0 if the node has not been written
+ * @see datastore_tree_write
+ */
+uint32_t
+xml_dsindex(cxobj *xn)
+{
+    return xn->x_dsindex & XML_DSINDEX_MASK;
+}
+
+/*! Set block index of the record of a node in a tree datastore file
+ * Also clears dirty bits of the node, its record is up-to-date.
+ * @param[in]  xn     xml node
+ * @param[in]  index  Block index, or 0
+ */
+int
+xml_dsindex_set(cxobj   *xn,
+		uint32_t index)
+{
+    xn->x_dsindex = index & XML_DSINDEX_MASK;
+    return 0;
+}
+
+/*! Get dirty bits of the tree datastore record of a node
+ * @param[in]  xn     xml node
+ * @retval     bits   XML_DSDIRTY_* bits, 0 if the record of the subtree is clean
+ */
+uint32_t
+xml_dsdirty(cxobj *xn)
+{
+    return xn->x_dsindex & ~XML_DSINDEX_MASK;
+}
+
+/*! Mark the tree datastore record of a node as changed
+ * Needed only if children are changed bypassing the xml API, eg reordered.
+ * @param[in]  xn     xml node
+ */
+int
+xml_dsdirty_set(cxobj *xn)
+{
+    xml_dsdirty_mark(xn, XML_DSDIRTY_SELF);
+    return 0;
+}
+
 /*! Get value of xnode
  * @param[in]  xn    xml node
  * @retval     value of xml node
@@ -622,7 +2018,51 @@ xml_flag_reset(cxobj   *xn,
 char*
 xml_value(cxobj *xn)
 {
-    return xn->x_value_cb?cbuf_get(xn->x_value_cb):NULL;
+    if (xn->x_type == CX_ELMNT)
+	return NULL;
+    return xn->x_value;
+}
+
+/*! Ensure value string of xml node has room for len characters
+ * Grows the allocated string exponentially.
+ * @param[in]  xn    xml node
+ * @param[in]  len   Length of value string (excluding null-character)
+ * @retval     -1    on error with clicon-err set
+ * @retval     0     OK
+ */
+static int
+xml_value_grow(cxobj *xn,
+	       size_t len)
+{
+    size_t max;
+    char  *v;
+
+    if (xn->x_type == CX_ELMNT){
+	clicon_err(OE_XML, EINVAL, "Element %s cannot have a value", xn->x_name);
+	return -1;
+    }
+    if (len < xn->x_value_max)
+	return 0;
+    if (len >= UINT32_MAX){
+	clicon_err(OE_XML, EFBIG, "Value of %s too long", xn->x_name);
+	return -1;
+    }
+    max = xn->x_value_max?xn->x_value_max:XML_VALUE_MAX_DEFAULT;
+    while (max <= len)
+	max *= 2;
+    if (max > UINT32_MAX)
+	max = UINT32_MAX;
+    if (xn->x_arena)
+	v = xml_arena_realloc(xn->x_arena, xn->x_value, xn->x_value_max, max);
+    else
+	v = realloc(xn->x_value, max);
+    if (v == NULL){
+	clicon_err(OE_XML, errno, "realloc");
+	return -1;
+    }
+    xn->x_value = v;
+    xn->x_value_max = max;
+    return 0;
 }
 
 /*! Set value of xml node, value is copied
@@ -635,17 +2075,18 @@ int
 xml_value_set(cxobj *xn, 
 	      char  *val)
 {
-    int retval = -1;
-    
-    if (xn->x_value_cb == NULL){
-	if ((xn->x_value_cb = cbuf_new()) == NULL){
-	    clicon_err(OE_XML, errno, "cbuf_new");
-	    goto done;
-	}
-    }
-    else
-	cbuf_reset(xn->x_value_cb);
-    cprintf(xn->x_value_cb, "%s", val);
+    int    retval = -1;
+    size_t len;
+
+    len = val?strlen(val):0;
+    /* Before change, caches may refer to old value */
+    xml_value_changed(xn);
+    if (xml_value_grow(xn, len) < 0)
+	goto done;
+    if (len)
+	memmove(xn->x_value, val, len);
+    xn->x_value[len] = '\0';
+    xn->x_value_len = len;
     retval = 0;
  done:
     return retval;
@@ -658,21 +2099,21 @@ xml_value_set(cxobj *xn,
  * @retval     new value
  */
 int
-xml_value_append(cxobj *xn, 
-		 char  *val)
-{
-    int retval = -1;
-    
-    if (xn->x_value_cb == NULL){
-	if ((xn->x_value_cb = cbuf_new()) == NULL){
-	    clicon_err(OE_XML, errno, "cbuf_new");
-	    goto done;
-	}
-    }
-    if (cprintf(xn->x_value_cb, "%s", val) < 0){
-	clicon_err(OE_XML, errno, "cprintf");
+xml_value_append(cxobj *xn, 
+		 char  *val)
+{
+    int    retval = -1;
+    size_t len;
+
+    len = val?strlen(val):0;
+    /* Before change, caches may refer to old value */
+    xml_value_changed(xn);
+    if (xml_value_grow(xn, xn->x_value_len + len) < 0)
 	goto done;
-    }
+    if (len)
+	memcpy(xn->x_value + xn->x_value_len, val, len);
+    xn->x_value_len += len;
+    xn->x_value[xn->x_value_len] = '\0';
     retval = 0;
  done:
     return retval;
@@ -689,6 +2130,9 @@ xml_type(cxobj *xn)
 }
 
 /*! Set type of xnode
+ * Elements have children and attributes and bodies have values, they share
+ * storage. Therefore, when changing an element to an attribute or body, its
+ * children are freed, and when changing to an element, its value is freed.
  * @param[in]  xn    xml node
  * @param[in]  type  new type
  * @retval     type  old type
@@ -698,7 +2142,26 @@ xml_type_set(cxobj          *xn,
 	     enum cxobj_type type)
 {
     enum cxobj_type old = xn->x_type;
-
+    int             i;
+    cxobj          *xc;
+
+    if (old == CX_ELMNT && type != CX_ELMNT){
+	xml_children_changed(xn, NULL);
+	xml_index_free(xn);
+	for (i=0; i<xn->x_childvec_len; i++)
+	    if ((xc = xml_child_i(xn, i)) != NULL)
+		xml_free(xc);
+	xml_chunks_free(xn);
+	if (xn->x_childvec && xn->x_arena == NULL)
+	    free(xn->x_childvec);
+	memset(&xn->x_u, 0, sizeof(xn->x_u));
+    }
+    else if (old != CX_ELMNT && type == CX_ELMNT){
+	xml_value_changed(xn);
+	if (xn->x_value && xn->x_arena == NULL)
+	    free(xn->x_value);
+	memset(&xn->x_u, 0, sizeof(xn->x_u));
+    }
     xn->x_type = type;
     return old;
 }
@@ -712,6 +2175,8 @@ xml_type_set(cxobj          *xn,
 int   
 xml_child_nr(cxobj *xn)
 {
+    if (xn->x_type != CX_ELMNT)
+	return 0;
     return xn->x_childvec_len;
 }
 
@@ -767,8 +2232,8 @@ cxobj *
 xml_child_i(cxobj *xn, 
 	    int    i)
 {
-    if (i < xn->x_childvec_len)
-	return xn->x_childvec[i];
+    if (xn->x_type == CX_ELMNT && i < xn->x_childvec_len)
+	return x_chunked(xn)?*xml_chunks_ref(xn, i):xn->x_childvec[i];
     return NULL;
 }
 
@@ -794,6 +2259,49 @@ xml_child_i_type(cxobj          *xn,
     return NULL;
 }
 
+/*! Account for a child added to a node, if the node is allocated from an arena
+ * A node under a node of the same arena is no longer a root of the arena. 
+ * Any other node under an arena node is freed when the arena is released.
+ * @param[in]  x     XML parent node
+ * @param[in]  xc    XML child node added to x
+ * @retval     0     OK
+ * @retval    -1     Error
+ * @see xml_arena_detach
+ */
+static int
+xml_arena_attach(cxobj *x,
+		 cxobj *xc)
+{
+    struct xml_arena *xa = x->x_arena;
+
+    if (xa == NULL)
+	return 0;
+    if (xc->x_arena == xa){
+	xa->xa_roots--;
+	return 0;
+    }
+    return xml_arena_ref(xa, &xa->xa_foreign, xc);
+}
+
+/*! Account for a child removed from a node, if the node is allocated from an arena
+ * @param[in]  x     XML parent node
+ * @param[in]  xc    XML child node removed from x
+ * @see xml_arena_attach
+ */
+static void
+xml_arena_detach(cxobj *x,
+		 cxobj *xc)
+{
+    struct xml_arena *xa = x->x_arena;
+
+    if (xa == NULL)
+	return;
+    if (xc->x_arena == xa)
+	xa->xa_roots++;
+    else
+	xml_arena_unref(&xa->xa_foreign, xc);
+}
+
 /*! Set specific child
  * @param[in]  xn    xml node
  * @param[in]  i     the number of the child, eg order in children vector
@@ -805,8 +2313,19 @@ xml_child_i_set(cxobj *xt,
 		int    i, 
 		cxobj *xc)
 {
-    if (i < xt->x_childvec_len)
-	xt->x_childvec[i] = xc;
+    cxobj **xp;
+
+    if (xt->x_type == CX_ELMNT && i < xt->x_childvec_len){
+	xp = x_chunked(xt)?xml_chunks_ref(xt, i):&xt->x_childvec[i];
+	if (*xp != NULL && (*xp)->x_up == xt){
+	    xml_index_rm(xt, *xp);
+	    xml_arena_detach(xt, *xp);
+	}
+	*xp = xc;
+	if (xc != NULL)
+	    xml_arena_attach(xt, xc); /* Error only if out of memory, logged */
+	xml_children_changed(xt, NULL);
+    }
     return 0;
 }
 
@@ -816,6 +2335,8 @@ xml_child_i_set(cxobj *xt,
  * @retval     xml   The child xml node
  * @retval     i     The order of the child
  * @retval     -1    if no such child, or empty child
+ * The position remembered by xml_child_each is tried first, if it is not valid
+ * the children are searched, which updates the positions of all of them.
  * @see xml_child_i
  */
 int
@@ -825,6 +2346,9 @@ xml_child_order(cxobj *xp,
     cxobj *x = NULL;
     int    i = 0;
 
+    if (xc->_x_vector_i < xml_child_nr(xp) &&
+	xml_child_i(xp, xc->_x_vector_i) == xc)
+	return xc->_x_vector_i;
     while ((x = xml_child_each(xp, x, -1)) != NULL) {
 	if (x == xc)
 	    return i;
@@ -858,10 +2382,13 @@ xml_child_each(cxobj           *xparent,
     int    i;
     cxobj *xn = NULL; 
 
-    if (xparent == NULL)
+    if (xparent == NULL || xparent->x_type != CX_ELMNT)
 	return NULL;
     for (i=xprev?xprev->_x_vector_i+1:0; i<xparent->x_childvec_len; i++){
-	xn = xparent->x_childvec[i];
+	if (x_chunked(xparent))
+	    xn = *xml_chunks_ref(xparent, i);
+	else
+	    xn = xparent->x_childvec[i];
 	if (xn == NULL)
 	    continue;
 	if (type != CX_ERROR && xn->x_type != type)
@@ -875,27 +2402,72 @@ xml_child_each(cxobj           *xparent,
     return xn;
 }
 
+/*! Ensure child vector has room for one more child, grow exponentially
+ * @param[in]  x   XML node
+ * @retval     0   OK
+ * @retval    -1   Error
+ */
+static int
+xml_childvec_grow(cxobj *x)
+{
+    cxobj **vec;
+    int     max;
+
+    if (x->x_type != CX_ELMNT){
+	clicon_err(OE_XML, EINVAL, "%s %s cannot have children",
+		   xml_type2str(x->x_type), x->x_name);
+	return -1;
+    }
+    if (x->x_childvec_len < x->x_childvec_max)
+	return 0;
+    max = x->x_childvec_max?2*x->x_childvec_max:XML_CHILDVEC_MAX_DEFAULT;
+    if (x->x_arena)
+	vec = xml_arena_realloc(x->x_arena, x->x_childvec,
+				x->x_childvec_max*sizeof(cxobj*),
+				max*sizeof(cxobj*));
+    else
+	vec = realloc(x->x_childvec, max*sizeof(cxobj*));
+    if (vec == NULL){
+	clicon_err(OE_XML, errno, "realloc");
+	return -1;
+    }
+    x->x_childvec = vec;
+    x->x_childvec_max = max;
+    return 0;
+}
+
 /*! Extend child vector with one and insert xml node there
+ * The children are no longer known to be sorted, see xml_sort_sorted.
  * @note does not do anything with child, you may need to set its parent, etc
  */
 static int
 xml_child_append(cxobj *x, 
 		 cxobj *xc)
 {
-    x->x_childvec_len++;
-    if (x->x_childvec_len > x->x_childvec_max)
-	x->x_childvec_max = x->x_childvec_max?2*x->x_childvec_max:XML_CHILDVEC_MAX_DEFAULT;
-    x->x_childvec = realloc(x->x_childvec, x->x_childvec_max*sizeof(cxobj*));
-    if (x->x_childvec == NULL){
-	clicon_err(OE_XML, errno, "realloc");
-	return -1;
+    x->x_flags &= ~XML_FLAG_SORTED;
+    if (x_chunked(x)){
+	if (xml_chunks_insert(x, xc, x->x_childvec_len) < 0)
+	    return -1;
     }
-    x->x_childvec[x->x_childvec_len-1] = xc;
+    else {
+	if (xml_childvec_grow(x) < 0)
+	    return -1;
+	x->x_childvec[x->x_childvec_len++] = xc;
+    }
+    if (xml_arena_attach(x, xc) < 0)
+	return -1;
+    xml_children_changed(x, xc);
+    if ((xc->x_flags & XML_FLAG_EDIT) && xml_edits_add(x, xc) < 0)
+	return -1;
     return 0;
 }
 
 /*! Insert child xc at position i under parent xp
  * 
+ * Children of nodes with many children are moved to chunks, so that the
+ * whole child vector is not moved on every insert.
+ * The children are no longer known to be sorted, unless the caller knows that
+ * i is the sorted position, see xml_insert.
  * @see xml_child_append
  * @note does not do anything with child, you may need to set its parent, etc
  */
@@ -906,17 +2478,28 @@ xml_child_insert_pos(cxobj *xp,
 {
     size_t size;
    
-    xp->x_childvec_len++;
-    if (xp->x_childvec_len > xp->x_childvec_max)
-	xp->x_childvec_max = xp->x_childvec_max?2*xp->x_childvec_max:XML_CHILDVEC_MAX_DEFAULT;
-    xp->x_childvec = realloc(xp->x_childvec, xp->x_childvec_max*sizeof(cxobj*));
-    if (xp->x_childvec == NULL){
-	clicon_err(OE_XML, errno, "realloc");
+    xp->x_flags &= ~XML_FLAG_SORTED;
+    if (xp->x_type == CX_ELMNT && !x_chunked(xp) && xp->x_arena == NULL &&
+	xp->x_childvec_len >= XML_CHILDVEC_CHUNKED_MIN &&
+	xml_chunks_split(xp) < 0)
 	return -1;
+    if (x_chunked(xp)){
+	if (xml_chunks_insert(xp, xc, i) < 0)
+	    return -1;
+    }
+    else {
+	if (xml_childvec_grow(xp) < 0)
+	    return -1;
+	xp->x_childvec_len++;
+	size = (xml_child_nr(xp) - i - 1)*sizeof(cxobj *);
+	memmove(&xp->x_childvec[i+1], &xp->x_childvec[i], size);
+	xp->x_childvec[i] = xc;
     }
-    size = (xml_child_nr(xp) - i - 1)*sizeof(cxobj *);
-    memmove(&xp->x_childvec[i+1], &xp->x_childvec[i], size);
-    xp->x_childvec[i] = xc;
+    if (xml_arena_attach(xp, xc) < 0)
+	return -1;
+    xml_children_changed(xp, xc);
+    if ((xc->x_flags & XML_FLAG_EDIT) && xml_edits_add(xp, xc) < 0)
+	return -1;
     return 0;
 }
 
@@ -931,8 +2514,27 @@ int
 xml_childvec_set(cxobj *x, 
 		 int    len)
 {
+    if (x->x_type != CX_ELMNT){
+	clicon_err(OE_XML, EINVAL, "%s %s cannot have children",
+		   xml_type2str(x->x_type), x->x_name);
+	return -1;
+    }
+    xml_children_changed(x, NULL);
+    xml_index_free(x);
+    if (x_chunked(x)){
+	xml_chunks_free(x);
+	x->x_childvec_max = 0;
+    }
     x->x_childvec_len = len;
     x->x_childvec_max = len;
+    if (x->x_arena){
+	if ((x->x_childvec = xml_arena_alloc(x->x_arena, len*sizeof(cxobj*))) == NULL){
+	    clicon_err(OE_XML, errno, "malloc");
+	    return -1;
+	}
+	memset(x->x_childvec, 0, len*sizeof(cxobj*));
+	return 0;
+    }
     if (x->x_childvec)
 	free(x->x_childvec);
     if ((x->x_childvec = calloc(len, sizeof(cxobj*))) == NULL){
@@ -947,9 +2549,58 @@ xml_childvec_set(cxobj *x,
 cxobj **
 xml_childvec_get(cxobj *x)
 {
+    if (x->x_type != CX_ELMNT)
+	return NULL;
+    /* Chunked children are moved back to a vector, to sort see xml_child_sort */
+    if (x_chunked(x) && xml_chunks_flatten(x) < 0)
+	return NULL;
     return x->x_childvec;
 }
 
+/*! Sort the children of an XML node
+ * Chunked children are sorted in place in their chunks, so that they are 
+ * not moved back to a vector and split into chunks again on the next insert.
+ * @param[in]  x       XML node
+ * @param[in]  compar  qsort compare function of two (cxobj **)
+ * @retval     0       OK
+ * @retval    -1       Error
+ * @see xml_sort
+ */
+int
+xml_child_sort(cxobj *x,
+	       int  (*compar)(const void *, const void *))
+{
+    struct xml_chunks *xcs;
+    cxobj            **vec;
+    int                i;
+    int                j;
+
+    if (x->x_type != CX_ELMNT || x->x_childvec_len < 2)
+	return 0;
+    if (!x_chunked(x)){
+	qsort(x->x_childvec, x->x_childvec_len, sizeof(cxobj *), compar);
+	return 0;
+    }
+    xcs = x->x_ext->xe_chunks;
+    if ((vec = malloc(x->x_childvec_len*sizeof(cxobj*))) == NULL){
+	clicon_err(OE_XML, errno, "malloc");
+	return -1;
+    }
+    i = 0;
+    for (j=0; j<xcs->xcs_len; j++){
+	memcpy(&vec[i], xcs->xcs_vec[j]->xch_vec, xcs->xcs_vec[j]->xch_len*sizeof(cxobj*));
+	i += xcs->xcs_vec[j]->xch_len;
+    }
+    qsort(vec, x->x_childvec_len, sizeof(cxobj *), compar);
+    i = 0;
+    for (j=0; j<xcs->xcs_len; j++){
+	memcpy(xcs->xcs_vec[j]->xch_vec, &vec[i], xcs->xcs_vec[j]->xch_len*sizeof(cxobj*));
+	i += xcs->xcs_vec[j]->xch_len;
+    }
+    free(vec);
+    return 0;
+}
+
 /*! Create new xml node given a name and parent. Free with xml_free().
  *
  * @param[in]  name      Name of XML node
@@ -968,32 +2619,99 @@ xml_childvec_get(cxobj *x)
  *       proper sorting and insert functionality. Except as follows:
  *         - type is body or attribute
  *         - Yang is unknown
+ * @note If the parent is allocated from an arena, so is the new node
  * @see xml_sort_insert
+ * @see xml_new_arena
  */
 cxobj *
 xml_new(char      *name, 
 	cxobj     *xp,
 	yang_stmt *yspec)
 {
-    cxobj *x;
+    cxobj            *x;
+    struct xml_arena *xa = xp?xp->x_arena:NULL;
     
-    if ((x = malloc(sizeof(cxobj))) == NULL){
+    if (xa)
+	x = xml_arena_alloc(xa, sizeof(cxobj));
+    else
+	x = malloc(sizeof(cxobj));
+    if (x == NULL){
 	clicon_err(OE_XML, errno, "malloc");
 	return NULL;
     }
     memset(x, 0, sizeof(cxobj));
-    if ((xml_name_set(x, name)) < 0)
+    if ((x->x_arena = xa) != NULL)
+	xa->xa_roots++; /* Until appended to xp */
+    if ((xml_name_set(x, name)) < 0){
+	xml_free(x);
 	return NULL;
+    }
     if (xp){
-	xml_parent_set(x, xp);
-	if (xml_child_append(xp, x) < 0) 
+	if (xml_child_append(xp, x) < 0){
+	    xml_free(x);
 	    return NULL;
+	}
+	xml_parent_set(x, xp);
 	x->_x_i = xml_child_nr(xp)-1;
     }
     x->x_spec = yspec; /* Can be NULL */
     return x;
 }
 
+/*! Create new top xml node whose whole tree is allocated from an arena
+ *
+ * All nodes later created under this node with xml_new(), including by the
+ * xml parser and by xml_copy(), as well as their names, prefixes, values and
+ * child vectors, are bump-allocated from a common arena. This is intended for
+ * large short-lived trees, such as incoming requests and datastore copies.
+ * Nodes are freed with xml_free() as usual, but arena memory is only
+ * released, all at once, when the last root of the arena has been freed.
+ * Freeing the top node therefore does not visit the tree, unless nodes not
+ * allocated from the arena have been added to it.
+ * @param[in]  name      Name of XML node
+ * @param[in]  spec      Yang statement of this XML or NULL.
+ * @retval     xml       Created xml object if successful. Free with xml_free()
+ * @retval     NULL      Error and clicon_err() called
+ * @code
+ *   cxobj *xt;
+ *   if ((xt = xml_new_arena("top", NULL)) == NULL)
+ *     err;
+ *   if (xml_parse_string(str, yspec, &xt) < 0)
+ *     err;
+ *   ...
+ *   xml_free(xt);
+ * @endcode
+ * @note Nodes moved from an arena tree to a long-lived tree keep the whole arena
+ *       alive, use xml_dup() to copy them to the heap instead
+ * @note Do not move arena nodes under a heap node that is itself added to the
+ *       same arena tree, the arena is then never released
+ * @see xml_new
+ */
+cxobj *
+xml_new_arena(char      *name, 
+	      yang_stmt *spec)
+{
+    cxobj            *x;
+    struct xml_arena *xa;
+
+    if ((xa = xml_arena_new()) == NULL)
+	return NULL;
+    if ((x = xml_arena_alloc(xa, sizeof(cxobj))) == NULL){
+	clicon_err(OE_XML, errno, "malloc");
+	xml_arena_free(xa);
+	return NULL;
+    }
+    memset(x, 0, sizeof(cxobj));
+    x->x_arena = xa;
+    xa->xa_roots++;
+    if ((xml_name_set(x, name)) < 0){
+	xml_free(x);
+	return NULL;
+    }
+    x->x_spec = spec; /* Can be NULL */
+    return x;
+}
+
 /*! Return yang spec of node. 
  * Not necessarily set. Either has not been set yet (by xml_spec_set( or anyxml.
  */
@@ -1007,6 +2725,15 @@ int
 xml_spec_set(cxobj     *x, 
 	     yang_stmt *spec)
 {
+    if (x->x_spec != spec){
+	/* Cached key tuples are built from yang */
+	xml_keys_reset(x);
+	if (x->x_up)
+	    xml_keys_reset(x->x_up);
+	/* Order is defined by yang */
+	x->x_flags &= ~XML_FLAG_SORTED;
+	xml_sorted_reset(x);
+    }
     x->x_spec = spec;
     return 0;
 }
@@ -1020,7 +2747,7 @@ xml_spec_set(cxobj     *x,
 cg_var *
 xml_cv(cxobj *x)
 {
-    return x->x_cv;
+    return x->x_ext?x->x_ext->xe_cv:NULL;
 }
 
 /*! Return (cached) cligen variable value of xml node
@@ -1033,12 +2760,195 @@ int
 xml_cv_set(cxobj  *x, 
 	   cg_var *cv)
 {
-    if (x->x_cv)
-	cv_free(x->x_cv);
-    x->x_cv = cv;
+    struct xml_ext *xe;
+
+    if ((xe = x->x_ext) == NULL){
+	if (cv == NULL)
+	    return 0;
+	if ((xe = xml_ext_get(x)) == NULL)
+	    return -1;
+    }
+    if (xe->xe_cv)
+	cv_free(xe->xe_cv);
+    xe->xe_cv = cv;
+    return 0;
+}
+
+/*! Get cached key tuple of a list entry
+ * @param[in]  x     XML list entry
+ * @param[out] len   Number of keys
+ * @retval     keys  Key tuple, owned by x
+ * @retval     NULL  No cached key tuple
+ * @note The tuple is cleared when children or key values of x change
+ * @see xml_keys_set
+ */
+struct xml_key *
+xml_keys(cxobj *x,
+	 int   *len)
+{
+    if (x->x_ext == NULL || x->x_ext->xe_keys == NULL)
+	return NULL;
+    *len = x->x_ext->xe_keys_len;
+    return x->x_ext->xe_keys;
+}
+
+/*! Set cached key tuple of a list entry
+ * @param[in]  x     XML list entry
+ * @param[in]  keys  Malloced key tuple, consumed by x
+ * @param[in]  len   Number of keys
+ * @retval     0     OK
+ * @retval    -1     Error
+ * @see xml_keys
+ */
+int
+xml_keys_set(cxobj          *x,
+	     struct xml_key *keys,
+	     int             len)
+{
+    struct xml_ext *xe;
+
+    if ((xe = xml_ext_get(x)) == NULL){
+	free(keys);
+	return -1;
+    }
+    xml_keys_reset(x);
+    xe->xe_keys = keys;
+    xe->xe_keys_len = len;
+    return 0;
+}
+
+/*! Double the number of buckets of a key index and rehash its entries
+ * @param[in]  xi   Key index
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+xml_index_grow(struct xml_index *xi)
+{
+    struct xml_index_entry **tab;
+    struct xml_index_entry  *xie;
+    uint32_t                 size;
+    uint32_t                 i;
+    uint32_t                 j;
+
+    size = xi->xi_size ? 2*xi->xi_size : XML_INDEX_SIZE_DEFAULT;
+    if ((tab = calloc(size, sizeof(*tab))) == NULL){
+	clicon_err(OE_XML, errno, "calloc");
+	return -1;
+    }
+    for (i=0; i<xi->xi_size; i++)
+	while ((xie = xi->xi_tab[i]) != NULL){
+	    xi->xi_tab[i] = xie->xie_next;
+	    j = xie->xie_hash & (size-1);
+	    xie->xie_next = tab[j];
+	    tab[j] = xie;
+	}
+    if (xi->xi_tab)
+	free(xi->xi_tab);
+    xi->xi_tab = tab;
+    xi->xi_size = size;
     return 0;
 }
 
+/*! Add a list entry to the key index of its parent, create index if needed
+ * The entry must have a cached key tuple, see xml_keys_set.
+ * @param[in]  xp   Parent XML node
+ * @param[in]  x    XML list entry, child of xp
+ * @retval     1    Added
+ * @retval     0    Not added: no key tuple, not indexable keys, not a child or
+ *                  already indexed
+ * @retval    -1    Error
+ * @see xml_index_find
+ */
+int
+xml_index_add(cxobj *xp,
+	      cxobj *x)
+{
+    struct xml_ext         *xe;
+    struct xml_index       *xi;
+    struct xml_index_entry *xie;
+    uint32_t                hash;
+
+    if (x->x_up != xp || !xml_keys_cached(x))
+	return 0;
+    if (xml_keys_hash(x->x_spec, x->x_ext->xe_keys, x->x_ext->xe_keys_len, &hash) == 0)
+	return 0;
+    if ((xe = xml_ext_get(xp)) == NULL)
+	return -1;
+    if ((xi = xe->xe_index) == NULL){
+	if ((xi = calloc(1, sizeof(*xi))) == NULL){
+	    clicon_err(OE_XML, errno, "calloc");
+	    return -1;
+	}
+	xe->xe_index = xi;
+    }
+    /* Already indexed: a second entry would be left behind by xml_index_rm */
+    if (xi->xi_size)
+	for (xie = xi->xi_tab[hash & (xi->xi_size-1)]; xie; xie = xie->xie_next)
+	    if (xie->xie_x == x)
+		return 0;
+    if (xi->xi_nr >= xi->xi_size && xml_index_grow(xi) < 0)
+	return -1;
+    if ((xie = malloc(sizeof(*xie))) == NULL){
+	clicon_err(OE_XML, errno, "malloc");
+	return -1;
+    }
+    xie->xie_hash = hash;
+    xie->xie_x = x;
+    xie->xie_next = xi->xi_tab[hash & (xi->xi_size-1)];
+    xi->xi_tab[hash & (xi->xi_size-1)] = xie;
+    xi->xi_nr++;
+    return 1;
+}
+
+/*! Find a list entry among children of a node using its key index
+ * @param[in]  xp    Parent XML node
+ * @param[in]  y     Yang spec of list entry
+ * @param[in]  keys  Key tuple to look for
+ * @param[in]  len   Number of keys
+ * @retval     x     Matching list entry
+ * @retval     NULL  Not found in index, may still be a child of xp
+ * @note The index may be incomplete, a miss does not mean the entry does not exist
+ * @see xml_index_add
+ */
+cxobj *
+xml_index_find(cxobj          *xp,
+	       yang_stmt      *y,
+	       struct xml_key *keys,
+	       int             len)
+{
+    struct xml_index       *xi;
+    struct xml_index_entry *xie;
+    uint32_t                hash;
+    cxobj                  *x;
+
+    if (xp->x_ext == NULL || (xi = xp->x_ext->xe_index) == NULL || xi->xi_nr == 0)
+	return NULL;
+    if (xml_keys_hash(y, keys, len, &hash) == 0)
+	return NULL;
+    for (xie = xi->xi_tab[hash & (xi->xi_size-1)]; xie; xie = xie->xie_next){
+	x = xie->xie_x;
+	if (xie->xie_hash == hash &&
+	    x->x_spec == y &&
+	    x->x_ext->xe_keys_len == len &&
+	    xml_keys_equal(x->x_ext->xe_keys, keys, len))
+	    return x;
+    }
+    return NULL;
+}
+
+/*! Get number of entries in the key index of a node
+ * @param[in]  xp    XML node
+ * @retval     nr    Number of indexed list entries, 0 if no index
+ */
+int
+xml_index_nr(cxobj *xp)
+{
+    if (xp->x_ext == NULL || xp->x_ext->xe_index == NULL)
+	return 0;
+    return xp->x_ext->xe_index->xi_nr;
+}
+
 /*! Find an XML node matching name among a parent's children.
  *
  * Get first XML node directly under x_up in the xml hierarchy with
@@ -1050,7 +2960,7 @@ xml_cv_set(cxobj  *x,
  * @retval xmlobj     if found.
  * @retval NULL       if no such node found.
  * @see xml_find_type  A more generic function
- * @note Linear scalability and relies on strcmp
+ * @note Linear scalability, but names are compared by (interned) pointer
  */
 cxobj *
 xml_find(cxobj *x_up, 
@@ -1058,8 +2968,10 @@ xml_find(cxobj *x_up,
 {
     cxobj *x = NULL;
 
+    if ((name = xml_symbol_find(name)) == NULL)
+	return NULL;
     while ((x = xml_child_each(x_up, x, -1)) != NULL) 
-	if (strcmp(name, xml_name(x)) == 0)
+	if (xml_name(x) == name)
 	    return x;
     return NULL;
 }
@@ -1135,13 +3047,12 @@ xml_wrap_all(cxobj *xp,
 {
     cxobj *xw; /* new wrap node */
 
-    if ((xw = xml_new(tag, NULL, NULL)) == NULL)
+    /* Create xw under xp, so that it is allocated from the arena of xp if any */
+    if ((xw = xml_new(tag, xp, NULL)) == NULL)
 	goto done;
-    while (xp->x_childvec_len)
+    while (xml_child_nr(xp) > 1)
 	if (xml_addsub(xw, xml_child_i(xp, 0)) < 0)
 	    goto done;
-    if (xml_addsub(xp, xw) < 0)
-	goto done;
   done:
     return xw;
 }
@@ -1226,12 +3137,27 @@ xml_child_rm(cxobj *xp,
 	clicon_err(OE_XML, 0, "Child not found");
 	goto done;
     }
-    xp->x_childvec[i] = NULL;
+    xml_index_rm(xp, xc);
+    if (xc->x_flags & XML_FLAG_EDIT)
+	xml_edits_rm(xp, xc);
+    if (!x_chunked(xp) && xp->x_arena == NULL &&
+	xp->x_childvec_len >= XML_CHILDVEC_CHUNKED_MIN &&
+	xml_chunks_split(xp) < 0)
+	goto done;
+    xml_arena_detach(xp, xc);
     xml_parent_set(xc, NULL);
-    xp->x_childvec_len--;
-    /* shift up, note same index i used but ok since we break */
-    for (; i<xp->x_childvec_len; i++)
-	xp->x_childvec[i] = xp->x_childvec[i+1];
+    xml_dsindex_clear(xc);
+    xml_dsdirty_mark(xp, XML_DSDIRTY_RM);
+    if (x_chunked(xp))
+	xml_chunks_rm(xp, i);
+    else {
+	xp->x_childvec[i] = NULL;
+	xp->x_childvec_len--;
+	/* shift up, note same index i used but ok since we break */
+	for (; i<xp->x_childvec_len; i++)
+	    xp->x_childvec[i] = xp->x_childvec[i+1];
+    }
+    xml_children_changed(xp, xc);
     retval = 0;
  done:
     return retval;
@@ -1490,16 +3416,15 @@ xml_find_type(cxobj           *xt,
 	      enum cxobj_type  type)
 {
     cxobj *x = NULL;
-    int    pmatch; /* prefix match */
-    char  *xprefix;     /* xprefix */
     
+    if ((name = xml_symbol_find(name)) == NULL)
+	return NULL;
+    if (prefix && (prefix = xml_symbol_find(prefix)) == NULL)
+	return NULL;
     while ((x = xml_child_each(xt, x, type)) != NULL) {
-	xprefix = xml_prefix(x);
-	if (prefix)
-	    pmatch = xprefix?strcmp(prefix,xprefix)==0:0;
-	else
-	    pmatch = 1;
-	if (pmatch && strcmp(name, xml_name(x)) == 0)
+	if (prefix && xml_prefix(x) != prefix)
+	    continue;
+	if (xml_name(x) == name)
 	    return x;
     }
     return NULL;
@@ -1526,8 +3451,10 @@ xml_find_value(cxobj *xt,
 {
     cxobj *x = NULL;
     
+    if ((name = xml_symbol_find(name)) == NULL)
+	return NULL;
     while ((x = xml_child_each(xt, x, -1)) != NULL) 
-	if (strcmp(name, xml_name(x)) == 0)
+	if (xml_name(x) == name)
 	    return xml_value(x);
     return NULL;
 }
@@ -1549,8 +3476,10 @@ xml_find_body(cxobj *xt,
 {
     cxobj *x=NULL;
 
+    if ((name = xml_symbol_find(name)) == NULL)
+	return NULL;
     while ((x = xml_child_each(xt, x, -1)) != NULL) 
-	if (strcmp(name, xml_name(x)) == 0)
+	if (xml_name(x) == name)
 	    return xml_body(x);
     return NULL;
 }
@@ -1577,8 +3506,10 @@ xml_find_body_obj(cxobj *xt,
     cxobj *x = NULL;
     char  *bstr;
 
+    if ((name = xml_symbol_find(name)) == NULL)
+	return NULL;
     while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
-	if (strcmp(name, xml_name(x)))
+	if (xml_name(x) != name)
 	    continue;
 	if ((bstr = xml_body(x)) == NULL)
 	    continue;
@@ -1588,34 +3519,99 @@ xml_find_body_obj(cxobj *xt,
     return x;
 }
 
+/*! Release an arena when its last root has been freed
+ * The nodes of the arena are not visited. Only what the arena holds references
+ * to is released: children not allocated from the arena are freed, heap 
+ * memory of side structures is freed and symbols are released. Then all 
+ * blocks are freed at once.
+ * @param[in]  xa  Arena
+ * @see xml_free
+ */
+static void
+xml_arena_release(struct xml_arena *xa)
+{
+    struct xml_arena_ref *ar;
+    struct xml_symbol    *xs;
+    struct xml_ext       *xe;
+    cxobj                *x;
+
+    for (ar = xa->xa_foreign; ar; ar = ar->ar_next){
+	x = ar->ar_p;
+	x->x_up = NULL;
+	xml_free(x);
+    }
+    for (ar = xa->xa_ext; ar; ar = ar->ar_next){
+	x = ar->ar_p;
+	if ((xe = x->x_ext) == NULL)
+	    continue;
+	if (xe->xe_cv)
+	    cv_free(xe->xe_cv);
+	if (xe->xe_ns_cache)
+	    xml_nsctx_free(xe->xe_ns_cache);
+	if (xe->xe_keys)
+	    free(xe->xe_keys);
+	xml_index_free(x);
+	xml_edits_free(x);
+    }
+    for (ar = xa->xa_syms; ar; ar = ar->ar_next){
+	xs = XML_SYMBOL((char*)ar->ar_p);
+	if (xs->xs_arena == xa)
+	    xs->xs_arena = NULL;
+	xml_symbol_put(ar->ar_p);
+    }
+    xml_arena_free(xa);
+}
+
 /*! Free an xl sub-tree recursively, but do not remove it from parent
+ * A node allocated from an arena is not freed by itself, nor are its
+ * children visited. If it is the last root of its arena, the whole arena is
+ * released at once, otherwise its memory is released with the arena.
  * @param[in]  x  the xml tree to be freed.
  * @see xml_purge where x is also removed from parent
+ * @see xml_new_arena
  */
 int
 xml_free(cxobj *x)
 {
-    int i;
-    cxobj *xc;
-
+    int               i;
+    cxobj            *xc;
+    struct xml_arena *xa;
+
+    if ((xa = x->x_arena) != NULL){
+	if ((x->x_up == NULL || x->x_up->x_arena != xa) && 
+	    --xa->xa_roots == 0)
+	    xml_arena_release(xa);
+	return 0;
+    }
+    if (x->x_up && x->x_up->x_arena) /* Freed under arena node, see xml_type_set */
+	xml_arena_unref(&x->x_up->x_arena->xa_foreign, x);
+    if (x->x_type == CX_ELMNT)
+	for (i=0; i<x->x_childvec_len; i++){
+	    if ((xc = xml_child_i(x, i)) != NULL)
+		xml_free(xc);
+	}
+    if (x->x_ext){
+	if (x->x_ext->xe_cv)
+	    cv_free(x->x_ext->xe_cv);
+	if (x->x_ext->xe_ns_cache)
+	    xml_nsctx_free(x->x_ext->xe_ns_cache);
+	if (x->x_ext->xe_keys)
+	    free(x->x_ext->xe_keys);
+	xml_index_free(x);
+	xml_chunks_free(x);
+	xml_edits_free(x);
+	free(x->x_ext);
+    }
     if (x->x_name)
-	free(x->x_name);
-    if (x->x_value_cb)
-	cbuf_free(x->x_value_cb);  
+	xml_symbol_put(x->x_name);
     if (x->x_prefix)
-	free(x->x_prefix);
-    for (i=0; i<x->x_childvec_len; i++){
-	if ((xc = x->x_childvec[i]) != NULL){
-	    xml_free(xc);
-	    x->x_childvec[i] = NULL;
-	}
+	xml_symbol_put(x->x_prefix);
+    if (x->x_type == CX_ELMNT){
+	if (x->x_childvec)
+	    free(x->x_childvec);
     }
-    if (x->x_childvec)
-	free(x->x_childvec);
-    if (x->x_cv)
-	cv_free(x->x_cv);
-    if (x->x_ns_cache)
-	xml_nsctx_free(x->x_ns_cache);
+    else if (x->x_value)
+	free(x->x_value);
     free(x);
     return 0;
 }
@@ -1956,19 +3952,6 @@ _xml_parse(const char  *str,
     return retval; 
 }
 
-/*! FSM to detect substring
- */
-static inline int
-FSM(char *tag, 
-    char  ch, 
-    int   state)
-{
-    if (tag[state] == ch)
-	return state+1;
-    else
-	return 0;
-}
-
 /*! Read an XML definition from file and parse it into a parse-tree. 
  *
  * @param[in]  fd  A file descriptor containing the XML file (as ASCII characters)
@@ -1994,61 +3977,21 @@ xml_parse_file(int        fd,
 	       yang_stmt *yspec,
 	       cxobj    **xt)
 {
-    int   retval = -1;
-    int   ret;
-    int   len = 0;
-    char  ch;
-    char *xmlbuf = NULL;
-    char *ptr;
-    int   xmlbuflen = BUFLEN; /* start size */
-    int   endtaglen = 0;
-    int   state = 0;
-    int   oldxmlbuflen;
-
-    if (endtag != NULL)
-	endtaglen = strlen(endtag);
-    if ((xmlbuf = malloc(xmlbuflen)) == NULL){
-	clicon_err(OE_XML, errno, "malloc");
+    int    retval = -1;
+    char  *xmlbuf = NULL;
+
+    /* Read whole file (or until endtag) in blocks, not one byte at a time */
+    if (clicon_file_read(fd, endtag, &xmlbuf, NULL) < 0)
+	goto done;
+    if (*xt == NULL)
+	if ((*xt = xml_new(XML_TOP_SYMBOL, NULL, NULL)) == NULL)
+	    goto done;
+    if (_xml_parse(xmlbuf, yspec, *xt) < 0)
 	goto done;
-    }
-    memset(xmlbuf, 0, xmlbuflen);
-    ptr = xmlbuf;
-    while (1){
-	if ((ret = read(fd, &ch, 1)) < 0){
-	    clicon_err(OE_XML, errno, "read: [pid:%d]", 
-		    (int)getpid());
-	    break;
-	}
-	if (ret != 0){
-	    if (endtag)
-		state = FSM(endtag, ch, state);
-	    xmlbuf[len++] = ch;
-	}
-	if (ret == 0 ||
-	    (endtag && (state == endtaglen))){
-	    state = 0;
-	    if (*xt == NULL)
-		if ((*xt = xml_new(XML_TOP_SYMBOL, NULL, NULL)) == NULL)
-		    goto done;
-	    if (_xml_parse(ptr, yspec, *xt) < 0)
-		goto done;
-	    break;
-	}
-	if (len>=xmlbuflen-1){ /* Space: one for the null character */
-	    oldxmlbuflen = xmlbuflen;
-	    xmlbuflen *= 2;
-	    if ((xmlbuf = realloc(xmlbuf, xmlbuflen)) == NULL){
-		clicon_err(OE_XML, errno, "realloc");
-		goto done;
-	    }
-	    memset(xmlbuf+oldxmlbuflen, 0, xmlbuflen-oldxmlbuflen);
-	    ptr = xmlbuf;
-	}
-    } /* while */
     retval = 0;
  done:
     if (retval < 0 && *xt){
-	free(*xt);
+	xml_free(*xt);
 	*xt = NULL;
     }
     if (xmlbuf)
@@ -2210,6 +4153,8 @@ xml_copy(cxobj *x0,
  *   x1 = xml_dup(x0);
  * @endcode
  * Note, returned tree should be freed as: xml_free(x1)
+ * The copy is allocated from the heap also if x0 is allocated from an arena, 
+ * so it does not keep the arena of x0 alive.
  */
 cxobj *
 xml_dup(cxobj *x0)
@@ -2250,6 +4195,8 @@ cxvec_dup(cxobj  **vec0,
  * @param[in]      x      XML tree (append this to vector)
  * @param[in,out]  vec    XML tree vector
  * @param[in,out]  len    Length of XML tree vector
+ * @note The vector is reallocated on every call, use cxvec_append_max when
+ *       appending many nodes
  */
 int
 cxvec_append(cxobj   *x, 
@@ -2268,6 +4215,52 @@ cxvec_append(cxobj   *x,
     return retval;
 }
 
+/*! Append a new xml tree to an xml vector with allocated length, grow exponentially
+ * @param[in]      x      XML tree (append this to vector)
+ * @param[in,out]  vec    XML tree vector
+ * @param[in,out]  len    Length of XML tree vector
+ * @param[in,out]  max    Allocated length of XML tree vector, 0 on init
+ * @retval         0      OK
+ * @retval        -1      Error
+ * @code
+ *   cxobj **vec = NULL;
+ *   size_t  len = 0;
+ *   size_t  max = 0;
+ *   if (cxvec_append_max(x, &vec, &len, &max) < 0)
+ *      err;
+ *   free(vec);
+ * @endcode
+ * @see cxvec_append
+ */
+int
+cxvec_append_max(cxobj   *x, 
+		 cxobj ***vec, 
+		 size_t  *len,
+		 size_t  *max)
+{
+    int     retval = -1;
+    cxobj **v;
+    size_t  m;
+
+    if (*vec == NULL)
+	*max = 0;
+    if (*len >= *max){
+	m = *max?2*(*max):XML_CHILDVEC_MAX_DEFAULT;
+	if (m <= *len)
+	    m = *len+1;
+	if ((v = realloc(*vec, m*sizeof(cxobj *))) == NULL){
+	    clicon_err(OE_XML, errno, "realloc");
+	    goto done;
+	}
+	*vec = v;
+	*max = m;
+    }
+    (*vec)[(*len)++] = x;
+    retval = 0;
+ done:
+    return retval;
+}
+
 /*! Apply a function call recursively on all xml node children recursively
  * Recursively traverse all xml nodes in a parse-tree and apply fn(arg) for 
  * each object found. The function is called with the xml node and an 
@@ -67,6 +67,8 @@
 #include <assert.h>
 #include <arpa/inet.h>
 #include <sys/param.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 #include <netinet/in.h>
 
 /* cligen */
@@ -264,6 +266,336 @@ xml2cli(FILE              *f,
     return retval;
 }
 
+/*! Evaluate the xpath of a must, when or leafref path statement to a nodeset
+ * Uses the xpath and namespace context compiled at yang parse time if 
+ * available, see ys_compile
+ * @param[in]  xt     XML context node
+ * @param[in]  ys     Yang must, when or path statement
+ * @param[in]  nsc    Namespace context if not compiled, or NULL
+ * @param[out] vec    Vector of nodes, free after use
+ * @param[out] veclen Length of vec
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+yang_xpath_vec(cxobj      *xt,
+	       yang_stmt  *ys,
+	       cvec       *nsc,
+	       cxobj    ***vec,
+	       size_t     *veclen)
+{
+    int     retval = -1;
+    xp_ctx *xr = NULL;
+
+    if (ys->ys_xpath == NULL)
+	return xpath_vec_nsc(xt, nsc, "%s", vec, veclen, ys->ys_argument);
+    *vec = NULL;
+    *veclen = 0;
+    if (xpath_vec_compiled(xt, ys->ys_nsc?ys->ys_nsc:nsc, ys->ys_xpath, &xr) < 0)
+	goto done;
+    if (xr && xr->xc_type == XT_NODESET){
+	*vec = xr->xc_nodeset;
+	xr->xc_nodeset = NULL;
+	*veclen = xr->xc_size;
+    }
+    retval = 0;
+ done:
+    if (xr)
+	ctx_free(xr);
+    return retval;
+}
+
+/*! Evaluate the xpath of a must or when statement to a boolean
+ * @param[in]  xt     XML context node
+ * @param[in]  ys     Yang must or when statement
+ * @retval     1      True
+ * @retval     0      False
+ * @retval    -1      Error
+ * @see yang_xpath_vec
+ */
+static int
+yang_xpath_bool(cxobj     *xt,
+		yang_stmt *ys)
+{
+    int     retval = -1;
+    xp_ctx *xr = NULL;
+
+    if (ys->ys_xpath == NULL)
+	return xpath_vec_bool(xt, NULL, "%s", ys->ys_argument);
+    if (xpath_vec_compiled(xt, NULL, ys->ys_xpath, &xr) < 0)
+	goto done;
+    if (xr)
+	retval = ctx2boolean(xr);
+ done:
+    if (xr)
+	ctx_free(xr);
+    return retval;
+}
+
+/*
+ * Leafref value index
+ * During validation of a tree, the target values of a leafref path are
+ * collected once per context node into a hash set, so that checking that a
+ * leafref value exists is a lookup instead of a scan of all targets.
+ * Sets are only made for context nodes shared by many leafrefs, ie above a
+ * list or leaf-list instance, and are found by hashing (path, context node).
+ * The tree must not be modified while the index is active.
+ */
+
+/*! Set of target values of a leafref path evaluated from a context node */
+struct leafref_set {
+    struct leafref_set *ls_next;  /* Next set in hash bucket */
+    yang_stmt          *ls_path;  /* Yang path statement */
+    cxobj              *ls_ctx;   /* Context node: root or ancestor of leafrefs */
+    char              **ls_vec;   /* Open addressing hash table of body strings */
+    size_t              ls_size;  /* Size of ls_vec, power of two */
+};
+
+/* Hash table of leafref value sets, active if _leafref_active > 0 */
+static struct leafref_set **_leafref_tab = NULL;
+static size_t               _leafref_size = 0; /* Buckets, power of two */
+static size_t               _leafref_nr = 0;   /* Number of sets */
+static int                  _leafref_active = 0;
+
+/*! Hash bucket of a leafref path and context node */
+static size_t
+leafref_bucket(yang_stmt *ypath,
+	       cxobj     *xc)
+{
+    uint32_t h;
+
+    h = clicon_hash_fnv1a(CLICON_HASH_FNV1A_INIT, &ypath, sizeof(ypath));
+    h = clicon_hash_fnv1a(h, &xc, sizeof(xc));
+    return h & (_leafref_size - 1);
+}
+
+/*! Activate leafref value index, sets are created on demand
+ * Calls may be nested, the index is freed when the outermost is ended
+ * @see leafref_index_end
+ */
+static void
+leafref_index_begin(void)
+{
+    _leafref_active++;
+}
+
+/*! Deactivate leafref value index and free its sets
+ * @see leafref_index_begin
+ */
+static void
+leafref_index_end(void)
+{
+    struct leafref_set *ls;
+    size_t              i;
+
+    if (_leafref_active == 0 || --_leafref_active > 0)
+	return;
+    for (i=0; i<_leafref_size; i++)
+	while ((ls = _leafref_tab[i]) != NULL){
+	    _leafref_tab[i] = ls->ls_next;
+	    if (ls->ls_vec)
+		free(ls->ls_vec);
+	    free(ls);
+	}
+    if (_leafref_tab)
+	free(_leafref_tab);
+    _leafref_tab = NULL;
+    _leafref_size = 0;
+    _leafref_nr = 0;
+}
+
+/*! Double the number of buckets of the leafref set hash table
+ * @retval  0   OK
+ * @retval -1   Error
+ */
+static int
+leafref_tab_grow(void)
+{
+    struct leafref_set **tab0 = _leafref_tab;
+    size_t               size0 = _leafref_size;
+    struct leafref_set  *ls;
+    size_t               i;
+    size_t               h;
+
+    _leafref_size = size0 ? 2*size0 : 64;
+    if ((_leafref_tab = calloc(_leafref_size, sizeof(*_leafref_tab))) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	_leafref_tab = tab0;
+	_leafref_size = size0;
+	return -1;
+    }
+    for (i=0; i<size0; i++)
+	while ((ls = tab0[i]) != NULL){
+	    tab0[i] = ls->ls_next;
+	    h = leafref_bucket(ls->ls_path, ls->ls_ctx);
+	    ls->ls_next = _leafref_tab[h];
+	    _leafref_tab[h] = ls;
+	}
+    if (tab0)
+	free(tab0);
+    return 0;
+}
+
+/*! Get context node of a leafref path, if its targets should be indexed
+ * Only plain paths are indexed: without predicates, and relative paths
+ * only with leading "../" steps. The targets of such a path are the same
+ * for all leafrefs with the same context node: the root for an absolute
+ * path, otherwise the ancestor given by the number of "../" steps.
+ * The context node is only shared by several leafrefs if there is a list or
+ * leaf-list instance between the leafref and the context node, otherwise
+ * the path is evaluated directly.
+ * @param[in]  xt    XML leafref node
+ * @param[in]  path  Leafref path
+ * @retval     xc    Context node
+ * @retval     NULL  Path should not be indexed
+ */
+static cxobj *
+leafref_ctx(cxobj *xt,
+	    char  *path)
+{
+    cxobj         *xc = xt;
+    yang_stmt     *y;
+    enum rfc_6020  keyw;
+    int            shared = 0;
+
+    if (strchr(path, '[') != NULL)
+	return NULL;
+    if (*path == '/'){
+	while (xml_parent(xc) != NULL)
+	    xc = xml_parent(xc);
+    }
+    else {
+	while (strncmp(path, "../", 3) == 0){
+	    if ((xc = xml_parent(xc)) == NULL)
+		return NULL;
+	    path += 3;
+	}
+	if (strstr(path, "..") != NULL)
+	    return NULL;
+    }
+    for (; xt != xc; xt = xml_parent(xt))
+	if ((y = xml_spec(xt)) != NULL &&
+	    ((keyw = yang_keyword_get(y)) == Y_LIST || keyw == Y_LEAF_LIST)){
+	    shared++;
+	    break;
+	}
+    return shared ? xc : NULL;
+}
+
+/*! Add a body string to a leafref value set, duplicates are ignored
+ * @param[in]  ls    Leafref value set with room for body
+ * @param[in]  body  Body string, not copied
+ */
+static void
+leafref_set_add(struct leafref_set *ls,
+		char               *body)
+{
+    size_t i;
+
+    i = clicon_hash_fnv1a_str(CLICON_HASH_FNV1A_INIT, body) & (ls->ls_size - 1);
+    while (ls->ls_vec[i] != NULL){
+	if (strcmp(ls->ls_vec[i], body) == 0)
+	    return;
+	i = (i + 1) & (ls->ls_size - 1);
+    }
+    ls->ls_vec[i] = body;
+}
+
+/*! Find a body string in a leafref value set
+ * @param[in]  ls    Leafref value set
+ * @param[in]  body  Body string
+ * @retval     1     Found
+ * @retval     0     Not found
+ */
+static int
+leafref_set_find(struct leafref_set *ls,
+		 char               *body)
+{
+    size_t i;
+
+    i = clicon_hash_fnv1a_str(CLICON_HASH_FNV1A_INIT, body) & (ls->ls_size - 1);
+    while (ls->ls_vec[i] != NULL){
+	if (strcmp(ls->ls_vec[i], body) == 0)
+	    return 1;
+	i = (i + 1) & (ls->ls_size - 1);
+    }
+    return 0;
+}
+
+/*! Get leafref value set of a path and context node, create it if not found
+ * @param[in]  xt     XML leafref node, path is evaluated from it on create
+ * @param[in]  ytype  Yang type statement of the leafref
+ * @param[in]  ypath  Yang path statement
+ * @param[in]  xc     Context node, see leafref_ctx
+ * @param[out] lsp    Leafref value set
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+leafref_set_get(cxobj               *xt,
+		yang_stmt           *ytype,
+		yang_stmt           *ypath,
+		cxobj               *xc,
+		struct leafref_set **lsp)
+{
+    int                 retval = -1;
+    struct leafref_set *ls;
+    cvec               *nsc = NULL;
+    cxobj             **xvec = NULL;
+    size_t              xlen = 0;
+    char               *body;
+    size_t              i;
+    size_t              h;
+
+    ls = NULL;
+    if (_leafref_size)
+	for (ls = _leafref_tab[leafref_bucket(ypath, xc)]; ls; ls = ls->ls_next)
+	    if (ls->ls_path == ypath && ls->ls_ctx == xc)
+		break;
+    if (ls == NULL){
+	if (ypath->ys_nsc == NULL &&
+	    xml_nsctx_yang(ytype, &nsc) < 0)
+	    goto done;
+	if (yang_xpath_vec(xt, ypath, nsc, &xvec, &xlen) < 0) 
+	    goto done;
+	if ((ls = malloc(sizeof(*ls))) == NULL){
+	    clicon_err(OE_UNIX, errno, "malloc");
+	    goto done;
+	}
+	memset(ls, 0, sizeof(*ls));
+	ls->ls_path = ypath;
+	ls->ls_ctx = xc;
+	ls->ls_size = 8;
+	while (ls->ls_size < 2*xlen)
+	    ls->ls_size *= 2;
+	if ((ls->ls_vec = calloc(ls->ls_size, sizeof(char*))) == NULL){
+	    clicon_err(OE_UNIX, errno, "calloc");
+	    free(ls);
+	    goto done;
+	}
+	for (i=0; i<xlen; i++)
+	    if ((body = xml_body(xvec[i])) != NULL)
+		leafref_set_add(ls, body);
+	if (_leafref_nr >= _leafref_size && leafref_tab_grow() < 0){
+	    free(ls->ls_vec);
+	    free(ls);
+	    goto done;
+	}
+	h = leafref_bucket(ypath, xc);
+	ls->ls_next = _leafref_tab[h];
+	_leafref_tab[h] = ls;
+	_leafref_nr++;
+    }
+    *lsp = ls;
+    retval = 0;
+ done:
+    if (nsc)
+	xml_nsctx_free(nsc);
+    if (xvec)
+	free(xvec);
+    return retval;
+}
+
 /*! Validate xml node of type leafref, ensure the value is one of that path's reference
  * @param[in]  xt    XML leaf node of type leafref
  * @param[in]  ytype Yang type statement belonging to the XML node
@@ -294,6 +626,8 @@ validate_leafref(cxobj     *xt,
     char        *leafrefbody;
     char        *leafbody;
     cvec        *nsc = NULL;
+    cxobj       *xc;
+    struct leafref_set *ls;
     
     if ((leafrefbody = xml_body(xt)) == NULL)
 	goto ok;
@@ -302,10 +636,23 @@ validate_leafref(cxobj     *xt,
 	    goto done;
 	goto fail;
     }
+    /* Use value index if active and path can be indexed */
+    if (_leafref_active &&
+	(xc = leafref_ctx(xt, yang_argument_get(ypath))) != NULL){
+	if (leafref_set_get(xt, ytype, ypath, xc, &ls) < 0)
+	    goto done;
+	if (leafref_set_find(ls, leafrefbody) == 0){
+	    if (netconf_bad_element_xml(xret, "application", leafrefbody, "Leafref validation failed: No such leaf") < 0)
+		goto done;
+	    goto fail;
+	}
+	goto ok;
+    }
     /* XXX see comment above regarding typeref or not */
-    if (xml_nsctx_yang(ytype, &nsc) < 0)
+    if (ypath->ys_nsc == NULL &&
+	xml_nsctx_yang(ytype, &nsc) < 0)
 	goto done;
-    if (xpath_vec_nsc(xt, nsc, "%s", &xvec, &xlen, yang_argument_get(ypath)) < 0) 
+    if (yang_xpath_vec(xt, ypath, nsc, &xvec, &xlen) < 0) 
 	goto done;
     for (i = 0; i < xlen; i++) {
 	x = xvec[i];
@@ -794,33 +1141,42 @@ check_list_key(cxobj     *xt,
     goto done;
 }
 
-/*! New element last in list, check if already exists if sp return -1
- * @param[in]  vec   Vector of existing entries (new is last)
+/*! New element last in list, check if already exists
+ * Entries are kept in an open addressing hash table on their tuple of values
+ * @param[in]  vec   Matrix of entries, vlen values each (new is last)
  * @param[in]  i1    The new entry is placed at vec[i1]
- * @param[in]  vlen  Lenght of entry
- * @retval     0     OK, entry is unique
+ * @param[in]  vlen  Length of entry
+ * @param[in]  tab   Hash table of entry indexes + 1 (0 is empty)
+ * @param[in]  size  Size of tab, power of two larger than number of entries
+ * @retval     0     OK, entry is unique and inserted in tab
  * @retval    -1     Duplicate detected
- * @note This is currently linear complexity. It could be improved by inserting new element sorted and binary search.
  */
 static int
 check_insert_duplicate(char **vec,
 		       int    i1,
-		       int    vlen)
+		       int    vlen,
+		       int   *tab,
+		       size_t size)
 {
-    int i;
-    int v;
-    char *b;
+    uint32_t h = CLICON_HASH_FNV1A_INIT;
+    size_t   j;
+    int      i;
+    int      v;
     
-    for (i=0; i<i1; i++){
-	for (v=0; v<vlen; v++){
-	    b = vec[i*vlen+v];
-	    if (b == NULL || strcmp(b, vec[i1*vlen+v]))
+    for (v=0; v<vlen; v++){
+	h = clicon_hash_fnv1a_str(h, vec[i1*vlen+v]);
+	h = clicon_hash_fnv1a(h, "\xff", 1); /* separator */
+    }
+    for (j = h & (size-1); tab[j] != 0; j = (j+1) & (size-1)){
+	i = tab[j] - 1;
+	for (v=0; v<vlen; v++)
+	    if (strcmp(vec[i*vlen+v], vec[i1*vlen+v]))
 		break;
-	}
 	if (v==vlen) /* duplicate */
-	    break;
+	    return -1;
     }
-    return i==i1?0:-1;
+    tab[j] = i1 + 1;
+    return 0;
 }
 
 /*! Given a list with unique constraint, detect duplicates
@@ -851,6 +1207,8 @@ check_unique_list(cxobj     *x,
     int        i;
     int        v;
     char      *bi;
+    int       *tab = NULL; /* hash table of entries */
+    size_t     size;
     
     cvk = yang_cvec_get(yu);
     vlen = cvec_len(cvk); /* nr of unique elements to check */
@@ -858,6 +1216,13 @@ check_unique_list(cxobj     *x,
 	clicon_err(OE_UNIX, errno, "calloc");
 	goto done;
     }
+    size = 8;
+    while (size < 2*xml_child_nr(xt))
+	size *= 2;
+    if ((tab = calloc(size, sizeof(int))) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	goto done;
+    }
     i = 0; /* x element index */
     do {
 	cvi = NULL;
@@ -873,7 +1238,7 @@ check_unique_list(cxobj     *x,
 	}
 	if (cvi==NULL){
 	    /* Last element (i) is newly inserted, see if it is already there */
-	    if (check_insert_duplicate(vec, i, vlen) < 0){
+	    if (check_insert_duplicate(vec, i, vlen, tab, size) < 0){
 		if (netconf_data_not_unique_xml(xret, x, cvk) < 0)
 		    goto done;
 		goto fail;
@@ -885,6 +1250,8 @@ check_unique_list(cxobj     *x,
     /* It would be possible to cache vec here as an optimization */
     retval = 1;
  done:
+    if (tab)
+	free(tab);
     if (vec)
 	free(vec);
     return retval;
@@ -1241,6 +1608,90 @@ xml_yang_validate_list_key_only(clicon_handle h,
     goto done;
 }
 
+/*! Validate leafref, identityref, must and when of a single XML node
+ * @param[in]  h     Clicon handle
+ * @param[in]  xt    XML node to be validated
+ * @param[in]  ys    Yang spec of xt
+ * @param[out] xret  Error XML tree (if retval=0). Free with xml_free after use
+ * @retval     1     Validation OK
+ * @retval     0     Validation failed (xret set)
+ * @retval    -1     Error
+ * @see xml_yang_validate_all  which also validates children recursively
+ */
+static int
+xml_yang_validate_node(clicon_handle h,
+		       cxobj        *xt,
+		       yang_stmt    *ys,
+		       cxobj       **xret)
+{
+    int        retval = -1;
+    yang_stmt *yc;  /* yang child */
+    yang_stmt *ye;  /* yang must error-message */
+    int        nr;
+    int        ret;
+
+    /* Node-specific validation */
+    switch (yang_keyword_get(ys)){
+    case Y_LEAF:
+	/* fall thru */
+    case Y_LEAF_LIST:
+	/* Special case if leaf is leafref, then first check against
+	   current xml tree
+	*/
+	/* Get base type yc */
+	if (yang_type_get(ys, NULL, &yc, NULL, NULL, NULL, NULL, NULL) < 0)
+	    goto done;
+	if (strcmp(yang_argument_get(yc), "leafref") == 0){
+	    if ((ret = validate_leafref(xt, yc, xret)) < 0)
+		goto done;
+	    if (ret == 0)
+		goto fail;
+	}
+	else if (strcmp(yang_argument_get(yc), "identityref") == 0){
+	    if ((ret = validate_identityref(xt, ys, yc, xret)) < 0)
+		goto done;
+	    if (ret == 0)
+		goto fail;
+	}
+	break;
+    default:
+	break;
+    }
+    /* must sub-node RFC 7950 Sec 7.5.3. Can be several. 
+     * XXX. use yang path instead? */
+    yc = NULL;
+    while ((yc = yn_each(ys, yc)) != NULL) {
+	if (yc->ys_keyword != Y_MUST)
+	    continue;
+	if ((nr = yang_xpath_bool(xt, yc)) < 0) /* "must" has xpath argument */
+	    goto done;
+	if (!nr){
+	    ye = yang_find(yc, Y_ERROR_MESSAGE, NULL);
+	    if (netconf_operation_failed_xml(xret, "application",
+					     ye?ye->ys_argument:"must xpath validation failed") < 0)
+		goto done;
+	    goto fail;
+	}
+    }
+    /* "when" sub-node RFC 7950 Sec 7.21.5. Can only be one. */
+    if ((yc = yang_find(ys, Y_WHEN, NULL)) != NULL){
+	if ((nr = yang_xpath_bool(xt, yc)) < 0) /* "when" has xpath argument */
+	    goto done;
+	if (!nr){
+	    if (netconf_operation_failed_xml(xret, "application",
+					     "when xpath validation failed") < 0)
+		goto done;
+	    goto fail;
+	}
+    }
+    retval = 1;
+ done:
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
 /*! Validate a single XML node with yang specification for all (not only added) entries
  * 1. Check leafrefs. Eg you delete a leaf and a leafref references it.
  * @param[in]  xt  XML node to be validated
@@ -1259,6 +1710,7 @@ xml_yang_validate_list_key_only(clicon_handle h,
  * @endcode
  * @see xml_yang_validate_add
  * @see xml_yang_validate_rpc
+ * @see xml_yang_validate_changed  Incremental variant
  * @note Should need a variant accepting cxobj **xret
  */
 int
@@ -1268,10 +1720,6 @@ xml_yang_validate_all(clicon_handle h,
 {
     int        retval = -1;
     yang_stmt *ys;  /* yang node */
-    yang_stmt *yc;  /* yang child */
-    yang_stmt *ye;  /* yang must error-message */
-    char      *xpath;
-    int        nr;
     int        ret;
     cxobj     *x;
 
@@ -1284,66 +1732,13 @@ xml_yang_validate_all(clicon_handle h,
 	goto fail;
     }
     if (yang_config(ys) != 0){
-	/* Node-specific validation */
-	switch (yang_keyword_get(ys)){
-	case Y_ANYXML:
-	case Y_ANYDATA:
+	if (yang_keyword_get(ys) == Y_ANYXML ||
+	    yang_keyword_get(ys) == Y_ANYDATA)
 	    goto ok;
-	    break;
-	case Y_LEAF:
-	    /* fall thru */
-	case Y_LEAF_LIST:
-	    /* Special case if leaf is leafref, then first check against
-	       current xml tree
- 	    */
-	    /* Get base type yc */
-	    if (yang_type_get(ys, NULL, &yc, NULL, NULL, NULL, NULL, NULL) < 0)
-		goto done;
-	    if (strcmp(yang_argument_get(yc), "leafref") == 0){
-		if ((ret = validate_leafref(xt, yc, xret)) < 0)
-		    goto done;
-		if (ret == 0)
-		    goto fail;
-		}
-	    else if (strcmp(yang_argument_get(yc), "identityref") == 0){
-		if ((ret = validate_identityref(xt, ys, yc, xret)) < 0)
-		    goto done;
-		if (ret == 0)
-		    goto fail;
-	    }
-	    break;
-	default:
-	    break;
-	}
-	/* must sub-node RFC 7950 Sec 7.5.3. Can be several. 
-	* XXX. use yang path instead? */
-	yc = NULL;
-	while ((yc = yn_each(ys, yc)) != NULL) {
-	    if (yc->ys_keyword != Y_MUST)
-		continue;
-	    xpath = yc->ys_argument; /* "must" has xpath argument */
-	    if ((nr = xpath_vec_bool(xt, NULL, "%s", xpath)) < 0)
-		goto done;
-	    if (!nr){
-		ye = yang_find(yc, Y_ERROR_MESSAGE, NULL);
-		if (netconf_operation_failed_xml(xret, "application",
-					     ye?ye->ys_argument:"must xpath validation failed") < 0)
-		    goto done;
-		goto fail;
-	    }
-	}
-	/* "when" sub-node RFC 7950 Sec 7.21.5. Can only be one. */
-	if ((yc = yang_find(ys, Y_WHEN, NULL)) != NULL){
-	    xpath = yc->ys_argument; /* "when" has xpath argument */
-	    if ((nr = xpath_vec_bool(xt, NULL, "%s", xpath)) < 0)
-		goto done;
-	    if (!nr){
-		if (netconf_operation_failed_xml(xret, "application",
-					     "when xpath validation failed") < 0)
-		    goto done;
-		goto fail;
-	    }
-	}
+	if ((ret = xml_yang_validate_node(h, xt, ys, xret)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
     }
     x = NULL;
     while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
@@ -1369,54 +1764,903 @@ xml_yang_validate_all(clicon_handle h,
     goto done;
 }
 
-/*! Translate a single xml node to a cligen variable vector. Note not recursive 
- * @param[out] xret    Error XML tree (if ret == 0). Free with xml_free after use
+/*
+ * Parallel validation
+ * Validation of a tree does not modify it (other than caches), so independent
+ * parts of it may be validated by forked worker processes sharing the tree
+ * copy-on-write. The tree is partitioned into units in document order:
+ * a top-level node, or for a top-level node with many children, its node
+ * checks, chunks of its children, and its unique/min/max checks.
+ * Each worker validates every nw:th unit and reports its first failing unit
+ * over a pipe. The failure of the lowest unit is the same as a serial
+ * validation would report.
+ */
+
+/* Number of children of a top-level node above which it is split in chunks */
+#define VALIDATE_CHUNK_SIZE 1024
+
+/* Type of validation unit */
+enum validate_unit_type{
+    VU_ALL,   /* Top-level node and its subtree */
+    VU_HEAD,  /* Checks of top-level node itself */
+    VU_CHUNK, /* Subtrees of a range of children */
+    VU_TAIL   /* Unique and min/max checks of children */
+};
+
+/*! Part of tree validated by one worker, see xml_yang_validate_parallel */
+struct validate_unit{
+    enum validate_unit_type vu_type;
+    cxobj                  *vu_x;  /* Top-level node */
+    int                     vu_i0; /* VU_CHUNK: index of first child */
+    int                     vu_i1; /* VU_CHUNK: index after last child */
+};
+
+/*! Result of a worker, written to pipe and followed by vr_len bytes of text */
+struct validate_result{
+    int vr_unit;     /* First failing unit, or -1 if none */
+    int vr_ret;      /* 0: failed, text is xret; -1: error, text is reason */
+    int vr_errno;    /* clicon_errno if vr_ret is -1 */
+    int vr_suberrno; /* clicon_suberrno if vr_ret is -1 */
+    int vr_len;      /* Length of text */
+};
+
+/*! Add a validation unit
+ * @param[in,out] uvec  Vector of units
+ * @param[in,out] ulen  Length of uvec
+ * @param[in]     type  Type of unit
+ * @param[in]     x     Top-level node
+ * @param[in]     i0    Index of first child (VU_CHUNK)
+ * @param[in]     i1    Index after last child (VU_CHUNK)
+ * @retval        0     OK
+ * @retval       -1     Error
+ */
+static int
+validate_unit_add(struct validate_unit   **uvec,
+		  int                     *ulen,
+		  enum validate_unit_type  type,
+		  cxobj                   *x,
+		  int                      i0,
+		  int                      i1)
+{
+    struct validate_unit *vu;
+
+    if ((*uvec = realloc(*uvec, (*ulen+1)*sizeof(**uvec))) == NULL){
+	clicon_err(OE_UNIX, errno, "realloc");
+	return -1;
+    }
+    vu = &(*uvec)[(*ulen)++];
+    vu->vu_type = type;
+    vu->vu_x = x;
+    vu->vu_i0 = i0;
+    vu->vu_i1 = i1;
+    return 0;
+}
+
+/*! Validate a unit
+ * @param[in]  h     Clicon handle
+ * @param[in]  vu    Validation unit
+ * @param[out] xret  Error XML tree (if ret == 0). Free with xml_free after use
  * @retval     1     Validation OK
  * @retval     0     Validation failed (xret set)
  * @retval    -1     Error
  */
-int
-xml_yang_validate_all_top(clicon_handle h,
-			  cxobj        *xt, 
-			  cxobj       **xret)
+static int
+validate_unit(clicon_handle         h,
+	      struct validate_unit *vu,
+	      cxobj               **xret)
 {
+    cxobj *xc;
+    int    i;
     int    ret;
-    cxobj *x;
 
-    x = NULL;
-    while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
-	if ((ret = xml_yang_validate_all(h, x, xret)) < 1)
-	    return ret;
+    switch (vu->vu_type){
+    case VU_ALL:
+	return xml_yang_validate_all(h, vu->vu_x, xret);
+    case VU_HEAD:
+	return xml_yang_validate_node(h, vu->vu_x, xml_spec(vu->vu_x), xret);
+    case VU_CHUNK:
+	for (i=vu->vu_i0; i<vu->vu_i1; i++){
+	    xc = xml_child_i(vu->vu_x, i);
+	    if (xml_type(xc) != CX_ELMNT)
+		continue;
+	    if ((ret = xml_yang_validate_all(h, xc, xret)) < 1)
+		return ret;
+	}
+	break;
+    case VU_TAIL:
+	return check_list_unique_minmax(vu->vu_x, xret);
     }
-    if ((ret = check_list_unique_minmax(xt, xret)) < 1)
-	return ret;
     return 1;
 }
 
-/*! Translate a single xml node to a cligen variable vector. Note not recursive 
- * @param[in]  xt   XML tree containing one top node
- * @param[in]  ys   Yang spec containing type specification of top-node of xt
- * @param[out] cvv  CLIgen variable vector. Should be freed by cvec_free()
- * @retval     0    Everything OK, cvv allocated and set
- * @retval    -1    Something wrong, clicon_err() called to set error. No cvv returned
- * @note  cvv Should be freed by cvec_free() after use.
- * 'Not recursive' means that only one level of XML bodies is translated to cvec:s.
- * If range is wriong (eg 1000 for uint8) a warning is logged, the value is 
- * skipped, and continues.
- * yang is needed to know which type an xml element has.
- * Example: 
-    <a>
-      <b>23</b>
-      <c>88</c>
-      <d>      
-        <e>99</e>
-      </d>
-    </a> 
-         --> b:23, c:88
- * @see cvec2xml
+/*! Read or write all of a buffer on a pipe
+ * @param[in]  fd    Pipe file descriptor
+ * @param[in]  buf   Buffer
+ * @param[in]  n     Number of bytes
+ * @param[in]  wr    If set write, else read
+ * @retval     0     OK
+ * @retval    -1     Error or end of file before n bytes
  */
-int
-xml2cvec(cxobj      *xt, 
+static int
+validate_pipe_io(int    fd,
+		 void  *buf,
+		 size_t n,
+		 int    wr)
+{
+    char   *s = buf;
+    ssize_t len;
+
+    while (n > 0){
+	if (wr)
+	    len = write(fd, s, n);
+	else
+	    len = read(fd, s, n);
+	if (len < 0 && errno == EINTR)
+	    continue;
+	if (len <= 0)
+	    return -1;
+	s += len;
+	n -= len;
+    }
+    return 0;
+}
+
+/*! Validation worker process, validate units and write result on pipe
+ * @param[in]  h     Clicon handle
+ * @param[in]  uvec  Vector of units
+ * @param[in]  ulen  Length of uvec
+ * @param[in]  w     Worker number, validates units w, w+nw, ...
+ * @param[in]  nw    Number of workers
+ * @param[in]  fd    Write end of pipe
+ * @note Does not return
+ */
+static void
+validate_worker(clicon_handle         h,
+		struct validate_unit *uvec,
+		int                   ulen,
+		int                   w,
+		int                   nw,
+		int                   fd)
+{
+    struct validate_result vr = {-1, 1, 0, 0, 0};
+    cxobj                 *xret = NULL;
+    cbuf                  *cb = NULL;
+    char                  *str = NULL;
+    int                    u;
+    int                    ret;
+
+    for (u=w; u<ulen; u+=nw){
+	if ((ret = validate_unit(h, &uvec[u], &xret)) < 1){
+	    vr.vr_unit = u;
+	    vr.vr_ret = ret;
+	    break;
+	}
+    }
+    if (vr.vr_ret == 0){
+	if ((cb = cbuf_new()) == NULL ||
+	    clicon_xml2cbuf(cb, xret, 0, 0, -1) < 0)
+	    vr.vr_ret = -1;
+	else
+	    str = cbuf_get(cb);
+    }
+    if (vr.vr_ret < 0){
+	vr.vr_errno = clicon_errno;
+	vr.vr_suberrno = clicon_suberrno;
+	str = clicon_err_reason;
+    }
+    if (str)
+	vr.vr_len = strlen(str);
+    if (validate_pipe_io(fd, &vr, sizeof(vr), 1) == 0 && str)
+	validate_pipe_io(fd, str, vr.vr_len, 1);
+    _exit(0);
+}
+
+/*! Validate top-level nodes of an XML tree in worker processes
+ * @param[in]  h     Clicon handle
+ * @param[in]  xt    Top of XML tree
+ * @param[in]  nw    Max number of worker processes
+ * @param[out] xret  Error XML tree (if ret == 0). Free with xml_free after use
+ * @retval     1     Validation OK
+ * @retval     0     Validation failed (xret set)
+ * @retval    -1     Error
+ * The unique and min/max checks of xt itself are not made.
+ * If a worker exits without a result, its units are validated by the 
+ * calling process instead.
+ * @see xml_yang_validate_all_top
+ */
+static int
+xml_yang_validate_parallel(clicon_handle h,
+			   cxobj        *xt,
+			   int           nw,
+			   cxobj       **xret)
+{
+    int                    retval = -1;
+    struct validate_unit  *uvec = NULL;
+    int                    ulen = 0;
+    struct validate_result vr;
+    struct validate_result best = {-1, 1, 0, 0, 0};
+    char                  *str = NULL;
+    char                  *bstr = NULL;
+    pid_t                 *pids = NULL;
+    int                   *fds = NULL;
+    int                   *lost = NULL; /* Workers without result */
+    int                    pfd[2];
+    cxobj                 *x;
+    cxobj                 *xerr = NULL;
+    cxobj                 *xu = NULL;
+    cxobj                 *xc;
+    yang_stmt             *ys;
+    int                    n;
+    int                    i;
+    int                    w;
+    int                    u;
+    int                    ret;
+
+    x = NULL;
+    while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
+	n = xml_child_nr(x);
+	ys = xml_spec(x);
+	if (n <= VALIDATE_CHUNK_SIZE || ys == NULL || yang_config(ys) == 0 ||
+	    yang_keyword_get(ys) == Y_ANYXML || yang_keyword_get(ys) == Y_ANYDATA){
+	    if (validate_unit_add(&uvec, &ulen, VU_ALL, x, 0, 0) < 0)
+		goto done;
+	    continue;
+	}
+	if (validate_unit_add(&uvec, &ulen, VU_HEAD, x, 0, 0) < 0)
+	    goto done;
+	for (i=0; i<n; i+=VALIDATE_CHUNK_SIZE)
+	    if (validate_unit_add(&uvec, &ulen, VU_CHUNK, x, i,
+				  i+VALIDATE_CHUNK_SIZE<n?i+VALIDATE_CHUNK_SIZE:n) < 0)
+		goto done;
+	if (validate_unit_add(&uvec, &ulen, VU_TAIL, x, 0, 0) < 0)
+	    goto done;
+    }
+    if (nw > ulen)
+	nw = ulen;
+    clicon_debug(1, "%s %d units %d workers", __FUNCTION__, ulen, nw);
+    if ((pids = calloc(nw, sizeof(pid_t))) == NULL ||
+	(fds = calloc(nw, sizeof(int))) == NULL ||
+	(lost = calloc(nw, sizeof(int))) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	goto done;
+    }
+    for (w=0; w<nw; w++)
+	fds[w] = -1;
+    for (w=0; w<nw; w++){
+	if (pipe(pfd) < 0){
+	    clicon_err(OE_UNIX, errno, "pipe");
+	    goto done;
+	}
+	if ((pids[w] = fork()) < 0){
+	    clicon_err(OE_UNIX, errno, "fork");
+	    close(pfd[0]);
+	    close(pfd[1]);
+	    goto done;
+	}
+	if (pids[w] == 0){ /* child */
+	    close(pfd[0]);
+	    validate_worker(h, uvec, ulen, w, nw, pfd[1]);
+	}
+	close(pfd[1]);
+	fds[w] = pfd[0];
+    }
+    /* Collect results, keep the failure of the lowest unit */
+    for (w=0; w<nw; w++){
+	if (validate_pipe_io(fds[w], &vr, sizeof(vr), 0) < 0){
+	    lost[w]++;
+	    continue;
+	}
+	if (vr.vr_ret == 1)
+	    continue;
+	if ((str = malloc(vr.vr_len+1)) == NULL){
+	    clicon_err(OE_UNIX, errno, "malloc");
+	    goto done;
+	}
+	if (validate_pipe_io(fds[w], str, vr.vr_len, 0) < 0){
+	    free(str);
+	    str = NULL;
+	    lost[w]++;
+	    continue;
+	}
+	str[vr.vr_len] = '\0';
+	if (best.vr_ret == 1 || vr.vr_unit < best.vr_unit){
+	    best = vr;
+	    if (bstr)
+		free(bstr);
+	    bstr = str;
+	}
+	else
+	    free(str);
+	str = NULL;
+    }
+    /* Validate units of lost workers here, up to the best failure so far */
+    for (w=0; w<nw; w++){
+	if (!lost[w])
+	    continue;
+	clicon_log(LOG_WARNING, "%s: validation worker %d exited without result, validating its part in this process", __FUNCTION__, w);
+	for (u=w; u<ulen && (best.vr_ret == 1 || u < best.vr_unit); u+=nw){
+	    if ((ret = validate_unit(h, &uvec[u], &xu)) < 0)
+		goto done;
+	    if (ret == 0){
+		best.vr_unit = u;
+		best.vr_ret = 0;
+		if (bstr)
+		    free(bstr);
+		bstr = NULL;
+		if (xerr)
+		    xml_free(xerr);
+		xerr = xu;
+		xu = NULL;
+		break;
+	    }
+	}
+    }
+    if (best.vr_ret < 0){
+	clicon_err(best.vr_errno, best.vr_suberrno, "%s", bstr);
+	goto done;
+    }
+    if (best.vr_ret == 0){
+	if (bstr != NULL){ /* From worker, else xerr is set above */
+	    if (xml_parse_string(bstr, NULL, &xerr) < 0)
+		goto done;
+	    if (xml_rootchild(xerr, 0, &xerr) < 0)
+		goto done;
+	}
+	if (*xret == NULL){
+	    *xret = xerr;
+	    xerr = NULL;
+	}
+	else
+	    while ((xc = xml_child_i(xerr, 0)) != NULL)
+		if (xml_addsub(*xret, xc) < 0)
+		    goto done;
+	goto fail;
+    }
+    retval = 1;
+ done:
+    if (fds){
+	for (w=0; w<nw; w++)
+	    if (fds[w] != -1)
+		close(fds[w]);
+	free(fds);
+    }
+    if (pids){
+	for (w=0; w<nw; w++)
+	    if (pids[w] > 0)
+		waitpid(pids[w], NULL, 0);
+	free(pids);
+    }
+    if (lost)
+	free(lost);
+    if (xerr)
+	xml_free(xerr);
+    if (xu)
+	xml_free(xu);
+    if (str)
+	free(str);
+    if (bstr)
+	free(bstr);
+    if (uvec)
+	free(uvec);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Validate a complete XML tree, all top-level nodes and their subtrees
+ * @param[in]  h     Clicon handle
+ * @param[in]  xt    Top of XML tree
+ * @param[out] xret    Error XML tree (if ret == 0). Free with xml_free after use
+ * @retval     1     Validation OK
+ * @retval     0     Validation failed (xret set)
+ * @retval    -1     Error
+ * If CLICON_VALIDATE_WORKERS is larger than one, the top-level nodes are
+ * validated by that many worker processes, see xml_yang_validate_parallel
+ */
+int
+xml_yang_validate_all_top(clicon_handle h,
+			  cxobj        *xt, 
+			  cxobj       **xret)
+{
+    int    retval = -1;
+    int    ret;
+    int    nw;
+    cxobj *x;
+
+    leafref_index_begin();
+    if ((nw = clicon_option_int(h, "CLICON_VALIDATE_WORKERS")) > 1 &&
+	xml_child_nr_type(xt, CX_ELMNT) > 0){
+	if ((ret = xml_yang_validate_parallel(h, xt, nw, xret)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
+    }
+    else {
+	x = NULL;
+	while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
+	    if ((ret = xml_yang_validate_all(h, x, xret)) < 0)
+		goto done;
+	    if (ret == 0)
+		goto fail;
+	}
+    }
+    if ((ret = check_list_unique_minmax(xt, xret)) < 0)
+	goto done;
+    if (ret == 0)
+	goto fail;
+    retval = 1;
+ done:
+    leafref_index_end();
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Add a schema node to the vector of a name in the dependency index
+ * @param[in]  idx   Dependency index
+ * @param[in]  name  Data node name referred to by an expression of ys
+ * @param[in]  ys    Schema node with must, when or leafref
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+yang_depidx_add(clicon_hash_t *idx,
+		char          *name,
+		yang_stmt     *ys)
+{
+    int         retval = -1;
+    yang_stmt **vec;
+    yang_stmt **vec1 = NULL;
+    size_t      vlen = 0;
+    size_t      n = 0;
+
+    if ((vec = clicon_hash_value(idx, name, &vlen)) != NULL){
+	n = vlen/sizeof(yang_stmt *);
+	if (n && vec[n-1] == ys) /* Already added */
+	    goto ok;
+    }
+    if ((vec1 = malloc((n+1)*sizeof(yang_stmt *))) == NULL){
+	clicon_err(OE_YANG, errno, "malloc");
+	goto done;
+    }
+    if (n)
+	memcpy(vec1, vec, n*sizeof(yang_stmt *));
+    vec1[n] = ys;
+    if (clicon_hash_add(idx, name, vec1, (n+1)*sizeof(yang_stmt *)) == NULL)
+	goto done;
+ ok:
+    retval = 0;
+ done:
+    if (vec1)
+	free(vec1);
+    return retval;
+}
+
+/*! Add the node names of a parsed xpath to the dependency index
+ * Wildcards, eg *, and node type tests, eg node(), may match any name and
+ * are stored as "*".
+ */
+static int
+yang_depidx_xpath(clicon_hash_t *idx,
+		  xpath_tree    *xs,
+		  yang_stmt     *ys)
+{
+    if (xs == NULL)
+	return 0;
+    if (xs->xs_type == XP_NODE){
+	if (yang_depidx_add(idx, xs->xs_s1?xs->xs_s1:"*", ys) < 0)
+	    return -1;
+    }
+    else if (xs->xs_type == XP_NODE_FN){
+	if (yang_depidx_add(idx, "*", ys) < 0)
+	    return -1;
+    }
+    if (yang_depidx_xpath(idx, xs->xs_c0, ys) < 0)
+	return -1;
+    return yang_depidx_xpath(idx, xs->xs_c1, ys);
+}
+
+/*! Add the node names of the xpath of a must, when or path statement to the
+ * dependency index, use the compiled xpath if available
+ */
+static int
+yang_depidx_expr(clicon_hash_t *idx,
+		 yang_stmt     *yx,
+		 yang_stmt     *ys)
+{
+    int         retval = -1;
+    xpath_tree *xpt = NULL;
+
+    if (yx->ys_xpath)
+	return yang_depidx_xpath(idx, yx->ys_xpath, ys);
+    if (xpath_parse(yx->ys_argument, &xpt) < 0)
+	goto done;
+    if (yang_depidx_xpath(idx, xpt, ys) < 0)
+	goto done;
+    retval = 0;
+ done:
+    if (xpt)
+	xpath_tree_free(xpt);
+    return retval;
+}
+
+/*! Add the names of the must, when and leafref path expressions of the
+ * descendant schema nodes of ys to the dependency index
+ */
+static int
+yang_depidx_build(clicon_hash_t *idx,
+		  yang_stmt     *ys)
+{
+    int         i;
+    int         j;
+    yang_stmt  *yc;
+    yang_stmt  *ym;
+    yang_stmt  *yrestype;
+    yang_stmt  *ypath;
+
+    for (i=0; i<ys->ys_len; i++){
+	yc = ys->ys_stmt[i];
+	if (yc->ys_keyword == Y_GROUPING) /* Expanded in uses */
+	    continue;
+	if (yang_datanode(yc)){
+	    for (j=0; j<yc->ys_len; j++){
+		ym = yc->ys_stmt[j];
+		if (ym->ys_keyword == Y_MUST || ym->ys_keyword == Y_WHEN)
+		    if (yang_depidx_expr(idx, ym, yc) < 0)
+			return -1;
+	    }
+	    if (yc->ys_keyword == Y_LEAF || yc->ys_keyword == Y_LEAF_LIST){
+		if (yang_type_get(yc, NULL, &yrestype, NULL, NULL, NULL, NULL, NULL) < 0)
+		    return -1;
+		if (yrestype && strcmp(yang_argument_get(yrestype), "leafref") == 0 &&
+		    (ypath = yang_find(yrestype, Y_PATH, NULL)) != NULL)
+		    if (yang_depidx_expr(idx, ypath, yc) < 0)
+			return -1;
+	    }
+	}
+	if (yang_depidx_build(idx, yc) < 0)
+	    return -1;
+    }
+    return 0;
+}
+
+/*! Mark schema nodes whose must/when/leafref may be affected by a name
+ * Mark with YANG_FLAG_DEP and their ancestors with YANG_FLAG_DEPANC
+ * @param[in]     yspec Yang specification with dependency index
+ * @param[in]     name  Name of added, deleted or changed data node
+ * @param[in,out] yvec  Vector of marked schema nodes
+ * @param[in,out] ylen  Length of yvec
+ * @retval        0     OK
+ * @retval       -1     Error
+ */
+static int
+yang_depidx_mark(yang_stmt   *yspec,
+		 char        *name,
+		 yang_stmt ***yvec,
+		 size_t      *ylen)
+{
+    yang_stmt **vec;
+    size_t      vlen;
+    size_t      i;
+    yang_stmt  *ys;
+    yang_stmt  *yp;
+
+    if ((vec = clicon_hash_value(yspec->ys_depidx, name, &vlen)) == NULL)
+	return 0;
+    for (i=0; i<vlen/sizeof(yang_stmt *); i++){
+	ys = vec[i];
+	if (ys->ys_flags & YANG_FLAG_DEP)
+	    continue;
+	if ((*ylen % 32) == 0 &&
+	    (*yvec = realloc(*yvec, (*ylen+32)*sizeof(yang_stmt *))) == NULL){
+	    clicon_err(OE_YANG, errno, "realloc");
+	    return -1;
+	}
+	(*yvec)[(*ylen)++] = ys;
+	ys->ys_flags |= YANG_FLAG_DEP;
+	yp = ys;
+	while ((yp = yang_parent_get(yp)) != NULL &&
+	       (yp->ys_flags & YANG_FLAG_DEPANC) == 0)
+	    yp->ys_flags |= YANG_FLAG_DEPANC;
+    }
+    return 0;
+}
+
+/*! Mark schema nodes affected by the names of all nodes in an XML subtree
+ * @see yang_depidx_mark
+ */
+static int
+yang_depidx_mark_tree(yang_stmt   *yspec,
+		      cxobj       *xt,
+		      yang_stmt ***yvec,
+		      size_t      *ylen)
+{
+    cxobj *x;
+
+    if (yang_depidx_mark(yspec, xml_name(xt), yvec, ylen) < 0)
+	return -1;
+    x = NULL;
+    while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL)
+	if (yang_depidx_mark_tree(yspec, x, yvec, ylen) < 0)
+	    return -1;
+    return 0;
+}
+
+/*! Find the node in tree xt that corresponds to a node in another tree
+ * The trees have the same top-level, eg a datastore and its copy
+ * @param[in]  xt   Top of XML tree
+ * @param[in]  x    XML node in other tree
+ * @param[out] xp   Matching node in xt, or NULL
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+xml_match_tree(cxobj  *xt,
+	       cxobj  *x,
+	       cxobj **xp)
+{
+    cxobj *xpt = NULL;
+
+    *xp = NULL;
+    if (xml_parent(x) == NULL){
+	*xp = xt;
+	return 0;
+    }
+    if (xml_match_tree(xt, xml_parent(x), &xpt) < 0)
+	return -1;
+    if (xpt == NULL || xml_spec(x) == NULL)
+	return 0;
+    return match_base_child(xpt, x, xml_spec(x), xp);
+}
+
+/*! Mark an XML node and its ancestors with XML_FLAG_MARK
+ * Also mark the schema nodes affected by the names of the node and its
+ * ancestors, since the string value of an ancestor, eg in must "/a = 'x'",
+ * or the nodes matched by a wildcard below it, change with it.
+ * @param[in]     yspec Yang specification with dependency index
+ * @param[in]     x     XML node
+ * @param[in,out] xvec  Vector of marked nodes, to reset marks later
+ * @param[in,out] xlen  Length of xvec
+ * @param[in,out] xmax  Allocated length of xvec
+ * @param[in,out] yvec  Vector of marked schema nodes
+ * @param[in,out] ylen  Length of yvec
+ */
+static int
+xml_validate_mark(yang_stmt   *yspec,
+		  cxobj       *x,
+		  cxobj     ***xvec,
+		  size_t      *xlen,
+		  size_t      *xmax,
+		  yang_stmt ***yvec,
+		  size_t      *ylen)
+{
+    if (x == NULL || xml_flag(x, XML_FLAG_MARK))
+	return 0;
+    if (cxvec_append_max(x, xvec, xlen, xmax) < 0)
+	return -1;
+    do {
+	xml_flag_set(x, XML_FLAG_MARK);
+	if (yang_depidx_mark(yspec, xml_name(x), yvec, ylen) < 0)
+	    return -1;
+    } while ((x = xml_parent(x)) != NULL && !xml_flag(x, XML_FLAG_MARK));
+    return 0;
+}
+
+/*! Validate nodes of an XML tree affected by changes 
+ * Nodes marked with XML_FLAG_ADD are validated completely. Nodes marked with
+ * XML_FLAG_MARK are ancestors of changes and are validated, as well as 
+ * unique/min/max of their children. Otherwise only must/when/leafref of
+ * schema nodes marked with YANG_FLAG_DEP are validated.
+ * @see xml_yang_validate_all
+ */
+static int
+xml_yang_validate_dep(clicon_handle h,
+		      cxobj        *xt, 
+		      cxobj       **xret)
+{
+    int        retval = -1;
+    yang_stmt *ys;  /* yang node */
+    int        mark;
+    int        ret;
+    cxobj     *x;
+
+    if (xml_flag(xt, XML_FLAG_ADD))
+	return xml_yang_validate_all(h, xt, xret);
+    mark = xml_flag(xt, XML_FLAG_MARK);
+    if ((ys = xml_spec(xt)) == NULL){
+	if (!mark)
+	    goto ok;
+	if (netconf_unknown_element_xml(xret, "application", xml_name(xt), NULL) < 0)
+	    goto done;
+	goto fail;
+    }
+    if (!mark && (ys->ys_flags & (YANG_FLAG_DEP|YANG_FLAG_DEPANC)) == 0)
+	goto ok; /* Not changed and no affected constraints below */
+    if (yang_config(ys) != 0){
+	if (yang_keyword_get(ys) == Y_ANYXML ||
+	    yang_keyword_get(ys) == Y_ANYDATA)
+	    goto ok;
+	if (mark || (ys->ys_flags & YANG_FLAG_DEP)){
+	    if ((ret = xml_yang_validate_node(h, xt, ys, xret)) < 0)
+		goto done;
+	    if (ret == 0)
+		goto fail;
+	}
+    }
+    x = NULL;
+    while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
+	if ((ret = xml_yang_validate_dep(h, x, xret)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
+    }
+    if (mark && yang_config(ys) != 0){
+	if ((ret = check_list_unique_minmax(xt, xret)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
+    }
+ ok:
+    retval = 1;
+ done:
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Validate only the parts of an XML tree affected by changes
+ * Incremental variant of xml_yang_validate_all_top for a tree that differs
+ * from a valid tree, eg the target and source of a commit, by the added,
+ * deleted and changed nodes given. Validated are:
+ * - Added subtrees, completely
+ * - Changed nodes and ancestors of added, deleted and changed nodes,
+ *   including unique and min/max-elements of their children
+ * - All nodes with must, when or leafref expressions that refer to a name
+ *   of an added, deleted or changed node, or of one of their ancestors
+ *   (see dependency index below)
+ * The dependency index maps data node names to the schema nodes whose
+ * expressions refer to them. It is built on first use from the yang spec.
+ * @param[in]  h     Clicon handle
+ * @param[in]  yspec Yang specification
+ * @param[in]  xt    Top of XML tree to validate
+ * @param[in]  avec  Added nodes in xt, marked with XML_FLAG_ADD (with subtrees)
+ * @param[in]  alen  Length of avec
+ * @param[in]  dvec  Deleted nodes, in the source tree
+ * @param[in]  dlen  Length of dvec
+ * @param[in]  cvec  Changed nodes in xt
+ * @param[in]  clen  Length of cvec
+ * @param[out] xret  Error XML tree (if ret == 0). Free with xml_free after use
+ * @retval     1     Validation OK
+ * @retval     0     Validation failed (xret set)
+ * @retval    -1     Error
+ * @see xml_yang_validate_all_top
+ */
+int
+xml_yang_validate_changed(clicon_handle h,
+			  yang_stmt    *yspec,
+			  cxobj        *xt,
+			  cxobj       **avec,
+			  size_t        alen,
+			  cxobj       **dvec,
+			  size_t        dlen,
+			  cxobj       **cvec,
+			  size_t        clen,
+			  cxobj       **xret)
+{
+    int            retval = -1;
+    clicon_hash_t *idx = NULL;
+    yang_stmt    **yvec = NULL;
+    size_t         ylen = 0;
+    cxobj        **xvec = NULL;
+    size_t         xlen = 0;
+    size_t         xmax = 0;
+    cxobj         *x;
+    yang_stmt     *yp;
+    size_t         i;
+    int            ret;
+
+    leafref_index_begin();
+    if (yspec->ys_depidx == NULL){
+	if ((idx = clicon_hash_init()) == NULL)
+	    goto done;
+	if (yang_depidx_build(idx, yspec) < 0)
+	    goto done;
+	yspec->ys_depidx = idx;
+	idx = NULL;
+    }
+    /* Mark affected schema nodes and ancestors of changes */
+    if (yang_depidx_mark(yspec, "*", &yvec, &ylen) < 0)
+	goto done;
+    for (i=0; i<alen; i++){
+	if (yang_depidx_mark_tree(yspec, avec[i], &yvec, &ylen) < 0)
+	    goto done;
+	if (xml_validate_mark(yspec, xml_parent(avec[i]), &xvec, &xlen, &xmax,
+			      &yvec, &ylen) < 0)
+	    goto done;
+    }
+    for (i=0; i<dlen; i++){
+	if (yang_depidx_mark_tree(yspec, dvec[i], &yvec, &ylen) < 0)
+	    goto done;
+	if (xml_match_tree(xt, xml_parent(dvec[i]), &x) < 0)
+	    goto done;
+	if (xml_validate_mark(yspec, x, &xvec, &xlen, &xmax, &yvec, &ylen) < 0)
+	    goto done;
+    }
+    for (i=0; i<clen; i++){
+	if (yang_depidx_mark(yspec, xml_name(cvec[i]), &yvec, &ylen) < 0)
+	    goto done;
+	if (xml_validate_mark(yspec, cvec[i], &xvec, &xlen, &xmax,
+			      &yvec, &ylen) < 0)
+	    goto done;
+    }
+    x = NULL;
+    while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
+	if ((ret = xml_yang_validate_dep(h, x, xret)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
+    }
+    if ((ret = check_list_unique_minmax(xt, xret)) < 0)
+	goto done;
+    if (ret == 0)
+	goto fail;
+    retval = 1;
+ done:
+    leafref_index_end();
+    /* Reset marks, ancestors are reset until a reset node */
+    for (i=0; i<xlen; i++){
+	x = xvec[i];
+	while (x && xml_flag(x, XML_FLAG_MARK)){
+	    xml_flag_reset(x, XML_FLAG_MARK);
+	    x = xml_parent(x);
+	}
+    }
+    for (i=0; i<ylen; i++){
+	yvec[i]->ys_flags &= ~YANG_FLAG_DEP;
+	yp = yvec[i];
+	while ((yp = yang_parent_get(yp)) != NULL &&
+	       (yp->ys_flags & YANG_FLAG_DEPANC))
+	    yp->ys_flags &= ~YANG_FLAG_DEPANC;
+    }
+    if (xvec)
+	free(xvec);
+    if (yvec)
+	free(yvec);
+    if (idx)
+	clicon_hash_free(idx);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Translate a single xml node to a cligen variable vector. Note not recursive 
+ * @param[in]  xt   XML tree containing one top node
+ * @param[in]  ys   Yang spec containing type specification of top-node of xt
+ * @param[out] cvv  CLIgen variable vector. Should be freed by cvec_free()
+ * @retval     0    Everything OK, cvv allocated and set
+ * @retval    -1    Something wrong, clicon_err() called to set error. No cvv returned
+ * @note  cvv Should be freed by cvec_free() after use.
+ * 'Not recursive' means that only one level of XML bodies is translated to cvec:s.
+ * If range is wriong (eg 1000 for uint8) a warning is logged, the value is 
+ * skipped, and continues.
+ * yang is needed to know which type an xml element has.
+ * Example: 
+    <a>
+      <b>23</b>
+      <c>88</c>
+      <d>      
+        <e>99</e>
+      </d>
+    </a> 
+         --> b:23, c:88
+ * @see cvec2xml
+ */
+int
+xml2cvec(cxobj      *xt, 
 	 yang_stmt  *yt, 
 	 cvec      **cvv0)
 {
@@ -1559,15 +2803,203 @@ cvec2xml_1(cvec   *cvv,
     return retval;
 }
 
+static int xml_diff1(yang_stmt *ys, cxobj *x0, cxobj *x1,
+		     cxobj ***x0vec, size_t *x0veclen, size_t *x0vecmax,
+		     cxobj ***x1vec, size_t *x1veclen, size_t *x1vecmax,
+		     cxobj ***changed_x0, size_t *changed_x0max,
+		     cxobj ***changed_x1, size_t *changed_x1max,
+		     size_t *changedlen);
+static int xml_diff_edit1(cxobj *x0, cxobj *x1,
+			  cxobj ***x0vec, size_t *x0veclen, size_t *x0vecmax,
+			  cxobj ***x1vec, size_t *x1veclen, size_t *x1vecmax,
+			  cxobj ***changed_x0, size_t *changed_x0max,
+			  cxobj ***changed_x1, size_t *changed_x1max,
+			  size_t *changedlen);
+
+/*! Compare two matching nodes of two xml trees, ie xml_cmp returns 0
+ * Choice nodes, and leafs with different values, are changed. Other nodes
+ * are compared recursively.
+ * @param[in]  x0c        Node in first XML tree
+ * @param[in]  x1c        Matching node in second XML tree
+ * @param[in]  edit       Compare recursively with xml_diff_edit1
+ * For other parameters, see xml_diff1
+ * @retval     0          OK
+ * @retval     1          Leaf without value (empty type), not compared
+ * @retval    -1          Error
+ */
+static int
+xml_diff_equal(cxobj     *x0c, 
+	       cxobj     *x1c,
+	       cxobj   ***x0vec,
+	       size_t    *x0veclen,
+	       size_t    *x0vecmax,
+	       cxobj   ***x1vec,
+	       size_t    *x1veclen,
+	       size_t    *x1vecmax,
+	       cxobj   ***changed_x0,
+	       size_t    *changed_x0max,
+	       cxobj   ***changed_x1,
+	       size_t    *changed_x1max,
+	       size_t    *changedlen,
+	       int        edit)
+{
+    int        retval = -1;
+    yang_stmt *yc;
+    char      *b1;
+    char      *b2;
+
+    if ((yc = xml_spec(x0c)) == NULL){
+	clicon_err(OE_UNIX, errno, "Unknown element: %s", xml_name(x0c));
+	goto done;
+    }
+    if (yang_choice(yc)){
+	/* if x0c and x1c are choice/case, then they are changed */
+	if (cxvec_append_max(x0c, changed_x0, changedlen, changed_x0max) < 0) 
+	    goto done;
+	(*changedlen)--; /* append two vectors */
+	if (cxvec_append_max(x1c, changed_x1, changedlen, changed_x1max) < 0) 
+	    goto done;
+    }
+    else if (yc->ys_keyword == Y_LEAF){
+	/* if x0c and x1c are leafs w bodies, then they are changed */
+	if ((b1 = xml_body(x0c)) == NULL || /* empty type */
+	    (b2 = xml_body(x1c)) == NULL){
+	    retval = 1;
+	    goto done;
+	}
+	if (strcmp(b1, b2)){
+	    if (cxvec_append_max(x0c, changed_x0, changedlen, changed_x0max) < 0) 
+		goto done;
+	    (*changedlen)--; /* append two vectors */
+	    if (cxvec_append_max(x1c, changed_x1, changedlen, changed_x1max) < 0) 
+		goto done;
+	}
+    }
+    else if (edit){
+	if (xml_diff_edit1(x0c, x1c,   
+			   x0vec, x0veclen, x0vecmax,
+			   x1vec, x1veclen, x1vecmax,
+			   changed_x0, changed_x0max,
+			   changed_x1, changed_x1max, changedlen) < 0)
+	    goto done;
+    }
+    else if (xml_diff1(yc, x0c, x1c,   
+		       x0vec, x0veclen, x0vecmax,
+		       x1vec, x1veclen, x1vecmax,
+		       changed_x0, changed_x0max,
+		       changed_x1, changed_x1max, changedlen) < 0)
+	goto done;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! qsort "compar" for nodes of two xml trees, see xml_diff_edit1
+ */
+static int
+xml_diff_edit_cmp(const void *arg1,
+		  const void *arg2)
+{
+    return xml_cmp(*(cxobj **)arg1, *(cxobj **)arg2, 0);
+}
+
+/*! Recursive help function to compute differences between two edited xml trees
+ * Only the edited and removed children of x0 and x1 are visited, see
+ * xml_edit_mark, not all children. They are sorted in document order and
+ * each is looked up in both trees. A node that is in neither tree, or is in
+ * both but is neither edited nor a default value, is skipped.
+ * @param[in]  x0         First XML tree
+ * @param[in]  x1         Second XML tree
+ * For other parameters, see xml_diff1
+ * @see xml_diff1  for trees without edit marks
+ */
+static int
+xml_diff_edit1(cxobj     *x0, 
+	       cxobj     *x1,
+	       cxobj   ***x0vec,
+	       size_t    *x0veclen,
+	       size_t    *x0vecmax,
+	       cxobj   ***x1vec,
+	       size_t    *x1veclen,
+	       size_t    *x1vecmax,
+	       cxobj   ***changed_x0,
+	       size_t    *changed_x0max,
+	       cxobj   ***changed_x1,
+	       size_t    *changed_x1max,
+	       size_t    *changedlen)
+{
+    int     retval = -1;
+    cxobj **vec = NULL; /* Edited and removed children of x0 and x1 */
+    size_t  len = 0;
+    size_t  max = 0;
+    cxobj  *x;
+    cxobj  *x0c;
+    cxobj  *x1c;
+    size_t  i;
+    int     j;
+
+    for (j=0; j<xml_edit_nr(x0); j++)
+	if (cxvec_append_max(xml_edit_i(x0, j), &vec, &len, &max) < 0)
+	    goto done;
+    for (j=0; j<xml_edit_nr(x1); j++)
+	if (cxvec_append_max(xml_edit_i(x1, j), &vec, &len, &max) < 0)
+	    goto done;
+    for (j=0; j<xml_edit_removed_nr(x0); j++)
+	if (cxvec_append_max(xml_edit_removed_i(x0, j), &vec, &len, &max) < 0)
+	    goto done;
+    for (j=0; j<xml_edit_removed_nr(x1); j++)
+	if (cxvec_append_max(xml_edit_removed_i(x1, j), &vec, &len, &max) < 0)
+	    goto done;
+    if (len > 1)
+	qsort(vec, len, sizeof(cxobj *), xml_diff_edit_cmp);
+    for (i=0; i<len; i++){
+	x = vec[i];
+	/* Same node edited or removed several times */
+	if (i > 0 && xml_cmp(vec[i-1], x, 0) == 0)
+	    continue;
+	x0c = xml_find_equal(x0, x);
+	x1c = xml_find_equal(x1, x);
+	if (x0c == NULL && x1c == NULL)
+	    continue;
+	if (x1c == NULL){
+	    if (cxvec_append_max(x0c, x0vec, x0veclen, x0vecmax) < 0) 
+		goto done;
+	}
+	else if (x0c == NULL){
+	    if (cxvec_append_max(x1c, x1vec, x1veclen, x1vecmax) < 0) 
+		goto done;
+	}
+	else if (!xml_flag(x0c, XML_FLAG_EDIT|XML_FLAG_DEFAULT) &&
+		 !xml_flag(x1c, XML_FLAG_EDIT|XML_FLAG_DEFAULT))
+	    ; /* Neither edited since common base (nor default): equal */
+	else if (xml_diff_equal(x0c, x1c,
+				x0vec, x0veclen, x0vecmax,
+				x1vec, x1veclen, x1vecmax,
+				changed_x0, changed_x0max,
+				changed_x1, changed_x1max, changedlen,
+				1) < 0)
+	    goto done;
+    }
+    retval = 0;
+ done:
+    if (vec)
+	free(vec);
+    return retval;
+}
+
 /*! Recursive help function to compute differences between two xml trees
  * @param[in]  x0         First XML tree
  * @param[in]  x1         Second XML tree
  * @param[out] x0vec      Pointervector to XML nodes existing in only first tree
  * @param[out] x0veclen   Length of first vector
+ * @param[out] x0vecmax   Allocated length of first vector
  * @param[out] x1vec      Pointervector to XML nodes existing in only second tree
  * @param[out] x1veclen   Length of x1vec vector
+ * @param[out] x1vecmax   Allocated length of x1vec vector
  * @param[out] changed_x0 Pointervector to XML nodes changed orig value
+ * @param[out] changed_x0max Allocated length of changed_x0
  * @param[out] changed_x1 Pointervector to XML nodes changed wanted value
+ * @param[out] changed_x1max Allocated length of changed_x1
  * @param[out] changedlen Length of changed vector
  * Algorithm to compare two sorted lists A, B:
  *   A 0 1 2 3 5 6
@@ -1589,19 +3021,21 @@ xml_diff1(yang_stmt *ys,
 	  cxobj     *x1,
 	  cxobj   ***x0vec,
 	  size_t    *x0veclen,
+	  size_t    *x0vecmax,
 	  cxobj   ***x1vec,
 	  size_t    *x1veclen,
+	  size_t    *x1vecmax,
 	  cxobj   ***changed_x0,
+	  size_t    *changed_x0max,
 	  cxobj   ***changed_x1,
+	  size_t    *changed_x1max,
 	  size_t    *changedlen)
 {
     int        retval = -1;
     cxobj     *x0c = NULL; /* x0 child */
     cxobj     *x1c = NULL; /* x1 child */
-    yang_stmt *yc;
-    char      *b1;
-    char      *b2;
     int        eq;
+    int        ret;
 
     /* Traverse x0 and x1 in lock-step */
     x0c = x1c = NULL;    
@@ -1611,13 +3045,13 @@ xml_diff1(yang_stmt *ys,
 	if (x0c == NULL && x1c == NULL)
 	    goto ok;
 	else if (x0c == NULL){
-	    if (cxvec_append(x1c, x1vec, x1veclen) < 0) 
+	    if (cxvec_append_max(x1c, x1vec, x1veclen, x1vecmax) < 0) 
 		goto done;
 	    x1c = xml_child_each(x1, x1c, CX_ELMNT);
 	    continue;
 	}
 	else if (x1c == NULL){
-	    if (cxvec_append(x0c, x0vec, x0veclen) < 0) 
+	    if (cxvec_append_max(x0c, x0vec, x0veclen, x0vecmax) < 0) 
 		goto done;
 	    x0c = xml_child_each(x0, x0c, CX_ELMNT);
 	    continue;
@@ -1625,49 +3059,27 @@ xml_diff1(yang_stmt *ys,
 	/* Both x0c and x1c exists, check if they are equal. */
 	eq = xml_cmp(x0c, x1c, 0);
 	if (eq < 0){
-	    if (cxvec_append(x0c, x0vec, x0veclen) < 0) 
+	    if (cxvec_append_max(x0c, x0vec, x0veclen, x0vecmax) < 0) 
 		goto done;
 	    x0c = xml_child_each(x0, x0c, CX_ELMNT);
 	    continue;
 	}
 	else if (eq > 0){
-	    if (cxvec_append(x1c, x1vec, x1veclen) < 0) 
+	    if (cxvec_append_max(x1c, x1vec, x1veclen, x1vecmax) < 0) 
 		goto done;
 	    x1c = xml_child_each(x1, x1c, CX_ELMNT);
 	    continue;
 	}
 	else{ /* equal */
-	    if ((yc = xml_spec(x0c)) == NULL){
-		clicon_err(OE_UNIX, errno, "Unknown element: %s", xml_name(x0c));
-		goto done;
-	    }
-	    if (yang_choice(yc)){
-		/* if x0c and x1c are choice/case, then they are changed */
-		if (cxvec_append(x0c, changed_x0, changedlen) < 0) 
-		    goto done;
-		(*changedlen)--; /* append two vectors */
-		if (cxvec_append(x1c, changed_x1, changedlen) < 0) 
-		    goto done;
-	    }
-	    else if (yc->ys_keyword == Y_LEAF){
-		/* if x0c and x1c are leafs w bodies, then they are changed */
-		if ((b1 = xml_body(x0c)) == NULL) /* empty type */
-		    break;
-		if ((b2 = xml_body(x1c)) == NULL) /* empty type */
-		    break;
-		if (strcmp(b1, b2)){
-		    if (cxvec_append(x0c, changed_x0, changedlen) < 0) 
-			goto done;
-		    (*changedlen)--; /* append two vectors */
-		    if (cxvec_append(x1c, changed_x1, changedlen) < 0) 
-			goto done;
-		}
-	    }
-	    else if (xml_diff1(yc, x0c, x1c,   
-			       x0vec, x0veclen, 
-			       x1vec, x1veclen, 
-			       changed_x0, changed_x1, changedlen)< 0)
+	    if ((ret = xml_diff_equal(x0c, x1c,
+				      x0vec, x0veclen, x0vecmax,
+				      x1vec, x1veclen, x1vecmax,
+				      changed_x0, changed_x0max,
+				      changed_x1, changed_x1max, changedlen,
+				      0)) < 0)
 		goto done;
+	    if (ret == 1) /* empty type */
+		break;
 	}
 	x0c = xml_child_each(x0, x0c, CX_ELMNT);
 	x1c = xml_child_each(x1, x1c, CX_ELMNT);
@@ -1682,6 +3094,7 @@ xml_diff1(yang_stmt *ys,
  * @param[in]  yspec      Yang specification
  * @param[in]  x0         First XML tree
  * @param[in]  x1         Second XML tree
+ * @param[in]  edit       Only visit edited and removed nodes, see xml_diff_edit1
  * @param[out] first      Pointervector to XML nodes existing in only first tree
  * @param[out] firstlen   Length of first vector
  * @param[out] second     Pointervector to XML nodes existing in only second tree
@@ -1689,21 +3102,25 @@ xml_diff1(yang_stmt *ys,
  * @param[out] changed_x0 Pointervector to XML nodes changed orig value
  * @param[out] changed_x1 Pointervector to XML nodes changed wanted value
  * @param[out] changedlen Length of changed vector
- * All xml vectors should be freed after use.
  */
-int
-xml_diff(yang_stmt *yspec, 
-	 cxobj     *x0, 
-	 cxobj     *x1,
-	 cxobj   ***first,
-	 size_t    *firstlen,
-	 cxobj   ***second,
-	 size_t    *secondlen,
-	 cxobj   ***changed_x0,
-	 cxobj   ***changed_x1,
-	 size_t    *changedlen)
+static int
+xml_diff0(yang_stmt *yspec, 
+	  cxobj     *x0, 
+	  cxobj     *x1,
+	  int        edit,
+	  cxobj   ***first,
+	  size_t    *firstlen,
+	  cxobj   ***second,
+	  size_t    *secondlen,
+	  cxobj   ***changed_x0,
+	  cxobj   ***changed_x1,
+	  size_t    *changedlen)
 {
-    int retval = -1;
+    int    retval = -1;
+    size_t firstmax = 0;
+    size_t secondmax = 0;
+    size_t changed_x0max = 0;
+    size_t changed_x1max = 0;
 
     *firstlen = 0;
     *secondlen = 0;    
@@ -1716,14 +3133,23 @@ xml_diff(yang_stmt *yspec,
 	goto ok;
     }
     if (x0 == NULL){
-	if (cxvec_append(x0, second, secondlen) < 0) 
+	if (cxvec_append(x1, second, secondlen) < 0) 
 	    goto done;
 	goto ok;
     }
-    if (xml_diff1((yang_stmt*)yspec, x0, x1,
-		  first, firstlen, 
-		  second, secondlen, 
-		  changed_x0, changed_x1, changedlen) < 0)
+    if (edit){
+	if (xml_diff_edit1(x0, x1,
+			   first, firstlen, &firstmax,
+			   second, secondlen, &secondmax,
+			   changed_x0, &changed_x0max,
+			   changed_x1, &changed_x1max, changedlen) < 0)
+	    goto done;
+    }
+    else if (xml_diff1((yang_stmt*)yspec, x0, x1,
+		       first, firstlen, &firstmax,
+		       second, secondlen, &secondmax,
+		       changed_x0, &changed_x0max,
+		       changed_x1, &changed_x1max, changedlen) < 0)
 	goto done;
  ok:
     retval = 0;
@@ -1731,6 +3157,74 @@ xml_diff(yang_stmt *yspec,
     return retval;
 }
 
+/*! Compute differences between two xml trees
+ * @param[in]  yspec      Yang specification
+ * @param[in]  x0         First XML tree
+ * @param[in]  x1         Second XML tree
+ * @param[out] first      Pointervector to XML nodes existing in only first tree
+ * @param[out] firstlen   Length of first vector
+ * @param[out] second     Pointervector to XML nodes existing in only second tree
+ * @param[out] secondlen  Length of second vector
+ * @param[out] changed_x0 Pointervector to XML nodes changed orig value
+ * @param[out] changed_x1 Pointervector to XML nodes changed wanted value
+ * @param[out] changedlen Length of changed vector
+ * All xml vectors should be freed after use.
+ * @see xml_diff_edit  for trees with edit marks relative to a common base
+ */
+int
+xml_diff(yang_stmt *yspec, 
+	 cxobj     *x0, 
+	 cxobj     *x1,
+	 cxobj   ***first,
+	 size_t    *firstlen,
+	 cxobj   ***second,
+	 size_t    *secondlen,
+	 cxobj   ***changed_x0,
+	 cxobj   ***changed_x1,
+	 size_t    *changedlen)
+{
+    return xml_diff0(yspec, x0, x1, 0,
+		     first, firstlen, second, secondlen,
+		     changed_x0, changed_x1, changedlen);
+}
+
+/*! Compute differences between two xml trees edited from a common base
+ * Same as xml_diff but only nodes marked with XML_FLAG_EDIT and nodes
+ * recorded as removed, see xml_edit_mark and xml_edit_removed, are visited.
+ * Other subtrees are assumed to be equal. This makes the diff proportional
+ * to the size of the edits, not of the trees or of the number of siblings.
+ * Only valid if x0 and x1 were equal (apart from edit marks) when the marks
+ * were last reset, eg two datastores where xmldb_edit_base returns 1.
+ * @param[in]  yspec      Yang specification
+ * @param[in]  x0         First XML tree
+ * @param[in]  x1         Second XML tree
+ * @param[out] first      Pointervector to XML nodes existing in only first tree
+ * @param[out] firstlen   Length of first vector
+ * @param[out] second     Pointervector to XML nodes existing in only second tree
+ * @param[out] secondlen  Length of second vector
+ * @param[out] changed_x0 Pointervector to XML nodes changed orig value
+ * @param[out] changed_x1 Pointervector to XML nodes changed wanted value
+ * @param[out] changedlen Length of changed vector
+ * All xml vectors should be freed after use.
+ * @see xml_diff
+ */
+int
+xml_diff_edit(yang_stmt *yspec, 
+	      cxobj     *x0, 
+	      cxobj     *x1,
+	      cxobj   ***first,
+	      size_t    *firstlen,
+	      cxobj   ***second,
+	      size_t    *secondlen,
+	      cxobj   ***changed_x0,
+	      cxobj   ***changed_x1,
+	      size_t    *changedlen)
+{
+    return xml_diff0(yspec, x0, x1, 1,
+		     first, firstlen, second, secondlen,
+		     changed_x0, changed_x1, changedlen);
+}
+
 /*! Construct an xml key format from yang statement using wildcards for keys
  * Recursively construct it to the top.
  * Example: 
@@ -67,16 +67,15 @@
 #include "clixon_yang_type.h"
 #include "clixon_xml_sort.h"
 
-/*! Get xml body value as cligen variable
+/*! Parse xml body value as cligen variable according to its yang type
  * @param[in]  x   XML node (body and leaf/leaf-list)
- * @param[out] cvp Pointer to cligen variable containing value of x body
+ * @param[out] cvp New cligen variable (free with cv_free), or NULL if no yang
  * @retval     0   OK, cvp contains cv or NULL
  * @retval    -1   Error
- * @note only applicable if x is body and has yang-spec and is leaf or leaf-list
- * Move to clixon_xml.c?
+ * @see xml_cv_cache  which caches the cv in x
  */
 static int
-xml_cv_cache(cxobj   *x,
+xml_cv_parse(cxobj   *x,
 	     cg_var **cvp)
 {
     int          retval = -1;
@@ -92,8 +91,6 @@ xml_cv_cache(cxobj   *x,
 		 
     if ((body = xml_body(x)) == NULL)
 	body="";
-    if ((cv = xml_cv(x)) != NULL)
-	goto ok;
     if ((y = xml_spec(x)) == NULL)
 	goto ok;
     if (yang_type_get(y, NULL, &yrestype, &options, NULL, NULL, NULL, &fraction) < 0)
@@ -119,8 +116,6 @@ xml_cv_cache(cxobj   *x,
 	clicon_err(OE_YANG, EINVAL, "cv parse error: %s\n", reason);
 	goto done;
     }
-    if (xml_cv_set(x, cv) < 0)
-	goto done;
  ok:
     *cvp = cv;
     cv = NULL;
@@ -133,6 +128,190 @@ xml_cv_cache(cxobj   *x,
     return retval;
 }
 
+/*! Get xml body value as cligen variable
+ * @param[in]  x   XML node (body and leaf/leaf-list)
+ * @param[out] cvp Pointer to cligen variable containing value of x body
+ * @retval     0   OK, cvp contains cv or NULL
+ * @retval    -1   Error
+ * @note only applicable if x is body and has yang-spec and is leaf or leaf-list
+ * Move to clixon_xml.c?
+ */
+static int
+xml_cv_cache(cxobj   *x,
+	     cg_var **cvp)
+{
+    cg_var *cv;
+
+    if ((cv = xml_cv(x)) == NULL){
+	if (xml_cv_parse(x, &cv) < 0)
+	    return -1;
+	if (cv && xml_cv_set(x, cv) < 0)
+	    return -1;
+    }
+    *cvp = cv;
+    return 0;
+}
+
+/*! Get typed key tuple of a list entry, build and cache it if not present
+ * Integer and string keys are extracted once so that xml_cmp can compare
+ * them directly. Other types are compared as cligen variables.
+ * @param[in]  x     XML list entry
+ * @param[in]  y     Yang list statement of x
+ * @param[out] keysp Key tuple, owned by x (or NULL if list has no keys)
+ * @param[out] lenp  Number of keys
+ * @retval     0     OK
+ * @retval    -1     Error
+ * @see xml_keys_set
+ */
+static int
+xml_keys_cache(cxobj           *x,
+	       yang_stmt       *y,
+	       struct xml_key **keysp,
+	       int             *lenp)
+{
+    int             retval = -1;
+    struct xml_key *keys = NULL;
+    struct xml_key *xk;
+    int             len = 0;
+    cvec           *cvk;
+    cg_var         *cvi;
+    cg_var         *cv;
+    cxobj          *xkl;
+    char           *body;
+    
+    if ((keys = xml_keys(x, &len)) != NULL)
+	goto ok;
+    cvk = yang_cvec_get(y); /* Use Y_LIST cache, see ys_populate_list() */
+    if ((len = cvec_len(cvk)) == 0)
+	goto ok;
+    if ((keys = calloc(len, sizeof(*keys))) == NULL){
+	clicon_err(OE_XML, errno, "calloc");
+	goto done;
+    }
+    xk = keys;
+    cvi = NULL;
+    while ((cvi = cvec_each(cvk, cvi)) != NULL) {
+	/* operational data may have NULL keys */
+	if ((xkl = xml_find(x, cv_string_get(cvi))) == NULL ||
+	    (body = xml_body(xkl)) == NULL){
+	    xk->xk_type = XK_NONE;
+	    xk++;
+	    continue;
+	}
+	/* Parse key value, but only cache the cv in the key leaf if needed */
+	if ((cv = xml_cv(xkl)) == NULL &&
+	    xml_cv_parse(xkl, &cv) < 0)
+	    goto done;
+	switch (cv?cv_type_get(cv):CGV_STRING){
+	case CGV_INT8:
+	    xk->xk_type = XK_INT;
+	    xk->xk_u.xk_int = cv_int8_get(cv);
+	    break;
+	case CGV_INT16:
+	    xk->xk_type = XK_INT;
+	    xk->xk_u.xk_int = cv_int16_get(cv);
+	    break;
+	case CGV_INT32:
+	    xk->xk_type = XK_INT;
+	    xk->xk_u.xk_int = cv_int32_get(cv);
+	    break;
+	case CGV_INT64:
+	    xk->xk_type = XK_INT;
+	    xk->xk_u.xk_int = cv_int64_get(cv);
+	    break;
+	case CGV_UINT8:
+	    xk->xk_type = XK_UINT;
+	    xk->xk_u.xk_uint = cv_uint8_get(cv);
+	    break;
+	case CGV_UINT16:
+	    xk->xk_type = XK_UINT;
+	    xk->xk_u.xk_uint = cv_uint16_get(cv);
+	    break;
+	case CGV_UINT32:
+	    xk->xk_type = XK_UINT;
+	    xk->xk_u.xk_uint = cv_uint32_get(cv);
+	    break;
+	case CGV_UINT64:
+	    xk->xk_type = XK_UINT;
+	    xk->xk_u.xk_uint = cv_uint64_get(cv);
+	    break;
+	case CGV_STRING:
+	case CGV_REST:
+	    xk->xk_type = XK_STR;
+	    xk->xk_u.xk_s.xk_str = body;
+	    xk->xk_u.xk_s.xk_len = strlen(body);
+	    break;
+	default:
+	    xk->xk_type = XK_CV;
+	    xk->xk_u.xk_cv = cv;
+	    break;
+	}
+	if (cv != NULL && cv != xml_cv(xkl)){ /* Not cached */
+	    if (xk->xk_type == XK_CV){
+		if (xml_cv_set(xkl, cv) < 0){
+		    cv_free(cv);
+		    goto done;
+		}
+	    }
+	    else
+		cv_free(cv);
+	}
+	xk++;
+    }
+    if (xml_keys_set(x, keys, len) < 0){
+	keys = NULL;
+	goto done;
+    }
+ ok:
+    *keysp = keys;
+    *lenp = len;
+    keys = NULL;
+    retval = 0;
+ done:
+    if (keys)
+	free(keys);
+    return retval;
+}
+
+/*! Compare two typed list keys
+ * @param[in]  xk1   Key 1
+ * @param[in]  xk2   Key 2
+ * @retval     0     Equal, or any key is missing
+ * @retval    <0     xk1 is less than xk2
+ * @retval    >0     xk1 is greater than xk2
+ */
+static int
+xml_key_cmp(struct xml_key *xk1,
+	    struct xml_key *xk2)
+{
+    size_t len1;
+    size_t len2;
+    int    cmp;
+
+    if (xk1->xk_type == XK_NONE || xk2->xk_type == XK_NONE)
+	return 0; /* Missing keys are not compared */
+    if (xk1->xk_type != xk2->xk_type)
+	return xk1->xk_type - xk2->xk_type; /* shouldnt happen, same yang */
+    switch (xk1->xk_type){
+    case XK_INT:
+	return (xk1->xk_u.xk_int > xk2->xk_u.xk_int) - (xk1->xk_u.xk_int < xk2->xk_u.xk_int);
+    case XK_UINT:
+	return (xk1->xk_u.xk_uint > xk2->xk_u.xk_uint) - (xk1->xk_u.xk_uint < xk2->xk_u.xk_uint);
+    case XK_STR:
+	len1 = xk1->xk_u.xk_s.xk_len;
+	len2 = xk2->xk_u.xk_s.xk_len;
+	if ((cmp = memcmp(xk1->xk_u.xk_s.xk_str, xk2->xk_u.xk_s.xk_str,
+			  len1<len2?len1:len2)) != 0)
+	    return cmp;
+	return (len1 > len2) - (len1 < len2);
+    case XK_CV:
+	return cv_cmp(xk1->xk_u.xk_cv, xk2->xk_u.xk_cv);
+    default:
+	break;
+    }
+    return 0;
+}
+
 /*! Given a child name and an XML object, return yang stmt of child
  * If no xml parent, find root yang stmt matching name
  * @param[in]  x        Child
@@ -227,18 +406,18 @@ xml_cmp(cxobj *x1,
     yang_stmt  *y2;
     int         yi1 = 0;
     int         yi2 = 0;
-    cvec       *cvk = NULL; /* vector of index keys */
-    cg_var     *cvi;
     int         equal = 0;
     char       *b1;
     char       *b2;
-    char       *keyname;
     cg_var     *cv1; 
     cg_var     *cv2;
     int         nr1 = 0;
     int         nr2 = 0;
-    cxobj      *x1b;
-    cxobj      *x2b;
+    struct xml_key *keys1 = NULL; /* typed key tuples */
+    struct xml_key *keys2 = NULL;
+    int         len1 = 0;
+    int         len2 = 0;
+    int         i;
 
     if (x1==NULL || x2==NULL)
 	goto done; /* shouldnt happen */
@@ -293,30 +472,16 @@ xml_cmp(cxobj *x1,
 	    equal = cv_cmp(cv1, cv2);
 	}
 	break;
-    case Y_LIST: /* Match with key values 
-		  * Use Y_LIST cache (see struct yang_stmt)
+    case Y_LIST: /* Match with key values using typed key tuples
+		  * (built from Y_LIST cache, see xml_keys_cache)
 		  */
-	cvk = yang_cvec_get(y1); /* Use Y_LIST cache, see ys_populate_list() */
-	cvi = NULL;
-	while ((cvi = cvec_each(cvk, cvi)) != NULL) {
-	    keyname = cv_string_get(cvi); /* operational data may have NULL keys*/
-	    if ((x1b = xml_find(x1, keyname)) == NULL ||
-		xml_body(x1b) == NULL)
-		equal = -1;
-	    else if ((x2b = xml_find(x2, keyname)) == NULL ||
-		     xml_body(x2b) == NULL)
-		equal = 1;
-	    else{
-		if (xml_cv_cache(x1b, &cv1) < 0) /* error case */
-		    goto done;
-		//		assert(cv1); 		
-		if (xml_cv_cache(x2b, &cv2) < 0) /* error case */
-		    goto done;
-		//		assert(cv2);
-		if ((equal = cv_cmp(cv1, cv2)) != 0)
-		    goto done;
-	    }
-	}
+	if (xml_keys_cache(x1, y1, &keys1, &len1) < 0) /* error case */
+	    goto done;
+	if (xml_keys_cache(x2, y2, &keys2, &len2) < 0) /* error case */
+	    goto done;
+	for (i=0; i<len1 && i<len2; i++)
+	    if ((equal = xml_key_cmp(&keys1[i], &keys2[i])) != 0)
+		goto done;
 	equal = 0;
 	break;
     default:
@@ -351,12 +516,30 @@ xml_sort(cxobj *x,
 	 void  *arg)
 {
     yang_stmt *ys;
+    cxobj     *xc;
+    int        i;
 
     /* Abort sort if non-config (=state) data */
     if ((ys = xml_spec(x)) != 0 && yang_config(ys)==0)
 	return 1;
+    /* Children not changed since they were last sorted or verified sorted */
+    if (xml_flag(x, XML_FLAG_SORTED))
+	return 0;
     xml_enumerate_children(x);
-    qsort(xml_childvec_get(x), xml_child_nr(x), sizeof(cxobj *), xml_cmp_qsort);
+    if (xml_child_sort(x, xml_cmp_qsort) < 0)
+	return -1;
+    xml_flag_set(x, XML_FLAG_SORTED);
+    /* Children were reordered bypassing the xml API, a tree datastore 
+     * record of x lists them in order */
+    if (xml_dsindex(x)){
+	i = 0;
+	xc = NULL;
+	while ((xc = xml_child_each(x, xc, -1)) != NULL)
+	    if (xml_enumerate_get(xc) != i++){
+		xml_dsdirty_set(x);
+		break;
+	    }
+    }
     return 0;
 }
 
@@ -442,10 +625,79 @@ xml_search1(cxobj        *xp,
     return NULL;
 }
 
+#ifdef XML_LIST_INDEX_MIN
+/*! Check if a key tuple is complete and can be hashed in a key index
+ * @param[in]  keys  Key tuple
+ * @param[in]  len   Number of keys
+ * @retval     1     All keys present with integer or string values
+ * @retval     0     Some key missing, or compared as cligen variable
+ * @see xml_keys_hash
+ */
+static int
+xml_keys_indexable(struct xml_key *keys,
+		   int             len)
+{
+    int i;
+
+    for (i=0; i<len; i++)
+	if (keys[i].xk_type != XK_INT &&
+	    keys[i].xk_type != XK_UINT &&
+	    keys[i].xk_type != XK_STR)
+	    return 0;
+    return 1;
+}
+
+/*! Find list entry under xp matching x1 using key index of xp
+ * The index is built for list yc when xp has many children, and list entries
+ * found by other means are added to it.
+ * @param[in]  xp     Parent xml node. 
+ * @param[in]  x1     Find this list entry among xp:s children
+ * @param[in]  yc     Yang spec of x1 (list)
+ * @param[out] miss   Set to 1 if the key tuple of x1 is complete and not in 
+ *                    the index, ie an entry found by other search is not
+ *                    indexed and may be added
+ * @retval     x      Matching list entry
+ * @retval     NULL   Not found in index (or error), use other search
+ */
+static cxobj *
+xml_search_index(cxobj     *xp,
+		 cxobj     *x1,
+		 yang_stmt *yc,
+		 int       *miss)
+{
+    struct xml_key *keys = NULL;
+    struct xml_key *keysc;
+    int             len = 0;
+    int             lenc;
+    cxobj          *xc;
+
+    if (xml_keys_cache(x1, yc, &keys, &len) < 0 || len == 0)
+	return NULL;
+    if (xml_index_nr(xp) == 0){
+	if (xml_child_nr(xp) < XML_LIST_INDEX_MIN)
+	    return NULL;
+	/* Build index of all entries of this list */
+	xc = NULL;
+	while ((xc = xml_child_each(xp, xc, CX_ELMNT)) != NULL){
+	    if (xml_spec(xc) != yc)
+		continue;
+	    if (xml_keys_cache(xc, yc, &keysc, &lenc) < 0 ||
+		xml_index_add(xp, xc) < 0)
+		return NULL;
+	}
+    }
+    if ((xc = xml_index_find(xp, yc, keys, len)) == NULL)
+	*miss = xml_keys_indexable(keys, len);
+    return xc;
+}
+#endif /* XML_LIST_INDEX_MIN */
+
 /*! Find XML child under xp matching x1 using binary search
  * @param[in] xp     Parent xml node. 
  * @param[in] x1     Find this object among xp:s children
  * @param[in] yc     Yang spec of x1
+ * If a list key index is enabled, keyed list entries are first looked up
+ * in the index of xp.
  */
 static cxobj *
 xml_search(cxobj        *xp,
@@ -458,7 +710,15 @@ xml_search(cxobj        *xp,
     int        userorder=0;
     cxobj     *xret = NULL;
     int        yangi;
+#ifdef XML_LIST_INDEX_MIN
+    int        miss = 0;
+#endif
     
+#ifdef XML_LIST_INDEX_MIN
+    if (yang_keyword_get(yc) == Y_LIST &&
+	(xret = xml_search_index(xp, x1, yc, &miss)) != NULL)
+	return xret;
+#endif
     /* Assume if there are any attributes, they are first in the list, mask
        them by raising low to skip them */
     for (low=0; low<upper; low++)
@@ -471,6 +731,13 @@ xml_search(cxobj        *xp,
 	userorder = (yang_find(yc, Y_ORDERED_BY, "user") != NULL);
     yangi = yang_order(yc);
     xret = xml_search1(xp, x1, userorder, yangi, low, upper);
+#ifdef XML_LIST_INDEX_MIN
+    /* Not in index, eg not added with xml_insert: add it now. Only after a
+     * real index miss: with missing keys the binary search may also find an
+     * entry that is indexed */
+    if (xret && miss && xml_index_nr(xp))
+	xml_index_add(xp, xret);
+#endif
     return xret;
 }
 
@@ -683,6 +950,11 @@ xml_insert(cxobj           *xp,
     int        userorder= 0;
     int        yi; /* Global yang-stmt order */
     int        i;
+    int        sorted;
+#ifdef XML_LIST_INDEX_MIN
+    struct xml_key *keys;
+    int        len;
+#endif
 
     /* Ensure the intermediate state that xp is parent of x but has not yet been
      * added as a child
@@ -711,9 +983,20 @@ xml_insert(cxobj           *xp,
 			 userorder, ins, key_val, nsc_key,
 			 low, upper)) < 0)
 	goto done;
+    sorted = xml_flag(xp, XML_FLAG_SORTED);
     if (xml_child_insert_pos(xp, xi, i) < 0)
 	goto done;
     xml_parent_set(xi, xp);
+    if (sorted) /* Inserted in sorted position */
+	xml_flag_set(xp, XML_FLAG_SORTED);
+#ifdef XML_LIST_INDEX_MIN
+    if (yang_keyword_get(y) == Y_LIST && xml_index_nr(xp)){
+	if (xml_keys_cache(xi, y, &keys, &len) < 0)
+	    goto done;
+	if (xml_index_add(xp, xi) < 0)
+	    goto done;
+    }
+#endif
     /* clear namespace context cache of child */
     nscache_clear(xi);
 
@@ -756,6 +1039,25 @@ xml_sort_verify(cxobj *x0,
     return retval;
 }
 
+/*! Check if the children of an XML node are sorted, eg for match_base_child
+ * The children are verified once and marked with XML_FLAG_SORTED, which is
+ * reset when they change.
+ * @param[in]   x       XML node. Check its children
+ * @retval      1       Sorted
+ * @retval      0       Not sorted, or not sorted by yang (state data)
+ * @see xml_sort_verify
+ */
+int
+xml_sort_sorted(cxobj *x)
+{
+    if (xml_flag(x, XML_FLAG_SORTED))
+	return 1;
+    if (xml_sort_verify(x, NULL) != 0)
+	return 0;
+    xml_flag_set(x, XML_FLAG_SORTED);
+    return 1;
+}
+
 /*! Given child tree x1c, find matching child in base tree x0 and return as x0cp
  * @param[in]  x0      Base tree node
  * @param[in]  x1c     Modification tree child
@@ -830,6 +1132,25 @@ match_base_child(cxobj      *x0,
     return retval;
 }
 	   
+/*! Find the child of xp equal to x, eg the node corresponding to x in another tree
+ * Equal as in xml_cmp: same yang spec and, for lists and leaf-lists, same
+ * keys or value. Unlike match_base_child, a choice matches only the same case.
+ * @param[in]  xp     Parent xml node, with sorted children
+ * @param[in]  x      XML node with yang spec, not necessarily in a tree
+ * @retval     xc     Child of xp equal to x
+ * @retval     NULL   Not found
+ */
+cxobj *
+xml_find_equal(cxobj *xp,
+	       cxobj *x)
+{
+    yang_stmt *y;
+
+    if ((y = xml_spec(x)) == NULL)
+	return NULL;
+    return xml_search(xp, x, y);
+}
+
 /*! Experimental API for binary search
  */
 cxobj *
@@ -839,7 +1160,8 @@ xml_binsearch(cxobj *xp,
 	      char  *keyval)
 {
     cxobj     *xc = NULL;
-    cxobj     *xa = NULL;
+    cxobj     *xk;
+    cxobj     *xb;
     cxobj     *xret = NULL;
     yang_stmt *yp;
     yang_stmt *yc;
@@ -852,11 +1174,15 @@ xml_binsearch(cxobj *xp,
 	clicon_err(OE_YANG, ENOENT, "yang not found");
 	goto done;
     }
-    if ((xc = xml_new(name, xp, yc)) == NULL)
+    /* Temporary search object, not added to xp: <name><keyname>keyval</keyname></name> */
+    if ((xc = xml_new(name, NULL, yc)) == NULL)
+	goto done;
+    if ((xk = xml_new(keyname, xc, yang_find(yc, Y_LEAF, keyname))) == NULL)
 	goto done;
-    if ((xa = xml_new(keyname, xc, NULL)) == NULL)
+    if ((xb = xml_new("body", xk, NULL)) == NULL)
 	goto done;
-    if (xml_value_set(xa, keyval) < 0)
+    xml_type_set(xb, CX_BODY);
+    if (xml_value_set(xb, keyval) < 0)
 	goto done;
     xret = xml_search(xp, xc, yc);
  done:
@@ -379,6 +379,271 @@ xpath_parse(char        *xpath,
     return retval;
 }
 
+#ifdef XPATH_CACHE_SIZE
+/*
+ * Compiled xpath cache
+ * Parsed xpath trees are cached keyed by xpath string so that frequently 
+ * evaluated expressions (nacm rules, leafrefs, when/must, stream filters) are
+ * parsed only once. Entries are kept in an LRU list and evicted when the cache
+ * is full. An evicted entry that is still referenced by a caller is freed on
+ * its last xpath_compile_free.
+ */
+#define XPATH_CACHE_HASH 1024 /* Number of hash buckets, power of 2 */
+
+struct xpath_cache_entry{
+    qelem_t                   xce_q;      /* LRU list, most recent first */
+    struct xpath_cache_entry *xce_next;   /* Hash chain keyed by xpath string */
+    struct xpath_cache_entry *xce_tnext;  /* Hash chain keyed by tree pointer */
+    char                     *xce_xpath;  /* Xpath string (key) */
+    xpath_tree               *xce_tree;   /* Parsed xpath tree */
+    int                       xce_refs;   /* Number of compile references */
+    int                       xce_cached; /* Entry is in cache (not evicted) */
+};
+typedef struct xpath_cache_entry xpath_cache_entry;
+
+static xpath_cache_entry *_xpath_cache_str[XPATH_CACHE_HASH] = {NULL,};
+static xpath_cache_entry *_xpath_cache_tree[XPATH_CACHE_HASH] = {NULL,};
+static xpath_cache_entry *_xpath_cache_lru = NULL;
+static int                _xpath_cache_nr = 0;
+
+/*! Hash function of an xpath string */
+static uint32_t
+xpath_cache_strhash(char *xpath)
+{
+    return clicon_hash_fnv1a_str(CLICON_HASH_FNV1A_INIT, xpath) & (XPATH_CACHE_HASH-1);
+}
+
+/*! Hash function of an xpath tree pointer */
+static uint32_t
+xpath_cache_treehash(xpath_tree *xpt)
+{
+    uintptr_t p = (uintptr_t)xpt;
+
+    return (uint32_t)((p >> 4) ^ (p >> 14)) & (XPATH_CACHE_HASH-1);
+}
+
+/*! Free a cache entry and its xpath tree, entry must be unlinked from all lists
+ */
+static int
+xpath_cache_entry_free(xpath_cache_entry *xce)
+{
+    if (xce->xce_xpath)
+	free(xce->xce_xpath);
+    if (xce->xce_tree)
+	xpath_tree_free(xce->xce_tree);
+    free(xce);
+    return 0;
+}
+
+/*! Unlink an entry from the tree pointer hash chain */
+static int
+xpath_cache_tree_rm(xpath_cache_entry *xce)
+{
+    xpath_cache_entry **xp;
+
+    xp = &_xpath_cache_tree[xpath_cache_treehash(xce->xce_tree)];
+    while (*xp != NULL){
+	if (*xp == xce){
+	    *xp = xce->xce_tnext;
+	    break;
+	}
+	xp = &(*xp)->xce_tnext;
+    }
+    return 0;
+}
+
+/*! Evict an entry from the cache: unlink it from the LRU and string hash
+ * The entry is freed unless it is referenced, in which case it is freed by the
+ * last xpath_compile_free.
+ */
+static int
+xpath_cache_evict(xpath_cache_entry *xce)
+{
+    xpath_cache_entry **xp;
+
+    xp = &_xpath_cache_str[xpath_cache_strhash(xce->xce_xpath)];
+    while (*xp != NULL){
+	if (*xp == xce){
+	    *xp = xce->xce_next;
+	    break;
+	}
+	xp = &(*xp)->xce_next;
+    }
+    DELQ(xce, _xpath_cache_lru, xpath_cache_entry *);
+    xce->xce_cached = 0;
+    _xpath_cache_nr--;
+    if (xce->xce_refs == 0){
+	xpath_cache_tree_rm(xce);
+	xpath_cache_entry_free(xce);
+    }
+    return 0;
+}
+#endif /* XPATH_CACHE_SIZE */
+
+/*! Given xpath, return a compiled (parsed) xpath tree, using a cache
+ *
+ * Same as xpath_parse but the parsed tree is cached, keyed by the xpath string,
+ * and shared between callers. The tree must not be modified by the caller.
+ * @param[in]  xpath  String with XPATH 1.0 syntax
+ * @param[out] xptree Compiled xpath tree, release with xpath_compile_free
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @code
+ *   xpath_tree *xpt = NULL;
+ *   if (xpath_compile(xpath, &xpt) < 0)
+ *     err;
+ *   if (xpath_vec_compiled(x, nsc, xpt, &xc) < 0)
+ *     err;
+ *   xpath_compile_free(xpt);
+ * @endcode
+ * @see xpath_parse  Uncached variant where the caller owns the tree
+ * @note XPATH_CACHE_SIZE in clixon_custom.h sets the cache size
+ */
+int
+xpath_compile(char        *xpath,
+	      xpath_tree **xptree)
+{
+#ifdef XPATH_CACHE_SIZE
+    int                retval = -1;
+    xpath_cache_entry *xce;
+    xpath_tree        *xpt = NULL;
+    uint32_t           h;
+
+    h = xpath_cache_strhash(xpath);
+    for (xce = _xpath_cache_str[h]; xce != NULL; xce = xce->xce_next)
+	if (strcmp(xce->xce_xpath, xpath) == 0)
+	    break;
+    if (xce != NULL){ /* Hit: move first in LRU list */
+	if (xce != _xpath_cache_lru){
+	    DELQ(xce, _xpath_cache_lru, xpath_cache_entry *);
+	    INSQ(xce, _xpath_cache_lru);
+	}
+    }
+    else {
+	if (xpath_parse(xpath, &xpt) < 0)
+	    goto done;
+	if ((xce = malloc(sizeof(*xce))) == NULL){
+	    clicon_err(OE_XML, errno, "malloc");
+	    goto done;
+	}
+	memset(xce, 0, sizeof(*xce));
+	if ((xce->xce_xpath = strdup(xpath)) == NULL){
+	    clicon_err(OE_XML, errno, "strdup");
+	    free(xce);
+	    goto done;
+	}
+	xce->xce_tree = xpt;
+	xpt = NULL;
+	xce->xce_cached = 1;
+	/* Evict least recently used entry, ie last in LRU list */
+	if (_xpath_cache_nr >= XPATH_CACHE_SIZE && _xpath_cache_lru)
+	    xpath_cache_evict(PREVQ(xpath_cache_entry *, _xpath_cache_lru));
+	xce->xce_next = _xpath_cache_str[h];
+	_xpath_cache_str[h] = xce;
+	h = xpath_cache_treehash(xce->xce_tree);
+	xce->xce_tnext = _xpath_cache_tree[h];
+	_xpath_cache_tree[h] = xce;
+	INSQ(xce, _xpath_cache_lru);
+	_xpath_cache_nr++;
+    }
+    xce->xce_refs++;
+    *xptree = xce->xce_tree;
+    retval = 0;
+ done:
+    if (xpt)
+	xpath_tree_free(xpt);
+    return retval;
+#else
+    return xpath_parse(xpath, xptree);
+#endif /* XPATH_CACHE_SIZE */
+}
+
+/*! Release a compiled xpath tree
+ * A tree not found in the cache, eg parsed by xpath_parse, is freed as with
+ * xpath_tree_free, as is done when the cache is disabled.
+ * @param[in]  xptree Compiled xpath tree created by xpath_compile
+ * @retval     0      OK
+ * @see xpath_compile
+ */
+int
+xpath_compile_free(xpath_tree *xptree)
+{
+#ifdef XPATH_CACHE_SIZE
+    xpath_cache_entry *xce;
+
+    for (xce = _xpath_cache_tree[xpath_cache_treehash(xptree)];
+	 xce != NULL;
+	 xce = xce->xce_tnext)
+	if (xce->xce_tree == xptree)
+	    break;
+    if (xce == NULL){ /* Not compiled */
+	xpath_tree_free(xptree);
+	return 0;
+    }
+    if (--xce->xce_refs == 0 && !xce->xce_cached){
+	xpath_cache_tree_rm(xce);
+	xpath_cache_entry_free(xce);
+    }
+#else
+    xpath_tree_free(xptree);
+#endif /* XPATH_CACHE_SIZE */
+    return 0;
+}
+
+/*! Free all cached xpath trees
+ * Entries still referenced are freed by their last xpath_compile_free.
+ * Typically called at exit.
+ */
+int
+xpath_cache_flush(void)
+{
+#ifdef XPATH_CACHE_SIZE
+    while (_xpath_cache_lru != NULL)
+	xpath_cache_evict(_xpath_cache_lru);
+#endif
+    return 0;
+}
+
+/*! Given XML tree and compiled xpath, eval it and return xpath context
+ * @param[in]  xcur   XML-tree where to search
+ * @param[in]  nsc    External XML namespace context, or NULL
+ * @param[in]  xptree Compiled xpath tree, see xpath_compile
+ * @param[out] xrp    Return XPATH context
+ * @retval     0      OK
+ * @retval    -1      Error
+ * Intermediate contexts are allocated in an arena which is freed on return.
+ * @see xpath_vec_ctx  Same but with xpath string
+ */
+int
+xpath_vec_compiled(cxobj      *xcur, 
+		   cvec       *nsc,
+		   xpath_tree *xptree,
+		   xp_ctx    **xrp)
+{
+    int         retval = -1;
+    xp_ctx      xc = {0,};
+    xp_ctx     *xr = NULL;
+    xp_arena    xa = {0,};
+    
+    ctx_arena_push(&xa);
+    xc.xc_type = XT_NODESET;
+    xc.xc_node = xcur;
+    xc.xc_initial = xcur;
+    if (cxvec_append_max(xcur, &xc.xc_nodeset, &xc.xc_size, &xc.xc_max) < 0)
+	goto done;
+    if (xp_eval(&xc, xptree, nsc, &xr) < 0)
+	goto done;
+    /* Result must survive the arena */
+    if ((*xrp = ctx_detach(xr)) == NULL)
+	goto done;
+    retval = 0;
+ done:
+    ctx_arena_pop(&xa);
+    if (xc.xc_nodeset)
+	free(xc.xc_nodeset);
+    return retval;
+}
+
 /*! Given XML tree and xpath, parse xpath, eval it and return xpath context, 
  * This is a raw form of xpath where you can do type conversion of the return
  * value, etc, not just a nodeset.
@@ -395,6 +660,7 @@ xpath_parse(char        *xpath,
  *   if (xc)
  *	ctx_free(xc);
  * @endcode
+ * @see xpath_compile  The parsed xpath is cached
  */
 int
 xpath_vec_ctx(cxobj    *xcur, 
@@ -404,25 +670,15 @@ xpath_vec_ctx(cxobj    *xcur,
 {
     int         retval = -1;
     xpath_tree *xptree = NULL;
-    xp_ctx      xc = {0,};
     
-    if (xpath_parse(xpath, &xptree) < 0)
+    if (xpath_compile(xpath, &xptree) < 0)
 	goto done;
-    xc.xc_type = XT_NODESET;
-    xc.xc_node = xcur;
-    xc.xc_initial = xcur;
-    if (cxvec_append(xcur, &xc.xc_nodeset, &xc.xc_size) < 0)
-	goto done;
-    if (xp_eval(&xc, xptree, nsc, xrp) < 0)
+    if (xpath_vec_compiled(xcur, nsc, xptree, xrp) < 0)
 	goto done;
-    if (xc.xc_nodeset){
-	free(xc.xc_nodeset);
-	xc.xc_nodeset = NULL;
-    }
     retval = 0;
  done:
     if (xptree)
-	xpath_tree_free(xptree);
+	xpath_compile_free(xptree);
     return retval;
 }
 
@@ -720,6 +976,7 @@ xpath_vec_flag(cxobj    *xcur,
     xp_ctx    *xr = NULL;
     int        i;
     cxobj     *x;
+    size_t     vecmax = 0;
     
     va_start(ap, veclen);    
     len = vsnprintf(NULL, 0, xpformat, ap);
@@ -745,7 +1002,7 @@ xpath_vec_flag(cxobj    *xcur,
 	for (i=0; i<xr->xc_size; i++){
 	    x = xr->xc_nodeset[i];
 	    if (flags==0x0 || xml_flag(x, flags))
-		if (cxvec_append(x, vec, veclen) < 0)
+		if (cxvec_append_max(x, vec, veclen, &vecmax) < 0)
 		    goto done;		
 	}
     }
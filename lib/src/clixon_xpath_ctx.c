@@ -73,14 +73,203 @@ const map_str2int ctxmap[] = {
     {NULL,        -1}
 };
 
-/*! Free xpath context */
+/* Number of contexts in an arena block */
+#define XP_ARENA_BLOCK 64
+
+struct xp_arena_block{
+    struct xp_arena_block *xb_next;
+    xp_ctx                 xb_ctx[XP_ARENA_BLOCK];
+};
+
+/* Arena used by ctx_new, set by ctx_arena_push */
+static xp_arena *_ctx_arena = NULL;
+
+/* Arenas are enabled, see ctx_arena_set */
+static int _ctx_arena_enable = 1;
+
+/* Number of allocations of contexts and nodesets made by context functions */
+static uint64_t _ctx_nalloc = 0;
+
+/*! Enable or disable xpath context arenas
+ * @param[in]  enable  0: disable, 1: enable (default)
+ * @retval     0       OK
+ */
+int
+ctx_arena_set(int enable)
+{
+    _ctx_arena_enable = enable;
+    return 0;
+}
+
+/*! Return number of allocations of xpath contexts and nodesets
+ * Counts calls to malloc of contexts and arena blocks, and of nodesets in 
+ * ctx_dup. 
+ * @param[out] nalloc  Number of allocations
+ * @retval     0       OK
+ */
+int
+ctx_stats(uint64_t *nalloc)
+{
+    *nalloc = _ctx_nalloc;
+    return 0;
+}
+
+/*! Start a new arena for xpath contexts created with ctx_new
+ * All contexts allocated in the arena are freed by ctx_arena_pop, except
+ * contexts detached with ctx_detach.
+ * @param[in]  xa   Arena, typically on stack, initialized to zero
+ * @retval     0    OK
+ * @code
+ *   xp_arena xa = {0,};
+ *   ctx_arena_push(&xa);
+ *   if (xp_eval(&xc, xptree, nsc, &xr) < 0)
+ *     err;
+ *   xr = ctx_detach(xr);
+ *   ctx_arena_pop(&xa);
+ * @endcode
+ */
+int
+ctx_arena_push(xp_arena *xa)
+{
+    if (!_ctx_arena_enable)
+	return 0;
+    xa->xa_prev = _ctx_arena;
+    _ctx_arena = xa;
+    return 0;
+}
+
+/*! Free an arena with all its contexts, and restore the enclosing arena
+ * @param[in]  xa   Arena
+ * @retval     0    OK
+ * @see ctx_arena_push
+ */
+int
+ctx_arena_pop(xp_arena *xa)
+{
+    struct xp_arena_block *xb;
+    xp_ctx                *xc;
+    int                    n;
+    int                    i;
+
+    if (!_ctx_arena_enable || _ctx_arena != xa)
+	return 0;
+    n = xa->xa_used;
+    while ((xb = xa->xa_blocks) != NULL){
+	xa->xa_blocks = xb->xb_next;
+	for (i=0; i<n; i++){
+	    xc = &xb->xb_ctx[i];
+	    if (xc->xc_nodeset)
+		free(xc->xc_nodeset);
+	    if (xc->xc_string)
+		free(xc->xc_string);
+	}
+	free(xb);
+	n = XP_ARENA_BLOCK;
+    }
+    _ctx_arena = xa->xa_prev;
+    memset(xa, 0, sizeof(*xa));
+    return 0;
+}
+
+/*! Create a new empty xpath context
+ * If an arena is active, the context is allocated in the arena and may reuse
+ * the nodeset vector of a freed context.
+ * @retval  xc    New context, free with ctx_free
+ * @retval  NULL  Error
+ */
+xp_ctx *
+ctx_new(void)
+{
+    xp_arena              *xa = _ctx_arena;
+    struct xp_arena_block *xb;
+    xp_ctx                *xc = NULL;
+    cxobj                **vec = NULL;
+    size_t                 max = 0;
+
+    if (xa == NULL){
+	if ((xc = malloc(sizeof(*xc))) == NULL){
+	    clicon_err(OE_UNIX, errno, "malloc");
+	    goto done;
+	}
+	_ctx_nalloc++;
+	memset(xc, 0, sizeof(*xc));
+	goto done;
+    }
+    if ((xc = xa->xa_free) != NULL){
+	xa->xa_free = xc->xc_next;
+	vec = xc->xc_nodeset;
+	max = xc->xc_max;
+    }
+    else {
+	if (xa->xa_blocks == NULL || xa->xa_used == XP_ARENA_BLOCK){
+	    if ((xb = malloc(sizeof(*xb))) == NULL){
+		clicon_err(OE_UNIX, errno, "malloc");
+		goto done;
+	    }
+	    _ctx_nalloc++;
+	    xb->xb_next = xa->xa_blocks;
+	    xa->xa_blocks = xb;
+	    xa->xa_used = 0;
+	}
+	xc = &xa->xa_blocks->xb_ctx[xa->xa_used++];
+    }
+    memset(xc, 0, sizeof(*xc));
+    xc->xc_nodeset = vec;
+    xc->xc_max = max;
+    xc->xc_arena = xa;
+ done:
+    return xc;
+}
+
+/*! Move a context out of its arena, so that it is not freed with the arena
+ * @param[in]  xc   Context, may be allocated in arena or not
+ * @retval     xc1  Context not in an arena, free with ctx_free
+ * @retval     NULL Error, xc is unchanged
+ */
+xp_ctx *
+ctx_detach(xp_ctx *xc)
+{
+    xp_ctx *xc1;
+
+    if (xc->xc_arena == NULL)
+	return xc;
+    if ((xc1 = malloc(sizeof(*xc1))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	return NULL;
+    }
+    _ctx_nalloc++;
+    *xc1 = *xc;
+    xc1->xc_arena = NULL;
+    xc1->xc_next = NULL;
+    /* Nodeset and string are now owned by xc1 */
+    xc->xc_nodeset = NULL;
+    xc->xc_max = 0;
+    xc->xc_string = NULL;
+    ctx_free(xc);
+    return xc1;
+}
+
+/*! Free xpath context 
+ * A context in an arena is put in the free list of the arena, keeping its 
+ * nodeset vector for reuse.
+ */
 int
 ctx_free(xp_ctx *xc)
 {
+    xp_arena *xa;
+
+    if (xc->xc_string){
+	free(xc->xc_string);
+	xc->xc_string = NULL;
+    }
+    if ((xa = xc->xc_arena) != NULL){
+	xc->xc_size = 0;
+	xc->xc_next = xa->xa_free;
+	xa->xa_free = xc;
+	return 0;
+    }
     if (xc->xc_nodeset)
 	free(xc->xc_nodeset);
-    if (xc->xc_string)
-	free(xc->xc_string);
     free(xc);
     return 0;
 }
@@ -89,20 +278,34 @@ ctx_free(xp_ctx *xc)
 xp_ctx *
 ctx_dup(xp_ctx *xc0)
 {
-    static xp_ctx *xc = NULL;
+    xp_ctx  *xc = NULL;
+    cxobj  **vec;
+    size_t   max;
     
-    if ((xc = malloc(sizeof(*xc))) == NULL){
-	clicon_err(OE_UNIX, errno, "malloc");
+    if ((xc = ctx_new()) == NULL)
 	goto done;
-    }
-    memset(xc, 0, sizeof(*xc));
+    vec = xc->xc_nodeset;
+    max = xc->xc_max;
     *xc = *xc0;
+    xc->xc_arena = _ctx_arena;
+    xc->xc_next = NULL;
+    xc->xc_nodeset = vec;
+    xc->xc_max = max;
+    xc->xc_string = NULL;
     if (xc0->xc_size){
-	if ((xc->xc_nodeset = calloc(xc0->xc_size, sizeof(cxobj*))) == NULL){
-	    clicon_err(OE_UNIX, errno, "calloc");
-	    goto done;
+	if (xc->xc_max < xc0->xc_size){
+	    if ((vec = realloc(xc->xc_nodeset, xc0->xc_size*sizeof(cxobj*))) == NULL){
+		clicon_err(OE_UNIX, errno, "realloc");
+		xc->xc_size = 0;
+		ctx_free(xc);
+		xc = NULL;
+		goto done;
+	    }
+	    _ctx_nalloc++;
+	    xc->xc_nodeset = vec;
+	    xc->xc_max = xc0->xc_size;
 	}
-	memcpy(xc->xc_nodeset, xc0->xc_nodeset, xc->xc_size*sizeof(cxobj*));
+	memcpy(xc->xc_nodeset, xc0->xc_nodeset, xc0->xc_size*sizeof(cxobj*));
     }
     if (xc0->xc_string)
 	if ((xc->xc_string = strdup(xc0->xc_string)) == NULL){
@@ -279,6 +482,9 @@ ctx2number(xp_ctx *xc,
 }
 
 /*! Replace a nodeset of a XPATH context with a new nodeset 
+ * @param[in]  xc     XPATH context
+ * @param[in]  vec    New nodeset, consumed by xc
+ * @param[in]  veclen Length of new nodeset (allocated length is at least veclen)
  */
 int
 ctx_nodeset_replace(xp_ctx   *xc,
@@ -289,6 +495,7 @@ ctx_nodeset_replace(xp_ctx   *xc,
 	free(xc->xc_nodeset);
     xc->xc_nodeset = vec;
     xc->xc_size = veclen;
+    xc->xc_max = veclen;
     return 0;
 }
 
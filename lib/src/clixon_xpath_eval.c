@@ -84,6 +84,7 @@
 #include "clixon_xml_nsctx.h"
 #include "clixon_xpath_ctx.h"
 #include "clixon_xpath.h"
+#include "clixon_xpath_optimize.h"
 #include "clixon_xpath_eval.h"
 
 /* Mapping between XPATH operator string <--> int  */
@@ -126,9 +127,6 @@ nodetest_eval_node(cxobj      *x,
     /* Namespaces is s0, name is s1 */
     if (strcmp(xs->xs_s1, "*")==0)
 	return 1;
-    /* get namespace of xml tree */
-    if (xml2ns(x, prefix1, &nsxml) < 0)
-	goto done;
     prefix2 = xs->xs_s0;
     name2 = xs->xs_s1;
     /* Before going into namespaces, check name equality and filter out noteq  */
@@ -136,6 +134,9 @@ nodetest_eval_node(cxobj      *x,
 	retval = 0; /* no match */
 	goto done;
     }
+    /* get namespace of xml tree */
+    if (xml2ns(x, prefix1, &nsxml) < 0)
+	goto done;
     /* here names are equal 
      * Now look for namespaces
      * 1) prefix1 and prefix2 point to same namespace <<-- try this first
@@ -179,7 +180,7 @@ nodetest_eval_node(cxobj      *x,
  * - node() is true for any node of any type whatsoever.
  * - text() is true for any text node.
  */
-static int
+int
 nodetest_eval(cxobj      *x,
 	      xpath_tree *xs,
 	      cvec       *nsc)
@@ -200,14 +201,93 @@ nodetest_eval(cxobj      *x,
     return retval;
 }
 
+/* Number of nodes visited by descendant searches, see xpath_descendant_stats */
+static uint64_t _descendant_nvisit = 0;
+
+#ifdef XPATH_DESCENDANT_SCHEMA
+/* Descendant searches are pruned, see xpath_descendant_schema_set */
+static int _descendant_schema_enable = 1;
+#endif
+
+/*! Enable or disable pruning of descendant xpath searches using yang
+ * @param[in]  enable  0: disable, 1: enable (default)
+ * @retval     0       OK
+ * @see XPATH_DESCENDANT_SCHEMA
+ */
+int
+xpath_descendant_schema_set(int enable)
+{
+#ifdef XPATH_DESCENDANT_SCHEMA
+    _descendant_schema_enable = enable;
+#endif
+    return 0;
+}
+
+/*! Return number of XML nodes visited by descendant xpath searches, eg //name
+ * @param[out] nvisit  Number of nodes visited
+ * @retval     0       OK
+ */
+int
+xpath_descendant_stats(uint64_t *nvisit)
+{
+    *nvisit = _descendant_nvisit;
+    return 0;
+}
+
+#ifdef XPATH_DESCENDANT_SCHEMA
+/*! Check if a descendant search for a named node may skip the subtree of x
+ * Uses the yang spec of x: if no descendant schema node of x has the name of
+ * the nodetest, there is no need to search below x.
+ * This requires x to be strictly schema-bound: content not described by the 
+ * schema may have any name. Anydata/anyxml and state data (which need not be 
+ * bound) below x are handled by yang_descendant_name. Children of x without
+ * yang spec, eg unknown elements of a tree that is not validated, are checked
+ * here. Descendants further down are assumed to be bound if the children are,
+ * as in datastore trees where an unbound node is rejected on edit.
+ * @param[in]  x         XML node (its subtree is searched)
+ * @param[in]  nodetest  XPATH stack
+ * @param[in]  node_type XML node types searched
+ * @retval     1         Skip subtree of x
+ * @retval     0         Search subtree of x
+ */
+static int
+nodetest_prune(cxobj      *x,
+	       xpath_tree *nodetest,
+	       int         node_type)
+{
+    yang_stmt *ys;
+    cxobj     *xc;
+
+    if (!_descendant_schema_enable ||
+	node_type != CX_ELMNT ||
+	nodetest->xs_type != XP_NODE ||
+	nodetest->xs_s1 == NULL ||
+	strcmp(nodetest->xs_s1, "*") == 0)
+	return 0;
+    if ((ys = xml_spec(x)) == NULL)
+	return 0;
+    if (yang_keyword_get(ys) != Y_CONTAINER &&
+	yang_keyword_get(ys) != Y_LIST)
+	return 0;
+    if (yang_descendant_name(ys, nodetest->xs_s1) != 0)
+	return 0;
+    xc = NULL;
+    while ((xc = xml_child_each(x, xc, CX_ELMNT)) != NULL)
+	if (xml_spec(xc) == NULL)
+	    return 0;
+    return 1;
+}
+#endif /* XPATH_DESCENDANT_SCHEMA */
+
 /*!
  * @param[in]  xn
  * @param[in]  nodetest  XPATH stack
  * @param[in]  node_type
  * @param[in]  flags
  * @param[in]  nsc        XML Namespace context
- * @param[out] vec0
- * @param[out] vec0len
+ * @param[in,out] vec0
+ * @param[in,out] vec0len
+ * @param[in,out] vec0max  Allocated length of vec0
  */
 int
 nodetest_recursive(cxobj      *xn, 
@@ -216,29 +296,240 @@ nodetest_recursive(cxobj      *xn,
 		   uint16_t    flags,
 		   cvec       *nsc,
 		   cxobj    ***vec0,
-		   size_t     *vec0len)
+		   size_t     *vec0len,
+		   size_t     *vec0max)
 {
     int     retval = -1;
     cxobj  *xsub; 
     cxobj **vec = *vec0;
     size_t  veclen = *vec0len;
+    size_t  vecmax = *vec0max;
 
     xsub = NULL;
     while ((xsub = xml_child_each(xn, xsub, node_type)) != NULL) {
+	_descendant_nvisit++;
 	if (nodetest_eval(xsub, nodetest, nsc) == 1){
 	    clicon_debug(2, "%s %x %x", __FUNCTION__, flags, xml_flag(xsub, flags));
 	    if (flags==0x0 || xml_flag(xsub, flags))
-		if (cxvec_append(xsub, &vec, &veclen) < 0)
+		if (cxvec_append_max(xsub, &vec, &veclen, &vecmax) < 0)
 		    goto done;
 	    //	    continue; /* Dont go deeper */
 	}
-	if (nodetest_recursive(xsub, nodetest, node_type, flags, nsc, &vec, &veclen) < 0)
+#ifdef XPATH_DESCENDANT_SCHEMA
+	if (nodetest_prune(xsub, nodetest, node_type))
+	    continue;
+#endif
+	if (nodetest_recursive(xsub, nodetest, node_type, flags, nsc, &vec, &veclen, &vecmax) < 0)
 	    goto done;
     }
     retval = 0;
+  done:
     *vec0 = vec;
     *vec0len = veclen;
-  done:
+    *vec0max = vecmax;
+    return retval;
+}
+
+/* Set of xml nodes, used to avoid duplicates in nodesets of some axes */
+struct xp_uniq{
+    cxobj **xu_tab;   /* Open addressing hash table */
+    size_t  xu_size;  /* Size of table, power of 2 */
+    size_t  xu_nr;    /* Number of nodes in table */
+};
+
+/*! Add xml node to set
+ * @param[in]  xu  Set of xml nodes
+ * @param[in]  x   XML node
+ * @retval     1   Added
+ * @retval     0   Already in set
+ * @retval    -1   Error
+ */
+static int
+xp_uniq_add(struct xp_uniq *xu,
+	    cxobj          *x)
+{
+    cxobj  **tab;
+    size_t   size;
+    size_t   i;
+    size_t   j;
+
+    if (2*(xu->xu_nr+1) > xu->xu_size){ /* Grow and rehash */
+	size = xu->xu_size?2*xu->xu_size:64;
+	if ((tab = calloc(size, sizeof(cxobj *))) == NULL){
+	    clicon_err(OE_XML, errno, "calloc");
+	    return -1;
+	}
+	for (i=0; i<xu->xu_size; i++){
+	    if (xu->xu_tab[i] == NULL)
+		continue;
+	    j = ((uintptr_t)xu->xu_tab[i] >> 4) & (size-1);
+	    while (tab[j] != NULL)
+		j = (j+1) & (size-1);
+	    tab[j] = xu->xu_tab[i];
+	}
+	if (xu->xu_tab)
+	    free(xu->xu_tab);
+	xu->xu_tab = tab;
+	xu->xu_size = size;
+    }
+    i = ((uintptr_t)x >> 4) & (xu->xu_size-1);
+    while (xu->xu_tab[i] != NULL){
+	if (xu->xu_tab[i] == x)
+	    return 0;
+	i = (i+1) & (xu->xu_size-1);
+    }
+    xu->xu_tab[i] = x;
+    xu->xu_nr++;
+    return 1;
+}
+
+/*! Append x to nodeset if it matches nodetest (or if no nodetest) */
+static int
+xp_nodetest_append(cxobj       *x,
+		   xpath_tree  *nodetest,
+		   cvec        *nsc,
+		   cxobj     ***vec,
+		   size_t      *veclen,
+		   size_t      *vecmax)
+{
+    if (nodetest == NULL || nodetest_eval(x, nodetest, nsc) == 1)
+	if (cxvec_append_max(x, vec, veclen, vecmax) < 0)
+	    return -1;
+    return 0;
+}
+
+/*! Evaluate ancestor and ancestor-or-self axes
+ * Walking up from a node stops at an ancestor already visited from another
+ * node, since its ancestors are then also visited.
+ * @param[in]     xc       Context, nodeset is the input nodes
+ * @param[in]     nodetest XPATH nodetest
+ * @param[in]     nsc      XML Namespace context
+ * @param[in]     self     Include the nodes themselves (ancestor-or-self)
+ * @param[in,out] vec      Resulting nodeset
+ * @param[in,out] veclen   Length of vec
+ * @param[in,out] vecmax   Allocated length of vec
+ */
+static int
+xp_axis_ancestor(xp_ctx      *xc,
+		 xpath_tree  *nodetest,
+		 cvec        *nsc,
+		 int          self,
+		 cxobj     ***vec,
+		 size_t      *veclen,
+		 size_t      *vecmax)
+{
+    int            retval = -1;
+    struct xp_uniq xu = {0,};
+    cxobj         *x;
+    int            i;
+    int            ret;
+
+    for (i=0; i<xc->xc_size; i++){
+	x = xc->xc_nodeset[i];
+	if (!self)
+	    x = xml_parent(x);
+	for (; x != NULL; x = xml_parent(x)){
+	    if ((ret = xp_uniq_add(&xu, x)) < 0)
+		goto done;
+	    if (ret == 0)
+		break;
+	    if (xp_nodetest_append(x, nodetest, nsc, vec, veclen, vecmax) < 0)
+		goto done;
+	}
+    }
+    retval = 0;
+ done:
+    if (xu.xu_tab)
+	free(xu.xu_tab);
+    return retval;
+}
+
+/*! Evaluate sibling, following and preceding axes
+ * The position of a node among its siblings is given by xml_child_order, which
+ * is constant time if the node was reached by iterating over its parent.
+ * Iterating over siblings of a node stops at a sibling already visited, since
+ * the rest of the siblings are then also visited.
+ * With several input nodes, following/preceding may reach a node both as a
+ * sibling and as a descendant of a sibling, such duplicates are removed last.
+ * @param[in]     xc       Context, nodeset is the input nodes
+ * @param[in]     nodetest XPATH nodetest
+ * @param[in]     nsc      XML Namespace context
+ * @param[in]     following 1: following axes, 0: preceding axes
+ * @param[in]     docorder 1: following/preceding (also siblings of ancestors
+ *                         and descendants), 0: following/preceding-sibling
+ * @param[in,out] vec      Resulting nodeset
+ * @param[in,out] veclen   Length of vec
+ * @param[in,out] vecmax   Allocated length of vec
+ */
+static int
+xp_axis_sibling(xp_ctx      *xc,
+		xpath_tree  *nodetest,
+		cvec        *nsc,
+		int          following,
+		int          docorder,
+		cxobj     ***vec,
+		size_t      *veclen,
+		size_t      *vecmax)
+{
+    int            retval = -1;
+    struct xp_uniq xu = {0,};
+    cxobj         *x;
+    cxobj         *xp;
+    cxobj         *xs;
+    int            i;
+    int            j;
+    int            ret;
+
+    for (i=0; i<xc->xc_size; i++){
+	x = xc->xc_nodeset[i];
+	for (; (xp = xml_parent(x)) != NULL; x = xp){
+	    if ((j = xml_child_order(xp, x)) < 0)
+		break;
+	    xs = NULL;
+	    while (1){
+		if (following)
+		    xs = xml_child_each(xp, xs?xs:x, CX_ELMNT);
+		else{
+		    xs = NULL;
+		    while (--j >= 0)
+			if ((xs = xml_child_i(xp, j)) != NULL &&
+			    xml_type(xs) == CX_ELMNT)
+			    break;
+		    if (j < 0)
+			xs = NULL;
+		}
+		if (xs == NULL)
+		    break;
+		if ((ret = xp_uniq_add(&xu, xs)) < 0)
+		    goto done;
+		if (ret == 0)
+		    break;
+		if (xp_nodetest_append(xs, nodetest, nsc, vec, veclen, vecmax) < 0)
+		    goto done;
+		if (docorder &&
+		    nodetest_recursive(xs, nodetest, CX_ELMNT, 0x0, nsc, vec, veclen, vecmax) < 0)
+		    goto done;
+	    }
+	    if (!docorder)
+		break;
+	}
+    }
+    if (docorder && xc->xc_size > 1){
+	free(xu.xu_tab);
+	memset(&xu, 0, sizeof(xu));
+	j = 0;
+	for (i=0; i<*veclen; i++){
+	    if ((ret = xp_uniq_add(&xu, (*vec)[i])) < 0)
+		goto done;
+	    if (ret == 1)
+		(*vec)[j++] = (*vec)[i];
+	}
+	*veclen = j;
+    }
+    retval = 0;
+ done:
+    if (xu.xu_tab)
+	free(xu.xu_tab);
     return retval;
 }
 
@@ -268,16 +559,21 @@ xp_eval_step(xp_ctx     *xc0,
     cxobj      *xp;
     cxobj     **vec = NULL;
     size_t      veclen = 0;
+    size_t      vecmax = 0;
     xpath_tree *nodetest = xs->xs_c0;
     xp_ctx     *xc = NULL;
+    int         ret;
     
     /* Create new xc */
     if ((xc = ctx_dup(xc0)) == NULL)
 	goto done;
     switch (xs->xs_int){
     case A_ANCESTOR:
-	break;
     case A_ANCESTOR_OR_SELF:
+	if (xp_axis_ancestor(xc, nodetest, nsc, xs->xs_int == A_ANCESTOR_OR_SELF,
+			     &vec, &veclen, &vecmax) < 0)
+	    goto done;
+	ctx_nodeset_replace(xc, vec, veclen);
 	break;
     case A_ATTRIBUTE: /* principal node type is attribute */
 	break;
@@ -285,7 +581,7 @@ xp_eval_step(xp_ctx     *xc0,
 	if (xc->xc_descendant){
 	    for (i=0; i<xc->xc_size; i++){
 		xv = xc->xc_nodeset[i];
-		if (nodetest_recursive(xv, nodetest, CX_ELMNT, 0x0, nsc, &vec, &veclen) < 0)
+		if (nodetest_recursive(xv, nodetest, CX_ELMNT, 0x0, nsc, &vec, &veclen, &vecmax) < 0)
 		    goto done;
 	    }
 	    xc->xc_descendant = 0;
@@ -294,16 +590,25 @@ xp_eval_step(xp_ctx     *xc0,
 	    if (nodetest->xs_type==XP_NODE_FN &&
 		nodetest->xs_s0 &&
 		strcmp(nodetest->xs_s0,"current")==0){
-		if (cxvec_append(xc->xc_initial, &vec, &veclen) < 0)
+		if (cxvec_append_max(xc->xc_initial, &vec, &veclen, &vecmax) < 0)
 		    goto done;
 	    }
 	    else for (i=0; i<xc->xc_size; i++){
 		xv = xc->xc_nodeset[i];
+		/* List entry with key predicates: binary search instead */
+		if ((ret = xpath_list_optimize(xs, xv, nsc, &x)) < 0)
+		    goto done;
+		if (ret == 1){
+		    if (x && nodetest_eval(x, nodetest, nsc) == 1)
+			if (cxvec_append_max(x, &vec, &veclen, &vecmax) < 0)
+			    goto done;
+		    continue;
+		}
 		x = NULL;
 		while ((x = xml_child_each(xv, x, CX_ELMNT)) != NULL) {
 		    /* xs->xs_c0 is nodetest */
 		    if (nodetest == NULL || nodetest_eval(x, nodetest, nsc) == 1){
-			if (cxvec_append(x, &vec, &veclen) < 0)
+			if (cxvec_append_max(x, &vec, &veclen, &vecmax) < 0)
 			    goto done;
 		    }
 		}
@@ -315,14 +620,24 @@ xp_eval_step(xp_ctx     *xc0,
     case A_DESCENDANT_OR_SELF:
 	for (i=0; i<xc->xc_size; i++){
 	    xv = xc->xc_nodeset[i];
-	    if (nodetest_recursive(xv, xs->xs_c0, CX_ELMNT, 0x0, nsc, &vec, &veclen) < 0)
+	    if (xs->xs_int == A_DESCENDANT_OR_SELF &&
+		xp_nodetest_append(xv, nodetest, nsc, &vec, &veclen, &vecmax) < 0)
+		goto done;
+	    if (nodetest_recursive(xv, xs->xs_c0, CX_ELMNT, 0x0, nsc, &vec, &veclen, &vecmax) < 0)
 		goto done;
 	}
 	ctx_nodeset_replace(xc, vec, veclen);
 	break;
     case A_FOLLOWING:
-	break;
     case A_FOLLOWING_SIBLING:
+    case A_PRECEDING:
+    case A_PRECEDING_SIBLING:
+	if (xp_axis_sibling(xc, nodetest, nsc,
+			    xs->xs_int == A_FOLLOWING || xs->xs_int == A_FOLLOWING_SIBLING,
+			    xs->xs_int == A_FOLLOWING || xs->xs_int == A_PRECEDING,
+			    &vec, &veclen, &vecmax) < 0)
+	    goto done;
+	ctx_nodeset_replace(xc, vec, veclen);
 	break;
     case A_NAMESPACE: /* principal node type is namespace */
 	break;
@@ -331,10 +646,11 @@ xp_eval_step(xp_ctx     *xc0,
 	vec = xc->xc_nodeset;
 	xc->xc_size = 0;
 	xc->xc_nodeset = NULL;
+	xc->xc_max = 0;
 	for (i=0; i<veclen; i++){
 	    x = vec[i];
 	    if ((xp = xml_parent(x)) != NULL)
-		if (cxvec_append(xp, &xc->xc_nodeset, &xc->xc_size) < 0)
+		if (xp_nodetest_append(xp, nodetest, nsc, &xc->xc_nodeset, &xc->xc_size, &xc->xc_max) < 0)
 		    goto done;
 	}
 	if (vec){
@@ -342,11 +658,14 @@ xp_eval_step(xp_ctx     *xc0,
 	    vec = NULL;
 	}
 	break;
-    case A_PRECEDING:
-	break;
-    case A_PRECEDING_SIBLING:
-	break;
     case A_SELF:
+	/* '.' has no nodetest and keeps the nodeset */
+	if (nodetest != NULL){
+	    for (i=0; i<xc->xc_size; i++)
+		if (xp_nodetest_append(xc->xc_nodeset[i], nodetest, nsc, &vec, &veclen, &vecmax) < 0)
+		    goto done;
+	    ctx_nodeset_replace(xc, vec, veclen);
+	}
 	break;
     default:
 	clicon_err(OE_XML, 0, "No such axisname: %d", xs->xs_int);
@@ -417,28 +736,22 @@ xp_eval_predicate(xp_ctx     *xc,
     if (xs->xs_c1){
 	/* Loop over each node in the nodeset */
 	assert (xr0->xc_type == XT_NODESET);
-	if ((xr1 = malloc(sizeof(*xr1))) == NULL){
-	    clicon_err(OE_UNIX, errno, "malloc");
+	if ((xr1 = ctx_new()) == NULL)
 	    goto done;
-	}
-	memset(xr1, 0, sizeof(*xr1));
 	xr1->xc_type = XT_NODESET;
 	xr1->xc_node = xc->xc_node;
 	xr1->xc_initial = xc->xc_initial;
 	for (i=0; i<xr0->xc_size; i++){
 	    x = xr0->xc_nodeset[i];
 	    /* Create new context */
-	    if ((xcc = malloc(sizeof(*xcc))) == NULL){
-		clicon_err(OE_XML, errno, "malloc");
+	    if ((xcc = ctx_new()) == NULL)
 		goto done;
-	    }
-	    memset(xcc, 0, sizeof(*xcc));
 	    xcc->xc_type = XT_NODESET;
 	    xcc->xc_initial = xc->xc_initial;
 	    xcc->xc_node = x;
 	    /* For each node in the node-set to be filtered, the PredicateExpr is
 	     * evaluated with that node as the context node */
-	    if (cxvec_append(x, &xcc->xc_nodeset, &xcc->xc_size) < 0)
+	    if (cxvec_append_max(x, &xcc->xc_nodeset, &xcc->xc_size, &xcc->xc_max) < 0)
 		goto done;
 	    if (xp_eval(xcc, xs->xs_c1, nsc, &xrc) < 0)
 		goto done;
@@ -448,14 +761,14 @@ xp_eval_predicate(xp_ctx     *xc,
 		/* If the result is a number, the result will be converted to true
 		   if the number is equal to the context position */
 		if ((int)xrc->xc_number == i)
-		    if (cxvec_append(x, &xr1->xc_nodeset, &xr1->xc_size) < 0)
+		    if (cxvec_append_max(x, &xr1->xc_nodeset, &xr1->xc_size, &xr1->xc_max) < 0)
 			goto done;		    
 	    }
 	    else {
 		/* if PredicateExpr evaluates to true for that node, the node is 
 		   included in the new node-set */
 		if (ctx2boolean(xrc))
-		    if (cxvec_append(x, &xr1->xc_nodeset, &xr1->xc_size) < 0)
+		    if (cxvec_append_max(x, &xr1->xc_nodeset, &xr1->xc_size, &xr1->xc_max) < 0)
 			goto done;		    
 	    }
 	    if (xrc)
@@ -502,11 +815,8 @@ xp_logop(xp_ctx    *xc1,
     int     b1;
     int     b2;
     
-    if ((xr = malloc(sizeof(*xr))) == NULL){
-	clicon_err(OE_UNIX, errno, "malloc");
+    if ((xr = ctx_new()) == NULL)
 	goto done;
-    }
-    memset(xr, 0, sizeof(*xr));
     xr->xc_initial = xc1->xc_initial;
     xr->xc_type = XT_BOOL;
     if ((b1 = ctx2boolean(xc1)) < 0)
@@ -552,11 +862,8 @@ xp_numop(xp_ctx    *xc1,
     double  n1;
     double  n2;
     
-    if ((xr = malloc(sizeof(*xr))) == NULL){
-	clicon_err(OE_UNIX, errno, "malloc");
+    if ((xr = ctx_new()) == NULL)
 	goto done;
-    }
-    memset(xr, 0, sizeof(*xr));
     xr->xc_initial = xc1->xc_initial;
     xr->xc_type = XT_NUMBER;
     if (ctx2number(xc1, &n1) < 0)
@@ -632,11 +939,8 @@ xp_relop(xp_ctx    *xc1,
     int     reverse = 0;
     double  n1, n2;
     
-    if ((xr = malloc(sizeof(*xr))) == NULL){
-	clicon_err(OE_UNIX, errno, "malloc");
+    if ((xr = ctx_new()) == NULL)
 	goto done;
-    }
-    memset(xr, 0, sizeof(*xr));
     xr->xc_initial = xc1->xc_initial;
     xr->xc_type = XT_BOOL;
     if (xc1->xc_type == xc2->xc_type){ /* cases (2-3) above */
@@ -832,19 +1136,16 @@ xp_union(xp_ctx    *xc1,
 		   __FUNCTION__, clicon_int2str(xpopmap,op));
 	goto done;
     }
-    if ((xr = malloc(sizeof(*xr))) == NULL){
-	clicon_err(OE_UNIX, errno, "malloc");
+    if ((xr = ctx_new()) == NULL)
 	goto done;
-    }
-    memset(xr, 0, sizeof(*xr));
     xr->xc_initial = xc1->xc_initial;
     xr->xc_type = XT_NODESET;
 
     for (i=0; i<xc1->xc_size; i++)
-	if (cxvec_append(xc1->xc_nodeset[i], &xr->xc_nodeset, &xr->xc_size) < 0)
+	if (cxvec_append_max(xc1->xc_nodeset[i], &xr->xc_nodeset, &xr->xc_size, &xr->xc_max) < 0)
 	    goto done;
     for (i=0; i<xc2->xc_size; i++){
-	if (cxvec_append(xc2->xc_nodeset[i], &xr->xc_nodeset, &xr->xc_size) < 0)
+	if (cxvec_append_max(xc2->xc_nodeset[i], &xr->xc_nodeset, &xr->xc_size, &xr->xc_max) < 0)
 	    goto done;
     }
     *xrp = xr;
@@ -947,16 +1248,13 @@ xp_eval(xp_ctx     *xc,
 	use_xr0++;
 	/* Special case, no c0 or c1, single "/" */
 	if (xs->xs_c0 == NULL){
-	    if ((xr0 = malloc(sizeof(*xr0))) == NULL){
-		clicon_err(OE_UNIX, errno, "malloc");
+	    if ((xr0 = ctx_new()) == NULL)
 		goto done;
-	    }
-	    memset(xr0, 0, sizeof(*xr0));
 	    xr0->xc_initial = xc->xc_initial;
 	    xr0->xc_type = XT_NODESET;
 	    x = NULL;
 	    while ((x = xml_child_each(xc->xc_node, x, CX_ELMNT)) != NULL) {
-		if (cxvec_append(x, &xr0->xc_nodeset, &xr0->xc_size) < 0)
+		if (cxvec_append_max(x, &xr0->xc_nodeset, &xr0->xc_size, &xr0->xc_max) < 0)
 		    goto done;
 	    }
 	}
@@ -973,21 +1271,15 @@ xp_eval(xp_ctx     *xc,
     case XP_PRI0:
 	break;
     case XP_PRIME_NR: /* primaryexpr -> [<number>] */
-	if ((xr0 = malloc(sizeof(*xr0))) == NULL){
-	    clicon_err(OE_UNIX, errno, "malloc");
+	if ((xr0 = ctx_new()) == NULL)
 	    goto done;
-	}
-	memset(xr0, 0, sizeof(*xr0));
 	xr0->xc_initial = xc->xc_initial;
 	xr0->xc_type = XT_NUMBER;
 	xr0->xc_number = xs->xs_double;
 	break;
     case XP_PRIME_STR:
-	if ((xr0 = malloc(sizeof(*xr0))) == NULL){
-	    clicon_err(OE_UNIX, errno, "malloc");
+	if ((xr0 = ctx_new()) == NULL)
 	    goto done;
-	}
-	memset(xr0, 0, sizeof(*xr0));
 	xr0->xc_initial = xc->xc_initial;
 	xr0->xc_type = XT_STRING;
 	xr0->xc_string = xs->xs_s0?strdup(xs->xs_s0):NULL;
@@ -44,6 +44,7 @@ extern const map_str2int xpopmap[];
 /*
  * Prototypes
  */
+int nodetest_eval(cxobj *x, xpath_tree *xs, cvec *nsc);
 int xp_eval(xp_ctx *xc, xpath_tree *xs,	cvec *nsc, xp_ctx **xrp);
 
 #endif /* _CLIXON_XPATH_EVAL_H */
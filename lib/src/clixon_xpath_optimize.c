@@ -0,0 +1,846 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+ 
+  Copyright (C) 2009-2019 Olof Hagsand and Benny Holmgren
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, 
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ * Clixon XML XPATH 1.0 optimizations
+ *
+ * Key predicate fast path: an xpath step selecting a yang list entry by all
+ * its keys, or a leaf-list entry by value, such as:
+ *   /x/y[a='42']
+ *   /x/y[a=42][b='foo']
+ *   /x/y[a=42 and b='foo']
+ *   /x/z[.='bar']
+ * is resolved by binary search (or list key index) among the children instead
+ * of evaluating the predicates for every child.
+ * Note this requires the children to be sorted, which is the case for config 
+ * data in datastores, but not necessarily for state data or trees bound to
+ * yang but not sorted. The fast path is therefore only applied to config
+ * lists, and only if the children are verified sorted, see xml_sort_sorted.
+ *
+ * Query planner: an absolute location path, such as /x/y[a=42]/z//w, is split
+ * into a prefix of child steps that are resolved from the root by lookups
+ * (binary search of containers and leafs, list keys as above) and a rest that
+ * is evaluated on the nodes found by the prefix, instead of on the full tree.
+ * See xpath_vec_plan.
+ */
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <syslog.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clicon */
+#include "clixon_err.h"
+#include "clixon_log.h"
+#include "clixon_string.h"
+#include "clixon_queue.h"
+#include "clixon_hash.h"
+#include "clixon_handle.h"
+#include "clixon_yang.h"
+#include "clixon_yang_type.h"
+#include "clixon_xml.h"
+#include "clixon_xml_nsctx.h"
+#include "clixon_xml_sort.h"
+#include "clixon_xpath_ctx.h"
+#include "clixon_xpath.h"
+#include "clixon_xpath_optimize.h"
+#include "clixon_xpath_eval.h"
+
+/* Max number of equality expressions in the predicates of a step */
+#define XP_KEYEQ_MAX 16
+
+/* Max number of steps of an absolute location path handled by the planner */
+#define XP_PLAN_STEPS_MAX 64
+
+/* Equality expression <name> = <literal> in a predicate, name is NULL for '.' */
+struct xp_keyeq{
+    char       *xk_name;
+    xpath_tree *xk_lit;
+};
+
+#ifdef XPATH_LIST_OPTIMIZE
+static int _optimize_enable = 1;
+static int _optimize_hits = 0;
+#endif
+
+/*! Enable or disable xpath list key optimization
+ * @param[in]  enable  0: disable, 1: enable (default)
+ * @retval     0       OK
+ */
+int
+xpath_list_optimize_set(int enable)
+{
+#ifdef XPATH_LIST_OPTIMIZE
+    _optimize_enable = enable;
+#endif
+    return 0;
+}
+
+/*! Return number of xpath steps resolved by list key optimization
+ * @param[out] hits  Number of optimized steps
+ * @retval     0     OK
+ */
+int
+xpath_list_optimize_stats(int *hits)
+{
+#ifdef XPATH_LIST_OPTIMIZE
+    *hits = _optimize_hits;
+#else
+    *hits = 0;
+#endif
+    return 0;
+}
+
+/*! Skip single-operand expression nodes, eg expr -> andexpr -> relexpr ...
+ */
+static xpath_tree *
+xp_unwrap(xpath_tree *xs)
+{
+    while (xs && xs->xs_c0 && xs->xs_c1 == NULL){
+	switch (xs->xs_type){
+	case XP_EXP:
+	case XP_AND:
+	case XP_RELEX:
+	case XP_ADD:
+	case XP_UNION:
+	case XP_PATHEXPR:
+	case XP_LOCPATH:
+	case XP_RELLOCPATH:
+	case XP_PRI0:
+	    xs = xs->xs_c0;
+	    break;
+	default:
+	    return xs;
+	}
+    }
+    return xs;
+}
+
+#ifdef XPATH_LIST_OPTIMIZE
+/*! Check if xpath tree is a plain child name or '.' without predicates
+ * @param[in]  xs    XPATH tree (unwrapped)
+ * @param[out] name  Child name, or NULL for '.'
+ * @retval     1     Yes
+ * @retval     0     No
+ */
+static int
+xp_operand_name(xpath_tree *xs,
+		char      **name)
+{
+    xpath_tree *xp;
+
+    if (xs->xs_type != XP_STEP)
+	return 0;
+    /* No predicates */
+    if ((xp = xs->xs_c1) != NULL && (xp->xs_c0 != NULL || xp->xs_c1 != NULL))
+	return 0;
+    if (xs->xs_int == A_SELF && xs->xs_c0 == NULL){
+	*name = NULL;
+	return 1;
+    }
+    if (xs->xs_int == A_CHILD && xs->xs_c0 &&
+	xs->xs_c0->xs_type == XP_NODE &&
+	xs->xs_c0->xs_s1 && strcmp(xs->xs_c0->xs_s1, "*") != 0){
+	*name = xs->xs_c0->xs_s1;
+	return 1;
+    }
+    return 0;
+}
+
+/*! Collect equalities from a predicate expression which is a conjunction of
+ * <name> = <literal>
+ * @param[in]     xs   Predicate expression
+ * @param[in,out] eqs  Vector of equalities
+ * @param[in,out] nr   Length of eqs
+ * @retval        1    All of expression collected 
+ * @retval        0    Expression is not a conjunction of equalities
+ */
+static int
+xp_pred_eqs(xpath_tree     *xs,
+	    struct xp_keyeq *eqs,
+	    int             *nr)
+{
+    xpath_tree *x0;
+    xpath_tree *x1;
+    char       *name;
+
+    xs = xp_unwrap(xs);
+    if (xs->xs_c1 == NULL)
+	return 0;
+    if (xs->xs_type == XP_AND && xs->xs_int == XO_AND)
+	return xp_pred_eqs(xs->xs_c0, eqs, nr) && xp_pred_eqs(xs->xs_c1, eqs, nr);
+    if (xs->xs_type != XP_RELEX || xs->xs_int != XO_EQ)
+	return 0;
+    x0 = xp_unwrap(xs->xs_c0);
+    x1 = xp_unwrap(xs->xs_c1);
+    if (x0->xs_type == XP_PRIME_STR || x0->xs_type == XP_PRIME_NR){ /* lit = name */
+	xs = x0;
+	x0 = x1;
+	x1 = xs;
+    }
+    if (x1->xs_type != XP_PRIME_STR && x1->xs_type != XP_PRIME_NR)
+	return 0;
+    if (xp_operand_name(x0, &name) == 0)
+	return 0;
+    if (*nr >= XP_KEYEQ_MAX)
+	return 0;
+    eqs[*nr].xk_name = name;
+    eqs[*nr].xk_lit = x1;
+    (*nr)++;
+    return 1;
+}
+
+/*! Collect equalities from the leading predicates of a step
+ * Only a leading sequence of predicates that are conjunctions of equalities
+ * are collected, since a predicate following another predicate, eg a
+ * position [1], is evaluated on the result of the preceding predicate.
+ * @param[in]     xs   Predicates (XP_PRED)
+ * @param[in,out] eqs  Vector of equalities
+ * @param[in,out] nr   Length of eqs
+ * @retval        1    All predicates collected
+ * @retval        0    Stopped at a predicate that is not a conjunction of equalities
+ */
+static int
+xp_preds_eqs(xpath_tree     *xs,
+	     struct xp_keyeq *eqs,
+	     int             *nr)
+{
+    int nr0;
+
+    if (xs->xs_c0 && xp_preds_eqs(xs->xs_c0, eqs, nr) == 0)
+	return 0;
+    if (xs->xs_c1 == NULL)
+	return 1;
+    nr0 = *nr;
+    if (xp_pred_eqs(xs->xs_c1, eqs, nr) == 0){
+	*nr = nr0;
+	return 0;
+    }
+    return 1;
+}
+
+/*! Translate a literal in an equality to a string value of a yang leaf
+ * @param[in]  y     Yang leaf or leaf-list
+ * @param[in]  lit   Literal xpath tree, string or number
+ * @param[in]  cb    Value is written here
+ * @retval     1     OK, value in cb, and all matching entries have this value
+ * @retval     0     Literal not applicable (eg number compared to string type)
+ * @retval    -1     Error
+ * Only string and integer types are handled: the equality then implies that
+ * the key is equal to the value as compared by xml_cmp().
+ */
+static int
+xp_key_value(yang_stmt  *y,
+	     xpath_tree *lit,
+	     cbuf       *cb)
+{
+    int          retval = -1;
+    yang_stmt   *yrestype = NULL;
+    int          options = 0;
+    uint8_t      fraction = 0;
+    enum cv_type cvtype;
+    cg_var      *cv = NULL;
+    char        *reason = NULL;
+    char        *str;
+    double       d;
+    int          ret;
+    
+    if (yang_type_get(y, NULL, &yrestype, &options, NULL, NULL, NULL, &fraction) < 0)
+	goto done;
+    if (yrestype == NULL)
+	goto notapplicable;
+    if (yang2cv_type(yang_argument_get(yrestype), &cvtype) < 0)
+	goto done;
+    switch (cvtype){
+    case CGV_STRING:
+	if (lit->xs_type != XP_PRIME_STR)
+	    goto notapplicable;
+	cprintf(cb, "%s", lit->xs_s0?lit->xs_s0:"");
+	break;
+    case CGV_INT8:
+    case CGV_INT16:
+    case CGV_INT32:
+    case CGV_INT64:
+    case CGV_UINT8:
+    case CGV_UINT16:
+    case CGV_UINT32:
+    case CGV_UINT64:
+	if (lit->xs_type == XP_PRIME_NR){
+	    d = lit->xs_double;
+	    if (d != (double)(int64_t)d)
+		goto notapplicable;
+	    cprintf(cb, "%" PRId64, (int64_t)d);
+	}
+	else{
+	    str = lit->xs_s0?lit->xs_s0:"";
+	    cprintf(cb, "%s", str);
+	}
+	/* Value must be valid for the type */
+	if ((cv = cv_new(cvtype)) == NULL){
+	    clicon_err(OE_XML, errno, "cv_new");
+	    goto done;
+	}
+	if ((ret = cv_parse1(cbuf_get(cb), cv, &reason)) < 0){
+	    clicon_err(OE_XML, errno, "cv_parse1");
+	    goto done;
+	}
+	if (ret == 0)
+	    goto notapplicable;
+	break;
+    default:
+	goto notapplicable;
+	break;
+    }
+    retval = 1;
+ done:
+    if (cv)
+	cv_free(cv);
+    if (reason)
+	free(reason);
+    return retval;
+ notapplicable:
+    retval = 0;
+    goto done;
+}
+
+/*! Add a leaf with value of literal to temporary search object
+ * @retval     1     OK
+ * @retval     0     Literal not applicable
+ * @retval    -1     Error
+ */
+static int
+xp_key_add(cxobj      *xn,
+	   yang_stmt  *y,
+	   xpath_tree *lit)
+{
+    int    retval = -1;
+    cbuf  *cb = NULL;
+    cxobj *xb;
+    int    ret;
+
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_XML, errno, "cbuf_new");
+	goto done;
+    }
+    if ((ret = xp_key_value(y, lit, cb)) <= 0){
+	retval = ret;
+	goto done;
+    }
+    if ((xb = xml_new("body", xn, NULL)) == NULL)
+	goto done;
+    xml_type_set(xb, CX_BODY);
+    if (xml_value_set(xb, cbuf_get(cb)) < 0)
+	goto done;
+    retval = 1;
+ done:
+    if (cb)
+	cbuf_free(cb);
+    return retval;
+}
+#endif /* XPATH_LIST_OPTIMIZE */
+
+/*! Resolve an xpath child step with key predicates using binary search
+ * Applies to an xpath step <name>[<key>=<literal>]... where name is a config 
+ * list of xv and all its keys are given, or <name>[.=<literal>] where name is a
+ * config leaf-list.
+ * @param[in]  xs    XPATH step (XP_STEP)
+ * @param[in]  xv    XML parent node (context node of step)
+ * @param[in]  nsc   XML Namespace context
+ * @param[out] xp    Matching child, or NULL if no match
+ * @retval     1     Optimized: xp is the only candidate of the step in xv. 
+ *                   The nodetest and predicates should be evaluated on it.
+ * @retval     0     Not applicable, evaluate step as usual
+ * @retval    -1     Error
+ */
+int
+xpath_list_optimize(xpath_tree *xs,
+		    cxobj      *xv,
+		    cvec       *nsc,
+		    cxobj     **xp)
+{
+#ifdef XPATH_LIST_OPTIMIZE
+    int             retval = -1;
+    xpath_tree     *nodetest;
+    yang_stmt      *yp;
+    yang_stmt      *yc;
+    yang_stmt      *yk;
+    struct xp_keyeq eqs[XP_KEYEQ_MAX];
+    int             nr = 0;
+    int             i;
+    char           *ns;
+    char           *keyname;
+    cvec           *cvk;
+    cg_var         *cvi;
+    cxobj          *x1 = NULL;
+    cxobj          *xk;
+    int             ret;
+
+    if (!_optimize_enable)
+	goto notapplicable;
+    if ((nodetest = xs->xs_c0) == NULL ||
+	nodetest->xs_type != XP_NODE ||
+	nodetest->xs_s1 == NULL ||
+	strcmp(nodetest->xs_s1, "*") == 0 ||
+	xs->xs_c1 == NULL)
+	goto notapplicable;
+    if ((yp = xml_spec(xv)) == NULL || yang_keyword_get(yp) == Y_SPEC)
+	goto notapplicable;
+    if ((yc = yang_find_datanode(yp, nodetest->xs_s1)) == NULL ||
+	yang_choice(yc) != NULL ||
+	yang_config(yc) == 0)
+	goto notapplicable;
+    /* Binary search requires sorted children, eg not if xv was populated
+     * with yang but never sorted */
+    if (!xml_sort_sorted(xv))
+	goto notapplicable;
+    /* Namespace of nodetest, if any, must be namespace of list */
+    if (nsc != NULL &&
+	(ns = xml_nsctx_get(nsc, nodetest->xs_s0)) != NULL &&
+	(yang_find_mynamespace(yc) == NULL ||
+	 strcmp(ns, yang_find_mynamespace(yc)) != 0))
+	goto notapplicable;
+    xp_preds_eqs(xs->xs_c1, eqs, &nr);
+    if (nr == 0)
+	goto notapplicable;
+    /* Temporary search object, not added to xv */
+    if ((x1 = xml_new(nodetest->xs_s1, NULL, yc)) == NULL)
+	goto done;
+    switch (yang_keyword_get(yc)){
+    case Y_LIST:
+	cvk = yang_cvec_get(yc);
+	if (cvec_len(cvk) == 0)
+	    goto notapplicable;
+	cvi = NULL;
+	while ((cvi = cvec_each(cvk, cvi)) != NULL) {
+	    keyname = cv_string_get(cvi);
+	    for (i=0; i<nr; i++)
+		if (eqs[i].xk_name && strcmp(eqs[i].xk_name, keyname) == 0)
+		    break;
+	    if (i == nr)
+		goto notapplicable;
+	    if ((yk = yang_find(yc, Y_LEAF, keyname)) == NULL)
+		goto notapplicable;
+	    if ((xk = xml_new(keyname, x1, yk)) == NULL)
+		goto done;
+	    if ((ret = xp_key_add(xk, yk, eqs[i].xk_lit)) < 0)
+		goto done;
+	    if (ret == 0)
+		goto notapplicable;
+	}
+	break;
+    case Y_LEAF_LIST:
+	for (i=0; i<nr; i++)
+	    if (eqs[i].xk_name == NULL)
+		break;
+	if (i == nr)
+	    goto notapplicable;
+	if ((ret = xp_key_add(x1, yc, eqs[i].xk_lit)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto notapplicable;
+	break;
+    default:
+	goto notapplicable;
+	break;
+    }
+    if (match_base_child(xv, x1, yc, xp) < 0)
+	goto done;
+    _optimize_hits++;
+    retval = 1;
+ done:
+    if (x1)
+	xml_free(x1);
+    return retval;
+ notapplicable:
+    retval = 0;
+    goto done;
+#else
+    return 0;
+#endif /* XPATH_LIST_OPTIMIZE */
+}
+
+/*! Find a single instance config child (container or leaf) by binary search
+ * @param[in]  nodetest  XPATH nodetest (XP_NODE) with child name
+ * @param[in]  xv        XML parent node
+ * @param[in]  nsc       XML Namespace context
+ * @param[out] xp        Matching child, or NULL if no match
+ * @retval     1         Looked up: xp is the only candidate in xv
+ * @retval     0         Not applicable, eg no yang or name is a list
+ * @retval    -1         Error
+ * @see xpath_list_optimize  for list and leaf-list entries
+ */
+static int
+xp_plan_lookup(xpath_tree *nodetest,
+	       cxobj      *xv,
+	       cvec       *nsc,
+	       cxobj     **xp)
+{
+    int        retval = -1;
+    yang_stmt *yp;
+    yang_stmt *yc;
+    char      *ns;
+    cxobj     *x1 = NULL;
+
+    if ((yp = xml_spec(xv)) == NULL || yang_keyword_get(yp) == Y_SPEC)
+	goto notapplicable;
+    if ((yc = yang_find_datanode(yp, nodetest->xs_s1)) == NULL ||
+	yang_choice(yc) != NULL ||
+	yang_config(yc) == 0)
+	goto notapplicable;
+    /* Binary search requires sorted children, eg not if xv was populated
+     * with yang but never sorted */
+    if (!xml_sort_sorted(xv))
+	goto notapplicable;
+    if (yang_keyword_get(yc) != Y_CONTAINER && yang_keyword_get(yc) != Y_LEAF)
+	goto notapplicable;
+    if (nsc != NULL &&
+	(ns = xml_nsctx_get(nsc, nodetest->xs_s0)) != NULL &&
+	(yang_find_mynamespace(yc) == NULL ||
+	 strcmp(ns, yang_find_mynamespace(yc)) != 0))
+	goto notapplicable;
+    /* Temporary search object, not added to xv */
+    if ((x1 = xml_new(nodetest->xs_s1, NULL, yc)) == NULL)
+	goto done;
+    if (match_base_child(xv, x1, yc, xp) < 0)
+	goto done;
+    retval = 1;
+ done:
+    if (x1)
+	xml_free(x1);
+    return retval;
+ notapplicable:
+    retval = 0;
+    goto done;
+}
+
+/*! Evaluate a prefix step of a plan on the nodes of the previous step
+ * @param[in]  xc     XPATH context, nodeset is the result of previous step
+ * @param[in]  xs     XPATH step (child axis with named nodetest)
+ * @param[in]  nsc    XML Namespace context
+ * @param[out] xrp    Result context
+ * @param[out] cbex   Plan explanation, or NULL
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+xp_plan_step(xp_ctx     *xc,
+	     xpath_tree *xs,
+	     cvec       *nsc,
+	     xp_ctx    **xrp,
+	     cbuf       *cbex)
+{
+    int         retval = -1;
+    xpath_tree *nodetest = xs->xs_c0;
+    xp_ctx     *xr = NULL;
+    cxobj     **vec = NULL;
+    size_t      veclen = 0;
+    size_t      vecmax = 0;
+    cxobj      *xv;
+    cxobj      *x;
+    int         nkey = 0;
+    int         nlookup = 0;
+    int         nscan = 0;
+    int         i;
+    int         ret;
+
+    for (i=0; i<xc->xc_size; i++){
+	xv = xc->xc_nodeset[i];
+	if ((ret = xpath_list_optimize(xs, xv, nsc, &x)) < 0)
+	    goto done;
+	if (ret == 1)
+	    nkey++;
+	else {
+	    if ((ret = xp_plan_lookup(nodetest, xv, nsc, &x)) < 0)
+		goto done;
+	    if (ret == 1)
+		nlookup++;
+	}
+	if (ret == 1){
+	    if (x && nodetest_eval(x, nodetest, nsc) == 1)
+		if (cxvec_append_max(x, &vec, &veclen, &vecmax) < 0)
+		    goto done;
+	    continue;
+	}
+	nscan++;
+	x = NULL;
+	while ((x = xml_child_each(xv, x, CX_ELMNT)) != NULL)
+	    if (nodetest_eval(x, nodetest, nsc) == 1)
+		if (cxvec_append_max(x, &vec, &veclen, &vecmax) < 0)
+		    goto done;
+    }
+    if (cbex){
+	cprintf(cbex, "step /");
+	xpath_tree2cbuf(xs, cbex);
+	cprintf(cbex, ": ");
+	if (nkey)
+	    cprintf(cbex, "key lookup in %d, ", nkey);
+	if (nlookup)
+	    cprintf(cbex, "lookup in %d, ", nlookup);
+	if (nscan)
+	    cprintf(cbex, "children scan in %d, ", nscan);
+	cprintf(cbex, "%zu candidates", veclen);
+    }
+    if ((xr = ctx_dup(xc)) == NULL)
+	goto done;
+    ctx_nodeset_replace(xr, vec, veclen);
+    vec = NULL;
+    /* Pushdown: predicates are evaluated on the candidates only */
+    if (xs->xs_c1 && (xs->xs_c1->xs_c0 || xs->xs_c1->xs_c1)){
+	if (xp_eval(xr, xs->xs_c1, nsc, xrp) < 0)
+	    goto done;
+	if (cbex)
+	    cprintf(cbex, ", predicates: %zu nodes",
+		    (*xrp)->xc_type==XT_NODESET?(*xrp)->xc_size:0);
+    }
+    else{
+	*xrp = xr;
+	xr = NULL;
+    }
+    if (cbex)
+	cprintf(cbex, "\n");
+    retval = 0;
+ done:
+    if (xr)
+	ctx_free(xr);
+    if (vec)
+	free(vec);
+    return retval;
+}
+
+/*! Given XML tree and xpath, returns nodeset as xml node vector using a query plan
+ *
+ * Same result as xpath_vec_nsc for absolute location paths, but the leading
+ * child steps are resolved from the root by lookups, and the rest of the path 
+ * is only evaluated in the subtrees found. Other xpaths are evaluated as usual.
+ * A plan is one of:
+ *   key:    All steps are resolved by lookups, eg /x/y[a=42]
+ *   prefix: Leading steps resolved by lookups, the rest evaluated on the 
+ *           result, eg /x/y[a=42]//z
+ *   scan:   Evaluated on the full tree, eg //z or /x//y/z
+ * @param[in]  xcur    XML tree where to search
+ * @param[in]  nsc     External XML namespace context, or NULL
+ * @param[in]  xpath   String with XPATH 1.0 syntax
+ * @param[out] vec     Vector of xml-trees. Vector must be free():d after use
+ * @param[out] veclen  returns length of vector in return value
+ * @param[out] cbex    If set, plan explanation (one line per step) is written here
+ * @retval     0       OK
+ * @retval    -1       Error
+ * @code
+ *   cbuf *cb = cbuf_new();
+ *   if (xpath_vec_plan(xt, nsc, "/x/y[a=42]/z", &vec, &veclen, cb) < 0)
+ *      err;
+ *   fprintf(stderr, "%s", cbuf_get(cb));
+ * @endcode
+ * @note The lookups require config data to be sorted, as in the datastore
+ * @see xpath_vec_nsc
+ */
+int
+xpath_vec_plan(cxobj   *xcur,
+	       cvec    *nsc,
+	       char    *xpath,
+	       cxobj ***vec,
+	       size_t  *veclen,
+	       cbuf    *cbex)
+{
+    int         retval = -1;
+    xpath_tree *xpt = NULL;
+    xpath_tree *xs;
+    xpath_tree *steps[XP_PLAN_STEPS_MAX];
+    int         seps[XP_PLAN_STEPS_MAX];
+    xpath_tree *xrest = NULL;
+    xpath_tree *xw;
+    xp_arena    xa = {0,};
+    xp_ctx     *xc = NULL;
+    xp_ctx     *xr = NULL;
+    cxobj      *x;
+    char       *reason = NULL;
+    int         n = 0;
+    int         k;
+    int         i;
+    
+    *vec = NULL;
+    *veclen = 0;
+    if (xpath_compile(xpath, &xpt) < 0)
+	goto done;
+    /* Static plan: split absolute location path into steps */
+    xs = xp_unwrap(xpt);
+    if (xs->xs_type != XP_ABSPATH || xs->xs_int != A_ROOT || xs->xs_c0 == NULL){
+	reason = "not an absolute location path";
+	goto scan;
+    }
+    for (xs = xs->xs_c0; xs->xs_c1 != NULL; xs = xs->xs_c0){
+	if (xs->xs_type != XP_RELLOCPATH || n == XP_PLAN_STEPS_MAX - 1){
+	    reason = "unsupported location path";
+	    goto scan;
+	}
+	steps[n] = xs->xs_c1;
+	seps[n++] = xs->xs_int;
+    }
+    if (xs->xs_type != XP_RELLOCPATH || xs->xs_c0 == NULL){
+	reason = "unsupported location path";
+	goto scan;
+    }
+    steps[n] = xs->xs_c0;
+    seps[n++] = A_NAN;
+    /* Reverse to path order, seps[i] is the separator before steps[i] */
+    for (i=0; i<n/2; i++){
+	xw = steps[i]; steps[i] = steps[n-1-i]; steps[n-1-i] = xw;
+	k = seps[i]; seps[i] = seps[n-1-i]; seps[n-1-i] = k;
+    }
+    /* Prefix: child steps with named nodetests */
+    for (k=0; k<n; k++){
+	xs = steps[k];
+	if (seps[k] != A_NAN ||
+	    xs->xs_type != XP_STEP ||
+	    xs->xs_int != A_CHILD ||
+	    xs->xs_c0 == NULL ||
+	    xs->xs_c0->xs_type != XP_NODE ||
+	    xs->xs_c0->xs_s1 == NULL ||
+	    strcmp(xs->xs_c0->xs_s1, "*") == 0)
+	    break;
+    }
+    if (k == 0){
+	reason = "first step is not a child step";
+	goto scan;
+    }
+    for (i=k+1; i<n; i++)
+	if (seps[i] != A_NAN){
+	    reason = "descendant step after first step of rest";
+	    goto scan;
+	}
+    if (cbex)
+	cprintf(cbex, "plan: %s\n", k==n?"key":"prefix");
+    /* Execute plan: resolve prefix from the root */
+    ctx_arena_push(&xa);
+    if ((xc = ctx_new()) == NULL)
+	goto pop;
+    x = xcur;
+    while (xml_parent(x) != NULL)
+	x = xml_parent(x);
+    xc->xc_type = XT_NODESET;
+    xc->xc_node = x;
+    xc->xc_initial = xcur;
+    if (cxvec_append_max(x, &xc->xc_nodeset, &xc->xc_size, &xc->xc_max) < 0)
+	goto pop;
+    for (i=0; i<k; i++){
+	if (xp_plan_step(xc, steps[i], nsc, &xr, cbex) < 0)
+	    goto pop;
+	ctx_free(xc);
+	xc = xr;
+	xr = NULL;
+	if (xc->xc_type != XT_NODESET)
+	    break;
+    }
+    /* Evaluate rest on the result of the prefix, as a relative location path
+     * borrowing the steps of the compiled tree */
+    if (k < n && xc->xc_type == XT_NODESET){
+	for (i=k; i<n; i++){
+	    if ((xw = calloc(1, sizeof(*xw))) == NULL){
+		clicon_err(OE_XML, errno, "calloc");
+		goto pop;
+	    }
+	    xw->xs_type = XP_RELLOCPATH;
+	    xw->xs_int = A_NAN;
+	    if (xrest == NULL)
+		xw->xs_c0 = steps[i];
+	    else{
+		xw->xs_c0 = xrest;
+		xw->xs_c1 = steps[i];
+	    }
+	    xrest = xw;
+	}
+	if (seps[k] == A_DESCENDANT_OR_SELF) /* // is short for /descendant-or-self::node()/ */
+	    xc->xc_descendant = 1;
+	if (xp_eval(xc, xrest, nsc, &xr) < 0)
+	    goto pop;
+	if (cbex){
+	    cprintf(cbex, "rest ");
+	    if (seps[k] == A_DESCENDANT_OR_SELF)
+		cprintf(cbex, "/");
+	    cprintf(cbex, "/");
+	    xpath_tree2cbuf(xrest, cbex);
+	    cprintf(cbex, ": evaluated on %zu nodes\n", xc->xc_size);
+	}
+	ctx_free(xc);
+	xc = xr;
+	xr = NULL;
+    }
+    if (xc->xc_type == XT_NODESET && xc->xc_size){
+	if ((*vec = malloc(xc->xc_size*sizeof(cxobj *))) == NULL){
+	    clicon_err(OE_XML, errno, "malloc");
+	    goto pop;
+	}
+	memcpy(*vec, xc->xc_nodeset, xc->xc_size*sizeof(cxobj *));
+	*veclen = xc->xc_size;
+    }
+    retval = 0;
+ pop:
+    if (xc){
+	ctx_free(xc);
+	xc = NULL;
+    }
+    ctx_arena_pop(&xa);
+    goto done;
+ scan:
+    if (cbex)
+	cprintf(cbex, "plan: scan (%s)\n", reason);
+    if (xpath_vec_compiled(xcur, nsc, xpt, &xc) < 0)
+	goto done;
+    if (xc->xc_type == XT_NODESET){
+	*vec = xc->xc_nodeset;
+	xc->xc_nodeset = NULL;
+	*veclen = xc->xc_size;
+    }
+    retval = 0;
+ done:
+    if (cbex && retval == 0)
+	cprintf(cbex, "result: %zu nodes\n", *veclen);
+    /* Free wrappers only, steps belong to the compiled tree */
+    while ((xw = xrest) != NULL){
+	xrest = xw->xs_c1 ? xw->xs_c0 : NULL;
+	free(xw);
+    }
+    if (xc)
+	ctx_free(xc);
+    if (xpt)
+	xpath_compile_free(xpt);
+    return retval;
+}
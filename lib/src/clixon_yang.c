@@ -87,6 +87,9 @@
 #include "clixon_yang.h"
 #include "clixon_hash.h"
 #include "clixon_xml.h"
+#include "clixon_xml_nsctx.h"
+#include "clixon_xpath_ctx.h"
+#include "clixon_xpath.h"
 #include "clixon_plugin.h"
 #include "clixon_data.h"
 #include "clixon_options.h"
@@ -98,6 +101,9 @@
 /* Size of json read buffer when reading from file*/
 #define BUFLEN 1024
 
+/* ys_order of yang statements whose order is not precomputed */
+#define YANG_ORDER_UNSET -2
+
 /*
  * Local variables
  */
@@ -277,6 +283,7 @@ ys_new(enum rfc_6020 keyw)
     }
     memset(ys, 0, sizeof(*ys));
     ys->ys_keyword    = keyw;
+    ys->ys_order      = YANG_ORDER_UNSET;
     /* The cvec contains stmt-specific variables. Only few stmts need variables so the
        cvec could be lazily created to save some heap and cycles. */
     if ((ys->ys_cvec = cvec_new(0)) == NULL){ 
@@ -298,6 +305,10 @@ ys_free1(yang_stmt *ys)
 	cvec_free(ys->ys_cvec);
     if (ys->ys_typecache)
 	yang_type_cache_free(ys->ys_typecache);
+    if (ys->ys_xpath)
+	xpath_tree_free(ys->ys_xpath);
+    if (ys->ys_nsc)
+	xml_nsctx_free(ys->ys_nsc);
     free(ys);
     return 0;
 }
@@ -350,6 +361,23 @@ ys_free(yang_stmt *ys)
     return 0;
 }
 
+/*! Free indexes of data node names of a yang spec
+ * Must be called if the yang spec changes
+ * @param[in]  yspec  Yang specification
+ */
+static void
+yang_descidx_free(yang_stmt *yspec)
+{
+    if (yspec->ys_descidx){
+	clicon_hash_free(yspec->ys_descidx);
+	yspec->ys_descidx = NULL;
+    }
+    if (yspec->ys_depidx){
+	clicon_hash_free(yspec->ys_depidx);
+	yspec->ys_depidx = NULL;
+    }
+}
+
 /*! Free a yang specification recursively 
  */
 int 
@@ -364,6 +392,7 @@ yspec_free(yang_stmt *yspec)
     }
     if (yspec->ys_stmt)
 	free(yspec->ys_stmt);
+    yang_descidx_free(yspec);
     free(yspec);
     return 0;
 }
@@ -402,6 +431,8 @@ ys_cp(yang_stmt *ynew,
 
     memcpy(ynew, yold, sizeof(*yold)); 
     ynew->ys_parent = NULL;
+    ynew->ys_xpath = NULL; /* Compiled again, see ys_compile */
+    ynew->ys_nsc = NULL;
     if (yold->ys_stmt)
 	if ((ynew->ys_stmt = calloc(yold->ys_len, sizeof(yang_stmt *))) == NULL){
 	    clicon_err(OE_YANG, errno, "calloc");
@@ -483,6 +514,7 @@ yn_insert(yang_stmt *ys_parent,
 	return -1;
     ys_parent->ys_stmt[pos] = ys_child;
     ys_child->ys_parent = ys_parent;
+    ys_child->ys_order = YANG_ORDER_UNSET; /* Computed on demand */
     return 0;
 }
 
@@ -960,15 +992,14 @@ order1(yang_stmt *yp,
     return 0;
 }
 
-/*! Return order of yang statement y in parents child vector
+/*! Compute order of yang statement y in parents child vector
  * @param[in]  y      Find position of this data-node
- * @param[out] index  Index of y in yp:s list of children
  * @retval   >=0      Order of child with specified argument
  * @retval    -1      Not found
- * @note special handling if y is child of (sub)module
+ * @see yang_order  which uses the precomputed order if available
  */
-int
-yang_order(yang_stmt *y)
+static int
+yang_order1(yang_stmt *y)
 {
     yang_stmt  *yp;
     yang_stmt  *ypp;
@@ -977,8 +1008,6 @@ yang_order(yang_stmt *y)
     int         j=0;
     int         tot = 0;
 
-    if (y == NULL)
-	return -1;
     /* Some special handling if yp is choice (or case)
      * if so, the real parent (from an xml point of view) is the parents
      * parent. 
@@ -1007,6 +1036,322 @@ yang_order(yang_stmt *y)
     return -1;
 }
 
+/*! Return order of yang statement y in parents child vector
+ * Normally precomputed when the yang spec is parsed, so this is O(1). 
+ * Statements inserted after parsing have their order computed on demand.
+ * @param[in]  y      Find position of this data-node
+ * @retval   >=0      Order of child with specified argument
+ * @retval    -1      Not found
+ * @note special handling if y is child of (sub)module
+ * @see yang_order_compute
+ */
+int
+yang_order(yang_stmt *y)
+{
+    if (y == NULL)
+	return -1;
+    if (y->ys_order != YANG_ORDER_UNSET)
+	return y->ys_order;
+    return yang_order1(y);
+}
+
+/*! Reset precomputed yang order of a yang tree
+ * @param[in]  yn  Yang node, its descendants are reset
+ */
+static void
+yang_order_reset(yang_stmt *yn)
+{
+    int i;
+
+    for (i=0; i<yn->ys_len; i++){
+	yn->ys_stmt[i]->ys_order = -1;
+	yang_order_reset(yn->ys_stmt[i]);
+    }
+}
+
+/*! Set yang order of datanode children of a choice, same as order1_choice
+ * @param[in]     yp     Choice node
+ * @param[in,out] index  Index of next datanode
+ * @see order1_choice
+ */
+static void
+yang_order_choice(yang_stmt *yp,
+		  int       *index)
+{
+    yang_stmt  *ys;
+    yang_stmt  *yc;
+    int         i;
+    int         j;
+    int         shortcut=0;
+    int         max=0;
+
+    for (i=0; i<yp->ys_len; i++){
+	ys = yp->ys_stmt[i];
+	if (ys->ys_keyword == Y_CASE){
+	    for (j=0; j<ys->ys_len; j++){
+		yc = ys->ys_stmt[j];
+		if (yang_datanode(yc))
+		    yc->ys_order = *index + j;
+	    }
+	    if (j>max)
+		max = j;
+	}
+	else {
+	    shortcut = 1;
+	    if (yang_datanode(ys))
+		ys->ys_order = *index;
+	}
+    }
+    if (shortcut)
+	(*index)++;
+    else
+	*index += max;
+}
+
+/*! Set yang order of all datanodes in a yang tree, same as order1
+ * @param[in]  yp   Yang node
+ * @param[in]  tot  Offset of first child (non-zero for (sub)modules)
+ * @see order1
+ */
+static void
+yang_order_set(yang_stmt *yp,
+	       int        tot)
+{
+    yang_stmt  *ys;
+    int         i;
+    int         j = tot;
+
+    /* Children of choice and case are ordered by their parent (from an xml
+     * point of view), see yang_order1 */
+    if (yp->ys_keyword != Y_CHOICE && yp->ys_keyword != Y_CASE)
+	for (i=0; i<yp->ys_len; i++){
+	    ys = yp->ys_stmt[i];
+	    if (ys->ys_keyword == Y_CHOICE)
+		yang_order_choice(ys, &j);
+	    else if (yang_datanode(ys))
+		ys->ys_order = j++;
+	}
+    for (i=0; i<yp->ys_len; i++)
+	yang_order_set(yp->ys_stmt[i], 0);
+}
+
+/*! Precompute yang order of all statements in a yang spec
+ * Makes yang_order() O(1). Must be recomputed if the yang spec changes.
+ * @param[in]  yspec  Yang specification
+ * @see yang_order
+ */
+static int
+yang_order_compute(yang_stmt *yspec)
+{
+    yang_stmt *ym;
+    int        i;
+    int        tot = 0;
+
+    yang_order_reset(yspec);
+    for (i=0; i<yspec->ys_len; i++){
+	ym = yspec->ys_stmt[i];
+	yang_order_set(ym, tot);
+	tot += ym->ys_len;
+    }
+    return 0;
+}
+
+/* Entry of descendant name index: data node name and one of its ancestors */
+struct yang_descpair{
+    char      *yd_name;
+    yang_stmt *yd_anc;
+};
+
+/*! Order descendant name pairs by name, then by ancestor */
+static int
+yang_descpair_cmp(const void *a,
+		  const void *b)
+{
+    const struct yang_descpair *da = a;
+    const struct yang_descpair *db = b;
+    int                         eq;
+
+    if ((eq = strcmp(da->yd_name, db->yd_name)) != 0)
+	return eq;
+    if (da->yd_anc == db->yd_anc)
+	return 0;
+    return (uintptr_t)da->yd_anc < (uintptr_t)db->yd_anc ? -1 : 1;
+}
+
+/*! Order yang statements by address */
+static int
+yang_ptr_cmp(const void *a,
+	     const void *b)
+{
+    uintptr_t pa = (uintptr_t)*(yang_stmt **)a;
+    uintptr_t pb = (uintptr_t)*(yang_stmt **)b;
+
+    return pa < pb ? -1 : (pa > pb ? 1 : 0);
+}
+
+/*! Collect (name, ancestor) pairs of all data and schema nodes in a yang tree
+ * @param[in]     yn     Yang node, its descendants are collected
+ * @param[in]     state  yn is, or is below, a config false node
+ * @param[in,out] anc    Stack of ancestors of yn, including yn
+ * @param[in]     nanc   Length of anc
+ * @param[in,out] maxanc Allocated length of anc
+ * @param[in,out] vec    Vector of pairs
+ * @param[in,out] len    Length of vec
+ * @param[in,out] max    Allocated length of vec
+ * @retval        0      OK
+ * @retval       -1      Error
+ */
+static int
+yang_descidx_collect(yang_stmt              *yn,
+		     int                      state,
+		     yang_stmt             ***anc,
+		     int                      nanc,
+		     int                     *maxanc,
+		     struct yang_descpair   **vec,
+		     size_t                  *len,
+		     size_t                  *max)
+{
+    int                   retval = -1;
+    yang_stmt            *ys;
+    struct yang_descpair *v;
+    yang_stmt           **a;
+    int                   i;
+    int                   j;
+    int                   ystate;
+
+    if (nanc >= *maxanc){
+	*maxanc = *maxanc ? 2 * *maxanc : 16;
+	if ((a = realloc(*anc, *maxanc*sizeof(yang_stmt *))) == NULL){
+	    clicon_err(OE_YANG, errno, "realloc");
+	    goto done;
+	}
+	*anc = a;
+    }
+    (*anc)[nanc++] = yn;
+    for (i=0; i<yn->ys_len; i++){
+	ys = yn->ys_stmt[i];
+	ystate = state || (yang_schemanode(ys) && yang_config(ys) == 0);
+	if (ys->ys_argument != NULL &&
+	    (yang_schemanode(ys) || ys->ys_keyword == Y_ACTION)){
+	    /* Every node on the path from the spec is an ancestor */
+	    for (j=0; j<nanc; j++){
+		if (*len >= *max){
+		    *max = *max ? 2 * *max : 256;
+		    if ((v = realloc(*vec, *max*sizeof(*v))) == NULL){
+			clicon_err(OE_YANG, errno, "realloc");
+			goto done;
+		    }
+		    *vec = v;
+		}
+		/* Anything may occur below anydata and anyxml, and in state
+		 * data, which is not necessarily bound to the schema */
+		if (ys->ys_keyword == Y_ANYDATA || ys->ys_keyword == Y_ANYXML ||
+		    ystate)
+		    (*vec)[*len].yd_name = "*";
+		else
+		    (*vec)[*len].yd_name = ys->ys_argument;
+		(*vec)[*len].yd_anc = (*anc)[j];
+		(*len)++;
+	    }
+	}
+	if (yang_descidx_collect(ys, ystate, anc, nanc, maxanc, vec, len, max) < 0)
+	    goto done;
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Build index of data node names to the schema nodes that may contain them
+ * The index maps every data node name in a yang spec to the (address-sorted)
+ * vector of all yang statements that have a descendant with that name.
+ * Ancestors of anydata and anyxml nodes, whose content is not described by the
+ * schema, and of state data nodes, which may not be bound to the schema, are
+ * stored under the name "*".
+ * @param[in]  yspec  Yang specification
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see yang_descendant_name
+ */
+static int
+yang_descidx_build(yang_stmt *yspec)
+{
+    int                   retval = -1;
+    clicon_hash_t        *idx = NULL;
+    struct yang_descpair *vec = NULL;
+    size_t                len = 0;
+    size_t                max = 0;
+    yang_stmt           **anc = NULL;
+    int                   maxanc = 0;
+    yang_stmt           **ys = NULL;
+    size_t                i;
+    size_t                j;
+    size_t                n;
+
+    if (yang_descidx_collect(yspec, 0, &anc, 0, &maxanc, &vec, &len, &max) < 0)
+	goto done;
+    qsort(vec, len, sizeof(*vec), yang_descpair_cmp);
+    if ((idx = clicon_hash_init()) == NULL)
+	goto done;
+    if (len && (ys = malloc(len*sizeof(yang_stmt *))) == NULL){
+	clicon_err(OE_YANG, errno, "malloc");
+	goto done;
+    }
+    for (i=0; i<len; i=j){
+	n = 0;
+	for (j=i; j<len && strcmp(vec[i].yd_name, vec[j].yd_name)==0; j++)
+	    if (n == 0 || ys[n-1] != vec[j].yd_anc)
+		ys[n++] = vec[j].yd_anc;
+	if (clicon_hash_add(idx, vec[i].yd_name, ys, n*sizeof(yang_stmt *)) == NULL)
+	    goto done;
+    }
+    yspec->ys_descidx = idx;
+    idx = NULL;
+    retval = 0;
+ done:
+    if (idx)
+	clicon_hash_free(idx);
+    if (ys)
+	free(ys);
+    if (anc)
+	free(anc);
+    if (vec)
+	free(vec);
+    return retval;
+}
+
+/*! Check if a data node with a given name may occur below a yang node
+ * Used to prune descendant searches (eg xpath //name) of subtrees whose schema
+ * cannot contain the name. The index is built on first use from the yang spec
+ * and freed when the spec changes.
+ * @param[in]  ys    Yang statement, eg container or list
+ * @param[in]  name  Data node name (without prefix)
+ * @retval     1     A descendant data node of ys may be called name (or unknown)
+ * @retval     0     No descendant data node of ys is called name
+ * @note Errors are not reported, 1 is returned instead
+ */
+int
+yang_descendant_name(yang_stmt *ys,
+		     char      *name)
+{
+    yang_stmt  *yspec;
+    yang_stmt **vec;
+    size_t      vlen;
+
+    if ((yspec = ys_spec(ys)) == NULL)
+	return 1;
+    if (yspec->ys_descidx == NULL &&
+	yang_descidx_build(yspec) < 0)
+	return 1;
+    if ((vec = clicon_hash_value(yspec->ys_descidx, "*", &vlen)) != NULL &&
+	bsearch(&ys, vec, vlen/sizeof(yang_stmt *), sizeof(yang_stmt *), yang_ptr_cmp) != NULL)
+	return 1;
+    if ((vec = clicon_hash_value(yspec->ys_descidx, name, &vlen)) != NULL &&
+	bsearch(&ys, vec, vlen/sizeof(yang_stmt *), sizeof(yang_stmt *), yang_ptr_cmp) != NULL)
+	return 1;
+    return 0;
+}
+
 /*! Reset flag in complete tree, arg contains flag */
 static int
 ys_flag_reset(yang_stmt *ys, 
@@ -2693,6 +3038,38 @@ yang_parse_recurse(clicon_handle h,
     return retval; /* top-level (sub)module */
 }
 
+/*! Compile xpath argument of must, when and leafref path statements
+ * Done once so that validation neither parses xpaths nor creates namespace
+ * contexts. An xpath that cannot be parsed is left uncompiled, it is then 
+ * parsed (and fails) when validated.
+ * @param[in] ys      Yang statement
+ * @param[in] dummy   Necessary for called in yang_apply
+ * @see yang_apply_fn
+ */
+static int 
+ys_compile(yang_stmt *ys,
+	   void      *dummy)
+{
+    switch (ys->ys_keyword){
+    case Y_PATH:
+	if (ys->ys_nsc == NULL &&
+	    xml_nsctx_yang(ys, &ys->ys_nsc) < 0)
+	    return -1;
+	/* fall thru */
+    case Y_MUST:
+    case Y_WHEN:
+	if (ys->ys_xpath == NULL &&
+	    xpath_parse(ys->ys_argument, &ys->ys_xpath) < 0){
+	    ys->ys_xpath = NULL;
+	    clicon_err_reset();
+	}
+	break;
+    default:
+	break;
+    }
+    return 0;
+}
+
 /*!
  * @param[in] ys      Yang statement
  * @param[in] dummy   Necessary for called in yang_apply
@@ -2930,6 +3307,20 @@ yang_parse_post(clicon_handle h,
     for (i=modnr; i<yspec->ys_len; i++)
 	if (yang_apply(yspec->ys_stmt[i], -1, ys_schemanode_check, NULL) < 0)
 	    goto done;
+
+    /* 9: Precompute yang order of all data nodes, also earlier modules since
+     * augments may have changed them */
+    if (yang_order_compute(yspec) < 0)
+	goto done;
+
+    /* 10: Name indexes are built on demand from the new spec */
+    yang_descidx_free(yspec);
+
+    /* 11: Compile must/when/path xpaths, also earlier modules since augments
+     * may have added statements to them */
+    for (i=0; i<yspec->ys_len; i++)
+	if (yang_apply(yspec->ys_stmt[i], -1, ys_compile, NULL) < 0)
+	    goto done;
     retval = 0;
  done:
     return retval;
@@ -50,6 +50,9 @@
 
 
 #define YANG_FLAG_MARK 0x01  /* Marker for dynamic algorithms, eg expand */
+#define YANG_FLAG_DEP  0x02  /* must/when/leafref affected by a change,
+				see xml_yang_validate_changed */
+#define YANG_FLAG_DEPANC 0x04 /* Ancestor of YANG_FLAG_DEP node */
 
 /*! Yang type cache. Yang type statements can cache all typedef info here
  * @note unions not cached
@@ -99,6 +102,18 @@ struct yang_stmt{
 				     */
     yang_type_cache   *ys_typecache; /* If ys_keyword==Y_TYPE, cache all typedef data except unions */
     int               _ys_vector_i;   /* internal use: yn_each */
+    int                ys_order;     /* Cached yang_order(), see yang_order_compute */
+    clicon_hash_t     *ys_descidx;   /* If ys_keyword==Y_SPEC, cache of data node
+					names to their ancestor schema nodes,
+					see yang_descendant_name */
+    clicon_hash_t     *ys_depidx;    /* If ys_keyword==Y_SPEC, index of data
+					node names to the schema nodes whose
+					must/when/leafref refer to them,
+					see xml_yang_validate_changed */
+    struct xpath_tree *ys_xpath;     /* If ys_keyword is Y_MUST, Y_WHEN or Y_PATH,
+					compiled argument, see ys_compile */
+    cvec              *ys_nsc;       /* If ys_keyword==Y_PATH, namespace
+					context of argument */
 };
 
 /* Yang data definition statement
@@ -163,6 +163,150 @@ expectfn "$clixon_util_datastore $conf lock 756" 0 ""
 
 #leaf-list
 
+# Tree format: binary block file, only changed records are written
+conf="-d candidate -b $mydir -y $dir/ietf-ip.yang -f tree"
+xml2=$(echo "$xml" | sed -e 's/astring/bstring/')
+
+new "datastore tree init"
+expectfn "$clixon_util_datastore $conf delete" 0 ""
+expectfn "$clixon_util_datastore $conf init" 0 ""
+
+new "datastore tree put all replace"
+ret=$($clixon_util_datastore $conf put replace "$xml")
+expectmatch "$ret" $? "0" ""
+
+new "datastore tree get"
+expectfn "$clixon_util_datastore $conf get /" 0 "^$xml$"
+
+cp $mydir/candidate_db $mydir/snapshot
+
+new "datastore tree put leaf merge"
+expectfn "$clixon_util_datastore $conf put merge <config><x xmlns=\"urn:example:clixon\"><g>bstring</g></x></config>" 0 ""
+
+new "datastore tree get changed"
+expectfn "$clixon_util_datastore $conf get /" 0 "^$xml2$"
+
+# Records are written to free blocks, only the superblock refers to them
+new "datastore tree crash before superblock write leaves previous tree"
+cp $mydir/candidate_db $mydir/written
+dd if=$mydir/snapshot of=$mydir/candidate_db bs=32 count=2 conv=notrunc 2> /dev/null
+expectfn "$clixon_util_datastore $conf get /" 0 "^$xml$"
+
+# Init and full write is generation 1 in slot 1, the merge is generation 2 in slot 0
+new "datastore tree torn superblock leaves previous tree"
+cp $mydir/written $mydir/candidate_db
+printf 'XXXX' | dd of=$mydir/candidate_db bs=1 seek=20 conv=notrunc 2> /dev/null
+expectfn "$clixon_util_datastore $conf get /" 0 "^$xml$"
+cp $mydir/written $mydir/candidate_db
+
+size=$(stat -c %s $mydir/candidate_db)
+
+new "datastore tree put leaf merge twice"
+expectfn "$clixon_util_datastore $conf put merge <config><x xmlns=\"urn:example:clixon\"><g>cstring</g></x></config>" 0 ""
+expectfn "$clixon_util_datastore $conf put merge <config><x xmlns=\"urn:example:clixon\"><g>bstring</g></x></config>" 0 ""
+
+new "datastore tree blocks of old records reused"
+if [ $(stat -c %s $mydir/candidate_db) -gt $size ]; then
+    err "$size" "$(stat -c %s $mydir/candidate_db)"
+fi
+rm -f $mydir/snapshot $mydir/written
+
+new "datastore tree get changed back"
+expectfn "$clixon_util_datastore $conf get /" 0 "^$xml2$"
+
+new "datastore tree get top-level subtree"
+expectfn "$clixon_util_datastore $conf get /x/g" 0 "^<config><x xmlns=\"urn:example:clixon\"><g>bstring</g></x></config>$"
+
+new "datastore tree remove and add list entries"
+expectfn "$clixon_util_datastore $conf put remove <config><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>2</b></y></x></config>" 0 ""
+expectfn "$clixon_util_datastore $conf put merge <config><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>2</b><c>first-entry</c></y></x></config>" 0 ""
+
+new "datastore tree get after reuse"
+expectfn "$clixon_util_datastore $conf get /" 0 "^$xml2$"
+
+new "datastore tree lazy get top-level subtree"
+expectfn "$clixon_util_datastore $conf -l get /x/g" 0 "^<config><x xmlns=\"urn:example:clixon\"><g>bstring</g></x></config>$"
+
+new "datastore tree lazy only root resident"
+expectfn "$clixon_util_datastore $conf -l resident /y" 0 "^resident: 1/[0-9]+$"
+
+new "datastore tree lazy subtree resident"
+expectfn "$clixon_util_datastore $conf -l resident /x" 0 "^resident: ([2-9]|[1-9][0-9]+)/[0-9]+$"
+
+new "datastore tree lazy put merge"
+expectfn "$clixon_util_datastore $conf -l put merge <config><x xmlns=\"urn:example:clixon\"><g>astring</g></x></config>" 0 ""
+
+new "datastore tree get after lazy put"
+expectfn "$clixon_util_datastore $conf get /" 0 "^$xml$"
+
+new "datastore tree corrupt superblocks"
+printf 'X' | dd of=$mydir/candidate_db bs=1 seek=10 conv=notrunc 2> /dev/null
+printf 'X' | dd of=$mydir/candidate_db bs=1 seek=42 conv=notrunc 2> /dev/null
+expectfn "$clixon_util_datastore $conf get /" 0 ""
+
+# Journal format: edits are appended to <db>.journal, replayed on read
+conf="-d candidate -b $mydir -y $dir/ietf-ip.yang -f journal"
+xml2=$(echo "$xml" | sed -e 's/astring/bstring/')
+
+new "datastore journal init"
+expectfn "$clixon_util_datastore $conf delete" 0 ""
+expectfn "$clixon_util_datastore $conf init" 0 ""
+
+new "datastore journal put all replace"
+ret=$($clixon_util_datastore $conf put replace "$xml")
+expectmatch "$ret" $? "0" ""
+
+new "datastore journal get"
+expectfn "$clixon_util_datastore $conf get /" 0 "^$xml$"
+
+cp $mydir/candidate_db $mydir/snapshot
+
+new "datastore journal put leaf merge"
+expectfn "$clixon_util_datastore $conf put merge <config><x xmlns=\"urn:example:clixon\"><g>bstring</g></x></config>" 0 ""
+
+new "datastore journal snapshot not rewritten"
+if ! cmp -s $mydir/candidate_db $mydir/snapshot; then
+    err "unchanged snapshot" "$mydir/candidate_db changed"
+fi
+if [ ! -s $mydir/candidate_db.journal ]; then
+    err "$mydir/candidate_db.journal" "no journal"
+fi
+
+new "datastore journal get replayed"
+expectfn "$clixon_util_datastore $conf get /" 0 "^$xml2$"
+
+new "datastore journal truncated record ignored"
+echo -n "4711 merge 00000000" >> $mydir/candidate_db.journal
+expectfn "$clixon_util_datastore $conf get /" 0 "^$xml2$"
+
+new "datastore journal truncated record removed"
+if grep -q 4711 $mydir/candidate_db.journal; then
+    err "no truncated record" "$(cat $mydir/candidate_db.journal)"
+fi
+
+new "datastore journal put after truncated record"
+echo -n "4711 merge 00000000" >> $mydir/candidate_db.journal
+expectfn "$clixon_util_datastore $conf put merge <config><x xmlns=\"urn:example:clixon\"><g>cstring</g></x></config>" 0 ""
+
+new "datastore journal record after truncated record replayed"
+xml3=$(echo "$xml" | sed -e 's/astring/cstring/')
+expectfn "$clixon_util_datastore $conf get /" 0 "^$xml3$"
+
+new "datastore journal put back"
+expectfn "$clixon_util_datastore $conf put merge <config><x xmlns=\"urn:example:clixon\"><g>bstring</g></x></config>" 0 ""
+
+new "datastore journal copy"
+expectfn "$clixon_util_datastore $conf copy kalle" 0 ""
+
+new "datastore journal get copy"
+expectfn "$clixon_util_datastore -d kalle -b $mydir -y $dir/ietf-ip.yang -f journal get /" 0 "^$xml2$"
+
+new "datastore journal delete"
+expectfn "$clixon_util_datastore $conf delete" 0 ""
+if [ -f $mydir/candidate_db.journal ]; then
+    err "no journal" "$mydir/candidate_db.journal"
+fi
+
 rm -rf $mydir
 
 rm -rf $dir
@@ -80,6 +80,33 @@ module example{
             }
         }
     }
+    container rel {
+        description "Relative leafrefs in large lists";
+        list target{
+            key name;
+            leaf name{
+                type string;
+            }
+        }
+        list ref{
+            key name;
+            leaf name{
+                type string;
+            }
+            leaf target{
+                description "Context node shared by all ref entries";
+                type leafref{
+                    path "../../target/name";
+                }
+            }
+            leaf self{
+                description "Context node of each ref entry";
+                type leafref{
+                    path "../name";
+                }
+            }
+        }
+    }
 }
 EOF
 
@@ -176,6 +203,62 @@ expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><validate><source><candidate/></sou
 new "leafref discard-changes"
 expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><discard-changes/></rpc>]]>]]>" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
 
+# Only changes are validated in a commit: references to a deleted interface
+# are not changed themselves
+new "leafref add relref and commit"
+expecteof "$clixon_netconf -qf $cfg" 0 '<rpc><edit-config><target><candidate/></target><config><default-address xmlns="urn:example:clixon"><relname>lo</relname></default-address></config></edit-config></rpc>]]>]]>' '^<rpc-reply><ok/></rpc-reply>]]>]]>$'
+
+new "leafref commit relref"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><commit/></rpc>]]>]]>" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+new "leafref delete referenced interface"
+expecteof "$clixon_netconf -qf $cfg" 0 '<rpc><edit-config><target><candidate/></target><config><interfaces xmlns="urn:ietf:params:xml:ns:yang:ietf-interfaces" xmlns:nc="urn:ietf:params:xml:ns:netconf:base:1.0"><interface nc:operation="delete"><name>lo</name></interface></interfaces></config></edit-config></rpc>]]>]]>' '^<rpc-reply><ok/></rpc-reply>'
+
+new "leafref commit (should fail)"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><commit/></rpc>]]>]]>" '^<rpc-reply><rpc-error><error-type>application</error-type><error-tag>bad-element</error-tag><error-info><bad-element>lo</bad-element></error-info><error-severity>error</error-severity><error-message>Leafref validation failed: No such leaf</error-message></rpc-error></rpc-reply>]]>]]>$'
+
+new "leafref discard-changes"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><discard-changes/></rpc>]]>]]>" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+# Many relative leafrefs with the same path and a shared context node
+fconfig=$dir/rel.xml
+new "generate config with 1000 relative leafrefs"
+{ echo -n '<rpc><edit-config><target><candidate/></target><config><rel xmlns="urn:example:clixon">'
+for (( i=0; i<1000; i++ )); do
+    echo -n "<target><name>t$i</name></target>"
+done
+for (( i=0; i<1000; i++ )); do
+    echo -n "<ref><name>r$i</name><target>t$(( (i*7)%1000 ))</target><self>r$i</self></ref>"
+done
+echo '</rel></config></edit-config></rpc>]]>]]>'; } > $fconfig
+
+new "leafref write relative leafrefs"
+expecteof_file "$clixon_netconf -qf $cfg" 0 "$fconfig" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+new "leafref validate relative leafrefs (ok)"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+new "leafref add relative leafref to missing target"
+expecteof "$clixon_netconf -qf $cfg" 0 '<rpc><edit-config><target><candidate/></target><config><rel xmlns="urn:example:clixon"><ref><name>r500</name><target>t1000</target></ref></rel></config></edit-config></rpc>]]>]]>' '^<rpc-reply><ok/></rpc-reply>]]>]]>$'
+
+new "leafref validate relative leafrefs (should fail)"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><validate><source><candidate/></source></validate></rpc>]]>]]>" '^<rpc-reply><rpc-error><error-type>application</error-type><error-tag>bad-element</error-tag><error-info><bad-element>t1000</bad-element></error-info><error-severity>error</error-severity><error-message>Leafref validation failed: No such leaf</error-message></rpc-error></rpc-reply>]]>]]>$'
+
+new "leafref discard-changes"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><discard-changes/></rpc>]]>]]>" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+new "leafref write relative leafrefs again"
+expecteof_file "$clixon_netconf -qf $cfg" 0 "$fconfig" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+new "leafref set self leafref to other entry"
+expecteof "$clixon_netconf -qf $cfg" 0 '<rpc><edit-config><target><candidate/></target><config><rel xmlns="urn:example:clixon"><ref><name>r500</name><self>r501</self></ref></rel></config></edit-config></rpc>]]>]]>' '^<rpc-reply><ok/></rpc-reply>]]>]]>$'
+
+new "leafref validate self leafref (should fail)"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><validate><source><candidate/></source></validate></rpc>]]>]]>" '^<rpc-reply><rpc-error><error-type>application</error-type><error-tag>bad-element</error-tag><error-info><bad-element>r501</bad-element></error-info><error-severity>error</error-severity><error-message>Leafref validation failed: No such leaf</error-message></rpc-error></rpc-reply>]]>]]>$'
+
+new "leafref discard-changes"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><discard-changes/></rpc>]]>]]>" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
 new "cli leafref lo"
 expectfn "$clixon_cli -1f $cfg -l o set default-address absname lo" 0 "^$"
 
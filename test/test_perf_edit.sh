@@ -0,0 +1,109 @@
+#!/usr/bin/env bash
+# Edit-config performance test of a large list in a wide yang schema
+# Every sorted insert compares yang order of siblings (see yang_order()), so
+# a schema with many data nodes before the list makes that cost visible.
+# Compare timing of this test between releases.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+# Number of list entries in edit-config
+: ${perfnr:=100000}
+
+# Number of leafs before and after the list, in the container and in the module
+: ${perfwidth:=100}
+
+APPNAME=example
+
+cfg=$dir/scaling-conf.xml
+fyang=$dir/scaling.yang
+fconfig=$dir/large.xml
+
+echo "module scaling{" > $fyang
+echo "   yang-version 1.1;" >> $fyang
+echo "   namespace \"urn:example:clixon\";" >> $fyang
+echo "   prefix ex;" >> $fyang
+for (( i=0; i<$perfwidth; i++ )); do  
+    echo "   leaf t$i { type string; }" >> $fyang
+done
+echo "   container x {" >> $fyang
+for (( i=0; i<$perfwidth; i++ )); do  
+    echo "      leaf p$i { type string; }" >> $fyang
+done
+cat <<EOF >> $fyang
+      list y {
+         key "a";
+         leaf a {
+            type int32;
+         }
+         leaf b {
+            type int32;
+         }
+      }
+EOF
+for (( i=0; i<$perfwidth; i++ )); do  
+    echo "      leaf q$i { type string; }" >> $fyang
+done
+echo "   }" >> $fyang
+echo "}" >> $fyang
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>$dir</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/example/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_XMLDB_PRETTY>false</CLICON_XMLDB_PRETTY>
+  <CLICON_FEATURE>ietf-netconf:startup</CLICON_FEATURE>
+</clixon-config>
+EOF
+
+new "test params: -f $cfg"
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "waiting"
+wait_backend
+
+new "generate config with $perfnr list entries in reverse order"
+echo -n "<rpc><edit-config><target><candidate/></target><config><x xmlns=\"urn:example:clixon\"><p0>p</p0><q0>q</q0>" > $fconfig
+for (( i=$perfnr; i>0; i-- )); do  
+    echo -n "<y><a>$i</a><b>$i</b></y>" >> $fconfig
+done
+echo "</x></config></edit-config></rpc>]]>]]>" >> $fconfig
+
+new "netconf edit-config $perfnr entries"
+expecteof_file "time $clixon_netconf -qf $cfg" 0 "$fconfig" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+# Here, there are $perfnr entries in candidate, the same are merged again
+new "netconf edit-config $perfnr entries again"
+expecteof_file "time $clixon_netconf -qf $cfg" 0 "$fconfig" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+new "netconf commit $perfnr entries"
+expecteof "time $clixon_netconf -qf $cfg" 0 "<rpc><commit/></rpc>]]>]]>" "^<rpc-reply><ok/></rpc-reply>]]>]]>$" 
+
+if [ $BE -eq 0 ]; then
+    exit # BE
+fi
+
+new "Kill backend"
+# Check if premature kill
+pid=$(pgrep -u root -f clixon_backend)
+if [ -z "$pid" ]; then
+    err "backend already dead"
+fi
+# kill backend
+stop_backend -f $cfg
+
+rm -rf $dir
@@ -5,8 +5,11 @@
 s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
 
 # Number of list/leaf-list entries in file
+# Eg run with perfnr=100000 or perfnr=1000000 to measure large file reading
 : ${perfnr:=10000}
 
+: ${clixon_util_xml:="clixon_util_xml"}
+
 APPNAME=example
 
 cfg=$dir/scaling-conf.xml
@@ -73,6 +76,10 @@ for (( i=0; i<$perfnr; i++ )); do
 done
 echo "</x></config>" >> $tmpx
 
+# Measure file reading and parsing only (no backend or yang)
+new "Parse startup file with $perfnr entries"
+{ time -p $clixon_util_xml -f $tmpx > /dev/null; } 2>&1 | awk '/real/ {print $2}'
+
 if false; then # XXX JSON dont work as datastore yet
 # Then generate large JSON file (cant translate namespace - long story)
 tmpj=$dir/tmp.json
@@ -89,6 +96,19 @@ done
 echo "]}}}" >> $tmpj
 fi
 
+# Measure datastore load and small edits in each format (no backend)
+for format in tree xml journal; do
+    file=$dir/candidate_db
+    rm -f $file ${file}.journal
+    clixon_util_datastore -d candidate -f $format -y $fyang -b $dir -x $tmpx put create
+    new "Datastore format: $format load and 100 merges"
+    clixon_util_datastore -d candidate -f $format -y $fyang -b $dir bench 100 "<config><x xmlns=\"urn:example:clixon\"><y><a>%d</a><b>0</b></y></x></config>"
+    if [ $format = tree ]; then
+	new "Datastore format: $format lazy load and 100 merges"
+	clixon_util_datastore -d candidate -f $format -l -y $fyang -b $dir bench 100 "<config><x xmlns=\"urn:example:clixon\"><y><a>%d</a><b>1</b></y></x></config>"
+    fi
+done
+
 # Loop over mode and format
 for mode in startup running; do
     file=$dir/${mode}_db
@@ -5,6 +5,8 @@
 s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
 
 : ${clixon_util_xml:="clixon_util_xml"}
+: ${clixon_util_insert:="clixon_util_insert"}
+: ${clixon_util_xpath:="clixon_util_xpath"}
 
 # Number of list/leaf-list entries in file
 : ${perfnr:=30000}
@@ -24,5 +26,90 @@ echo "]]></stdout></rpc-reply>" >> $fxml
 new "xml parse long CDATA"
 expecteof_file "time $clixon_util_xml" 0 "$fxml"
 
+# Memory usage per list entry: parse two files with $perfnr and 2*$perfnr list
+# entries and divide the difference in max resident size by $perfnr
+fmem=$dir/mem.xml
+
+# Generate file with list entries
+# 1: Number of entries
+genlist(){
+    echo -n "<config><x>" > $fmem
+    for (( i=0; i<$1; i++ )); do  
+	echo -n "<y><a>$i</a><b>$i</b></y>" >> $fmem
+    done
+    echo "</x></config>" >> $fmem
+}
+
+if [ -x /usr/bin/time ]; then
+    new "xml memory per list entry"
+    genlist $perfnr
+    rss1=$(/usr/bin/time -f %M $clixon_util_xml -f $fmem 2>&1 >/dev/null | tail -1)
+    genlist $((2*$perfnr))
+    rss2=$(/usr/bin/time -f %M $clixon_util_xml -f $fmem 2>&1 >/dev/null | tail -1)
+    if ! [ "$rss1" -gt 0 -a "$rss2" -gt 0 ] 2> /dev/null; then
+	err "max resident size" "$rss1 $rss2"
+    fi
+    echo "bytes per list entry: $(( ($rss2 - $rss1) * 1024 / $perfnr ))"
+fi
+
+# XPATH returning all list entries, see cxvec_append_max()
+genlist $perfnr
+new "xpath //y over $perfnr list entries"
+ret=$($clixon_util_xpath -f $fmem -p //y -t 1)
+if ! expr "$ret" : "1 evaluations, $perfnr nodes:" > /dev/null; then
+    err "1 evaluations, $perfnr nodes:" "$ret"
+fi
+echo "$ret"
+
+# XPATH predicate over all list entries, with and without evaluation arena
+new "xpath //y[b=42] context allocations with and without arena"
+ret=$($clixon_util_xpath -f $fmem -p "//y[b=42]" -t 1)
+echo "$ret"
+n1=$(echo "$ret" | sed -n 's/ context allocations$//p')
+ret=$($clixon_util_xpath -A -f $fmem -p "//y[b=42]" -t 1)
+echo "$ret"
+n2=$(echo "$ret" | sed -n 's/ context allocations$//p')
+if ! [ "$n1" -lt "$n2" ] 2> /dev/null; then
+    err "arena allocations less than $n2" "$n1"
+fi
+
+# Sorted insert of list entries with random keys, see xml_insert()
+fyang=$dir/example.yang
+cat <<EOF > $fyang
+module example {
+    yang-version 1.1;
+    namespace "urn:example:example";
+    prefix ex;
+    container c{
+      list a{
+	key x;
+	leaf x{
+	    type int32;
+	}
+      }
+    }
+}
+EOF
+
+new "xml insert $perfnr random list entries"
+ret=$($clixon_util_insert -y $fyang -b "<c xmlns=\"urn:example:example\"/>" -x "<c xmlns=\"urn:example:example\"><a><x>0</x></a></c>" -p c -n $perfnr)
+if ! expr "$ret" : "$perfnr inserts:" > /dev/null; then
+    err "$perfnr inserts:" "$ret"
+fi
+echo "$ret"
+
+# XPATH list entry lookup by key, see xpath_list_optimize()
+echo -n "<c xmlns=\"urn:example:example\">" > $fmem
+for (( i=0; i<$perfnr; i++ )); do  
+    echo -n "<a><x>$i</x></a>" >> $fmem
+done
+echo "</c>" >> $fmem
+new "xpath list key lookup among $perfnr list entries"
+ret=$($clixon_util_xpath -y $fyang -f $fmem -p "c/a[x=42]" -t 1000)
+if ! expr "$ret" : "1000 evaluations, 1 nodes:" > /dev/null; then
+    err "1000 evaluations, 1 nodes:" "$ret"
+fi
+echo "$ret"
+
 rm -rf $dir
 
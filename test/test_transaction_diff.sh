@@ -0,0 +1,191 @@
+#!/usr/bin/env bash
+# Transaction vectors of incremental diff vs full diff
+# A commit where candidate and running share an edit base only diffs the
+# edited nodes (xml_diff_edit). Check that the add/del/change vectors logged
+# by the example backend plugin are the same as those of the full xml_diff.
+# The full diff is forced by restarting the backend with -s none, so that
+# candidate and running are read from file and have no common edit base.
+# Edits are made deep in a nested list: edit, add, delete, replace and default
+# change.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/trans.yang
+flog=$dir/backend.log
+touch $flog
+
+cat <<EOF > $fyang
+module trans{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   container x {
+    list y {
+      key "a";
+      leaf a {
+        type int32;
+      }
+      container deep {
+        list z {
+          key "k";
+          leaf k {
+            type int32;
+          }
+          leaf v {
+            type int32;
+          }
+          leaf w {
+            type int32;
+            default 7;
+          }
+        }
+      }
+    }
+  }
+}
+EOF
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_SOCK>$dir/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+</clixon-config>
+EOF
+
+# Base config: three y entries with three z entries each
+base="<x xmlns='urn:example:clixon'>"
+for a in 1 2 3; do
+    base="$base<y><a>$a</a><deep>"
+    for k in 1 2 3; do
+	base="$base<z><k>$k</k><v>$k</v></z>"
+    done
+    base="$base</deep></y>"
+done
+base="$base</x>"
+
+# Restart backend, -s none keeps the datastores
+# Arguments: startup mode
+restart(){
+    mode=$1
+    if [ $BE -eq 0 ]; then
+	return
+    fi
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s $mode -f $cfg -l f$flog -- -t"
+    start_backend -s $mode -f $cfg -l f$flog -- -t # -t means transaction logging
+
+    new "waiting"
+    wait_backend
+}
+
+# Replace candidate with base config and commit
+setbase(){
+    new "netconf replace base config"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><edit-config><target><candidate/></target><default-operation>replace</default-operation><config>$base</config></edit-config></rpc>]]>]]>" '^<rpc-reply><ok/></rpc-reply>]]>]]>$'
+
+    new "netconf commit base config"
+    expecteof "$clixon_netconf -qf $cfg" 0 '<rpc><commit/></rpc>]]>]]>' '^<rpc-reply><ok/></rpc-reply>]]>]]>$'
+}
+
+# Edit candidate and commit, the transaction vectors of the main plugin
+# (without transaction id) are left in ret
+# Arguments: edit-config config
+commit(){
+    edit=$1
+    l0=$(wc -l < $flog)
+    new "netconf edit $edit"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><edit-config><target><candidate/></target><config><x xmlns='urn:example:clixon' xmlns:nc='urn:ietf:params:xml:ns:netconf:base:1.0'>$edit</x></config></edit-config></rpc>]]>]]>" '^<rpc-reply><ok/></rpc-reply>]]>]]>$'
+
+    new "netconf commit edit"
+    expecteof "$clixon_netconf -qf $cfg" 0 '<rpc><commit/></rpc>]]>]]>' '^<rpc-reply><ok/></rpc-reply>]]>]]>$'
+    ret=$(tail -n +$((l0+1)) $flog | sed -n 's/.*transaction_log [0-9]* \(main_.*\)$/\1/p')
+}
+
+# Commit an edit incrementally and with full diff and compare vectors
+# Arguments: test name, edit-config config, expected part of vectors
+diffcheck(){
+    name=$1
+    edit=$2
+    expect=$3
+
+    new "$name incremental diff"
+    commit "$edit"
+    incr=$ret
+    match=$(echo "$incr" | grep -F -- "$expect")
+    if [ -z "$match" ]; then
+	err "$expect" "$incr"
+    fi
+
+    setbase
+    restart none
+
+    new "$name full diff"
+    commit "$edit"
+    if [ "$ret" != "$incr" ]; then
+	err "$ret" "$incr"
+    fi
+
+    setbase
+}
+
+new "test params: -f $cfg -l f$flog -- -t"
+
+restart init
+
+setbase
+
+diffcheck "edit deep list leaf" \
+	  "<y><a>2</a><deep><z><k>2</k><v>42</v></z></deep></y>" \
+	  "main_commit change: <v>2</v><v>42</v>"
+
+diffcheck "add deep list entry" \
+	  "<y><a>3</a><deep><z><k>4</k><v>4</v></z></deep></y>" \
+	  "main_commit add: <z><k>4</k><v>4</v>"
+
+diffcheck "delete deep list entry" \
+	  "<y><a>2</a><deep><z nc:operation='delete'><k>3</k></z></deep></y>" \
+	  "main_commit del: <z><k>3</k><v>3</v>"
+
+diffcheck "replace deep list entry" \
+	  "<y><a>2</a><deep><z nc:operation='replace'><k>2</k><v>43</v></z></deep></y>" \
+	  "main_commit change: <v>2</v><v>43</v>"
+
+diffcheck "change deep default" \
+	  "<y><a>1</a><deep><z><k>1</k><w>8</w></z></deep></y>" \
+	  "<w>8</w>"
+
+# Start from an explicit non-default value and remove it
+base=$(echo "$base" | sed 's#<k>1</k><v>1</v>#<k>1</k><v>1</v><w>8</w>#')
+setbase
+
+diffcheck "remove deep default" \
+	  "<y><a>1</a><deep><z><k>1</k><w nc:operation='remove'/></z></deep></y>" \
+	  "<w>8</w>"
+
+if [ $BE -eq 0 ]; then
+    exit # BE
+fi
+
+new "Kill backend"
+# Check if premature kill
+pid=$(pgrep -u root -f clixon_backend)
+if [ -z "$pid" ]; then
+    err "backend already dead"
+fi
+# kill backend
+stop_backend -f $cfg
+
+rm -rf $dir
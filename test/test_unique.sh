@@ -5,7 +5,9 @@
 # The test adds the rfc conf that fails, then one that passes, then makes add
 # to fail it and then del to pass it.
 # Then makes a fail / pass test on the single field case
-# Last, a complex unsorted list with several sub-elements.
+# Then a complex unsorted list with several sub-elements.
+# Last, a list with many entries, valid and with a duplicate of an entry in
+# the middle of the list.
 
 # Magic line must be first in script (see README.md)
 s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
@@ -210,6 +212,30 @@ expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><validate><source><candidate/></sou
 new "netconf discard-changes"
 expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><discard-changes/></rpc>]]>]]>" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
 
+# List with many entries where the duplicate is not adjacent to its original
+fconfig=$dir/many.xml
+new "generate config with 200 server entries"
+{ echo -n '<rpc><edit-config><target><candidate/></target><default-operation>replace</default-operation><config><c xmlns="urn:example:clixon">'
+for (( i=0; i<200; i++ )); do
+    echo -n "<server><name>s$i</name><ip>10.0.0.$i</ip><port>25</port></server>"
+done
+echo '</c></config></edit-config></rpc>]]>]]>'; } > $fconfig
+
+new "netconf write config with many entries"
+expecteof_file "$clixon_netconf -qf $cfg" 0 "$fconfig" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+new "netconf validate many entries ok"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+new "add duplicate of entry in the middle"
+expecteof "$clixon_netconf -qf $cfg" 0 '<rpc><edit-config><target><candidate/></target><config><c xmlns="urn:example:clixon"><server><name>z</name><ip>10.0.0.100</ip><port>25</port></server></c></config></edit-config></rpc>]]>]]>' "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+new "netconf validate many entries (should fail)"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><validate><source><candidate/></source></validate></rpc>]]>]]>" '^<rpc-reply><rpc-error><error-type>protocol</error-type><error-tag>operation-failed</error-tag><error-app-tag>data-not-unique</error-app-tag><error-severity>error</error-severity><error-info><non-unique><ip>10.0.0.100</ip></non-unique><non-unique><port>25</port></non-unique></error-info></rpc-error></rpc-reply>]]>]]>$'
+
+new "netconf discard-changes"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><discard-changes/></rpc>]]>]]>" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
 if [ $BE -eq 0 ]; then
     exit # BE
 fi
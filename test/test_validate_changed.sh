@@ -0,0 +1,240 @@
+#!/usr/bin/env bash
+# Incremental validation of changed subtrees
+# When candidate and running share an edit base only the parts of candidate
+# affected by the edits are validated (xml_yang_validate_changed).
+# Check constraints that fail on a node outside of the edited subtree:
+# - must referring to another top-level subtree
+# - when on an unchanged node whose condition node changes
+# - unique, min-elements and max-elements violated by a sibling edit
+# Each error must be the same as that of full validation, which is forced by
+# restarting the backend with -s none so that candidate and running are read
+# from file and have no common edit base.
+# Also check that an invalid running read with -s none is not trusted.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/changed.yang
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module changed{
+  yang-version 1.1;
+  namespace "urn:example:clixon";
+  prefix ex;
+  container a{
+     leaf x {
+       type int32;
+       must "/b/y < 10" {
+         error-message "y must be less than 10";
+       }
+     }
+     leaf z {
+       type int32;
+       must "count(/e/*) < 3" {
+         error-message "e must have less than 3 children";
+       }
+     }
+  }
+  container b{
+     leaf y {
+       type int32;
+     }
+  }
+  container c{
+     leaf mode {
+       type string;
+     }
+     leaf extra {
+       when "../mode = 'on'";
+       type string;
+     }
+  }
+  container d{
+     list server {
+       key "name";
+       unique "ip";
+       min-elements 2;
+       max-elements 3;
+       leaf name {
+         type string;
+       }
+       leaf ip {
+         type string;
+       }
+     }
+  }
+  container e{
+     leaf p {
+       type int32;
+     }
+     leaf q {
+       type int32;
+     }
+     leaf r {
+       type int32;
+     }
+  }
+}
+EOF
+
+# Valid base config
+base='<a xmlns="urn:example:clixon"><x>1</x><z>1</z></a><b xmlns="urn:example:clixon"><y>1</y></b><c xmlns="urn:example:clixon"><mode>on</mode><extra>e</extra></c><d xmlns="urn:example:clixon"><server><name>s1</name><ip>10.0.0.1</ip></server><server><name>s2</name><ip>10.0.0.2</ip></server></d><e xmlns="urn:example:clixon"><p>1</p><q>1</q></e>'
+
+# Restart backend without touching the datastores
+restart(){
+    if [ $BE -eq 0 ]; then
+	return
+    fi
+    new "kill old backend"
+    stop_backend -f $cfg
+
+    new "start backend -s none -f $cfg"
+    start_backend -s none -f $cfg
+
+    new "waiting"
+    wait_backend
+}
+
+# Validate candidate, the reply is left in ret
+validate(){
+    ret=$(echo "<rpc><validate><source><candidate/></source></validate></rpc>]]>]]>" | $clixon_netconf -qf $cfg)
+}
+
+# Edit a valid committed base config, validate it incrementally and check
+# the error, then validate it fully and check that the error is the same
+# Arguments: test name, edit-config config, expected error
+changed(){
+    name=$1
+    edit=$2
+    expect=$3
+
+    new "$name: replace base config"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><edit-config><target><candidate/></target><default-operation>replace</default-operation><config>$base</config></edit-config></rpc>]]>]]>" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+    new "$name: commit base config"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><commit/></rpc>]]>]]>" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+    new "$name: edit"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><edit-config><target><candidate/></target><config>$edit</config></edit-config></rpc>]]>]]>" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+    new "$name: incremental validate fail"
+    validate
+    incr=$ret
+    match=$(echo "$incr" | grep --null -o "$expect")
+    if [ -z "$match" ]; then
+	err "$expect" "$incr"
+    fi
+
+    restart
+
+    new "$name: full validate same as incremental"
+    validate
+    if [ "$ret" != "$incr" ]; then
+	err "$incr" "$ret"
+    fi
+
+    new "$name: discard-changes"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><discard-changes/></rpc>]]>]]>" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+}
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+
+    new "waiting"
+    wait_backend
+fi
+
+changed "must other top-level" \
+	'<b xmlns="urn:example:clixon"><y>20</y></b>' \
+	"<error-message>y must be less than 10</error-message>"
+
+changed "must wildcard other top-level" \
+	'<e xmlns="urn:example:clixon"><r>1</r></e>' \
+	"<error-message>e must have less than 3 children</error-message>"
+
+changed "when condition changed" \
+	'<c xmlns="urn:example:clixon"><mode>off</mode></c>' \
+	"<error-message>when xpath validation failed</error-message>"
+
+changed "unique sibling edit" \
+	'<d xmlns="urn:example:clixon"><server><name>s2</name><ip>10.0.0.1</ip></server></d>' \
+	"<error-app-tag>data-not-unique</error-app-tag>"
+
+changed "max-elements sibling add" \
+	'<d xmlns="urn:example:clixon"><server><name>s3</name><ip>10.0.0.3</ip></server><server><name>s4</name><ip>10.0.0.4</ip></server></d>' \
+	"<error-app-tag>too-many-elements</error-app-tag>"
+
+changed "min-elements sibling delete" \
+	'<d xmlns="urn:example:clixon" xmlns:nc="urn:ietf:params:xml:ns:netconf:base:1.0"><server nc:operation="delete"><name>s2</name></server></d>' \
+	"<error-app-tag>too-few-elements</error-app-tag>"
+
+if [ $BE -eq 0 ]; then
+    exit # BE
+fi
+
+# Running read from file with -s none has never been validated, and is no edit
+# base for incremental validation. An invalid running must still be found.
+new "kill old backend"
+stop_backend -f $cfg
+
+new "write invalid running"
+sudo tee /usr/local/var/$APPNAME/running_db > /dev/null <<EOF
+<config>$(echo "$base" | sed 's#<y>1</y>#<y>20</y>#')</config>
+EOF
+
+new "start backend -s none -f $cfg"
+start_backend -s none -f $cfg
+
+new "waiting"
+wait_backend
+
+new "edit node unrelated to invalid running"
+expecteof "$clixon_netconf -qf $cfg" 0 '<rpc><edit-config><target><candidate/></target><config><e xmlns="urn:example:clixon"><p>2</p></e></config></edit-config></rpc>]]>]]>' "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+new "validate finds invalid running"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><validate><source><candidate/></source></validate></rpc>]]>]]>" "<error-message>y must be less than 10</error-message>"
+
+new "fix invalid running"
+expecteof "$clixon_netconf -qf $cfg" 0 '<rpc><edit-config><target><candidate/></target><config><b xmlns="urn:example:clixon"><y>1</y></b></config></edit-config></rpc>]]>]]>' "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+new "commit fixed running"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><commit/></rpc>]]>]]>" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+new "edit after commit"
+expecteof "$clixon_netconf -qf $cfg" 0 '<rpc><edit-config><target><candidate/></target><config><e xmlns="urn:example:clixon"><p>3</p></e></config></edit-config></rpc>]]>]]>' "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+new "incremental validate after commit"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+new "Kill backend"
+# Check if premature kill
+pid=$(pgrep -u root -f clixon_backend)
+if [ -z "$pid" ]; then
+    err "backend already dead"
+fi
+# kill backend
+stop_backend -f $cfg
+
+rm -rf $dir
@@ -0,0 +1,203 @@
+#!/usr/bin/env bash
+# Parallel validation using CLICON_VALIDATE_WORKERS worker processes
+# A large top-level list is split in chunks validated by different workers.
+# Check that a valid config validates, that the error of an invalid config
+# is the same as in serial validation, also if workers are killed without
+# result. Workers are killed by the test while validation is running, whether
+# a worker is hit depends on timing, the result must be the same anyway.
+# The backend is restarted with -s none before each validation so that the
+# whole candidate is validated, not only the edits.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+# Number of list entries, several chunks of 1024
+: ${perfnr:=3000}
+
+# Number of validation workers
+: ${nw:=4}
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/workers.yang
+fconfig=$dir/large.xml
+fvalidate=$dir/validate.xml
+pidfile=/usr/local/var/$APPNAME/$APPNAME.pidfile
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>$pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_XMLDB_PRETTY>false</CLICON_XMLDB_PRETTY>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module workers{
+  yang-version 1.1;
+  namespace "urn:example:clixon";
+  prefix wo;
+  container c{
+     list server {
+       key "name";
+       unique "ip";
+       must "port != 0" {
+         error-message "Port must not be zero";
+       }
+       leaf name {
+         type string;
+       }
+       leaf ip {
+         type string;
+       }
+       leaf port {
+         type uint16;
+       }
+     }
+  }
+  container d{
+     leaf x {
+       type int32;
+       must ". < 100" {
+         error-message "x must be less than 100";
+       }
+     }
+  }
+}
+EOF
+
+# Restart backend without touching the datastores
+# Arguments: number of workers
+restart(){
+    nr=$1
+    if [ $BE -eq 0 ]; then
+	return
+    fi
+    new "kill old backend"
+    stop_backend -f $cfg
+
+    new "start backend -s none -f $cfg -o CLICON_VALIDATE_WORKERS=$nr"
+    start_backend -s none -f $cfg -o CLICON_VALIDATE_WORKERS=$nr
+
+    new "waiting"
+    wait_backend
+}
+
+# Validate candidate, the reply is left in ret
+validate(){
+    ret=$(echo "<rpc><validate><source><candidate/></source></validate></rpc>]]>]]>" | $clixon_netconf -qf $cfg)
+}
+
+# Validate candidate while killing the validation workers, ie the child
+# processes of the backend, the reply is left in ret
+killvalidate(){
+    if [ $BE -eq 0 ]; then
+	validate
+	return
+    fi
+    bpid=$(sudo cat $pidfile)
+    echo "<rpc><validate><source><candidate/></source></validate></rpc>]]>]]>" | $clixon_netconf -qf $cfg > $fvalidate &
+    vpid=$!
+    while kill -0 $vpid 2> /dev/null; do
+	sudo pkill -KILL -P $bpid
+    done
+    wait $vpid
+    ret=$(cat $fvalidate)
+}
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+
+    new "waiting"
+    wait_backend
+fi
+
+new "generate config with $perfnr server entries"
+{ echo -n '<rpc><edit-config><target><candidate/></target><default-operation>replace</default-operation><config><c xmlns="urn:example:clixon">'
+for (( i=0; i<$perfnr; i++ )); do
+    echo -n "<server><name>s$i</name><ip>10.$((i/65536)).$((i/256%256)).$((i%256))</ip><port>25</port></server>"
+done
+echo '</c><d xmlns="urn:example:clixon"><x>1</x></d></config></edit-config></rpc>]]>]]>'; } > $fconfig
+
+new "netconf write $perfnr entries"
+expecteof_file "$clixon_netconf -qf $cfg" 0 "$fconfig" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+restart $nw
+
+new "netconf validate $perfnr entries with $nw workers"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+new "netconf commit $perfnr entries with $nw workers"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><commit/></rpc>]]>]]>" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+restart $nw
+
+new "netconf validate $perfnr entries with workers killed"
+killvalidate
+match=$(echo "$ret" | grep --null -o "^<rpc-reply><ok/></rpc-reply>]]>]]>$")
+if [ -z "$match" ]; then
+    err "<rpc-reply><ok/></rpc-reply>]]>]]>" "$ret"
+fi
+
+# Errors in two chunks of the list and in a later top-level node
+new "netconf add invalid entries"
+expecteof "$clixon_netconf -qf $cfg" 0 '<rpc><edit-config><target><candidate/></target><config><c xmlns="urn:example:clixon"><server><name>s2000</name><port>0</port></server><server><name>s999</name><port>0</port></server></c><d xmlns="urn:example:clixon"><x>200</x></d></config></edit-config></rpc>]]>]]>' "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+restart 0
+
+new "netconf validate invalid serial"
+validate
+serial=$ret
+match=$(echo "$serial" | grep --null -o "Port must not be zero")
+if [ -z "$match" ]; then
+    err "Port must not be zero" "$serial"
+fi
+
+restart $nw
+
+new "netconf validate invalid with $nw workers same as serial"
+validate
+if [ "$ret" != "$serial" ]; then
+    err "$serial" "$ret"
+fi
+
+for (( i=0; i<$nw; i++ )); do
+    restart $nw
+
+    new "netconf validate invalid with workers killed same as serial"
+    killvalidate
+    if [ "$ret" != "$serial" ]; then
+	err "$serial" "$ret"
+    fi
+done
+
+new "netconf discard-changes"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc><discard-changes/></rpc>]]>]]>" "^<rpc-reply><ok/></rpc-reply>]]>]]>$"
+
+if [ $BE -eq 0 ]; then
+    exit # BE
+fi
+
+new "Kill backend"
+# Check if premature kill
+pid=$(pgrep -u root -f clixon_backend)
+if [ -z "$pid" ]; then
+    err "backend already dead"
+fi
+# kill backend
+stop_backend -f $cfg
+
+rm -rf $dir
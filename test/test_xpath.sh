@@ -113,6 +113,30 @@ expecteof "$clixon_util_xpath -f $xml -p //bbb[0]" 0 "" "^nodeset:0:<bbb x=\"hel
 new "xpath //bbb[ccc=99]"
 expecteof "$clixon_util_xpath -f $xml -p //bbb[ccc=99]" 0 "" "^nodeset:0:<bbb x=\"bye\"><ccc>99</ccc></bbb>$"
 
+new "xpath preceding-sibling::bbb"
+expecteof "$clixon_util_xpath -f $xml -p /aaa/ddd/preceding-sibling::bbb" 0 "" "^nodeset:0:<bbb x=\"bye\"><ccc>99</ccc></bbb>1:<bbb x=\"hello\"><ccc>42</ccc></bbb>$"
+
+new "xpath following-sibling::ddd (no duplicates)"
+expecteof "$clixon_util_xpath -f $xml -p /aaa/bbb/following-sibling::ddd" 0 "" "^nodeset:0:<ddd><ccc>22</ccc></ddd>$"
+
+new "xpath following::ccc"
+expecteof "$clixon_util_xpath -f $xml -p /aaa/bbb/ccc/following::ccc" 0 "" "^nodeset:0:<ccc>99</ccc>1:<ccc>22</ccc>$"
+
+new "xpath preceding::ccc"
+expecteof "$clixon_util_xpath -f $xml -p /aaa/ddd/ccc/preceding::ccc" 0 "" "^nodeset:0:<ccc>99</ccc>1:<ccc>42</ccc>$"
+
+new "xpath ancestor::ddd"
+expecteof "$clixon_util_xpath -f $xml -p //ccc/ancestor::ddd" 0 "" "^nodeset:0:<ddd><ccc>22</ccc></ddd>$"
+
+new "xpath ancestor-or-self::ccc"
+expecteof "$clixon_util_xpath -f $xml -p /aaa/ddd/ccc/ancestor-or-self::ccc" 0 "" "^nodeset:0:<ccc>22</ccc>$"
+
+new "xpath self::ddd"
+expecteof "$clixon_util_xpath -f $xml -p /aaa/*/self::ddd" 0 "" "^nodeset:0:<ddd><ccc>22</ccc></ddd>$"
+
+new "xpath parent::ddd"
+expecteof "$clixon_util_xpath -f $xml -p //ccc/parent::ddd" 0 "" "^nodeset:0:<ddd><ccc>22</ccc></ddd>$"
+
 new "xpath ../connection-type = 'responder-only'"
 expecteof "$clixon_util_xpath -f $xml2 -p ../connection-type='responder-only' -i /aaa/bbb/here" 0 "" "^bool:true$"
 
@@ -258,4 +282,161 @@ expectpart "$($clixon_util_xpath -c -y $ydir -p /x/j:y -n i:urn:example:a -n j:u
 new "xpath canonical form (wrong namespace should fail)"
 expectpart "$($clixon_util_xpath -c -y $ydir -p /i:x/j:y -n i:urn:example:c -n j:urn:example:b)" 255
 
+# List key predicates resolved by binary search, see xpath_list_optimize()
+cat <<EOF > $ydir/c.yang
+module c{
+  namespace "urn:example:c";
+  prefix c;
+  container c{
+    list l{
+      key "k1 k2";
+      leaf k1{
+        type int32;
+      }
+      leaf k2{
+        type string;
+      }
+      leaf v{
+        type string;
+      }
+    }
+    leaf-list ll{
+      type string;
+    }
+  }
+}
+EOF
+
+xml4=$dir/xml4.xml
+cat <<EOF > $xml4
+<c xmlns="urn:example:c">
+  <l><k1>3</k1><k2>b</k2><v>x</v></l>
+  <l><k1>1</k1><k2>a</k2><v>y</v></l>
+  <l><k1>42</k1><k2>a</k2><v>z</v></l>
+  <l><k1>1</k1><k2>b</k2><v>w</v></l>
+  <ll>foo</ll>
+  <ll>bar</ll>
+</c>
+EOF
+
+# Same result with (default) and without (-o) optimization
+for o in "" "-o"; do
+    new "xpath list keys $o"
+    expecteof "$clixon_util_xpath $o -y $ydir -f $xml4 -p c/l[k1=1][k2='b']" 0 "" "^nodeset:0:<l><k1>1</k1><k2>b</k2><v>w</v></l>$"
+
+    new "xpath list keys and $o"
+    expectpart "$($clixon_util_xpath $o -y $ydir -f $xml4 -p "c/l[k2='a' and k1='42']")" 0 "^nodeset:0:<l><k1>42</k1><k2>a</k2><v>z</v></l>$"
+
+    new "xpath list keys and value $o"
+    expecteof "$clixon_util_xpath $o -y $ydir -f $xml4 -p c/l[k1=1][k2='a'][v='y']/v" 0 "" "^nodeset:0:<v>y</v>$"
+
+    new "xpath list keys no match $o"
+    expecteof "$clixon_util_xpath $o -y $ydir -f $xml4 -p c/l[k1=1][k2='c']" 0 "" "^nodeset:$"
+
+    new "xpath list keys other value no match $o"
+    expecteof "$clixon_util_xpath $o -y $ydir -f $xml4 -p c/l[k1=1][k2='a'][v='z']" 0 "" "^nodeset:$"
+
+    new "xpath list one key $o"
+    expecteof "$clixon_util_xpath $o -y $ydir -f $xml4 -p c/l[k1=1]/v" 0 "" "^nodeset:0:<v>y</v>1:<v>w</v>$"
+
+    new "xpath leaf-list $o"
+    expecteof "$clixon_util_xpath $o -y $ydir -f $xml4 -p c/ll[.='foo']" 0 "" "^nodeset:0:<ll>foo</ll>$"
+done
+
+# Unsorted tree bound to yang (-u): key lookups may not use binary search
+for o in "" "-o"; do
+    new "xpath unsorted list keys $o"
+    expecteof "$clixon_util_xpath $o -u -y $ydir -f $xml4 -p c/l[k1=1][k2='b']" 0 "" "^nodeset:0:<l><k1>1</k1><k2>b</k2><v>w</v></l>$"
+
+    new "xpath unsorted list keys first $o"
+    expecteof "$clixon_util_xpath $o -u -y $ydir -f $xml4 -p c/l[k1=3][k2='b']" 0 "" "^nodeset:0:<l><k1>3</k1><k2>b</k2><v>x</v></l>$"
+
+    new "xpath unsorted leaf-list $o"
+    expecteof "$clixon_util_xpath $o -u -y $ydir -f $xml4 -p c/ll[.='foo']" 0 "" "^nodeset:0:<ll>foo</ll>$"
+
+    new "xpath unsorted leaf-list last $o"
+    expecteof "$clixon_util_xpath $o -u -y $ydir -f $xml4 -p c/ll[.='bar']" 0 "" "^nodeset:0:<ll>bar</ll>$"
+done
+
+new "xpath plan key"
+expectpart "$($clixon_util_xpath -e -y $ydir -f $xml4 -p "/c/l[k1=1][k2='b']/v")" 0 "plan: key" "step /l" "key lookup in 1" "nodeset:0:<v>w</v>"
+
+new "xpath plan prefix"
+expectpart "$($clixon_util_xpath -e -y $ydir -f $xml4 -p /c//v)" 0 "plan: prefix" "rest //v" "nodeset:0:<v>y</v>1:<v>w</v>2:<v>x</v>3:<v>z</v>"
+
+new "xpath plan scan"
+expectpart "$($clixon_util_xpath -e -y $ydir -f $xml4 -p //ll)" 0 "plan: scan" "nodeset:0:<ll>bar</ll>1:<ll>foo</ll>"
+
+# Descendant search pruned by yang schema, except below anydata
+cat <<EOF > $ydir/d.yang
+module d{
+  namespace "urn:example:d";
+  prefix d;
+  container d{
+    container e{
+      leaf v{
+        type string;
+      }
+    }
+    list f{
+      key n;
+      leaf n{
+        type string;
+      }
+      anydata g;
+    }
+  }
+}
+EOF
+
+xml5=$dir/xml5.xml
+cat <<EOF > $xml5
+<d xmlns="urn:example:d">
+  <e><v>1</v></e>
+  <f><n>a</n><g><v>2</v></g></f>
+</d>
+EOF
+
+new "xpath descendant schema //v"
+expecteof "$clixon_util_xpath -y $ydir -f $xml5 -p //v" 0 "" "^nodeset:0:<v>1</v>1:<v>2</v>$"
+
+new "xpath descendant schema //n"
+expecteof "$clixon_util_xpath -y $ydir -f $xml5 -p //n" 0 "" "^nodeset:0:<n>a</n>$"
+
+new "xpath descendant schema d/e//n"
+expecteof "$clixon_util_xpath -y $ydir -f $xml5 -p d/e//n" 0 "" "^nodeset:$"
+
+new "xpath descendant schema //w"
+expecteof "$clixon_util_xpath -y $ydir -f $xml5 -p //w" 0 "" "^nodeset:$"
+
+# Names only occurring in anydata content, not in the schema
+xml6=$dir/xml6.xml
+cat <<EOF > $xml6
+<d xmlns="urn:example:d">
+  <e><v>1</v></e>
+  <f><n>a</n><g><k><x>3</x><n>b</n></k></g></f>
+</d>
+EOF
+
+new "xpath descendant schema anydata //x"
+expecteof "$clixon_util_xpath -y $ydir -f $xml6 -p //x" 0 "" "^nodeset:0:<x>3</x>$"
+
+new "xpath descendant schema anydata //n"
+expecteof "$clixon_util_xpath -y $ydir -f $xml6 -p //n" 0 "" "^nodeset:0:<n>a</n>1:<n>b</n>$"
+
+new "xpath descendant schema anydata d/e//x"
+expecteof "$clixon_util_xpath -y $ydir -f $xml6 -p d/e//x" 0 "" "^nodeset:$"
+
+new "xpath descendant schema //x visits less nodes than without pruning"
+ret=$($clixon_util_xpath -y $ydir -f $xml6 -p //x -t 1)
+n1=$(echo "$ret" | sed -n 's/ descendant nodes visited$//p')
+ret=$($clixon_util_xpath -S -y $ydir -f $xml6 -p //x -t 1)
+n2=$(echo "$ret" | sed -n 's/ descendant nodes visited$//p')
+if [ -z "$n1" -o -z "$n2" ]; then
+    err "descendant nodes visited" "$ret"
+fi
+if [ $n1 -ge $n2 ]; then
+    err "less than $n2 nodes visited" "$n1"
+fi
+
 rm -rf $dir
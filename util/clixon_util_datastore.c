@@ -63,7 +63,7 @@
 #include <clixon/clixon.h>
 
 /* Command line options to be passed to getopt(3) */
-#define DATASTORE_OPTS "hDd:b:f:x:y:"
+#define DATASTORE_OPTS "hDd:b:f:lx:y:"
 
 /*! usage
  */
@@ -76,13 +76,16 @@ usage(char *argv0)
 		"\t-D\t\tDebug\n"
 		"\t-d <db>\t\tDatabase name. Default: running. Alt: candidate,startup\n"
 		"\t-b <dir>\tDatabase directory. Mandatory\n"
-	        "\t-f <fmt>\tDatabase format: xml, json, tree\n"
+	        "\t-f <fmt>\tDatabase format: xml, json, tree, journal\n"
+		"\t-l\t\tLazy loading of tree format\n"
 		"\t-x <xml>\tXML file. Alternative to put <xml> argument\n"
 		"\t-y <file>\tYang file. Mandatory\n"
 		"and command is either:\n"
 		"\tget [<xpath>]\n"
  	        "\tmget <nr> [<xpath>]\n"
 		"\tput (merge|replace|create|delete|remove) [<xml>]\n"
+		"\tbench <nr> <xml>\tTime load and <nr> merges of <xml>, %%d is replaced\n"
+		"\t\t\twith iteration nr\n"
 		"\tcopy <todb>\n"
 		"\tlock <pid>\n"
 		"\tunlock\n"
@@ -91,6 +94,7 @@ usage(char *argv0)
 		"\texists\n"
 		"\tdelete\n"
 		"\tinit\n"
+		"\tresident [<xpath>]\tGet and print nr of blocks read from tree file\n"
 		,
 		argv0
 		);
@@ -150,6 +154,9 @@ main(int argc, char **argv)
 	        usage(argv0);
 	    clicon_option_str_set(h, "CLICON_XMLDB_FORMAT", optarg);
 	    break;
+	case 'l': /* lazy loading of tree format */
+	    clicon_option_str_set(h, "CLICON_XMLDB_LAZY", "true");
+	    break;
 	case 'x': /* XML file */
 	    if (!optarg)
 	        usage(argv0);
@@ -268,6 +275,48 @@ main(int argc, char **argv)
 	if (xmldb_put(h, db, op, xt, NULL, cbret) < 1)
 	    goto done;
     }
+    else if (strcmp(cmd, "bench")==0){
+	int            nr;
+	struct timeval t0;
+	struct timeval t1;
+	struct timeval td;
+	cbuf          *cb;
+
+	if (argc != 3)
+	    usage(argv0);
+	nr = atoi(argv[1]);
+	if ((cbret = cbuf_new()) == NULL || (cb = cbuf_new()) == NULL){
+	    clicon_err(OE_UNIX, errno, "cbuf_new");
+	    goto done;
+	}
+	/* Load: read datastore file into cache */
+	gettimeofday(&t0, NULL);
+	if (xmldb_get(h, db, "/", &xt) < 0)
+	    goto done;
+	gettimeofday(&t1, NULL);
+	timersub(&t1, &t0, &td);
+	fprintf(stdout, "load: %lu.%06lu s\n", (unsigned long)td.tv_sec, (unsigned long)td.tv_usec);
+	xml_free(xt);
+	xt = NULL;
+	/* Write: merge small edits, each written to file */
+	gettimeofday(&t0, NULL);
+	for (i=0; i<nr; i++){
+	    cbuf_reset(cb);
+	    cprintf(cb, argv[2], i);
+	    if (xml_parse_string(cbuf_get(cb), yspec, &xt) < 0)
+		goto done;
+	    if (xml_rootchild(xt, 0, &xt) < 0)
+		goto done;
+	    if (xmldb_put(h, db, OP_MERGE, xt, NULL, cbret) < 1)
+		goto done;
+	    xml_free(xt);
+	    xt = NULL;
+	}
+	gettimeofday(&t1, NULL);
+	timersub(&t1, &t0, &td);
+	fprintf(stdout, "put: %lu.%06lu s (%d)\n", (unsigned long)td.tv_sec, (unsigned long)td.tv_usec, nr);
+	cbuf_free(cb);
+    }
     else if (strcmp(cmd, "copy")==0){
 	if (argc != 2)
 	    usage(argv0);
@@ -314,6 +363,18 @@ main(int argc, char **argv)
 	if (xmldb_delete(h, db) < 0)
 	    goto done;
     }
+    else if (strcmp(cmd, "resident")==0){
+	uint32_t resident = 0;
+	uint32_t total = 0;
+
+	if (argc != 1 && argc != 2)
+	    usage(argv0);
+	if (xmldb_get(h, db, argc==2?argv[1]:"/", &xt) < 0)
+	    goto done;
+	if ((ret = xmldb_resident(h, db, &resident, &total)) < 0)
+	    goto done;
+	fprintf(stdout, "resident: %u/%u\n", resident, total);
+    }
     else if (strcmp(cmd, "init")==0){
 	if (argc != 1)
 	    usage(argv0);
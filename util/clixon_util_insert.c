@@ -48,6 +48,7 @@
 #include <assert.h>
 #include <syslog.h>
 #include <fcntl.h>
+#include <sys/time.h>
 
 /* cligen */
 #include <cligen/cligen.h>
@@ -67,12 +68,83 @@ usage(char *argv0)
 	    "\t-x <xml>  \tXML to insert\n"
 	    "\t-p <xpath>\tXpath to where in base and XML\n"
 	    "\t-s        \tSort output after insert\n"
+	    "\t-n <nr>   \tBenchmark: insert <nr> copies of list entry with random keys\n"
 	    "Assume insert xml is first child of xpath. Ie if xml=<a><x>23 and xpath=a, then inserted element is <x>23\n",
 	    argv0
 	    );
     exit(0);
 }
 
+/*! Insert copies of a list entry with keys 0..nr-1 in random order
+ * The first key of the entry is replaced by the random key value.
+ * @param[in]  xb   Parent
+ * @param[in]  xi   List entry template, not inserted
+ * @param[in]  nr   Number of entries to insert
+ */
+static int
+insert_bench(cxobj *xb,
+	     cxobj *xi,
+	     int    nr)
+{
+    int            retval = -1;
+    yang_stmt     *y;
+    char          *keyname;
+    int           *keys = NULL;
+    int            i;
+    int            j;
+    int            tmp;
+    cxobj         *xc;
+    cxobj         *xk;
+    char           keystr[16];
+    struct timeval t0;
+    struct timeval t1;
+
+    if ((y = xml_spec(xi)) == NULL || yang_keyword_get(y) != Y_LIST ||
+	cvec_len(yang_cvec_get(y)) == 0){
+	clicon_err(OE_XML, 0, "Insert xml is not a keyed list entry");
+	goto done;
+    }
+    keyname = cv_string_get(cvec_i(yang_cvec_get(y), 0));
+    if ((keys = calloc(nr, sizeof(*keys))) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	goto done;
+    }
+    for (i=0; i<nr; i++)
+	keys[i] = i;
+    for (i=nr-1; i>0; i--){ /* Shuffle */
+	j = random() % (i+1);
+	tmp = keys[i];
+	keys[i] = keys[j];
+	keys[j] = tmp;
+    }
+    gettimeofday(&t0, NULL);
+    for (i=0; i<nr; i++){
+	if ((xc = xml_dup(xi)) == NULL)
+	    goto done;
+	if ((xk = xml_find(xc, keyname)) == NULL ||
+	    (xk = xml_find_type(xk, NULL, "body", CX_BODY)) == NULL){
+	    clicon_err(OE_XML, 0, "Insert xml has no key %s", keyname);
+	    xml_free(xc);
+	    goto done;
+	}
+	snprintf(keystr, sizeof(keystr), "%d", keys[i]);
+	if (xml_value_set(xk, keystr) < 0){
+	    xml_free(xc);
+	    goto done;
+	}
+	if (xml_insert(xb, xc, INS_LAST, NULL, NULL) < 0)
+	    goto done;
+    }
+    gettimeofday(&t1, NULL);
+    timersub(&t1, &t0, &t1);
+    fprintf(stdout, "%d inserts: %lu.%06lu s\n", nr, t1.tv_sec, t1.tv_usec);
+    retval = 0;
+ done:
+    if (keys)
+	free(keys);
+    return retval;
+}
+
 int
 main(int argc, char **argv)
 {
@@ -89,6 +161,7 @@ main(int argc, char **argv)
     cxobj      *xb;
     cxobj      *xi = NULL;
     int         sort = 0;
+    int         nr = 0;
     clicon_handle h;
     
     clicon_log_init("clixon_insert", LOG_DEBUG, CLICON_LOG_STDERR); 
@@ -96,7 +169,7 @@ main(int argc, char **argv)
 	goto done;
     optind = 1;
     opterr = 0;
-    while ((c = getopt(argc, argv, "hD:y:b:x:p:s")) != -1)
+    while ((c = getopt(argc, argv, "hD:y:b:x:p:sn:")) != -1)
 	switch (c) {
 	case 'h':
 	    usage(argv0);
@@ -124,6 +197,9 @@ main(int argc, char **argv)
 	case 's': /* sort output after insert */
 	    sort++;
 	    break;
+	case 'n': /* Benchmark: number of entries to insert */
+	    nr = atoi(optarg);
+	    break;
 	default:
 	    usage(argv[0]);
 	    break;
@@ -184,6 +260,11 @@ main(int argc, char **argv)
 	clicon_debug(1, "xi:");
 	xml_print(stderr, xi);
     }
+    if (nr){
+	retval = insert_bench(xb, xi, nr);
+	xml_free(xi);
+	goto done;
+    }
     if (xml_insert(xb, xi, INS_LAST, NULL, NULL) < 0) 
 	goto done;
     if (debug){
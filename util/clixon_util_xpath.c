@@ -47,10 +47,12 @@ See https://www.w3.org/TR/xpath/
 #include <string.h>
 #include <limits.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <assert.h>
 #include <syslog.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 
 /* cligen */
 #include <cligen/cligen.h>
@@ -72,6 +74,12 @@ usage(char *argv0)
 	    "\t-c \t\tMap xpath to canonical form\n"
 	    "\t-y <filename> \tYang filename or dir (load all files)\n"
     	    "\t-Y <dir> \tYang dirs (can be several)\n"
+	    "\t-t <nr> \tBenchmark: evaluate xpath <nr> times and print time instead of result\n"
+	    "\t-o \t\tDisable xpath list key optimization\n"
+	    "\t-A \t\tDisable xpath evaluation arena\n"
+	    "\t-S \t\tDisable yang schema pruning of descendant search\n"
+	    "\t-u \t\tUnsorted: bind XML to yang but do not sort or validate it\n"
+	    "\t-e \t\tExplain: print query plan before result (absolute paths)\n"
 	    "and the following extra rules:\n"
 	    "\tif -f is not given, XML input is expected on stdin\n"
 	    "\tif -p is not given, <xpath> is expected as the first line on stdin\n"
@@ -134,6 +142,16 @@ main(int    argc,
     struct stat st;
     cvec       *nsc = NULL;
     int         canonical = 0;
+    int         nr = 0;
+    struct timeval t0;
+    struct timeval t1;
+    uint64_t       nalloc0 = 0;
+    uint64_t       nalloc1 = 0;
+    uint64_t       nvisit0 = 0;
+    uint64_t       nvisit1 = 0;
+    int            explain = 0;
+    int            unsorted = 0;
+    size_t         xlen = 0;
 
     clicon_log_init("xpath", LOG_DEBUG, CLICON_LOG_STDERR); 
 
@@ -142,7 +160,7 @@ main(int    argc,
 
     optind = 1;
     opterr = 0;
-    while ((c = getopt(argc, argv, "hD:f:p:i:n:cy:Y:")) != -1)
+    while ((c = getopt(argc, argv, "hD:f:p:i:n:cy:Y:t:oASue")) != -1)
 	switch (c) {
 	case 'h':
 	    usage(argv0);
@@ -194,6 +212,24 @@ main(int    argc,
 	    if (clicon_option_add(h, "CLICON_YANG_DIR", optarg) < 0)
 		goto done;
 	    break;
+	case 't': /* Benchmark: number of evaluations */
+	    nr = atoi(optarg);
+	    break;
+	case 'o': /* Disable list key optimization */
+	    xpath_list_optimize_set(0);
+	    break;
+	case 'A': /* Disable evaluation arena */
+	    ctx_arena_set(0);
+	    break;
+	case 'S': /* Disable schema pruning of descendant search */
+	    xpath_descendant_schema_set(0);
+	    break;
+	case 'u': /* Unsorted XML */
+	    unsorted++;
+	    break;
+	case 'e': /* Explain query plan */
+	    explain++;
+	    break;
 	default:
 	    usage(argv[0]);
 	    break;
@@ -273,8 +309,12 @@ main(int    argc,
 	return -1;
     }
 
+    /* Only bind XML to yang, eg to test xpath on unsorted trees */
+    if (yang_file_dir && unsorted &&
+	xml_apply0(xml_child_i(x0, 0), CX_ELMNT, xml_spec_populate, yspec) < 0)
+	goto done;
     /* Validate XML as well */
-    if (yang_file_dir){
+    if (yang_file_dir && !unsorted){
 	cbuf  *cbret = NULL;
 	cxobj *x1;
 	cxobj *xerr = NULL; /* malloced must be freed */
@@ -317,6 +357,39 @@ main(int    argc,
     else
 	x = x0;
 
+    if (nr){ /* Benchmark */
+	ctx_stats(&nalloc0);
+	xpath_descendant_stats(&nvisit0);
+	gettimeofday(&t0, NULL);
+	for (i=0; i<nr; i++){
+	    if (xc)
+		ctx_free(xc);
+	    xc = NULL;
+	    if (xpath_vec_ctx(x, nsc, xpath, &xc) < 0)
+		goto done;
+	}
+	gettimeofday(&t1, NULL);
+	timersub(&t1, &t0, &t1);
+	ctx_stats(&nalloc1);
+	xpath_descendant_stats(&nvisit1);
+	fprintf(stdout, "%d evaluations, %zu nodes: %lu.%06lu s\n", nr,
+		xc->xc_type==XT_NODESET?xc->xc_size:0, t1.tv_sec, t1.tv_usec);
+	fprintf(stdout, "%" PRIu64 " context allocations\n", nalloc1 - nalloc0);
+	fprintf(stdout, "%" PRIu64 " descendant nodes visited\n", nvisit1 - nvisit0);
+	goto ok;
+    }
+    if (explain){ /* Query plan and resulting nodeset */
+	cb = cbuf_new();
+	if (xpath_vec_plan(x, nsc, xpath, &xv, &xlen, cb) < 0)
+	    goto done;
+	cprintf(cb, "nodeset:");
+	for (i=0; i<xlen; i++){
+	    cprintf(cb, "%d:", i);
+	    clicon_xml2cbuf(cb, xv[i], 0, 0, -1);
+	}
+	fprintf(stdout, "%s\n", cbuf_get(cb));
+	goto ok;
+    }
     /* Parse XPATH (use nsc == NULL to indicate dont use) */
     if (xpath_vec_ctx(x, nsc, xpath, &xc) < 0)
 	return -1;